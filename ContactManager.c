@@ -1,773 +1,1754 @@
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#include <commctrl.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <ctype.h>
-
-#pragma comment(lib, "Comctl32.lib")
-
-// ------------------------------------------
-//               Data Structures
-// ------------------------------------------
-typedef struct {
-    char name[100];
-    char phone[30];
-    char email[100];
-    char date[11]; // Expected format: "YYYY-MM-DD" or empty
-} Contact;
-
-// ------------------------------------------
-//              Global Definitions
-// ------------------------------------------
-#define MAX_CONTACTS 1000
-
-// RSA keys (small and insecure, for demonstration only)
-static const int RSA_n = 3233;   // Example modulus (61*53)
-static const int RSA_e = 17;     // Public exponent
-static const int RSA_d = 2753;   // Private exponent
-
-// Menu and Control IDs
-enum {
-    IDM_ADD = 1,
-    IDM_EDIT,
-    IDM_DELETE,
-    IDM_SAVE,
-    IDM_LOAD,
-    IDM_SORT_NAME,
-    IDM_SORT_PHONE,
-    IDM_EXIT
-};
-
-#define IDC_MAIN_LISTVIEW  100
-#define IDC_SEARCH_LABEL   110
-#define IDC_SEARCH_EDIT    111
-#define IDC_SEARCH_BUTTON  112
-#define IDC_CLEAR_BUTTON   113
-#define IDD_ADD_DIALOG     101
-
-// ------------------------------------------
-//              Global Variables
-// ------------------------------------------
-
-// Global array of contacts
-static Contact g_contacts[MAX_CONTACTS];
-static int g_contactCount = 0;     // Current count of contacts
-
-static HWND g_hMainWnd = NULL;     // Handle to the main window
-static HWND g_hListView = NULL;    // Handle to the ListView control
-
-// If g_editIndex is -1, we are adding a new contact.
-// Otherwise, we are editing the contact at g_editIndex.
-static int g_editIndex = -1;
-
-// Forward declarations of functions
-LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
-INT_PTR CALLBACK ContactDlgProc(HWND, UINT, WPARAM, LPARAM);
-
-void InitializeListViewColumns(HWND hListView);
-void DisplayContacts(HWND hListView, const char *filter);
-void ShowAddContactDialog(HWND hwnd);
-void ShowEditContactDialog(HWND hwnd, int index);
-void AddNewContact(const char *name, const char *phone, const char *email, const char *date);
-void UpdateExistingContact(int index, const char *name, const char *phone, const char *email, const char *date);
-void DeleteSelectedContact(HWND hListView);
-void SaveContactsRSA(const char *filename);
-void LoadContactsRSA(const char *filename);
-
-int  ValidateName(const char *name);
-int  ValidatePhone(const char *phone);
-int  ValidateEmail(const char *email);
-
-void SortContactsByName();
-void SortContactsByPhone();
-int  CompareContactsByName(const void *a, const void *b);
-int  CompareContactsByPhone(const void *a, const void *b);
-
-void ShowError(const char *msg);
-void ShowInfo(const char *msg);
-void PerformSearch();
-void ClearSearchFilter();
-
-// RSA and modular exponentiation
-int RSA_EncryptChar(int m);
-int RSA_DecryptChar(int c);
-int modExp(int base, int exp, int mod);
-
-// ------------------------------------------
-//                 WinMain
-// ------------------------------------------
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
-    // Initialize common controls for ListView support
-    INITCOMMONCONTROLSEX icex = { sizeof(INITCOMMONCONTROLSEX), ICC_LISTVIEW_CLASSES };
-    InitCommonControlsEx(&icex);
-
-    // Set up and register the main window class
-    WNDCLASS wc = {0};
-    wc.style = CS_HREDRAW | CS_VREDRAW;
-    wc.lpfnWndProc = WndProc;                // Our window procedure
-    wc.hInstance = hInstance;
-    wc.lpszClassName = "ContactManagerClass";
-    wc.hbrBackground = (HBRUSH)(COLOR_WINDOW+1);
-    wc.hCursor = LoadCursor(NULL, IDC_ARROW);
-
-    if (!RegisterClass(&wc)) {
-        MessageBox(NULL, "Window Registration Failed!", "Error", MB_ICONERROR);
-        return 0;
-    }
-
-    // Create the main application window
-    g_hMainWnd = CreateWindow("ContactManagerClass", "Contact Management System",
-                              WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT,
-                              700, 500, NULL, NULL, hInstance, NULL);
-
-    if (!g_hMainWnd) {
-        MessageBox(NULL, "Window Creation Failed!", "Error", MB_ICONERROR);
-        return 0;
-    }
-
-    // Show and update the main window
-    ShowWindow(g_hMainWnd, nCmdShow);
-    UpdateWindow(g_hMainWnd);
-
-    // Main message loop for the application
-    MSG msg;
-    while (GetMessage(&msg, NULL, 0,0)) {
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
-    }
-    return (int)msg.wParam;
-}
-
-// ------------------------------------------
-//               Window Procedure
-// ------------------------------------------
-LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    static HMENU hMenu;
-    switch(msg) {
-        case WM_CREATE: {
-            // Create and set up the menu
-            hMenu = CreateMenu();
-            if (!hMenu) {
-                ShowError("Failed to create menu.");
-                PostQuitMessage(1);
-                break;
-            }
-
-            // File menu with various contact operations
-            HMENU hFileMenu = CreatePopupMenu();
-            AppendMenu(hFileMenu, MF_STRING, IDM_ADD,         "Add Contact");
-            AppendMenu(hFileMenu, MF_STRING, IDM_EDIT,        "Edit Contact");
-            AppendMenu(hFileMenu, MF_STRING, IDM_DELETE,      "Delete Contact");
-            AppendMenu(hFileMenu, MF_STRING, IDM_SORT_NAME,   "Sort by Name");
-            AppendMenu(hFileMenu, MF_STRING, IDM_SORT_PHONE,  "Sort by Phone");
-            AppendMenu(hFileMenu, MF_STRING, IDM_SAVE,        "Save (RSA Encrypted)");
-            AppendMenu(hFileMenu, MF_STRING, IDM_LOAD,        "Load (RSA Decrypted)");
-            AppendMenu(hFileMenu, MF_STRING, IDM_EXIT,        "Exit");
-            AppendMenu(hMenu, MF_STRING | MF_POPUP, (UINT_PTR)hFileMenu, "Menu");
-            SetMenu(hwnd, hMenu);
-
-            // Create UI elements for searching contacts by name
-            CreateWindow("STATIC", "Search by name:",
-                         WS_CHILD | WS_VISIBLE,
-                         10, 10, 100, 20,
-                         hwnd, (HMENU)IDC_SEARCH_LABEL,
-                         GetModuleHandle(NULL), NULL);
-
-            CreateWindow("EDIT", "",
-                         WS_CHILD | WS_VISIBLE | WS_BORDER,
-                         120, 10, 200, 20,
-                         hwnd, (HMENU)IDC_SEARCH_EDIT,
-                         GetModuleHandle(NULL), NULL);
-
-            CreateWindow("BUTTON", "Go",
-                         WS_CHILD | WS_VISIBLE,
-                         330, 10, 40, 20,
-                         hwnd, (HMENU)IDC_SEARCH_BUTTON,
-                         GetModuleHandle(NULL), NULL);
-
-            CreateWindow("BUTTON", "Clear",
-                         WS_CHILD | WS_VISIBLE,
-                         380, 10, 50, 20,
-                         hwnd, (HMENU)IDC_CLEAR_BUTTON,
-                         GetModuleHandle(NULL), NULL);
-
-            // Create the ListView control to display contacts
-            g_hListView = CreateWindow(WC_LISTVIEW, "",
-                                       WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_SINGLESEL,
-                                       10, 40, 660, 400,
-                                       hwnd, (HMENU)IDC_MAIN_LISTVIEW, 
-                                       GetModuleHandle(NULL), NULL);
-            if (!g_hListView) {
-                ShowError("Failed to create ListView.");
-                PostQuitMessage(1);
-                break;
-            }
-
-            // Initialize the columns in the ListView
-            InitializeListViewColumns(g_hListView);
-            break;
-        }
-
-        case WM_SIZE: {
-            // Adjust the ListView size when the main window is resized
-            int width = LOWORD(lParam);
-            int height = HIWORD(lParam);
-            MoveWindow(g_hListView, 10, 40, width - 20, height - 50, TRUE);
-            break;
-        }
-
-        case WM_COMMAND: {
-            // Handle menu and button commands
-            switch(LOWORD(wParam)) {
-                case IDM_ADD:
-                    // Show dialog to add a new contact
-                    g_editIndex = -1;
-                    ShowAddContactDialog(hwnd);
-                    break;
-                case IDM_EDIT: {
-                    // Show dialog to edit the currently selected contact
-                    int selected = ListView_GetNextItem(g_hListView, -1, LVNI_SELECTED);
-                    if (selected == -1) {
-                        ShowInfo("No contact selected to edit.");
-                    } else {
-                        g_editIndex = selected;
-                        ShowEditContactDialog(hwnd, selected);
-                    }
-                    break;
-                }
-                case IDM_DELETE:
-                    // Delete the currently selected contact
-                    if (g_contactCount == 0) {
-                        ShowInfo("No contacts to delete.");
-                    } else {
-                        DeleteSelectedContact(g_hListView);
-                    }
-                    break;
-                case IDM_SAVE:
-                    // Save all contacts to file (RSA encrypted)
-                    if (g_contactCount == 0) {
-                        ShowInfo("No contacts to save.");
-                    } else {
-                        SaveContactsRSA("contacts.txt");
-                    }
-                    break;
-                case IDM_LOAD:
-                    // Load contacts from file (RSA decrypted)
-                    LoadContactsRSA("contacts.txt");
-                    DisplayContacts(g_hListView, NULL);
-                    break;
-                case IDM_SORT_NAME:
-                    // Sort contacts by name
-                    if (g_contactCount > 1) {
-                        SortContactsByName();
-                        DisplayContacts(g_hListView, NULL);
-                    } else {
-                        ShowInfo("Not enough contacts to sort.");
-                    }
-                    break;
-                case IDM_SORT_PHONE:
-                    // Sort contacts by phone
-                    if (g_contactCount > 1) {
-                        SortContactsByPhone();
-                        DisplayContacts(g_hListView, NULL);
-                    } else {
-                        ShowInfo("Not enough contacts to sort.");
-                    }
-                    break;
-                case IDM_EXIT:
-                    // Exit the application
-                    PostQuitMessage(0);
-                    break;
-                case IDC_SEARCH_BUTTON:
-                    // Perform a search by name substring
-                    PerformSearch();
-                    break;
-                case IDC_CLEAR_BUTTON:
-                    // Clear the search filter and show all contacts
-                    ClearSearchFilter();
-                    break;
-            }
-            break;
-        }
-
-        case WM_DESTROY:
-            // Window destroyed, quit the application
-            PostQuitMessage(0);
-            break;
-    }
-    return DefWindowProc(hwnd, msg, wParam, lParam);
-}
-
-// ------------------------------------------
-//   Initialize the columns of the ListView
-// ------------------------------------------
-void InitializeListViewColumns(HWND hListView) {
-    LVCOLUMN columnInfo;
-    ZeroMemory(&columnInfo, sizeof(columnInfo));
-    columnInfo.mask = LVCF_TEXT | LVCF_WIDTH | LVCF_SUBITEM;
-
-    columnInfo.pszText = "Name";
-    columnInfo.cx = 150;
-    ListView_InsertColumn(hListView, 0, &columnInfo);
-
-    columnInfo.pszText = "Phone";
-    columnInfo.cx = 100;
-    ListView_InsertColumn(hListView, 1, &columnInfo);
-
-    columnInfo.pszText = "Email";
-    columnInfo.cx = 200;
-    ListView_InsertColumn(hListView, 2, &columnInfo);
-
-    columnInfo.pszText = "Date";
-    columnInfo.cx = 100;
-    ListView_InsertColumn(hListView, 3, &columnInfo);
-}
-
-// ------------------------------------------
-// Display all contacts in the ListView
-// If 'filter' is provided and not empty, only display contacts whose names contain the filter string.
-// ------------------------------------------
-void DisplayContacts(HWND hListView, const char *filter) {
-    ListView_DeleteAllItems(hListView);
-
-    LVITEM itemInfo;
-    ZeroMemory(&itemInfo, sizeof(itemInfo));
-    itemInfo.mask = LVIF_TEXT;
-
-    for (int i = 0; i < g_contactCount; i++) {
-        // Apply the filter if provided
-        if (filter && filter[0] != '\0') {
-            if (strstr(g_contacts[i].name, filter) == NULL) {
-                continue;
-            }
-        }
-
-        // Insert the contact into the ListView
-        itemInfo.iItem = ListView_GetItemCount(hListView);
-        itemInfo.iSubItem = 0;
-        itemInfo.pszText = g_contacts[i].name;
-        int insertedIndex = ListView_InsertItem(hListView, &itemInfo);
-
-        ListView_SetItemText(hListView, insertedIndex, 1, g_contacts[i].phone);
-        ListView_SetItemText(hListView, insertedIndex, 2, g_contacts[i].email);
-        ListView_SetItemText(hListView, insertedIndex, 3, g_contacts[i].date);
-    }
-}
-
-// ------------------------------------------
-// Show the dialog for adding a new contact
-// ------------------------------------------
-void ShowAddContactDialog(HWND hwnd) {
-    g_editIndex = -1;
-    DialogBox(GetModuleHandle(NULL), MAKEINTRESOURCE(IDD_ADD_DIALOG), hwnd, ContactDlgProc);
-}
-
-// ------------------------------------------
-// Show the dialog for editing an existing contact
-// ------------------------------------------
-void ShowEditContactDialog(HWND hwnd, int index) {
-    DialogBox(GetModuleHandle(NULL), MAKEINTRESOURCE(IDD_ADD_DIALOG), hwnd, ContactDlgProc);
-}
-
-// ------------------------------------------
-// Dialog procedure for the Add/Edit Contact dialog
-// Handles input validation and updates global contact array
-// ------------------------------------------
-INT_PTR CALLBACK ContactDlgProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam) {
-    static char nameBuffer[100], phoneBuffer[30], emailBuffer[100], dateBuffer[11];
-
-    switch(message) {
-        case WM_INITDIALOG:
-            // If editing, populate the fields with existing data
-            if (g_editIndex != -1) {
-                SetDlgItemText(hDlg, 1001, g_contacts[g_editIndex].name);
-                SetDlgItemText(hDlg, 1002, g_contacts[g_editIndex].phone);
-                SetDlgItemText(hDlg, 1003, g_contacts[g_editIndex].email);
-                SetDlgItemText(hDlg, 1004, g_contacts[g_editIndex].date);
-            } else {
-                // If adding, clear the fields
-                SetDlgItemText(hDlg, 1001, "");
-                SetDlgItemText(hDlg, 1002, "");
-                SetDlgItemText(hDlg, 1003, "");
-                SetDlgItemText(hDlg, 1004, "");
-            }
-            return (INT_PTR)TRUE;
-
-        case WM_COMMAND:
-            if (LOWORD(wParam) == IDOK) {
-                // User clicked OK, retrieve data
-                GetDlgItemText(hDlg, 1001, nameBuffer, 100);
-                GetDlgItemText(hDlg, 1002, phoneBuffer, 30);
-                GetDlgItemText(hDlg, 1003, emailBuffer, 100);
-                GetDlgItemText(hDlg, 1004, dateBuffer, 11);
-
-                // Trim trailing whitespace from all fields
-                for (int i=(int)strlen(nameBuffer)-1; i>=0 && isspace((unsigned char)nameBuffer[i]); i--) nameBuffer[i]=0;
-                for (int i=(int)strlen(phoneBuffer)-1; i>=0 && isspace((unsigned char)phoneBuffer[i]); i--) phoneBuffer[i]=0;
-                for (int i=(int)strlen(emailBuffer)-1; i>=0 && isspace((unsigned char)emailBuffer[i]); i--) emailBuffer[i]=0;
-                for (int i=(int)strlen(dateBuffer)-1; i>=0 && isspace((unsigned char)dateBuffer[i]); i--) dateBuffer[i]=0;
-
-                // Validate inputs
-                if (!ValidateName(nameBuffer)) {
-                    MessageBox(hDlg, "Invalid name! Must not be empty.", "Error", MB_OK|MB_ICONERROR);
-                    return (INT_PTR)TRUE;
-                }
-                if (!ValidatePhone(phoneBuffer)) {
-                    MessageBox(hDlg, "Invalid phone! Must be digits, '+' and '-' only and follow basic rules.", "Error", MB_OK|MB_ICONERROR);
-                    return (INT_PTR)TRUE;
-                }
-                if (!ValidateEmail(emailBuffer)) {
-                    MessageBox(hDlg, "Invalid email! Must contain '@' if not empty.", "Error", MB_OK|MB_ICONERROR);
-                    return (INT_PTR)TRUE;
-                }
-
-                // If all good, add or update the contact
-                if (g_editIndex == -1) {
-                    // Add a new contact
-                    AddNewContact(nameBuffer, phoneBuffer, emailBuffer, dateBuffer);
-                } else {
-                    // Update existing contact
-                    UpdateExistingContact(g_editIndex, nameBuffer, phoneBuffer, emailBuffer, dateBuffer);
-                }
-
-                DisplayContacts(g_hListView, NULL);
-                EndDialog(hDlg, IDOK);
-            } else if (LOWORD(wParam) == IDCANCEL) {
-                // User clicked cancel
-                EndDialog(hDlg, IDCANCEL);
-            }
-            return (INT_PTR)TRUE;
-    }
-    return (INT_PTR)FALSE;
-}
-
-// ------------------------------------------
-// Add a new contact to the global array
-// ------------------------------------------
-void AddNewContact(const char *name, const char *phone, const char *email, const char *date) {
-    if (g_contactCount >= MAX_CONTACTS) {
-        ShowError("Contact list is full!");
-        return;
-    }
-
-    Contact newContact;
-    strncpy(newContact.name,  name,  100); newContact.name[99] = '\0';
-    strncpy(newContact.phone, phone, 30);  newContact.phone[29] = '\0';
-    strncpy(newContact.email, email, 100); newContact.email[99] = '\0';
-    strncpy(newContact.date,  date,  11);  newContact.date[10] = '\0';
-
-    g_contacts[g_contactCount++] = newContact;
-}
-
-// ------------------------------------------
-// Update an existing contact at the specified index
-// ------------------------------------------
-void UpdateExistingContact(int index, const char *name, const char *phone, const char *email, const char *date) {
-    if (index < 0 || index >= g_contactCount) return;
-
-    strncpy(g_contacts[index].name,  name,  100); g_contacts[index].name[99] = '\0';
-    strncpy(g_contacts[index].phone, phone, 30);  g_contacts[index].phone[29] = '\0';
-    strncpy(g_contacts[index].email, email, 100); g_contacts[index].email[99] = '\0';
-    strncpy(g_contacts[index].date,  date,  11);  g_contacts[index].date[10] = '\0';
-}
-
-// ------------------------------------------
-// Delete the currently selected contact
-// ------------------------------------------
-void DeleteSelectedContact(HWND hListView) {
-    int selected = ListView_GetNextItem(hListView, -1, LVNI_SELECTED);
-    if (selected == -1) {
-        ShowInfo("No contact selected!");
-        return;
-    }
-
-    int response = MessageBox(g_hMainWnd, "Are you sure you want to delete this contact?", "Confirm", MB_YESNO|MB_ICONQUESTION);
-    if (response == IDYES) {
-        // Shift all contacts after the deleted one forward
-        for (int i = selected; i < g_contactCount - 1; i++) {
-            g_contacts[i] = g_contacts[i+1];
-        }
-        g_contactCount--;
-        DisplayContacts(hListView, NULL);
-    }
-}
-
-// ------------------------------------------
-// Save all contacts to a file, RSA encrypted
-// ------------------------------------------
-void SaveContactsRSA(const char *filename) {
-    // Serialize all contacts into a pipe-delimited text
-    char buffer[100000];
-    buffer[0] = '\0';
-
-    for (int i = 0; i < g_contactCount; i++) {
-        char line[512];
-        // Format: Name|Phone|Email|Date\n
-        snprintf(line, sizeof(line), "%s|%s|%s|%s\n",
-                 g_contacts[i].name, g_contacts[i].phone, g_contacts[i].email, g_contacts[i].date);
-
-        if (strlen(buffer) + strlen(line) < sizeof(buffer)) {
-            strcat(buffer, line);
-        } else {
-            ShowError("Contact data too large to save!");
-            return;
-        }
-    }
-
-    FILE *f = fopen(filename, "wb");
-    if (!f) {
-        ShowError("Failed to open file for writing.");
-        return;
-    }
-
-    // Encrypt each character using RSA and write the integer value to the file
-    for (size_t i = 0; i < strlen(buffer); i++) {
-        int c = (unsigned char)buffer[i];
-        int enc = RSA_EncryptChar(c);
-        if (fwrite(&enc, sizeof(enc), 1, f) != 1) {
-            ShowError("File write error.");
-            fclose(f);
-            return;
-        }
-    }
-    fclose(f);
-    ShowInfo("Contacts saved (RSA encrypted) to contacts.txt!");
-}
-
-// ------------------------------------------
-// Load contacts from file, RSA decrypted
-// ------------------------------------------
-void LoadContactsRSA(const char *filename) {
-    FILE *f = fopen(filename, "rb");
-    if (!f) {
-        ShowInfo("No file found to load.");
-        return;
-    }
-
-    // Read and decrypt the contents of the file
-    int enc;
-    char buffer[100000];
-    int pos = 0;
-    while (fread(&enc, sizeof(enc), 1, f) == 1) {
-        int dec = RSA_DecryptChar(enc);
-        if (pos < (int)sizeof(buffer)-1) {
-            buffer[pos++] = (char)dec;
-        } else {
-            ShowError("Buffer overflow while loading data!");
-            fclose(f);
-            return;
-        }
-    }
-    buffer[pos] = '\0';
-    fclose(f);
-
-    // Parse the decrypted data
-    Contact tempContacts[MAX_CONTACTS];
-    int tempCount = 0;
-
-    char *lineContext = NULL;
-    char *contactLine = strtok_r(buffer, "\n", &lineContext);
-
-    while (contactLine) {
-        char *tokenContext = NULL;
-        // Fields: Name|Phone|Email|Date
-        char *tokenName  = strtok_r(contactLine, "|", &tokenContext);
-        char *tokenPhone = strtok_r(NULL, "|", &tokenContext);
-        char *tokenEmail = strtok_r(NULL, "|", &tokenContext);
-        char *tokenDate  = strtok_r(NULL, "|", &tokenContext);
-
-        // Only add if we have a valid name
-        if (tokenName && tokenName[0] != '\0') {
-            Contact c;
-            strncpy(c.name, tokenName, 100); c.name[99] = '\0';
-
-            if (tokenPhone && tokenPhone[0] != '\0') {
-                strncpy(c.phone, tokenPhone, 30);
-            } else {
-                c.phone[0] = '\0';
-            }
-            c.phone[29] = '\0';
-
-            if (tokenEmail && tokenEmail[0] != '\0') {
-                strncpy(c.email, tokenEmail, 100);
-            } else {
-                c.email[0] = '\0';
-            }
-            c.email[99] = '\0';
-
-            if (tokenDate && tokenDate[0] != '\0') {
-                strncpy(c.date, tokenDate, 11);
-            } else {
-                c.date[0] = '\0';
-            }
-            c.date[10] = '\0';
-
-            if (tempCount < MAX_CONTACTS) {
-                tempContacts[tempCount++] = c;
-            } else {
-                ShowError("Too many contacts loaded!");
-                break;
-            }
-        }
-
-        contactLine = strtok_r(NULL, "\n", &lineContext);
-    }
-
-    // If we loaded any contacts successfully, replace the current list
-    if (tempCount > 0) {
-        g_contactCount = tempCount;
-        for (int i = 0; i < tempCount; i++) {
-            g_contacts[i] = tempContacts[i];
-        }
-        ShowInfo("Contacts loaded and decrypted from contacts.txt!");
-    } else {
-        ShowInfo("No valid contacts found in the file. Existing contacts remain unchanged.");
-    }
-}
-
-// ------------------------------------------
-// Validate the contact's name: must not be empty
-// ------------------------------------------
-int ValidateName(const char *name) {
-    return (strlen(name) > 0);
-}
-
-// ------------------------------------------
-// Validate the phone number
-// Conditions:
-// - Allowed chars: digits, '+', '-'
-// - If starts with '+', must start with '+44' (UK) or '+60' (Malaysia)
-// This is a basic check and can be enhanced as needed.
-// ------------------------------------------
-int ValidatePhone(const char *phone) {
-    for (int i = 0; i < (int)strlen(phone); i++) {
-        if (!isdigit((unsigned char)phone[i]) && phone[i] != '+' && phone[i] != '-') {
-            return 0;
-        }
-    }
-
-    // If starts with '+', check the country code
-    if (phone[0] == '+') {
-        if (strncmp(phone, "+44", 3) != 0 && strncmp(phone, "+60", 3) != 0) {
-            // Must be either +44 or +60 if starting with '+'
-            return 0;
-        }
-    }
-    return 1;
-}
-
-// ------------------------------------------
-// Validate the email
-// Conditions:
-// - Allow empty email
-// - If not empty, must contain '@'
-// ------------------------------------------
-int ValidateEmail(const char *email) {
-    if (email[0] == '\0') return 1;
-    return (strchr(email, '@') != NULL);
-}
-
-// ------------------------------------------
-// Comparison function for qsort to sort by name
-// ------------------------------------------
-int CompareContactsByName(const void *a, const void *b) {
-    const Contact *c1 = (const Contact*)a;
-    const Contact *c2 = (const Contact*)b;
-#ifdef _MSC_VER
-    return _stricmp(c1->name, c2->name);
-#else
-    return strcasecmp(c1->name, c2->name);
-#endif
-}
-
-// ------------------------------------------
-// Comparison function for qsort to sort by phone
-// ------------------------------------------
-int CompareContactsByPhone(const void *a, const void *b) {
-    const Contact *c1 = (const Contact*)a;
-    const Contact *c2 = (const Contact*)b;
-#ifdef _MSC_VER
-    return _stricmp(c1->phone, c2->phone);
-#else
-    return strcasecmp(c1->phone, c2->phone);
-#endif
-}
-
-// ------------------------------------------
-// Sort the global contacts by name
-// ------------------------------------------
-void SortContactsByName() {
-    qsort(g_contacts, g_contactCount, sizeof(Contact), CompareContactsByName);
-}
-
-// ------------------------------------------
-// Sort the global contacts by phone
-// ------------------------------------------
-void SortContactsByPhone() {
-    qsort(g_contacts, g_contactCount, sizeof(Contact), CompareContactsByPhone);
-}
-
-// ------------------------------------------
-// Show an error message box
-// ------------------------------------------
-void ShowError(const char *msg) {
-    MessageBox(g_hMainWnd, msg, "Error", MB_OK | MB_ICONERROR);
-}
-
-// ------------------------------------------
-// Show an info message box
-// ------------------------------------------
-void ShowInfo(const char *msg) {
-    MessageBox(g_hMainWnd, msg, "Info", MB_OK | MB_ICONINFORMATION);
-}
-
-// ------------------------------------------
-// Perform a search based on the text entered in the search box
-// Displays only those contacts whose name contains the search query
-// ------------------------------------------
-void PerformSearch() {
-    char query[256];
-    GetWindowText(GetDlgItem(g_hMainWnd, IDC_SEARCH_EDIT), query, sizeof(query));
-    DisplayContacts(g_hListView, query);
-}
-
-// ------------------------------------------
-// Clear the search filter and show all contacts
-// ------------------------------------------
-void ClearSearchFilter() {
-    SetWindowText(GetDlgItem(g_hMainWnd, IDC_SEARCH_EDIT), "");
-    DisplayContacts(g_hListView, NULL);
-}
-
-// ------------------------------------------
-// RSA Encryption: Encrypt a single character using RSA
-// ------------------------------------------
-int RSA_EncryptChar(int m) {
-    return modExp(m, RSA_e, RSA_n);
-}
-
-// ------------------------------------------
-// RSA Decryption: Decrypt a single character using RSA
-// ------------------------------------------
-int RSA_DecryptChar(int c) {
-    return modExp(c, RSA_d, RSA_n);
-}
-
-// ------------------------------------------
-// Modular exponentiation function used for RSA
-// (base^exp) % mod efficiently computed
-// ------------------------------------------
-int modExp(int base, int exp, int mod) {
-    long long result = 1;
-    long long b = base % mod;
-    long long e = exp;
-    while (e > 0) {
-        if (e & 1) result = (result * b) % mod;
-        b = (b * b) % mod;
-        e >>= 1;
-    }
-    return (int)result;
-}
-
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <commctrl.h>
+#include <commdlg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "Autocomplete.h"
+#include "ContactStore.h"
+#include "ContactFile.h"
+#include "ContactJobs.h"
+#include "ContactView.h"
+#include "Dedup.h"
+#include "Export.h"
+#include "FuzzySearch.h"
+#include "Import.h"
+#include "Journal.h"
+#include "LiveSearch.h"
+#include "PhoneIndex.h"
+#include "Platform.h"
+#include "Query.h"
+#include "Search.h"
+#include "SortIndex.h"
+#include "Validation.h"
+
+#pragma comment(lib, "Comctl32.lib")
+
+// ------------------------------------------
+//              Global Definitions
+// ------------------------------------------
+
+// Menu and Control IDs
+enum {
+    IDM_ADD = 1,
+    IDM_EDIT,
+    IDM_DELETE,
+    IDM_SAVE,
+    IDM_LOAD,
+    IDM_IMPORT,
+    IDM_EXPORT,
+    IDM_DEDUP,
+    IDM_CANCEL_JOB,
+    IDM_SORT_NAME,
+    IDM_SORT_PHONE,
+    IDM_SORT_DATE,
+    IDM_EXIT
+};
+
+#define IDC_MAIN_LISTVIEW  100
+#define IDC_SEARCH_LABEL   110
+#define IDC_SEARCH_EDIT    111
+#define IDC_SEARCH_BUTTON  112
+#define IDC_CLEAR_BUTTON   113
+#define IDD_ADD_DIALOG     101
+#define IDC_SUGGESTIONS    1005  // List of completions in the Add/Edit dialog
+#define IDD_PASSPHRASE_DIALOG 102
+#define IDC_PASSPHRASE_EDIT   1101
+#define IDD_DUPLICATES_DIALOG 103
+#define IDC_DUP_GROUPS        1201  // Groups of likely duplicates (multiple selection)
+#define IDC_DUP_MEMBERS       1202  // Contacts of the group under the caret
+#define IDC_DUP_SELECT_ALL    1203
+
+// Search-as-you-type: timer that continues a search between keystrokes,
+// and the longest the message loop may be held by one slice of it
+#define IDT_LIVE_SEARCH       1
+#define LIVE_SEARCH_BUDGET_MS 8.0
+
+// Deleted contacts stay behind as tombstones; once there are enough of
+// them, this timer purges them while the user is idle
+#define IDT_PURGE             2
+#define PURGE_DELAY_MS        2000
+
+// Change journal: this timer syncs appended changes to disk at most
+// JOURNAL_COMMIT_MS after the first one, and the other one polls a
+// checkpoint running in the background
+#define IDT_JOURNAL           3
+#define IDT_CHECKPOINT        4
+#define CHECKPOINT_POLL_MS    100
+
+// Posted by a worker thread whenever a background job makes progress or
+// ends; the handler polls the job queue
+#define WM_JOB                (WM_APP + 1)
+#define JOB_WORKERS           2
+
+// Completions listed under the Add/Edit dialog fields
+#define SUGGESTIONS           8
+
+// Structured queries estimated to cost more than this (see Query_Plan)
+// wait for Go instead of running on every keystroke
+#define QUERY_LIVE_COST       2000000.0
+
+// ------------------------------------------
+//              Global Variables
+// ------------------------------------------
+
+// Global contact store
+static ContactStore g_store;
+
+// Trigram index over g_store for the search box, kept in step with every
+// add, update and delete and rebuilt after loads
+static TrigramIndex g_index;
+
+// Name, phone, email and date orders of g_store, maintained the same way;
+// sorting only switches which one the ListView shows
+static SortIndex g_sortIndex;
+
+// Phone number -> contacts hash index, for the duplicate number check
+static PhoneIndex g_phoneIndex;
+
+// Names and email domains by frequency, for completions as the user types;
+// invalidated when the store is replaced and rebuilt on first use
+static Autocomplete g_complete;
+
+// Set while the search box text is changed by its own completion
+static int g_completingSearch = 0;
+
+// Search in progress for the text of the search box
+static LiveSearch g_liveSearch;
+
+// Rows shown by the virtual ListView (it may be filtered)
+static ContactView g_view;
+
+static HWND g_hMainWnd = NULL;     // Handle to the main window
+static HWND g_hListView = NULL;    // Handle to the ListView control
+
+// If g_editId is 0, we are adding a new contact.
+// Otherwise, we are editing the contact with that id (its position may
+// change while the dialog is open, when tombstones are purged).
+static uint64_t g_editId = 0;
+
+// Passphrase of the contacts file, asked for once per session
+static char g_passphrase[256];
+
+// Journal of contacts.txt once it has been saved or loaded; every add,
+// update and delete is appended to it as it is made
+static Journal g_journal;
+static JournalCheckpoint g_checkpoint;  // Its thread is set while one runs
+static int g_checkpointHolds = 0;       // It holds imported rows the journal does not
+
+// Load, save, import, export and sort run as background jobs, so the
+// message loop never waits for them. While the exclusive job (a load,
+// import or sort) is pending its result depends on g_store staying as it
+// was, so edits are refused until it ends. A save or an export works on
+// a snapshot and lets editing go on.
+static JobQueue g_jobs;
+static ContactJob *g_exclusiveJob = NULL;
+static ContactJob *g_saveJob = NULL;
+static ContactJob *g_exportJob = NULL;
+static SortColumn g_jobSortColumn;      // Column to show once a sort job ends
+
+// Finished dedup job whose groups the Duplicates dialog lists, and the
+// groups picked there. Its groups are positions of g_store, so purges
+// wait while it is set.
+static ContactJob *g_dedupReview = NULL;
+static int *g_dedupGroups = NULL;
+static int  g_dedupGroupCount = 0;
+
+// Changes made so far, and when the pending save took its snapshot
+static uint64_t g_changes = 0;
+static uint64_t g_saveChanges = 0;
+
+// Forward declarations of functions
+LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
+INT_PTR CALLBACK ContactDlgProc(HWND, UINT, WPARAM, LPARAM);
+INT_PTR CALLBACK PassphraseDlgProc(HWND, UINT, WPARAM, LPARAM);
+INT_PTR CALLBACK DuplicatesDlgProc(HWND, UINT, WPARAM, LPARAM);
+
+void InitializeListViewColumns(HWND hListView);
+void DisplayContacts(HWND hListView, const char *filter);
+void DisplayRows(HWND hListView, const int *rows, int count);
+void RefreshListView(HWND hListView);
+void GetListViewText(NMLVDISPINFO *info);
+int  SelectedContactIndex(HWND hListView);
+void ShowAddContactDialog(HWND hwnd);
+void ShowEditContactDialog(HWND hwnd, int index);
+int  ConfirmSharedPhone(HWND hDlg, const char *phone, uint64_t editId);
+void AddNewContact(const char *name, const char *phone, const char *email, const char *date);
+void UpdateExistingContact(int index, const char *name, const char *phone, const char *email, const char *date);
+void DeleteSelectedContacts(HWND hListView);
+void SchedulePurge();
+void PurgeContacts();
+void SortContacts(SortColumn column);
+void JournalChange(JournalOp op, int index);
+void JournalImport(int first);
+void CheckpointIfNeeded();
+void CommitJournal();
+void FinishCheckpoint(int wait);
+int  RequestPassphrase(HWND hwnd);
+void SaveContacts(const char *filename);
+void LoadContacts(const char *filename);
+void ImportContacts(HWND hwnd);
+void ExportContacts(HWND hwnd);
+void FindDuplicates();
+void ReviewDuplicates(ContactJob *job);
+void ShowDuplicateGroup(HWND hDlg, int group);
+void NotifyJobs(void *context);
+int  SubmitJob(ContactJob *job);
+int  JobBusy();
+void CancelJobs();
+void HandleJobEvents();
+void FinishJob(ContactJob *job);
+void ShowJobProgress(const ContactJob *job, int done, int total);
+
+void ShowError(const char *msg);
+void ShowInfo(const char *msg);
+void PerformSearch();
+void ShowFuzzyMatches(const char *query);
+void ShowQueryResults(const char *text, int interactive);
+int  EnsureCompletions();
+void CompleteSearchText();
+void SuggestCompletions(HWND hDlg, int field);
+void AcceptSuggestion(HWND hDlg, int field);
+void ClearSearchFilter();
+void StartLiveSearch();
+void ContinueLiveSearch();
+void StopLiveSearch();
+
+// ------------------------------------------
+//                 WinMain
+// ------------------------------------------
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
+    Store_Init(&g_store);
+    TrigramIndex_Init(&g_index);
+    SortIndex_Init(&g_sortIndex);
+    PhoneIndex_Init(&g_phoneIndex);
+    Autocomplete_Init(&g_complete);
+    LiveSearch_Init(&g_liveSearch);
+    ContactView_Init(&g_view);
+    Journal_Init(&g_journal);
+
+    // Initialize common controls for ListView support
+    INITCOMMONCONTROLSEX icex = { sizeof(INITCOMMONCONTROLSEX), ICC_LISTVIEW_CLASSES };
+    InitCommonControlsEx(&icex);
+
+    // Set up and register the main window class
+    WNDCLASS wc = {0};
+    wc.style = CS_HREDRAW | CS_VREDRAW;
+    wc.lpfnWndProc = WndProc;                // Our window procedure
+    wc.hInstance = hInstance;
+    wc.lpszClassName = "ContactManagerClass";
+    wc.hbrBackground = (HBRUSH)(COLOR_WINDOW+1);
+    wc.hCursor = LoadCursor(NULL, IDC_ARROW);
+
+    if (!RegisterClass(&wc)) {
+        MessageBox(NULL, "Window Registration Failed!", "Error", MB_ICONERROR);
+        return 0;
+    }
+
+    // Create the main application window
+    g_hMainWnd = CreateWindow("ContactManagerClass", "Contact Management System",
+                              WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT,
+                              700, 500, NULL, NULL, hInstance, NULL);
+
+    if (!g_hMainWnd) {
+        MessageBox(NULL, "Window Creation Failed!", "Error", MB_ICONERROR);
+        return 0;
+    }
+    if (!JobQueue_Init(&g_jobs, JOB_WORKERS, NotifyJobs, g_hMainWnd)) {
+        MessageBox(NULL, "Out of memory!", "Error", MB_ICONERROR);
+        return 0;
+    }
+
+    // Show and update the main window
+    ShowWindow(g_hMainWnd, nCmdShow);
+    UpdateWindow(g_hMainWnd);
+
+    // Main message loop for the application
+    MSG msg;
+    while (GetMessage(&msg, NULL, 0,0)) {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+    // Let a save in progress complete; anything else is abandoned
+    if (g_saveJob) {
+        if (g_exclusiveJob) JobQueue_Cancel(&g_jobs, &g_exclusiveJob->job);
+        if (g_exportJob) JobQueue_Cancel(&g_jobs, &g_exportJob->job);
+        JobQueue_Wait(&g_jobs);
+    }
+    JobQueue_Free(&g_jobs);
+    ContactJob_Free(g_exclusiveJob);
+    ContactJob_Free(g_saveJob);
+    ContactJob_Free(g_exportJob);
+
+    // Leave every change on disk
+    if (g_checkpoint.thread) Journal_FinishCheckpoint(&g_checkpoint, &g_journal);
+    Journal_Close(&g_journal);
+    LiveSearch_Free(&g_liveSearch);
+    TrigramIndex_Free(&g_index);
+    SortIndex_Free(&g_sortIndex);
+    PhoneIndex_Free(&g_phoneIndex);
+    Autocomplete_Free(&g_complete);
+    ContactView_Free(&g_view);
+    Store_Free(&g_store);
+    SecureZeroMemory(g_passphrase, sizeof(g_passphrase));
+    return (int)msg.wParam;
+}
+
+// ------------------------------------------
+//               Window Procedure
+// ------------------------------------------
+LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    static HMENU hMenu;
+    switch(msg) {
+        case WM_CREATE: {
+            // Create and set up the menu
+            hMenu = CreateMenu();
+            if (!hMenu) {
+                ShowError("Failed to create menu.");
+                PostQuitMessage(1);
+                break;
+            }
+
+            // File menu with various contact operations
+            HMENU hFileMenu = CreatePopupMenu();
+            AppendMenu(hFileMenu, MF_STRING, IDM_ADD,         "Add Contact");
+            AppendMenu(hFileMenu, MF_STRING, IDM_EDIT,        "Edit Contact");
+            AppendMenu(hFileMenu, MF_STRING, IDM_DELETE,      "Delete Selected");
+            AppendMenu(hFileMenu, MF_STRING, IDM_SORT_NAME,   "Sort by Name");
+            AppendMenu(hFileMenu, MF_STRING, IDM_SORT_PHONE,  "Sort by Phone");
+            AppendMenu(hFileMenu, MF_STRING, IDM_SORT_DATE,   "Sort by Date");
+            AppendMenu(hFileMenu, MF_STRING, IDM_SAVE,        "Save (Encrypted)");
+            AppendMenu(hFileMenu, MF_STRING, IDM_LOAD,        "Load (Decrypted)");
+            AppendMenu(hFileMenu, MF_STRING, IDM_IMPORT,      "Import CSV/vCard...");
+            AppendMenu(hFileMenu, MF_STRING, IDM_EXPORT,      "Export...");
+            AppendMenu(hFileMenu, MF_STRING, IDM_DEDUP,       "Find Duplicates...");
+            AppendMenu(hFileMenu, MF_STRING, IDM_CANCEL_JOB,  "Cancel Background Job");
+            AppendMenu(hFileMenu, MF_STRING, IDM_EXIT,        "Exit");
+            AppendMenu(hMenu, MF_STRING | MF_POPUP, (UINT_PTR)hFileMenu, "Menu");
+            SetMenu(hwnd, hMenu);
+
+            // Create UI elements for searching contacts (name, phone and email)
+            CreateWindow("STATIC", "Search:",
+                         WS_CHILD | WS_VISIBLE,
+                         10, 10, 100, 20,
+                         hwnd, (HMENU)IDC_SEARCH_LABEL,
+                         GetModuleHandle(NULL), NULL);
+
+            CreateWindow("EDIT", "",
+                         WS_CHILD | WS_VISIBLE | WS_BORDER,
+                         120, 10, 200, 20,
+                         hwnd, (HMENU)IDC_SEARCH_EDIT,
+                         GetModuleHandle(NULL), NULL);
+
+            CreateWindow("BUTTON", "Go",
+                         WS_CHILD | WS_VISIBLE,
+                         330, 10, 40, 20,
+                         hwnd, (HMENU)IDC_SEARCH_BUTTON,
+                         GetModuleHandle(NULL), NULL);
+
+            CreateWindow("BUTTON", "Clear",
+                         WS_CHILD | WS_VISIBLE,
+                         380, 10, 50, 20,
+                         hwnd, (HMENU)IDC_CLEAR_BUTTON,
+                         GetModuleHandle(NULL), NULL);
+
+            // Create the ListView control to display contacts. It is virtual:
+            // rows are not stored in the control but fetched on demand.
+            g_hListView = CreateWindow(WC_LISTVIEW, "",
+                                       WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_OWNERDATA,
+                                       10, 40, 660, 400,
+                                       hwnd, (HMENU)IDC_MAIN_LISTVIEW, 
+                                       GetModuleHandle(NULL), NULL);
+            if (!g_hListView) {
+                ShowError("Failed to create ListView.");
+                PostQuitMessage(1);
+                break;
+            }
+
+            // Initialize the columns in the ListView
+            InitializeListViewColumns(g_hListView);
+            break;
+        }
+
+        case WM_SIZE: {
+            // Adjust the ListView size when the main window is resized
+            int width = LOWORD(lParam);
+            int height = HIWORD(lParam);
+            MoveWindow(g_hListView, 10, 40, width - 20, height - 50, TRUE);
+            break;
+        }
+
+        case WM_COMMAND: {
+            // Handle menu and button commands
+            switch(LOWORD(wParam)) {
+                case IDM_ADD:
+                    // Show dialog to add a new contact
+                    if (JobBusy()) break;
+                    g_editId = 0;
+                    ShowAddContactDialog(hwnd);
+                    break;
+                case IDM_EDIT: {
+                    // Show dialog to edit the currently selected contact
+                    if (JobBusy()) break;
+                    int selected = SelectedContactIndex(g_hListView);
+                    if (selected == -1) {
+                        ShowInfo("No contact selected to edit.");
+                    } else {
+                        g_editId = Store_GetId(&g_store, selected);
+                        ShowEditContactDialog(hwnd, selected);
+                    }
+                    break;
+                }
+                case IDM_DELETE:
+                    // Delete the selected contacts
+                    if (JobBusy()) break;
+                    if (Store_LiveCount(&g_store) == 0) {
+                        ShowInfo("No contacts to delete.");
+                    } else {
+                        DeleteSelectedContacts(g_hListView);
+                    }
+                    break;
+                case IDM_SAVE:
+                    // Save all contacts to file (encrypted)
+                    if (JobBusy()) break;
+                    if (Store_LiveCount(&g_store) == 0) {
+                        ShowInfo("No contacts to save.");
+                    } else {
+                        SaveContacts("contacts.txt");
+                    }
+                    break;
+                case IDM_LOAD:
+                    // Load contacts from file (decrypted), in the background
+                    if (JobBusy()) break;
+                    LoadContacts("contacts.txt");
+                    break;
+                case IDM_IMPORT:
+                    // Append the contacts of a CSV or vCard export
+                    if (JobBusy()) break;
+                    ImportContacts(hwnd);
+                    break;
+                case IDM_EXPORT:
+                    // Write the listed contacts as CSV, vCard or JSON Lines
+                    ExportContacts(hwnd);
+                    break;
+                case IDM_DEDUP:
+                    // Suggest groups of duplicates and merge them
+                    if (JobBusy()) break;
+                    FindDuplicates();
+                    break;
+                case IDM_CANCEL_JOB:
+                    // Stop the background jobs at their next step
+                    CancelJobs();
+                    break;
+                case IDM_SORT_NAME:
+                    // Sort contacts by name
+                    SortContacts(SORT_BY_NAME);
+                    break;
+                case IDM_SORT_PHONE:
+                    // Sort contacts by phone
+                    SortContacts(SORT_BY_PHONE);
+                    break;
+                case IDM_SORT_DATE:
+                    // Sort contacts by date, oldest first
+                    SortContacts(SORT_BY_DATE);
+                    break;
+                case IDM_EXIT:
+                    // Exit the application
+                    PostQuitMessage(0);
+                    break;
+                case IDC_SEARCH_EDIT:
+                    // Complete the name and filter again on every keystroke
+                    if (HIWORD(wParam) == EN_CHANGE && !g_completingSearch) {
+                        CompleteSearchText();
+                        StartLiveSearch();
+                    }
+                    break;
+                case IDC_SEARCH_BUTTON:
+                    // Search name, phone and email for a substring
+                    PerformSearch();
+                    break;
+                case IDC_CLEAR_BUTTON:
+                    // Clear the search filter and show all contacts
+                    ClearSearchFilter();
+                    break;
+            }
+            break;
+        }
+
+        case WM_NOTIFY: {
+            NMHDR *header = (NMHDR *)lParam;
+            if (header->idFrom == IDC_MAIN_LISTVIEW && header->code == LVN_GETDISPINFO) {
+                GetListViewText((NMLVDISPINFO *)lParam);
+            } else if (header->idFrom == IDC_MAIN_LISTVIEW && header->code == LVN_COLUMNCLICK) {
+                // Columns are laid out in SortColumn order
+                SortContacts((SortColumn)((NMLISTVIEW *)lParam)->iSubItem);
+            }
+            break;
+        }
+
+        case WM_TIMER:
+            if (wParam == IDT_LIVE_SEARCH) {
+                ContinueLiveSearch();
+            } else if (wParam == IDT_PURGE) {
+                PurgeContacts();
+            } else if (wParam == IDT_JOURNAL) {
+                CommitJournal();
+            } else if (wParam == IDT_CHECKPOINT) {
+                FinishCheckpoint(0);
+            }
+            break;
+
+        case WM_JOB:
+            HandleJobEvents();
+            break;
+
+        case WM_DESTROY:
+            // Window destroyed, quit the application
+            PostQuitMessage(0);
+            break;
+    }
+    return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+// ------------------------------------------
+//   Initialize the columns of the ListView
+// ------------------------------------------
+void InitializeListViewColumns(HWND hListView) {
+    LVCOLUMN columnInfo;
+    ZeroMemory(&columnInfo, sizeof(columnInfo));
+    columnInfo.mask = LVCF_TEXT | LVCF_WIDTH | LVCF_SUBITEM;
+
+    columnInfo.pszText = "Name";
+    columnInfo.cx = 150;
+    ListView_InsertColumn(hListView, 0, &columnInfo);
+
+    columnInfo.pszText = "Phone";
+    columnInfo.cx = 100;
+    ListView_InsertColumn(hListView, 1, &columnInfo);
+
+    columnInfo.pszText = "Email";
+    columnInfo.cx = 200;
+    ListView_InsertColumn(hListView, 2, &columnInfo);
+
+    columnInfo.pszText = "Date";
+    columnInfo.cx = 100;
+    ListView_InsertColumn(hListView, 3, &columnInfo);
+}
+
+// ------------------------------------------
+// Display all contacts in the ListView
+// If 'filter' is provided and not empty, only display contacts whose name,
+// phone or email contains the filter string (ignoring case).
+// ------------------------------------------
+void DisplayContacts(HWND hListView, const char *filter) {
+    if (!ContactView_Filter(&g_view, &g_store, &g_index, filter)) {
+        ShowError("Out of memory while displaying contacts!");
+        ContactView_ShowAll(&g_view, &g_store);
+    }
+    RefreshListView(hListView);
+}
+
+// ------------------------------------------
+// Display the given store positions in the ListView
+// ------------------------------------------
+void DisplayRows(HWND hListView, const int *rows, int count) {
+    if (!ContactView_SetRows(&g_view, &g_store, rows, count)) {
+        ShowError("Out of memory while displaying contacts!");
+        return;
+    }
+    RefreshListView(hListView);
+}
+
+// ------------------------------------------
+// Tell the virtual ListView how many rows the view has now
+// Only the visible rows are repainted; the old selection is dropped since
+// it pointed at a row of the previous view.
+// ------------------------------------------
+void RefreshListView(HWND hListView) {
+    ListView_SetItemState(hListView, -1, 0, LVIS_SELECTED);
+    ListView_SetItemCountEx(hListView, g_view.count, LVSICF_NOSCROLL);
+}
+
+// ------------------------------------------
+// LVN_GETDISPINFO: copy the text of the requested cell
+// ------------------------------------------
+void GetListViewText(NMLVDISPINFO *info) {
+    if (!(info->item.mask & LVIF_TEXT) || info->item.cchTextMax <= 0) return;
+    const char *text = ContactView_Text(&g_view, &g_store, info->item.iItem, info->item.iSubItem);
+    lstrcpyn(info->item.pszText, text, info->item.cchTextMax);
+}
+
+// ------------------------------------------
+// Store position of the (first) selected ListView row, or -1
+// ------------------------------------------
+int SelectedContactIndex(HWND hListView) {
+    int selected = ListView_GetNextItem(hListView, -1, LVNI_SELECTED);
+    return ContactView_IndexOfRow(&g_view, &g_store, selected);
+}
+
+// ------------------------------------------
+// Show the dialog for adding a new contact
+// ------------------------------------------
+void ShowAddContactDialog(HWND hwnd) {
+    g_editId = 0;
+    DialogBox(GetModuleHandle(NULL), MAKEINTRESOURCE(IDD_ADD_DIALOG), hwnd, ContactDlgProc);
+}
+
+// ------------------------------------------
+// Show the dialog for editing an existing contact
+// ------------------------------------------
+void ShowEditContactDialog(HWND hwnd, int index) {
+    DialogBox(GetModuleHandle(NULL), MAKEINTRESOURCE(IDD_ADD_DIALOG), hwnd, ContactDlgProc);
+}
+
+// ------------------------------------------
+// Dialog procedure for the Add/Edit Contact dialog
+// Handles input validation and updates global contact array
+// ------------------------------------------
+INT_PTR CALLBACK ContactDlgProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam) {
+    static char nameBuffer[CONTACT_NAME_SIZE], phoneBuffer[CONTACT_PHONE_SIZE];
+    static char emailBuffer[CONTACT_EMAIL_SIZE], dateBuffer[CONTACT_DATE_SIZE];
+    static int filling = 0;   // Fields set by code, not typed: no suggestions
+    static int suggestFor = 0; // Field the suggestion list completes
+    int editIndex;
+
+    switch(message) {
+        case WM_INITDIALOG:
+            filling = 1;
+            suggestFor = 0;
+            // If editing, populate the fields with existing data
+            if (g_editId != 0 && (editIndex = Store_FindId(&g_store, g_editId)) != -1) {
+                SetDlgItemText(hDlg, 1001, Store_GetName(&g_store, editIndex));
+                SetDlgItemText(hDlg, 1002, Store_GetPhone(&g_store, editIndex));
+                SetDlgItemText(hDlg, 1003, Store_GetEmail(&g_store, editIndex));
+                SetDlgItemText(hDlg, 1004, Store_GetDate(&g_store, editIndex));
+            } else {
+                // If adding, clear the fields
+                SetDlgItemText(hDlg, 1001, "");
+                SetDlgItemText(hDlg, 1002, "");
+                SetDlgItemText(hDlg, 1003, "");
+                SetDlgItemText(hDlg, 1004, "");
+            }
+            filling = 0;
+            return (INT_PTR)TRUE;
+
+        case WM_COMMAND:
+            // Suggest names and email domains while typing in those fields
+            if ((LOWORD(wParam) == 1001 || LOWORD(wParam) == 1003) && HIWORD(wParam) == EN_CHANGE) {
+                if (!filling) {
+                    suggestFor = LOWORD(wParam);
+                    SuggestCompletions(hDlg, suggestFor);
+                }
+                return (INT_PTR)TRUE;
+            }
+            if (LOWORD(wParam) == IDC_SUGGESTIONS && HIWORD(wParam) == LBN_SELCHANGE) {
+                if (suggestFor != 0) {
+                    filling = 1;
+                    AcceptSuggestion(hDlg, suggestFor);
+                    filling = 0;
+                }
+                return (INT_PTR)TRUE;
+            }
+            if (LOWORD(wParam) == IDOK) {
+                // User clicked OK, retrieve data
+                GetDlgItemText(hDlg, 1001, nameBuffer, CONTACT_NAME_SIZE);
+                GetDlgItemText(hDlg, 1002, phoneBuffer, CONTACT_PHONE_SIZE);
+                GetDlgItemText(hDlg, 1003, emailBuffer, CONTACT_EMAIL_SIZE);
+                GetDlgItemText(hDlg, 1004, dateBuffer, CONTACT_DATE_SIZE);
+
+                // Trim trailing whitespace from all fields
+                for (int i=(int)strlen(nameBuffer)-1; i>=0 && isspace((unsigned char)nameBuffer[i]); i--) nameBuffer[i]=0;
+                for (int i=(int)strlen(phoneBuffer)-1; i>=0 && isspace((unsigned char)phoneBuffer[i]); i--) phoneBuffer[i]=0;
+                for (int i=(int)strlen(emailBuffer)-1; i>=0 && isspace((unsigned char)emailBuffer[i]); i--) emailBuffer[i]=0;
+                for (int i=(int)strlen(dateBuffer)-1; i>=0 && isspace((unsigned char)dateBuffer[i]); i--) dateBuffer[i]=0;
+
+                // Validate inputs
+                if (!ValidateName(nameBuffer)) {
+                    MessageBox(hDlg, "Invalid name! Must not be empty.", "Error", MB_OK|MB_ICONERROR);
+                    return (INT_PTR)TRUE;
+                }
+                if (!ValidatePhone(phoneBuffer)) {
+                    MessageBox(hDlg, "Invalid phone! Must be digits, '+' and '-' only and follow basic rules.", "Error", MB_OK|MB_ICONERROR);
+                    return (INT_PTR)TRUE;
+                }
+                if (!ValidateEmail(emailBuffer)) {
+                    MessageBox(hDlg, "Invalid email! Must contain '@' if not empty.", "Error", MB_OK|MB_ICONERROR);
+                    return (INT_PTR)TRUE;
+                }
+                if (!ValidateDate(dateBuffer)) {
+                    MessageBox(hDlg, "Invalid date! Use YYYY-MM-DD or leave empty.", "Error", MB_OK|MB_ICONERROR);
+                    return (INT_PTR)TRUE;
+                }
+                if (!ConfirmSharedPhone(hDlg, phoneBuffer, g_editId)) {
+                    return (INT_PTR)TRUE;
+                }
+
+                // If all good, add or update the contact
+                if (g_editId == 0) {
+                    // Add a new contact
+                    AddNewContact(nameBuffer, phoneBuffer, emailBuffer, dateBuffer);
+                } else if ((editIndex = Store_FindId(&g_store, g_editId)) == -1) {
+                    MessageBox(hDlg, "The contact no longer exists.", "Error", MB_OK|MB_ICONERROR);
+                } else {
+                    // Update existing contact
+                    UpdateExistingContact(editIndex, nameBuffer, phoneBuffer, emailBuffer, dateBuffer);
+                }
+
+                DisplayContacts(g_hListView, NULL);
+                EndDialog(hDlg, IDOK);
+            } else if (LOWORD(wParam) == IDCANCEL) {
+                // User clicked cancel
+                EndDialog(hDlg, IDCANCEL);
+            }
+            return (INT_PTR)TRUE;
+    }
+    return (INT_PTR)FALSE;
+}
+
+// ------------------------------------------
+// Build the completion tries if the store was replaced since they were
+// last used. Returns 1 when they are ready.
+// ------------------------------------------
+int EnsureCompletions() {
+    return !g_complete.stale || Autocomplete_Build(&g_complete, &g_store);
+}
+
+// ------------------------------------------
+// Fill the suggestion list for the text of the Add/Edit dialog 'field':
+// the most frequent names starting with it for the name field, and the
+// most frequent domains after its '@' for the email field
+// ------------------------------------------
+void SuggestCompletions(HWND hDlg, int field) {
+    char text[CONTACT_EMAIL_SIZE];
+    Completion found[SUGGESTIONS];
+    int count = 0;
+
+    SendDlgItemMessage(hDlg, IDC_SUGGESTIONS, LB_RESETCONTENT, 0, 0);
+    GetDlgItemText(hDlg, field, text, sizeof(text));
+    if (text[0] == '\0' || !EnsureCompletions()) return;
+
+    if (field == 1001) {
+        count = Autocomplete_Lookup(&g_complete, COMPLETE_NAME, text, found, SUGGESTIONS);
+    } else {
+        const char *domain = Autocomplete_Domain(text);
+        if (domain) count = Autocomplete_Lookup(&g_complete, COMPLETE_DOMAIN, domain, found, SUGGESTIONS);
+    }
+    for (int i = 0; i < count; i++) {
+        SendDlgItemMessage(hDlg, IDC_SUGGESTIONS, LB_ADDSTRING, 0, (LPARAM)found[i].text);
+    }
+}
+
+// ------------------------------------------
+// Put the selected suggestion into 'field' (after the '@' for an email)
+// and return the caret to the end of it
+// ------------------------------------------
+void AcceptSuggestion(HWND hDlg, int field) {
+    char text[CONTACT_EMAIL_SIZE], choice[CONTACT_NAME_SIZE];
+    int selected = (int)SendDlgItemMessage(hDlg, IDC_SUGGESTIONS, LB_GETCURSEL, 0, 0);
+    if (selected == LB_ERR) return;
+    int length = (int)SendDlgItemMessage(hDlg, IDC_SUGGESTIONS, LB_GETTEXTLEN, selected, 0);
+    if (length == LB_ERR || length >= (int)sizeof(choice)) return;
+    SendDlgItemMessage(hDlg, IDC_SUGGESTIONS, LB_GETTEXT, selected, (LPARAM)choice);
+
+    if (field == 1001) {
+        snprintf(text, sizeof(text), "%s", choice);
+    } else {
+        GetDlgItemText(hDlg, field, text, sizeof(text));
+        const char *domain = Autocomplete_Domain(text);
+        if (!domain) return;
+        size_t local = (size_t)(domain - text);
+        snprintf(text + local, sizeof(text) - local, "%s", choice);
+    }
+    SetDlgItemText(hDlg, field, text);
+    SendDlgItemMessage(hDlg, field, EM_SETSEL, strlen(text), strlen(text));
+    SetFocus(GetDlgItem(hDlg, field));
+}
+
+// ------------------------------------------
+// Ask before saving a number another contact already has, in any
+// spelling ("+44-20-1234" and "+44 2012 34" are the same number).
+// O(1) through the phone index. Returns 1 to go ahead.
+// ------------------------------------------
+int ConfirmSharedPhone(HWND hDlg, const char *phone, uint64_t editId) {
+    if (g_phoneIndex.stale && !PhoneIndex_Build(&g_phoneIndex, &g_store)) return 1;
+    int rows[2];
+    int found = PhoneIndex_Owners(&g_phoneIndex, &g_store, phone, rows, 2);
+    for (int i = 0; i < found; i++) {
+        if (Store_GetId(&g_store, rows[i]) == editId) continue;
+        char prompt[256];
+        snprintf(prompt, sizeof(prompt), "%s already has this number (%s). Save anyway?",
+                 Store_GetName(&g_store, rows[i]), Store_GetPhone(&g_store, rows[i]));
+        return MessageBox(hDlg, prompt, "Duplicate Phone", MB_YESNO | MB_ICONQUESTION) == IDYES;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Add a new contact to the global store
+// ------------------------------------------
+void AddNewContact(const char *name, const char *phone, const char *email, const char *date) {
+    StopLiveSearch();
+    if (!Store_Add(&g_store, name, phone, email, date)) {
+        ShowError("Out of memory while adding contact!");
+        return;
+    }
+    TrigramIndex_Insert(&g_index, &g_store, g_store.count - 1);
+    SortIndex_Insert(&g_sortIndex, &g_store, g_store.count - 1);
+    PhoneIndex_Insert(&g_phoneIndex, &g_store, g_store.count - 1);
+    Autocomplete_Insert(&g_complete, &g_store, g_store.count - 1);
+    JournalChange(JOURNAL_ADD, g_store.count - 1);
+    CheckpointIfNeeded();
+}
+
+// ------------------------------------------
+// Update an existing contact at the specified index
+// ------------------------------------------
+void UpdateExistingContact(int index, const char *name, const char *phone, const char *email, const char *date) {
+    StopLiveSearch();
+    TrigramIndex_BeginUpdate(&g_index, &g_store, index);
+    SortIndex_BeginUpdate(&g_sortIndex, &g_store, index);
+    PhoneIndex_BeginUpdate(&g_phoneIndex, &g_store, index);
+    Autocomplete_BeginUpdate(&g_complete, &g_store, index);
+    int updated = Store_Update(&g_store, index, name, phone, email, date);
+    TrigramIndex_EndUpdate(&g_index, &g_store, index);
+    SortIndex_EndUpdate(&g_sortIndex, &g_store, index);
+    PhoneIndex_EndUpdate(&g_phoneIndex, &g_store, index);
+    Autocomplete_EndUpdate(&g_complete, &g_store, index);
+    if (!updated) {
+        ShowError("Out of memory while updating contact!");
+        return;
+    }
+    JournalChange(JOURNAL_UPDATE, index);
+    CheckpointIfNeeded();
+}
+
+// ------------------------------------------
+// Delete every selected contact
+// Each delete leaves a tombstone in O(1), so nothing shifts while the
+// selection is walked; the sort orders and the view then drop all of them
+// in one pass instead of one pass per contact.
+// ------------------------------------------
+void DeleteSelectedContacts(HWND hListView) {
+    int selected = 0;
+    for (int row = ListView_GetNextItem(hListView, -1, LVNI_SELECTED); row != -1;
+         row = ListView_GetNextItem(hListView, row, LVNI_SELECTED)) {
+        selected++;
+    }
+    if (selected == 0) {
+        ShowInfo("No contact selected!");
+        return;
+    }
+
+    char prompt[96] = "Are you sure you want to delete this contact?";
+    if (selected > 1) {
+        snprintf(prompt, sizeof(prompt), "Are you sure you want to delete these %d contacts?", selected);
+    }
+    int response = MessageBox(g_hMainWnd, prompt, "Confirm", MB_YESNO|MB_ICONQUESTION);
+    if (response != IDYES) return;
+
+    StopLiveSearch();
+    for (int row = ListView_GetNextItem(hListView, -1, LVNI_SELECTED); row != -1;
+         row = ListView_GetNextItem(hListView, row, LVNI_SELECTED)) {
+        int index = ContactView_IndexOfRow(&g_view, &g_store, row);
+        if (index == -1) continue;
+        TrigramIndex_Remove(&g_index, &g_store, index);
+        PhoneIndex_Remove(&g_phoneIndex, &g_store, index);
+        Autocomplete_Remove(&g_complete, &g_store, index);
+        if (!Store_Delete(&g_store, index)) {
+            // Still there: index it again and stop
+            TrigramIndex_Insert(&g_index, &g_store, index);
+            PhoneIndex_Insert(&g_phoneIndex, &g_store, index);
+            Autocomplete_Insert(&g_complete, &g_store, index);
+            ShowError("Out of memory while deleting contacts!");
+            break;
+        }
+        JournalChange(JOURNAL_DELETE, index);
+    }
+    SortIndex_RemoveDeleted(&g_sortIndex, &g_store);
+    if (!ContactView_RemoveDeleted(&g_view, &g_store)) {
+        ShowError("Out of memory while displaying contacts!");
+    }
+    RefreshListView(hListView);
+    SchedulePurge();
+    CheckpointIfNeeded();
+}
+
+// ------------------------------------------
+// Arm the purge timer once the dead ratio calls for it
+// Each new batch of deletes pushes the purge back, so it runs once the
+// user pauses.
+// ------------------------------------------
+void SchedulePurge() {
+    if (Store_NeedsPurge(&g_store)) {
+        SetTimer(g_hMainWnd, IDT_PURGE, PURGE_DELAY_MS, NULL);
+    }
+}
+
+// ------------------------------------------
+// Drop the tombstones and move every index to the new positions
+// O(n) with no re-sorting or re-indexing; the view keeps its rows, so the
+// ListView only needs repainting.
+// ------------------------------------------
+void PurgeContacts() {
+    KillTimer(g_hMainWnd, IDT_PURGE);
+    if (!Store_NeedsPurge(&g_store)) return;
+    if ((g_liveSearch.active && !g_liveSearch.complete) || g_exclusiveJob || g_dedupReview) {
+        // Its candidates, or the job's results, are positions: try again
+        // once it is done
+        SetTimer(g_hMainWnd, IDT_PURGE, PURGE_DELAY_MS, NULL);
+        return;
+    }
+
+    int *remap = (int*)malloc((size_t)g_store.count * sizeof(int));
+    if (!remap) return;  // Tombstones are harmless; purge another time
+    StopLiveSearch();
+    if (!Store_Purge(&g_store, remap)) {
+        free(remap);
+        return;
+    }
+    TrigramIndex_Purge(&g_index, remap, g_store.count);
+    SortIndex_Purge(&g_sortIndex, remap);
+    ContactView_Purge(&g_view, remap);
+    free(remap);
+    InvalidateRect(g_hListView, NULL, FALSE);
+}
+
+// ------------------------------------------
+// Append a change to the journal, if there is one
+// Without a journal (nothing saved or loaded yet) the next save writes
+// the whole file.
+// ------------------------------------------
+void JournalChange(JournalOp op, int index) {
+    g_changes++;
+    if (!g_journal.file || g_journal.failed) return;
+    if (!Journal_Append(&g_journal, op, &g_store, index)) {
+        ShowError("Could not write to the change journal. Save to write the whole file again.");
+        return;
+    }
+    if (g_journal.pending == 1) {
+        SetTimer(g_hMainWnd, IDT_JOURNAL, JOURNAL_COMMIT_MS, NULL);
+    }
+}
+
+// ------------------------------------------
+// Record the rows from 'first' on, just imported, with a checkpoint
+// Journaling each row would encrypt and sync every one of them on the UI
+// thread, only for the checkpoint that follows to rewrite them all; the
+// new snapshot holds them instead. A checkpoint still running is waited
+// for, since only one is written at a time.
+// ------------------------------------------
+void JournalImport(int first) {
+    g_changes += (uint64_t)(g_store.count - first);
+    if (!g_journal.file || g_journal.failed) return;
+    FinishCheckpoint(1);
+    if (!g_journal.file) return;
+    if (!Journal_StartCheckpoint(&g_checkpoint, &g_journal, &g_store, g_passphrase)) {
+        // The journal lacks the rows: the next save writes the whole file
+        Journal_Close(&g_journal);
+        return;
+    }
+    g_checkpointHolds = 1;
+    SetTimer(g_hMainWnd, IDT_CHECKPOINT, CHECKPOINT_POLL_MS, NULL);
+}
+
+// ------------------------------------------
+// Once the journal has grown large enough, fold it into a new snapshot
+// written on a background thread
+// Only between changes: the store copied must match the journal.
+// ------------------------------------------
+void CheckpointIfNeeded() {
+    if (!g_checkpoint.thread && Journal_NeedsCheckpoint(&g_journal, &g_store) &&
+        Journal_StartCheckpoint(&g_checkpoint, &g_journal, &g_store, g_passphrase)) {
+        SetTimer(g_hMainWnd, IDT_CHECKPOINT, CHECKPOINT_POLL_MS, NULL);
+    }
+}
+
+// ------------------------------------------
+// Group commit: sync every change appended in the last window at once
+// ------------------------------------------
+void CommitJournal() {
+    KillTimer(g_hMainWnd, IDT_JOURNAL);
+    if (g_journal.file && !g_journal.failed && !Journal_Commit(&g_journal)) {
+        ShowError("Could not write to the change journal. Save to write the whole file again.");
+    }
+}
+
+// ------------------------------------------
+// Put the snapshot of a checkpoint in place once it is written
+// Polled from a timer; 'wait' blocks until the background save is done.
+// A checkpoint that fails leaves the journal as it was; it is tried
+// again after the next change.
+// ------------------------------------------
+void FinishCheckpoint(int wait) {
+    if (!wait && g_checkpoint.thread && !Journal_CheckpointDone(&g_checkpoint)) return;
+    KillTimer(g_hMainWnd, IDT_CHECKPOINT);
+    if (!g_checkpoint.thread) return;
+    if (Journal_FinishCheckpoint(&g_checkpoint, &g_journal) != CONTACT_FILE_OK && g_checkpointHolds) {
+        // The journal goes on without the imported rows
+        Journal_Close(&g_journal);
+    }
+    g_checkpointHolds = 0;
+    if (!g_journal.file) {
+        ShowError("Could not write the checkpoint of the change journal. Save to write the whole file again.");
+    }
+}
+
+// ------------------------------------------
+// Show the contacts in 'column' order
+// Nothing moves in the store; the view switches to another maintained
+// order, so selections, searches and indexes stay valid. Only an order
+// left stale by an earlier failure is rebuilt, by a background job.
+// ------------------------------------------
+void SortContacts(SortColumn column) {
+    if (Store_LiveCount(&g_store) <= 1) {
+        ShowInfo("Not enough contacts to sort.");
+        return;
+    }
+    if (g_sortIndex.stale) {
+        if (JobBusy()) return;
+        g_jobSortColumn = column;
+        SubmitJob(ContactJob_Sort(&g_store));
+        return;
+    }
+    ContactView_SetSort(&g_view, &g_store, &g_sortIndex, column);
+    RefreshListView(g_hListView);
+}
+
+// ------------------------------------------
+// Dialog procedure for the passphrase prompt
+// ------------------------------------------
+INT_PTR CALLBACK PassphraseDlgProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam) {
+    (void)lParam;
+    switch(message) {
+        case WM_INITDIALOG:
+            SetDlgItemText(hDlg, IDC_PASSPHRASE_EDIT, "");
+            return (INT_PTR)TRUE;
+
+        case WM_COMMAND:
+            if (LOWORD(wParam) == IDOK) {
+                GetDlgItemText(hDlg, IDC_PASSPHRASE_EDIT, g_passphrase, sizeof(g_passphrase));
+                if (g_passphrase[0] == '\0') {
+                    MessageBox(hDlg, "The passphrase must not be empty.", "Error", MB_OK|MB_ICONERROR);
+                    return (INT_PTR)TRUE;
+                }
+                EndDialog(hDlg, IDOK);
+            } else if (LOWORD(wParam) == IDCANCEL) {
+                EndDialog(hDlg, IDCANCEL);
+            }
+            return (INT_PTR)TRUE;
+    }
+    return (INT_PTR)FALSE;
+}
+
+// ------------------------------------------
+// Make sure a passphrase is known, prompting for it if needed
+// Returns 0 if the user cancelled.
+// ------------------------------------------
+int RequestPassphrase(HWND hwnd) {
+    if (g_passphrase[0] != '\0') return 1;
+    return DialogBox(GetModuleHandle(NULL), MAKEINTRESOURCE(IDD_PASSPHRASE_DIALOG), hwnd, PassphraseDlgProc) == IDOK;
+}
+
+// ------------------------------------------
+// Save all contacts to a file, compressed and encrypted (v2 format)
+// With a journal every change is already in it, so saving only syncs
+// it: O(changes) instead of rewriting the file. Otherwise the whole file
+// is written by a background job, which starts a journal for it.
+// ------------------------------------------
+void SaveContacts(const char *filename) {
+    if (g_saveJob) {
+        ShowInfo("A save is still in progress. Please wait for it to finish.");
+        return;
+    }
+    // Imported rows are on disk only once their checkpoint is
+    if (g_checkpointHolds) FinishCheckpoint(1);
+    if (g_journal.file && !g_journal.failed) {
+        KillTimer(g_hMainWnd, IDT_JOURNAL);
+        if (Journal_Commit(&g_journal)) {
+            ShowInfo("Changes saved (encrypted) to contacts.txt!");
+            return;
+        }
+    }
+    if (!RequestPassphrase(g_hMainWnd)) return;
+
+    // A checkpoint would replace the file written here
+    FinishCheckpoint(1);
+    Journal_Close(&g_journal);
+
+    g_saveChanges = g_changes;
+    SubmitJob(ContactJob_Save(&g_store, filename, CONTACT_V2_COMPRESSED | CONTACT_V2_ENCRYPTED, g_passphrase));
+}
+
+// ------------------------------------------
+// Load contacts from file, decrypted
+// Older RSA encrypted files and plain v2 files (e.g. written by
+// "ContactTool migrate") are detected and loaded as well. The file is
+// read, its journal replayed and the indexes built by a background job;
+// the current contacts stay until it is done (see FinishJob).
+// ------------------------------------------
+void LoadContacts(const char *filename) {
+    if (g_saveJob) {
+        ShowInfo("A save is still in progress. Please wait for it to finish.");
+        return;
+    }
+    if (ContactFile_IsEncrypted(filename) && !RequestPassphrase(g_hMainWnd)) return;
+
+    // Everything written so far must be on disk before it is read back
+    CommitJournal();
+    FinishCheckpoint(1);
+
+    SubmitJob(ContactJob_Load(filename, g_passphrase));
+}
+
+// ------------------------------------------
+// Append the contacts of a CSV or vCard export
+// A background job appends them to a copy of the store: the file is
+// parsed and validated on all cores, the accepted rows are appended in
+// batches and the indexes rebuilt once instead of updated row by row.
+// The copy replaces the store when the job ends (see FinishJob).
+// ------------------------------------------
+void ImportContacts(HWND hwnd) {
+    char filename[MAX_PATH] = "";
+    OPENFILENAME ofn;
+    memset(&ofn, 0, sizeof(ofn));
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hwnd;
+    ofn.lpstrFilter = "Contact exports (*.csv;*.vcf)\0*.csv;*.vcf;*.vcard\0All files (*.*)\0*.*\0";
+    ofn.lpstrFile = filename;
+    ofn.nMaxFile = sizeof(filename);
+    ofn.Flags = OFN_FILEMUSTEXIST | OFN_HIDEREADONLY;
+    if (!GetOpenFileName(&ofn)) return;
+
+    SubmitJob(ContactJob_Import(&g_store, filename, IMPORT_AUTO));
+}
+
+// ------------------------------------------
+// Export the contacts as listed: the current search results in the
+// current sort order. A background job writes them from a copy of the
+// store, so editing can go on meanwhile.
+// ------------------------------------------
+void ExportContacts(HWND hwnd) {
+    char filename[MAX_PATH] = "contacts.csv";
+    OPENFILENAME ofn;
+    memset(&ofn, 0, sizeof(ofn));
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hwnd;
+    ofn.lpstrFilter = "CSV (*.csv)\0*.csv\0vCard (*.vcf)\0*.vcf\0JSON Lines (*.jsonl)\0*.jsonl\0";
+    ofn.lpstrFile = filename;
+    ofn.nMaxFile = sizeof(filename);
+    ofn.lpstrDefExt = "csv";
+    ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST | OFN_HIDEREADONLY;
+    if (!GetSaveFileName(&ofn)) return;
+    if (g_exportJob) {
+        ShowInfo("An export is still running. Please wait for it to finish.");
+        return;
+    }
+
+    // Finish a search still running so the whole result is written
+    if (g_liveSearch.active && !g_liveSearch.complete) PerformSearch();
+
+    // The rows as listed, in store positions of the copy
+    int *rows = (int*)malloc((size_t)(g_view.count > 0 ? g_view.count : 1) * sizeof(int));
+    if (!rows) {
+        ShowError("Out of memory while exporting contacts!");
+        return;
+    }
+    for (int row = 0; row < g_view.count; row++) {
+        rows[row] = ContactView_IndexOfRow(&g_view, &g_store, row);
+    }
+    SubmitJob(ContactJob_Export(&g_store, rows, g_view.count, filename, EXPORT_AUTO));
+    free(rows);
+}
+
+// ------------------------------------------
+// Look for likely duplicates in the background
+// The groups are then listed for review (ReviewDuplicates) and the ones
+// picked are merged by another job, which also rebuilds the indexes.
+// ------------------------------------------
+void FindDuplicates() {
+    SubmitJob(ContactJob_Dedup(&g_store, DEDUP_DEFAULT_THRESHOLD));
+}
+
+// ------------------------------------------
+// List the groups of a finished dedup job and merge the ones picked
+// g_store has not changed since the job's snapshot (it was exclusive),
+// so its groups still name the right contacts.
+// ------------------------------------------
+void ReviewDuplicates(ContactJob *job) {
+    g_dedupReview = job;
+    INT_PTR choice = DialogBox(GetModuleHandle(NULL), MAKEINTRESOURCE(IDD_DUPLICATES_DIALOG), g_hMainWnd,
+                               DuplicatesDlgProc);
+    g_dedupReview = NULL;
+    if (choice == IDOK && g_dedupGroupCount > 0 && !JobBusy()) {
+        SubmitJob(ContactJob_Merge(&g_store, &job->dedup, g_dedupGroups, g_dedupGroupCount));
+    }
+    free(g_dedupGroups);
+    g_dedupGroups = NULL;
+    g_dedupGroupCount = 0;
+}
+
+// ------------------------------------------
+// Name of a field merged from duplicates, for messages
+// ------------------------------------------
+static const char *MergedFieldName(ContactField field) {
+    switch (field) {
+        case CONTACT_FIELD_PHONE: return "phone";
+        case CONTACT_FIELD_EMAIL: return "email";
+        case CONTACT_FIELD_DATE:  return "date";
+        default:                  return "name";
+    }
+}
+
+// ------------------------------------------
+// List the contacts of one group in the Duplicates dialog
+// The first is kept; values the merge would leave behind are marked.
+// ------------------------------------------
+void ShowDuplicateGroup(HWND hDlg, int group) {
+    const DedupResult *result = &g_dedupReview->dedup;
+    SendDlgItemMessage(hDlg, IDC_DUP_MEMBERS, LB_RESETCONTENT, 0, 0);
+    if (group < 0 || group >= result->groupCount) return;
+
+    DedupDropped dropped[DEDUP_MAX_GROUP * DEDUP_MERGED_FIELDS];
+    int lost = Dedup_Dropped(&g_store, result, &group, 1, dropped, DEDUP_MAX_GROUP * DEDUP_MERGED_FIELDS);
+    for (int m = result->groupStart[group]; m < result->groupStart[group + 1]; m++) {
+        int row = result->members[m];
+        const char *values[DEDUP_MERGED_FIELDS] = {
+            Store_GetPhone(&g_store, row), Store_GetEmail(&g_store, row), Store_GetDate(&g_store, row)
+        };
+        const char *marks[DEDUP_MERGED_FIELDS] = { "", "", "" };
+        for (int d = 0; d < lost; d++) {
+            if (dropped[d].row != row) continue;
+            int f = dropped[d].field == CONTACT_FIELD_PHONE ? 0 : dropped[d].field == CONTACT_FIELD_EMAIL ? 1 : 2;
+            marks[f] = " (lost)";
+        }
+        char line[512];
+        snprintf(line, sizeof(line), "%s  %s  |  %s%s  |  %s%s  |  %s%s",
+                 m == result->groupStart[group] ? "keep " : "merge", Store_GetName(&g_store, row),
+                 values[0], marks[0], values[1], marks[1], values[2], marks[2]);
+        SendDlgItemMessage(hDlg, IDC_DUP_MEMBERS, LB_ADDSTRING, 0, (LPARAM)line);
+    }
+}
+
+// ------------------------------------------
+// Dialog procedure for reviewing duplicates
+// Groups that would lose no value start selected.
+// ------------------------------------------
+INT_PTR CALLBACK DuplicatesDlgProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam) {
+    (void)lParam;
+    const DedupResult *result = &g_dedupReview->dedup;
+    switch(message) {
+        case WM_INITDIALOG: {
+            HWND groups = GetDlgItem(hDlg, IDC_DUP_GROUPS);
+            SendMessage(groups, LB_INITSTORAGE, (WPARAM)result->groupCount, (LPARAM)result->groupCount * 64);
+            for (int g = 0; g < result->groupCount; g++) {
+                int size = result->groupStart[g + 1] - result->groupStart[g];
+                int lost = Dedup_Dropped(&g_store, result, &g, 1, NULL, 0);
+                char line[256];
+                int len = snprintf(line, sizeof(line), "%s: %d contacts (score %.2f)",
+                                   Store_GetName(&g_store, result->members[result->groupStart[g]]), size,
+                                   result->groupScore[g]);
+                if (lost > 0 && len < (int)sizeof(line)) {
+                    snprintf(line + len, sizeof(line) - (size_t)len, " - %d value%s would be lost", lost,
+                             lost > 1 ? "s" : "");
+                }
+                SendMessage(groups, LB_ADDSTRING, 0, (LPARAM)line);
+                if (lost == 0) SendMessage(groups, LB_SETSEL, TRUE, g);
+            }
+            SendMessage(groups, LB_SETCARETINDEX, 0, FALSE);
+            ShowDuplicateGroup(hDlg, 0);
+            return (INT_PTR)TRUE;
+        }
+
+        case WM_COMMAND:
+            if (LOWORD(wParam) == IDC_DUP_GROUPS && HIWORD(wParam) == LBN_SELCHANGE) {
+                ShowDuplicateGroup(hDlg, (int)SendDlgItemMessage(hDlg, IDC_DUP_GROUPS, LB_GETCARETINDEX, 0, 0));
+            } else if (LOWORD(wParam) == IDC_DUP_SELECT_ALL) {
+                SendDlgItemMessage(hDlg, IDC_DUP_GROUPS, LB_SETSEL, TRUE, -1);
+            } else if (LOWORD(wParam) == IDOK) {
+                int count = (int)SendDlgItemMessage(hDlg, IDC_DUP_GROUPS, LB_GETSELCOUNT, 0, 0);
+                if (count <= 0) {
+                    MessageBox(hDlg, "Select the groups to merge.", "Duplicates", MB_OK|MB_ICONINFORMATION);
+                    return (INT_PTR)TRUE;
+                }
+                g_dedupGroups = (int*)malloc((size_t)count * sizeof(int));
+                if (!g_dedupGroups) {
+                    MessageBox(hDlg, "Out of memory while merging duplicates!", "Error", MB_OK|MB_ICONERROR);
+                    return (INT_PTR)TRUE;
+                }
+                g_dedupGroupCount = (int)SendDlgItemMessage(hDlg, IDC_DUP_GROUPS, LB_GETSELITEMS, (WPARAM)count,
+                                                            (LPARAM)g_dedupGroups);
+                EndDialog(hDlg, IDOK);
+            } else if (LOWORD(wParam) == IDCANCEL) {
+                EndDialog(hDlg, IDCANCEL);
+            }
+            return (INT_PTR)TRUE;
+    }
+    return (INT_PTR)FALSE;
+}
+
+// ------------------------------------------
+// Worker thread callback: have the message loop poll the job queue
+// ------------------------------------------
+void NotifyJobs(void *context) {
+    PostMessage((HWND)context, WM_JOB, 0, 0);
+}
+
+// ------------------------------------------
+// Queue a job made by one of the ContactJob_* constructors
+// Returns 0 (and frees it) if it could not be queued.
+// ------------------------------------------
+int SubmitJob(ContactJob *job) {
+    if (!job) {
+        ShowError("Out of memory while starting the operation!");
+        return 0;
+    }
+    if (!JobQueue_Submit(&g_jobs, &job->job)) {
+        ContactJob_Free(job);
+        ShowError("Could not start a background thread!");
+        return 0;
+    }
+    if (ContactJob_Exclusive(job)) {
+        g_exclusiveJob = job;
+    } else if (job->kind == CONTACT_JOB_SAVE) {
+        g_saveJob = job;
+    } else {
+        g_exportJob = job;
+    }
+    ShowJobProgress(job, 0, 0);
+    return 1;
+}
+
+// ------------------------------------------
+// Refuse a change while the exclusive job is pending
+// Returns 1 (after telling the user) if there is one.
+// ------------------------------------------
+int JobBusy() {
+    if (!g_exclusiveJob) return 0;
+    char message[160];
+    snprintf(message, sizeof(message), "%s is still in progress. Please wait for it to finish, "
+             "or cancel it from the menu.", ContactJob_Title(g_exclusiveJob));
+    ShowInfo(message);
+    return 1;
+}
+
+// ------------------------------------------
+// Ask every pending job to stop
+// A save that has started writing completes; the others stop at their
+// next step and leave the contacts as they were.
+// ------------------------------------------
+void CancelJobs() {
+    if (!g_exclusiveJob && !g_saveJob && !g_exportJob) {
+        ShowInfo("No background job is running.");
+        return;
+    }
+    if (g_exclusiveJob) JobQueue_Cancel(&g_jobs, &g_exclusiveJob->job);
+    if (g_saveJob) JobQueue_Cancel(&g_jobs, &g_saveJob->job);
+    if (g_exportJob) JobQueue_Cancel(&g_jobs, &g_exportJob->job);
+}
+
+// ------------------------------------------
+// Take in what the workers reported since the last WM_JOB
+// A job is forgotten before its result is shown: a message box runs a
+// nested message loop, which may come back here.
+// ------------------------------------------
+void HandleJobEvents() {
+    JobEvent event;
+    while (JobQueue_Poll(&g_jobs, &event)) {
+        ContactJob *job = (ContactJob*)event.job;
+        if (event.state == JOB_QUEUED || event.state == JOB_RUNNING) {
+            ShowJobProgress(job, event.done, event.total);
+            continue;
+        }
+        if (job == g_exclusiveJob) g_exclusiveJob = NULL;
+        if (job == g_saveJob) g_saveJob = NULL;
+        if (job == g_exportJob) g_exportJob = NULL;
+        ShowJobProgress(g_exclusiveJob ? g_exclusiveJob : g_saveJob ? g_saveJob : g_exportJob, 0, 0);
+        if (event.state == JOB_FINISHED) {
+            FinishJob(job);
+        }
+        ContactJob_Free(job);
+    }
+}
+
+// ------------------------------------------
+// Adopt the results of a job that ran to the end
+// Whatever is moved out of the job is re-initialized there, so that
+// ContactJob_Free leaves it alone.
+// ------------------------------------------
+void FinishJob(ContactJob *job) {
+    char message[512];
+    switch (job->kind) {
+        case CONTACT_JOB_LOAD:
+            if (job->status == CONTACT_FILE_OK) {
+                StopLiveSearch();
+                Store_Free(&g_store);
+                g_store = job->store;
+                Store_Init(&job->store);
+                Journal_Close(&g_journal);
+                g_journal = job->journal;
+                Journal_Init(&job->journal);
+                TrigramIndex_Free(&g_index);
+                SortIndex_Free(&g_sortIndex);
+                PhoneIndex_Free(&g_phoneIndex);
+                g_index = job->index;
+                g_sortIndex = job->sortIndex;
+                g_phoneIndex = job->phoneIndex;
+                TrigramIndex_Init(&job->index);
+                SortIndex_Init(&job->sortIndex);
+                PhoneIndex_Init(&job->phoneIndex);
+                if (!job->indexed) {
+                    TrigramIndex_Build(&g_index, &g_store);
+                    SortIndex_Build(&g_sortIndex, &g_store);
+                    PhoneIndex_Build(&g_phoneIndex, &g_store);
+                }
+                Autocomplete_Invalidate(&g_complete);
+                DisplayContacts(g_hListView, NULL);
+                ShowInfo("Contacts loaded and decrypted from contacts.txt!");
+            } else if (job->status == CONTACT_FILE_BAD_PASSPHRASE) {
+                // Forget it so the next attempt asks again
+                SecureZeroMemory(g_passphrase, sizeof(g_passphrase));
+                ShowError(ContactFile_StatusMessage(job->status));
+            } else if (job->status == CONTACT_FILE_NOT_FOUND) {
+                ShowInfo("No file found to load.");
+            } else if (job->status == CONTACT_FILE_EMPTY) {
+                ShowInfo("No valid contacts found in the file. Existing contacts remain unchanged.");
+            } else {
+                ShowError(ContactFile_StatusMessage(job->status));
+            }
+            break;
+
+        case CONTACT_JOB_SAVE:
+            if (job->status == CONTACT_FILE_OK) {
+                // The new journal follows the snapshot that was saved: it
+                // only fits if nothing changed since. Otherwise the next
+                // save is a full one again.
+                if (g_changes == g_saveChanges) {
+                    Journal_Close(&g_journal);
+                    g_journal = job->journal;
+                    Journal_Init(&job->journal);
+                }
+                ShowInfo("Contacts saved (encrypted) to contacts.txt!");
+            } else {
+                ShowError(ContactFile_StatusMessage(job->status));
+            }
+            break;
+
+        case CONTACT_JOB_IMPORT: {
+            ImportResult *result = &job->import;
+            if (job->store.count > job->first) {
+                // The copy is the store plus the imported rows
+                StopLiveSearch();
+                Store_Free(&g_store);
+                g_store = job->store;
+                Store_Init(&job->store);
+                TrigramIndex_Free(&g_index);
+                SortIndex_Free(&g_sortIndex);
+                PhoneIndex_Free(&g_phoneIndex);
+                g_index = job->index;
+                g_sortIndex = job->sortIndex;
+                g_phoneIndex = job->phoneIndex;
+                TrigramIndex_Init(&job->index);
+                SortIndex_Init(&job->sortIndex);
+                PhoneIndex_Init(&job->phoneIndex);
+                if (!job->indexed) {
+                    TrigramIndex_Build(&g_index, &g_store);
+                    SortIndex_Build(&g_sortIndex, &g_store);
+                    PhoneIndex_Build(&g_phoneIndex, &g_store);
+                }
+                Autocomplete_Invalidate(&g_complete);
+                JournalImport(job->first);
+                DisplayContacts(g_hListView, NULL);
+            }
+            if (job->status != CONTACT_FILE_OK) {
+                ShowError(ContactFile_StatusMessage(job->status));
+                break;
+            }
+            int len = snprintf(message, sizeof(message), "Imported %d of %d contacts.", result->imported, result->rows);
+            for (int i = 0; i < result->rejectedCount && i < 5 && len < (int)sizeof(message); i++) {
+                len += snprintf(message + len, sizeof(message) - (size_t)len, "\nLine %lld: %s",
+                                result->rejected[i].line, Import_ReasonText(result->rejected[i].reason));
+            }
+            if (result->rejectedCount > 5 && len < (int)sizeof(message)) {
+                snprintf(message + len, sizeof(message) - (size_t)len, "\n... and %d more rejected rows.",
+                         result->rejectedCount - 5);
+            }
+            ShowInfo(message);
+            break;
+        }
+
+        case CONTACT_JOB_EXPORT:
+            if (job->status != CONTACT_FILE_OK) {
+                ShowError(ContactFile_StatusMessage(job->status));
+            } else {
+                snprintf(message, sizeof(message), "Exported %d contacts.", job->exported);
+                ShowInfo(message);
+            }
+            break;
+
+        case CONTACT_JOB_DEDUP:
+            if (job->status != CONTACT_FILE_OK) {
+                ShowError("Out of memory while looking for duplicates!");
+            } else if (job->dedup.groupCount == 0) {
+                ShowInfo("No duplicates found.");
+            } else {
+                ReviewDuplicates(job);
+            }
+            break;
+
+        case CONTACT_JOB_MERGE: {
+            if (job->status != CONTACT_FILE_OK) {
+                ShowError("Out of memory while merging duplicates!");
+                break;
+            }
+            // The copy is the store with the groups merged, at the same positions
+            StopLiveSearch();
+            Store_Free(&g_store);
+            g_store = job->store;
+            Store_Init(&job->store);
+            TrigramIndex_Free(&g_index);
+            SortIndex_Free(&g_sortIndex);
+            PhoneIndex_Free(&g_phoneIndex);
+            g_index = job->index;
+            g_sortIndex = job->sortIndex;
+            g_phoneIndex = job->phoneIndex;
+            TrigramIndex_Init(&job->index);
+            SortIndex_Init(&job->sortIndex);
+            PhoneIndex_Init(&job->phoneIndex);
+            if (!job->indexed) {
+                TrigramIndex_Build(&g_index, &g_store);
+                SortIndex_Build(&g_sortIndex, &g_store);
+                PhoneIndex_Build(&g_phoneIndex, &g_store);
+            }
+            Autocomplete_Invalidate(&g_complete);
+            const DedupResult *result = &job->dedup;
+            for (int i = 0; i < job->count; i++) {
+                int first = result->groupStart[job->rows[i]];
+                int last = result->groupStart[job->rows[i] + 1];
+                if (!Store_IsDeleted(&g_store, result->members[first + 1])) continue;  // Left alone
+                JournalChange(JOURNAL_UPDATE, result->members[first]);
+                for (int m = first + 1; m < last; m++) {
+                    JournalChange(JOURNAL_DELETE, result->members[m]);
+                }
+            }
+            DisplayContacts(g_hListView, NULL);
+            SchedulePurge();
+            CheckpointIfNeeded();
+
+            // Merged-away contacts hold one phone, email and date each: the
+            // ones their survivor already had a different value for are gone
+            int len = snprintf(message, sizeof(message), "Merged away %d duplicate contacts.", job->merged);
+            if (job->droppedCount > 0 && len < (int)sizeof(message)) {
+                len += snprintf(message + len, sizeof(message) - (size_t)len,
+                                "\n\n%d values differed from the contact kept and were not kept:",
+                                job->droppedCount);
+            }
+            for (int i = 0; i < job->droppedCount && i < 8 && len < (int)sizeof(message); i++) {
+                const DedupDropped *dropped = &job->dropped[i];
+                len += snprintf(message + len, sizeof(message) - (size_t)len, "\n%s: %s %s",
+                                Store_GetName(&g_store, result->members[result->groupStart[dropped->group]]),
+                                MergedFieldName(dropped->field), dropped->value);
+            }
+            if (job->droppedCount > 8 && len < (int)sizeof(message)) {
+                snprintf(message + len, sizeof(message) - (size_t)len, "\n... and %d more.", job->droppedCount - 8);
+            }
+            ShowInfo(message);
+            break;
+        }
+
+        case CONTACT_JOB_SORT:
+            if (job->status != CONTACT_FILE_OK) {
+                ShowError("Out of memory while sorting contacts!");
+                break;
+            }
+            SortIndex_Free(&g_sortIndex);
+            g_sortIndex = job->sortIndex;
+            SortIndex_Init(&job->sortIndex);
+            ContactView_SetSort(&g_view, &g_store, &g_sortIndex, g_jobSortColumn);
+            RefreshListView(g_hListView);
+            break;
+    }
+}
+
+// ------------------------------------------
+// Show what runs in the background in the title bar
+// 'job' NULL restores the plain title.
+// ------------------------------------------
+void ShowJobProgress(const ContactJob *job, int done, int total) {
+    char title[96] = "Contact Management System";
+    if (job) {
+        int percent = total > 0 ? (int)((long long)done * 100 / total) : 0;
+        snprintf(title, sizeof(title), "Contact Management System - %s %d%%", ContactJob_Title(job), percent);
+    }
+    SetWindowText(g_hMainWnd, title);
+}
+
+// ------------------------------------------
+// Show an error message box
+// ------------------------------------------
+void ShowError(const char *msg) {
+    MessageBox(g_hMainWnd, msg, "Error", MB_OK | MB_ICONERROR);
+}
+
+// ------------------------------------------
+// Show an info message box
+// ------------------------------------------
+void ShowInfo(const char *msg) {
+    MessageBox(g_hMainWnd, msg, "Info", MB_OK | MB_ICONINFORMATION);
+}
+
+// ------------------------------------------
+// Perform a search based on the text entered in the search box
+// Displays only those contacts whose name, phone or email contains the query
+// Runs the search to completion, unlike typing.
+// ------------------------------------------
+void PerformSearch() {
+    char query[256];
+    GetWindowText(GetDlgItem(g_hMainWnd, IDC_SEARCH_EDIT), query, sizeof(query));
+    StopLiveSearch();
+    if (Query_IsStructured(query)) {
+        ShowQueryResults(query, 1);
+        return;
+    }
+    DisplayContacts(g_hListView, query);
+    if (g_view.count == 0) ShowFuzzyMatches(query);
+}
+
+// ------------------------------------------
+// Show the contacts matching a structured query such as
+// "email ends-with @corp.com AND date >= 2024-01-01", through the most
+// selective index. While typing ('interactive' unset) the query is still
+// incomplete more often than not: syntax errors are not reported and
+// costly queries wait for Go.
+// ------------------------------------------
+void ShowQueryResults(const char *text, int interactive) {
+    Query query;
+    if (!Query_Parse(&query, text)) {
+        if (interactive) MessageBox(g_hMainWnd, query.error, "Query", MB_OK | MB_ICONERROR);
+        return;
+    }
+    QueryIndexes indexes = { &g_index, &g_phoneIndex, &g_sortIndex };
+    Query_Plan(&query, &g_store, &indexes);
+    if (!interactive && query.cost > QUERY_LIVE_COST) return;
+
+    int *rows = (int*)malloc((size_t)(g_store.count > 0 ? g_store.count : 1) * sizeof(int));
+    if (!rows) return;
+    int count = Query_Run(&query, &g_store, &indexes, rows);
+    if (count >= 0) DisplayRows(g_hListView, rows, count);
+    free(rows);
+}
+
+// ------------------------------------------
+// Nothing contains the query: show the names that match it despite a typo
+// or two instead ("Jonh" finds "John"), closest first unless a column
+// sort is active. Leaves the empty result alone for queries too short to
+// allow typos.
+// ------------------------------------------
+void ShowFuzzyMatches(const char *query) {
+    int maxDistance = FuzzySearch_DefaultDistance(strlen(query));
+    if (maxDistance == 0 || strlen(query) > FUZZY_MAX_QUERY) return;
+
+    int *rows = (int*)malloc((size_t)(g_store.count > 0 ? g_store.count : 1) * sizeof(int));
+    if (!rows) return;
+    int count = FuzzySearch_Names(&g_store, &g_index, query, maxDistance, Platform_CpuCount(), rows, NULL);
+    if (count > 0) DisplayRows(g_hListView, rows, count);
+    free(rows);
+}
+
+// ------------------------------------------
+// Clear the search filter and show all contacts
+// ------------------------------------------
+void ClearSearchFilter() {
+    SetWindowText(GetDlgItem(g_hMainWnd, IDC_SEARCH_EDIT), "");
+    StopLiveSearch();
+    DisplayContacts(g_hListView, NULL);
+}
+
+// ------------------------------------------
+// Complete the name being typed in the search box with the most frequent
+// name it starts, selecting the added text so the next keystroke replaces
+// it. Only when the text grew at its end: deleting must not bring the
+// completion back.
+// ------------------------------------------
+void CompleteSearchText() {
+    static size_t typedLength = 0;
+    HWND hEdit = GetDlgItem(g_hMainWnd, IDC_SEARCH_EDIT);
+    char text[CONTACT_NAME_SIZE];
+    Completion best;
+    DWORD start = 0, end = 0;
+
+    GetWindowText(hEdit, text, sizeof(text));
+    size_t length = strlen(text);
+    size_t previous = typedLength;
+    typedLength = length;
+    SendMessage(hEdit, EM_GETSEL, (WPARAM)&start, (LPARAM)&end);
+    if (length <= previous || start != length || Query_IsStructured(text) || !EnsureCompletions()) return;
+    if (Autocomplete_Lookup(&g_complete, COMPLETE_NAME, text, &best, 1) != 1) return;
+
+    size_t full = strlen(best.text);
+    if (full <= length) return;
+    // Keep what was typed, in the case it was typed, and add the rest
+    snprintf(text + length, sizeof(text) - length, "%s", best.text + length);
+    g_completingSearch = 1;
+    SetWindowText(hEdit, text);
+    SendMessage(hEdit, EM_SETSEL, length, -1);
+    g_completingSearch = 0;
+}
+
+// ------------------------------------------
+// Start filtering for the current search box text
+// Refines the previous results when the new text contains the old one.
+// Text selected at the end is an inline completion and is not searched
+// for until accepted.
+// ------------------------------------------
+void StartLiveSearch() {
+    char query[256];
+    DWORD start = 0, end = 0;
+    HWND hEdit = GetDlgItem(g_hMainWnd, IDC_SEARCH_EDIT);
+    GetWindowText(hEdit, query, sizeof(query));
+    SendMessage(hEdit, EM_GETSEL, (WPARAM)&start, (LPARAM)&end);
+    if (start < end && end == strlen(query)) query[start] = '\0';
+    if (Query_IsStructured(query)) {
+        StopLiveSearch();
+        ShowQueryResults(query, 0);
+        return;
+    }
+    if (!LiveSearch_Start(&g_liveSearch, &g_store, &g_index, query)) {
+        PerformSearch();
+        return;
+    }
+    ContinueLiveSearch();
+}
+
+// ------------------------------------------
+// Advance the live search in slices of LIVE_SEARCH_BUDGET_MS while no
+// input is waiting. A pending keystroke wins: the timer resumes the search
+// later unless that keystroke has replaced it.
+// ------------------------------------------
+void ContinueLiveSearch() {
+    int done = LiveSearch_Step(&g_liveSearch, &g_store, LIVE_SEARCH_BUDGET_MS);
+    while (!done && HIWORD(GetQueueStatus(QS_INPUT)) == 0) {
+        done = LiveSearch_Step(&g_liveSearch, &g_store, LIVE_SEARCH_BUDGET_MS);
+    }
+
+    if (!done) {
+        SetTimer(g_hMainWnd, IDT_LIVE_SEARCH, USER_TIMER_MINIMUM, NULL);
+        return;
+    }
+    KillTimer(g_hMainWnd, IDT_LIVE_SEARCH);
+    if (g_liveSearch.active && g_liveSearch.valid) {
+        DisplayRows(g_hListView, g_liveSearch.results, g_liveSearch.count);
+        if (g_liveSearch.count == 0) ShowFuzzyMatches(g_liveSearch.query);
+    }
+}
+
+// ------------------------------------------
+// Drop the live search; called before the store changes
+// ------------------------------------------
+void StopLiveSearch() {
+    KillTimer(g_hMainWnd, IDT_LIVE_SEARCH);
+    LiveSearch_Cancel(&g_liveSearch);
+    LiveSearch_Invalidate(&g_liveSearch);
+}
@@ -0,0 +1,774 @@
+// ------------------------------------------
+// ContactBench: times the core contact operations on synthetic
+// address books and prints the results as JSON.
+//
+// Usage: ContactBench [--sizes 1k,10k,100k,1M] [--reps N] [--queries N]
+//                     [--deletes N] [--seed N] [--file path] [--out path]
+// ------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+#include "Autocomplete.h"
+#include "ContactStore.h"
+#include "ContactFile.h"
+#include "ContactJobs.h"
+#include "ContactSort.h"
+#include "DateKey.h"
+#include "Dedup.h"
+#include "Export.h"
+#include "FuzzySearch.h"
+#include "Import.h"
+#include "Journal.h"
+#include "PhoneIndex.h"
+#include "Platform.h"
+#include "Query.h"
+#include "Search.h"
+#include "SortIndex.h"
+#include "SynthContacts.h"
+
+#define MAX_SIZES 16
+
+typedef struct {
+    int      sizes[MAX_SIZES];
+    int      sizeCount;
+    int      reps;       // Repetitions of the bulk operations
+    int      queries;    // Search queries per size
+    int      deletes;    // Single deletes per size
+    uint64_t seed;
+    const char *file;    // Scratch file for save/load
+    FILE    *out;
+} BenchOptions;
+
+static int s_firstResult = 1;
+
+// ------------------------------------------
+// Monotonic clock in milliseconds
+// ------------------------------------------
+static double Bench_NowMs(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1000.0 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+#endif
+}
+
+// ------------------------------------------
+// Peak resident set size of the process in KB
+// ------------------------------------------
+static long Bench_PeakRssKb(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return (long)(pmc.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#endif
+}
+
+static int CompareDoubles(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// ------------------------------------------
+// Nearest-rank percentile of sorted samples
+// ------------------------------------------
+static double Bench_Percentile(const double *sorted, int count, double pct) {
+    int rank = (int)(pct / 100.0 * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+// ------------------------------------------
+// Print one result object
+// 'itemsPerSample' is the work done by one timed sample, used for the
+// throughput figure (records/s for bulk operations, queries/s, ...).
+// ------------------------------------------
+static void Bench_Report(BenchOptions *opt, int size, const char *operation, const char *status,
+                         double *samples, int count, double itemsPerSample, const char *unit) {
+    double total = 0.0;
+    for (int i = 0; i < count; i++) total += samples[i];
+    qsort(samples, count, sizeof(double), CompareDoubles);
+
+    fprintf(opt->out, "%s\n    {\"size\": %d, \"operation\": \"%s\", \"status\": \"%s\", \"iterations\": %d",
+            s_firstResult ? "" : ",", size, operation, status, count);
+    if (count > 0) {
+        double throughput = total > 0.0 ? itemsPerSample * count / (total / 1000.0) : 0.0;
+        fprintf(opt->out, ", \"throughput\": %.1f, \"throughput_unit\": \"%s\""
+                          ", \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"mean_ms\": %.4f",
+                throughput, unit,
+                Bench_Percentile(samples, count, 50.0), Bench_Percentile(samples, count, 99.0),
+                total / count);
+    }
+    fprintf(opt->out, ", \"peak_rss_kb\": %ld}", Bench_PeakRssKb());
+    fflush(opt->out);
+    s_firstResult = 0;
+}
+
+// ------------------------------------------
+// Print the size of an in-memory structure holding 'keys' distinct keys
+// ------------------------------------------
+static void Bench_ReportMemory(BenchOptions *opt, int size, const char *operation, size_t bytes, long keys) {
+    fprintf(opt->out, "%s\n    {\"size\": %d, \"operation\": \"%s\", \"status\": \"ok\""
+                      ", \"bytes\": %zu, \"keys\": %ld, \"bytes_per_key\": %.1f}",
+            s_firstResult ? "" : ",", size, operation, bytes, keys,
+            keys > 0 ? (double)bytes / (double)keys : 0.0);
+    fflush(opt->out);
+    s_firstResult = 0;
+}
+
+// ------------------------------------------
+// Shuffle the record order so every sort index build starts from random input
+// ------------------------------------------
+static void Bench_Shuffle(ContactStore *store, SynthRng *rng) {
+    int *rows = (int*)malloc((size_t)(store->count > 0 ? store->count : 1) * sizeof(int));
+    if (!rows) return;
+    for (int i = 0; i < store->count; i++) rows[i] = i;
+    for (int i = store->count - 1; i > 0; i--) {
+        int j = (int)Synth_Below(rng, (uint32_t)i + 1);
+        int tmp = rows[i];
+        rows[i] = rows[j];
+        rows[j] = tmp;
+    }
+    // Ids are renumbered in the new order, so they keep ascending
+    Store_Permute(store, rows);
+    free(rows);
+}
+
+typedef ContactFileStatus (*SaveFn)(const ContactStore *store, const char *filename);
+typedef ContactFileStatus (*LoadFn)(ContactStore *out, const char *filename);
+
+static ContactFileStatus Bench_SaveRSA(const ContactStore *store, const char *filename) {
+    return ContactFile_SaveRSA(store, filename);
+}
+
+static ContactFileStatus Bench_SaveV2(const ContactStore *store, const char *filename) {
+    return ContactFile_SaveV2(store, filename, CONTACT_V2_COMPRESSED, NULL);
+}
+
+static ContactFileStatus Bench_LoadV2(ContactStore *out, const char *filename) {
+    return ContactFile_LoadV2(out, filename, NULL);
+}
+
+// Includes one PBKDF2 key derivation per save and per load
+#define BENCH_PASSPHRASE "correct horse battery staple"
+
+static ContactFileStatus Bench_SaveV2Encrypted(const ContactStore *store, const char *filename) {
+    return ContactFile_SaveV2(store, filename, CONTACT_V2_COMPRESSED | CONTACT_V2_ENCRYPTED, BENCH_PASSPHRASE);
+}
+
+static ContactFileStatus Bench_LoadV2Encrypted(ContactStore *out, const char *filename) {
+    return ContactFile_LoadV2(out, filename, BENCH_PASSPHRASE);
+}
+
+// ------------------------------------------
+// Time 'reps' saves, then 'reps' loads of the saved file
+// ------------------------------------------
+static void Bench_SaveLoad(BenchOptions *opt, const ContactStore *store, int size,
+                           const char *saveName, const char *loadName,
+                           SaveFn save, LoadFn load, double *samples) {
+    int done = 0;
+    ContactFileStatus status = CONTACT_FILE_OK;
+    for (; done < opt->reps; done++) {
+        double t0 = Bench_NowMs();
+        status = save(store, opt->file);
+        samples[done] = Bench_NowMs() - t0;
+        if (status != CONTACT_FILE_OK) break;
+    }
+    Bench_Report(opt, size, saveName, status == CONTACT_FILE_OK ? "ok" : ContactFile_StatusMessage(status),
+                 samples, done, size, "records/s");
+
+    int saved = (status == CONTACT_FILE_OK);
+    done = 0;
+    for (; saved && done < opt->reps; done++) {
+        ContactStore loaded;
+        double t0 = Bench_NowMs();
+        status = load(&loaded, opt->file);
+        samples[done] = Bench_NowMs() - t0;
+        Store_Free(&loaded);
+        if (status != CONTACT_FILE_OK) break;
+    }
+    Bench_Report(opt, size, loadName, !saved ? "skipped" : status == CONTACT_FILE_OK ? "ok" : ContactFile_StatusMessage(status),
+                 samples, done, size, "records/s");
+    remove(opt->file);
+}
+
+// ------------------------------------------
+// Incremental saves: an encrypted snapshot, then single edits appended to
+// its journal and committed (synced) one at a time, then the snapshot
+// loaded with the journal replayed on top
+// ------------------------------------------
+static void Bench_Journal(BenchOptions *opt, ContactStore *store, int size, SynthRng *rng, double *samples) {
+    char journalPath[1024];
+    snprintf(journalPath, sizeof(journalPath), "%s.journal", opt->file);
+    Journal journal;
+    Journal_Init(&journal);
+    ContactFileStatus status = Bench_SaveV2Encrypted(store, opt->file);
+    if (status == CONTACT_FILE_OK) status = Journal_Create(&journal, opt->file, BENCH_PASSPHRASE);
+
+    int done;
+    for (done = 0; status == CONTACT_FILE_OK && done < opt->deletes; done++) {
+        char name[CONTACT_NAME_SIZE], phone[CONTACT_PHONE_SIZE], email[CONTACT_EMAIL_SIZE], date[CONTACT_DATE_SIZE];
+        Synth_Contact(rng, name, phone, email, date);
+        int row = (int)Synth_Below(rng, (uint32_t)store->count);
+        double t0 = Bench_NowMs();
+        Store_Update(store, row, name, phone, email, date);
+        if (!Journal_Append(&journal, JOURNAL_UPDATE, store, row) || !Journal_Commit(&journal)) {
+            status = CONTACT_FILE_WRITE_FAILED;
+        }
+        samples[done] = Bench_NowMs() - t0;
+    }
+    Journal_Close(&journal);
+    Bench_Report(opt, size, "journal_commit", status == CONTACT_FILE_OK ? "ok" : ContactFile_StatusMessage(status),
+                 samples, done, 1, "edits/s");
+
+    done = 0;
+    if (status == CONTACT_FILE_OK) {
+        ContactStore loaded;
+        double t0 = Bench_NowMs();
+        status = ContactFile_LoadV2(&loaded, opt->file, BENCH_PASSPHRASE);
+        if (status == CONTACT_FILE_OK) status = Journal_Open(&journal, opt->file, BENCH_PASSPHRASE, &loaded);
+        samples[0] = Bench_NowMs() - t0;
+        done = status == CONTACT_FILE_OK;
+        Journal_Close(&journal);
+        Store_Free(&loaded);
+    }
+    Bench_Report(opt, size, "journal_replay", done ? "ok" : ContactFile_StatusMessage(status),
+                 samples, done, size, "records/s");
+    remove(journalPath);
+    remove(opt->file);
+}
+
+// ------------------------------------------
+// Streaming export of the whole store in each format
+// ------------------------------------------
+static void Bench_Export(BenchOptions *opt, const ContactStore *store, int size, double *samples) {
+    static const struct { const char *operation; const char *extension; ExportFormat format; } kinds[] = {
+        { "export_csv",   "csv",   EXPORT_CSV },
+        { "export_vcard", "vcf",   EXPORT_VCARD },
+        { "export_jsonl", "jsonl", EXPORT_JSONL },
+    };
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s.%s", opt->file, kinds[k].extension);
+        int done;
+        ContactFileStatus status = CONTACT_FILE_OK;
+        for (done = 0; status == CONTACT_FILE_OK && done < opt->reps; done++) {
+            double t0 = Bench_NowMs();
+            status = Export_File(store, NULL, 0, path, kinds[k].format, NULL);
+            samples[done] = Bench_NowMs() - t0;
+        }
+        Bench_Report(opt, size, kinds[k].operation, status == CONTACT_FILE_OK ? "ok" : ContactFile_StatusMessage(status),
+                     samples, done, size, "records/s");
+        remove(path);
+    }
+}
+
+// ------------------------------------------
+// Bulk import: the store exported as CSV, then imported into an empty
+// store (parsing, validation and batched inserts)
+// ------------------------------------------
+static void Bench_Import(BenchOptions *opt, const ContactStore *store, int size, double *samples) {
+    char csvPath[1024];
+    snprintf(csvPath, sizeof(csvPath), "%s.csv", opt->file);
+    ContactFileStatus status = Export_File(store, NULL, 0, csvPath, EXPORT_CSV, NULL);
+
+    int done;
+    for (done = 0; status == CONTACT_FILE_OK && done < opt->reps; done++) {
+        ContactStore imported;
+        ImportResult result;
+        Store_Init(&imported);
+        status = Import_File(&imported, csvPath, IMPORT_CSV, &result);
+        samples[done] = result.ms;
+        Import_FreeResult(&result);
+        Store_Free(&imported);
+    }
+    Bench_Report(opt, size, "import_csv", status == CONTACT_FILE_OK ? "ok" : ContactFile_StatusMessage(status),
+                 samples, done, size, "records/s");
+    remove(csvPath);
+}
+
+// ------------------------------------------
+// Encrypted save as a background job: how long the submitting (UI)
+// thread is held making the snapshot, and how long until the job ends
+// ------------------------------------------
+static void Bench_SaveJob(BenchOptions *opt, const ContactStore *store, int size, double *samples) {
+    JobQueue queue;
+    double *totals = (double*)malloc((size_t)opt->reps * sizeof(double));
+    if (!totals || !JobQueue_Init(&queue, 1, NULL, NULL)) {
+        Bench_Report(opt, size, "job_save_submit", "out of memory", samples, 0, 1, "jobs/s");
+        free(totals);
+        return;
+    }
+    ContactFileStatus status = CONTACT_FILE_OK;
+    int done;
+    for (done = 0; status == CONTACT_FILE_OK && done < opt->reps; done++) {
+        double t0 = Bench_NowMs();
+        ContactJob *job = ContactJob_Save(store, opt->file, CONTACT_V2_COMPRESSED | CONTACT_V2_ENCRYPTED,
+                                          BENCH_PASSPHRASE);
+        if (!job || !JobQueue_Submit(&queue, &job->job)) {
+            ContactJob_Free(job);
+            status = CONTACT_FILE_NO_MEMORY;
+            break;
+        }
+        samples[done] = Bench_NowMs() - t0;
+        JobQueue_Wait(&queue);
+        totals[done] = Bench_NowMs() - t0;
+        JobEvent event;
+        while (JobQueue_Poll(&queue, &event)) {
+            if (event.state == JOB_FINISHED || event.state == JOB_CANCELLED) status = job->status;
+        }
+        ContactJob_Free(job);
+    }
+    JobQueue_Free(&queue);
+    const char *result = status == CONTACT_FILE_OK ? "ok" : ContactFile_StatusMessage(status);
+    Bench_Report(opt, size, "job_save_submit", result, samples, done, 1, "jobs/s");
+    Bench_Report(opt, size, "job_save", result, totals, done, 1, "jobs/s");
+    free(totals);
+    char journalPath[1024];
+    snprintf(journalPath, sizeof(journalPath), "%s.journal", opt->file);
+    remove(journalPath);
+    remove(opt->file);
+}
+
+// ------------------------------------------
+// A 3-5 character substring of a random contact's name, like a typed query
+// ------------------------------------------
+static void Bench_RandomQuery(const ContactStore *store, SynthRng *rng, char query[8]) {
+    const char *name = Store_GetName(store, (int)Synth_Below(rng, (uint32_t)store->count));
+    size_t len = strlen(name);
+    size_t qlen = 3 + Synth_Below(rng, 3);
+    if (qlen > len) qlen = len;
+    size_t start = Synth_Below(rng, (uint32_t)(len - qlen + 1));
+    memcpy(query, name + start, qlen);
+    query[qlen] = '\0';
+}
+
+// ------------------------------------------
+// A random contact's full name with one or two typos (a replaced, a
+// dropped or two swapped characters), like a misspelt search
+// ------------------------------------------
+static void Bench_TypoQuery(const ContactStore *store, SynthRng *rng, char query[CONTACT_NAME_SIZE]) {
+    const char *name = Store_GetName(store, (int)Synth_Below(rng, (uint32_t)store->count));
+    size_t len = strlen(name);
+    if (len > FUZZY_MAX_QUERY) len = FUZZY_MAX_QUERY;
+    memcpy(query, name, len);
+    query[len] = '\0';
+    int typos = 1 + (int)Synth_Below(rng, 2);
+    for (int t = 0; t < typos && len > 2; t++) {
+        size_t at = Synth_Below(rng, (uint32_t)(len - 1));
+        switch (Synth_Below(rng, 3)) {
+        case 0:
+            query[at] = (char)('a' + Synth_Below(rng, 26));
+            break;
+        case 1:
+            memmove(query + at, query + at + 1, len - at);
+            len--;
+            break;
+        default: {
+            char c = query[at];
+            query[at] = query[at + 1];
+            query[at + 1] = c;
+            break;
+        }
+        }
+    }
+}
+
+// ------------------------------------------
+// Run every benchmark for one address book size
+// ------------------------------------------
+static void Bench_RunSize(BenchOptions *opt, int size) {
+    int sampleCapacity = opt->reps;
+    if (opt->queries > sampleCapacity) sampleCapacity = opt->queries;
+    if (opt->deletes > sampleCapacity) sampleCapacity = opt->deletes;
+    double *samples = (double*)malloc((size_t)sampleCapacity * sizeof(double));
+    int *matches = (int*)malloc((size_t)size * sizeof(int));
+    SynthRng rng;
+    Synth_Seed(&rng, opt->seed ^ (uint64_t)size);
+
+    ContactStore store;
+    Store_Init(&store);
+    double t0 = Bench_NowMs();
+    int generated = Synth_FillStore(&store, size, opt->seed);
+    samples[0] = Bench_NowMs() - t0;
+    Bench_Report(opt, size, "generate", generated ? "ok" : "out of memory", samples, 1, size, "records/s");
+    if (!generated || !matches) {
+        Store_Free(&store);
+        free(samples);
+        free(matches);
+        return;
+    }
+    Bench_ReportMemory(opt, size, "store_memory", Store_MemoryBytes(&store), size);
+
+    // Save, then load what was saved, in each file format
+    Bench_SaveLoad(opt, &store, size, "save", "load", Bench_SaveRSA, ContactFile_LoadRSA, samples);
+    Bench_SaveLoad(opt, &store, size, "save_v2", "load_v2", Bench_SaveV2, Bench_LoadV2, samples);
+    Bench_SaveLoad(opt, &store, size, "save_v2_enc", "load_v2_enc",
+                   Bench_SaveV2Encrypted, Bench_LoadV2Encrypted, samples);
+    Bench_Journal(opt, &store, size, &rng, samples);
+    Bench_Export(opt, &store, size, samples);
+    Bench_Import(opt, &store, size, samples);
+    Bench_SaveJob(opt, &store, size, samples);
+
+    // Sort index: full build of the four column orders from a shuffled
+    // store, then contacts edited in place with the orders kept sorted
+    int done;
+    SortIndex sortIndex;
+    SortIndex_Init(&sortIndex);
+    int sorted = 0;
+    for (done = 0; done < opt->reps; done++) {
+        Bench_Shuffle(&store, &rng);
+        t0 = Bench_NowMs();
+        sorted = SortIndex_Build(&sortIndex, &store);
+        samples[done] = Bench_NowMs() - t0;
+        if (!sorted) break;
+    }
+    Bench_Report(opt, size, "sort_build", sorted ? "ok" : "out of memory", samples, done, size, "records/s");
+
+    // Multi-column bulk reorder: newest first, then by name
+    SortSpec multi;
+    ContactSort_ParseSpec(&multi, "date-,name");
+    int multiOk = 1;
+    for (done = 0; multiOk && done < opt->reps; done++) {
+        for (int i = 0; i < store.count; i++) {
+            matches[i] = i;
+        }
+        t0 = Bench_NowMs();
+        multiOk = ContactSort_Rows(&store, &multi, matches, store.count);
+        samples[done] = Bench_NowMs() - t0;
+    }
+    Bench_Report(opt, size, "sort_multi", multiOk ? "ok" : "out of memory", samples, done, size, "records/s");
+
+    for (done = 0; sorted && done < opt->deletes; done++) {
+        char name[CONTACT_NAME_SIZE], phone[CONTACT_PHONE_SIZE], email[CONTACT_EMAIL_SIZE], date[CONTACT_DATE_SIZE];
+        Synth_Contact(&rng, name, phone, email, date);
+        int row = (int)Synth_Below(&rng, (uint32_t)store.count);
+        t0 = Bench_NowMs();
+        SortIndex_BeginUpdate(&sortIndex, &store, row);
+        Store_Update(&store, row, name, phone, email, date);
+        SortIndex_EndUpdate(&sortIndex, &store, row);
+        samples[done] = Bench_NowMs() - t0;
+    }
+    Bench_Report(opt, size, "sort_update", sorted ? "ok" : "skipped", samples, done, 1, "updates/s");
+
+    // Dates: the loaders' bulk parse of every date text into day numbers,
+    // then "contacts dated in a quarter" for random quarters, listed from
+    // the date order
+    uint32_t daySum = 0;
+    for (done = 0; done < opt->reps; done++) {
+        t0 = Bench_NowMs();
+        for (int i = 0; i < store.count; i++) {
+            daySum += DateKey_Parse(Store_GetDate(&store, i));
+        }
+        samples[done] = Bench_NowMs() - t0;
+    }
+    Bench_Report(opt, size, "date_parse", daySum ? "ok" : "no dates", samples, done, size, "records/s");
+
+    for (done = 0; sorted && done < opt->queries; done++) {
+        int year = 2000 + (int)Synth_Below(&rng, 26);
+        int month = 1 + 3 * (int)Synth_Below(&rng, 4);
+        uint32_t low = DateKey_FromCivil(year, month, 1);
+        uint32_t high = month == 10 ? DateKey_FromCivil(year + 1, 1, 1) : DateKey_FromCivil(year, month + 3, 1);
+        int first, end;
+        t0 = Bench_NowMs();
+        SortIndex_DayRange(&sortIndex, &store, low, high, &first, &end);
+        memcpy(matches, SortIndex_Order(&sortIndex, SORT_BY_DATE) + first, (size_t)(end - first) * sizeof(int));
+        samples[done] = Bench_NowMs() - t0;
+    }
+    Bench_Report(opt, size, "date_range", sorted ? "ok" : "skipped", samples, done, 1, "queries/s");
+
+    // Name filter: substrings taken from random contacts, like typed queries
+    long totalMatches = 0;
+    SynthRng queryRng = rng;
+    for (done = 0; done < opt->queries; done++) {
+        char query[8];
+        Bench_RandomQuery(&store, &rng, query);
+        t0 = Bench_NowMs();
+        totalMatches += Search_FilterByName(&store, query, matches);
+        samples[done] = Bench_NowMs() - t0;
+    }
+    Bench_Report(opt, size, "search_name", "ok", samples, done, size, "records/s");
+
+    // Trigram index: full build, then the same queries over name, phone and email
+    TrigramIndex index;
+    TrigramIndex_Init(&index);
+    t0 = Bench_NowMs();
+    int built = TrigramIndex_Build(&index, &store);
+    samples[0] = Bench_NowMs() - t0;
+    Bench_Report(opt, size, "index_build", built ? "ok" : "out of memory", samples, 1, size, "records/s");
+
+    for (done = 0; built && done < opt->queries; done++) {
+        char query[8];
+        Bench_RandomQuery(&store, &queryRng, query);
+        t0 = Bench_NowMs();
+        totalMatches += Search_Contacts(&store, &index, query, matches);
+        samples[done] = Bench_NowMs() - t0;
+    }
+    Bench_Report(opt, size, "search_index", built ? "ok" : "skipped", samples, done, size, "records/s");
+
+    // Fuzzy name search (k = 2 for full names): a plain scan on one core
+    // and on every core, then pruned through the trigram index
+    static const char *fuzzyOps[3] = { "fuzzy_scan", "fuzzy_scan_parallel", "fuzzy_index" };
+    for (int mode = 0; mode < 3; mode++) {
+        SynthRng typoRng = queryRng;
+        int fuzzyOk = (mode < 2 || built);
+        for (done = 0; fuzzyOk && done < opt->queries; done++) {
+            char query[CONTACT_NAME_SIZE];
+            Bench_TypoQuery(&store, &typoRng, query);
+            t0 = Bench_NowMs();
+            int found = FuzzySearch_Names(&store, mode == 2 ? &index : NULL, query,
+                                          FuzzySearch_DefaultDistance(strlen(query)),
+                                          mode == 1 ? Platform_CpuCount() : 1, matches, NULL);
+            samples[done] = Bench_NowMs() - t0;
+            if (found < 0) {
+                fuzzyOk = 0;
+                break;
+            }
+            totalMatches += found;
+        }
+        Bench_Report(opt, size, fuzzyOps[mode], fuzzyOk ? "ok" : (built ? "out of memory" : "skipped"),
+                     samples, done, size, "records/s");
+    }
+
+    // Phone hash index: full build, then "who owns this number" lookups
+    // of random contacts' numbers
+    PhoneIndex phoneIndex;
+    PhoneIndex_Init(&phoneIndex);
+    t0 = Bench_NowMs();
+    int phoned = PhoneIndex_Build(&phoneIndex, &store);
+    samples[0] = Bench_NowMs() - t0;
+    Bench_Report(opt, size, "phone_index_build", phoned ? "ok" : "out of memory", samples, 1, size, "records/s");
+
+    for (done = 0; phoned && done < opt->queries; done++) {
+        const char *phone = Store_GetPhone(&store, (int)Synth_Below(&rng, (uint32_t)store.count));
+        int owners[16];
+        t0 = Bench_NowMs();
+        totalMatches += PhoneIndex_Owners(&phoneIndex, &store, phone, owners, 16);
+        samples[done] = Bench_NowMs() - t0;
+    }
+    Bench_Report(opt, size, "phone_lookup", phoned ? "ok" : "skipped", samples, done, 1, "lookups/s");
+
+    // Structured queries over every field: a scan, then through whichever
+    // of the sort, phone and trigram indexes the planner picks
+    static const char *queries[] = {
+        "email ends-with @corp.com AND date >= 2024-01-01 AND phone starts-with +60",
+        "name starts-with jo AND date < 2001-01-01",
+        "date >= 2010-01-01 AND date <= 2010-03-31 AND NOT email contains gmail",
+        "phone = +44 7123 456789",
+        "name contains smith AND email ends-with .uk",
+    };
+    QueryIndexes queryIndexes = { &index, &phoneIndex, &sortIndex };
+    static const char *queryOps[2] = { "query_scan", "query_indexed" };
+    for (int mode = 0; mode < 2; mode++) {
+        int queried = 1;
+        for (done = 0; queried && done < opt->queries; done++) {
+            Query query;
+            Query_Parse(&query, queries[done % (int)(sizeof(queries) / sizeof(queries[0]))]);
+            t0 = Bench_NowMs();
+            Query_Plan(&query, &store, mode ? &queryIndexes : NULL);
+            int found = Query_Run(&query, &store, mode ? &queryIndexes : NULL, matches);
+            samples[done] = Bench_NowMs() - t0;
+            queried = found >= 0;
+            if (queried) totalMatches += found;
+        }
+        Bench_Report(opt, size, queryOps[mode], queried ? "ok" : "out of memory", samples, done, size, "records/s");
+    }
+    PhoneIndex_Free(&phoneIndex);
+    TrigramIndex_Free(&index);
+    SortIndex_Free(&sortIndex);
+
+    // Autocomplete: build, top-8 lookups for the first 1-3 letters of
+    // random names as typed, then edits kept in step with the store
+    Autocomplete complete;
+    Autocomplete_Init(&complete);
+    t0 = Bench_NowMs();
+    int completed = Autocomplete_Build(&complete, &store);
+    samples[0] = Bench_NowMs() - t0;
+    Bench_Report(opt, size, "autocomplete_build", completed ? "ok" : "out of memory", samples, 1, size, "records/s");
+    if (completed) {
+        Bench_ReportMemory(opt, size, "autocomplete_memory", Autocomplete_MemoryBytes(&complete),
+                           (long)complete.tries[COMPLETE_NAME].keys + (long)complete.tries[COMPLETE_DOMAIN].keys);
+    }
+
+    for (done = 0; completed && done < opt->queries; done++) {
+        char prefix[4];
+        const char *name = Store_GetName(&store, (int)Synth_Below(&rng, (uint32_t)store.count));
+        snprintf(prefix, sizeof(prefix), "%.*s", 1 + (int)Synth_Below(&rng, 3), name);
+        Completion found[8];
+        t0 = Bench_NowMs();
+        int count = Autocomplete_Lookup(&complete, COMPLETE_NAME, prefix, found, 8);
+        samples[done] = Bench_NowMs() - t0;
+        if (count > 0) totalMatches += count;
+    }
+    Bench_Report(opt, size, "autocomplete_lookup", completed ? "ok" : "skipped", samples, done, 1, "lookups/s");
+
+    for (done = 0; completed && done < opt->deletes; done++) {
+        char name[CONTACT_NAME_SIZE], phone[CONTACT_PHONE_SIZE], email[CONTACT_EMAIL_SIZE], date[CONTACT_DATE_SIZE];
+        Synth_Contact(&rng, name, phone, email, date);
+        int row = (int)Synth_Below(&rng, (uint32_t)store.count);
+        // Only the trie work is timed, not the store edit in between
+        t0 = Bench_NowMs();
+        Autocomplete_BeginUpdate(&complete, &store, row);
+        samples[done] = Bench_NowMs() - t0;
+        Store_Update(&store, row, name, phone, email, date);
+        t0 = Bench_NowMs();
+        Autocomplete_EndUpdate(&complete, &store, row);
+        samples[done] += Bench_NowMs() - t0;
+    }
+    Bench_Report(opt, size, "autocomplete_update", completed ? "ok" : "skipped", samples, done, 1, "updates/s");
+    Autocomplete_Free(&complete);
+
+    // Duplicate detection over the whole store: blocking, scoring, grouping
+    int deduped = 1;
+    for (done = 0; deduped && done < opt->reps; done++) {
+        DedupResult result;
+        deduped = Dedup_Find(&store, DEDUP_DEFAULT_THRESHOLD, &result);
+        samples[done] = result.ms;
+        Dedup_FreeResult(&result);
+    }
+    Bench_Report(opt, size, "dedup", deduped ? "ok" : "out of memory", samples, done, size, "records/s");
+
+    // Single deletes at random positions (tombstones), then one purge
+    for (done = 0; done < opt->deletes && Store_LiveCount(&store) > 0; done++) {
+        int index;
+        do {
+            index = (int)Synth_Below(&rng, (uint32_t)store.count);
+        } while (Store_IsDeleted(&store, index));
+        t0 = Bench_NowMs();
+        Store_Delete(&store, index);
+        samples[done] = Bench_NowMs() - t0;
+    }
+    Bench_Report(opt, size, "delete", "ok", samples, done, 1, "deletes/s");
+
+    int records = store.count;
+    t0 = Bench_NowMs();
+    Store_Purge(&store, matches);
+    samples[0] = Bench_NowMs() - t0;
+    Bench_Report(opt, size, "purge", "ok", samples, 1, records, "records/s");
+
+    // Snapshots: taking one, then single edits that copy the chunk and
+    // page they touch while it is held
+    ContactStore snapshot;
+    int copied = 1;
+    for (done = 0; copied && done < opt->reps; done++) {
+        t0 = Bench_NowMs();
+        copied = Store_Copy(&snapshot, &store);
+        samples[done] = Bench_NowMs() - t0;
+        if (copied && done + 1 < opt->reps) Store_Free(&snapshot);
+    }
+    Bench_Report(opt, size, "snapshot", copied ? "ok" : "out of memory", samples, done, 1, "snapshots/s");
+    int updated = copied;
+    for (done = 0; updated && done < opt->deletes && store.count > 0; done++) {
+        char name[CONTACT_NAME_SIZE], phone[CONTACT_PHONE_SIZE], email[CONTACT_EMAIL_SIZE], date[CONTACT_DATE_SIZE];
+        Synth_Contact(&rng, name, phone, email, date);
+        int index = (int)Synth_Below(&rng, (uint32_t)store.count);
+        t0 = Bench_NowMs();
+        updated = Store_Update(&store, index, name, phone, email, date);
+        samples[done] = Bench_NowMs() - t0;
+    }
+    Bench_Report(opt, size, "snapshot_update", updated ? "ok" : "out of memory", samples, done, 1, "edits/s");
+    if (copied) Store_Free(&snapshot);
+
+    (void)totalMatches;
+    Store_Free(&store);
+    free(samples);
+    free(matches);
+}
+
+// ------------------------------------------
+// Parse "1k,10k,1M"-style size lists
+// ------------------------------------------
+static int Bench_ParseSizes(BenchOptions *opt, const char *list) {
+    opt->sizeCount = 0;
+    while (*list && opt->sizeCount < MAX_SIZES) {
+        char *end;
+        double value = strtod(list, &end);
+        if (end == list) return 0;
+        if (*end == 'k' || *end == 'K') { value *= 1e3; end++; }
+        else if (*end == 'm' || *end == 'M') { value *= 1e6; end++; }
+        if (value < 1 || value > 10e6) return 0;
+        opt->sizes[opt->sizeCount++] = (int)value;
+        list = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') return 0;
+    }
+    return opt->sizeCount > 0;
+}
+
+static void Bench_Usage(void) {
+    fprintf(stderr,
+            "Usage: ContactBench [--sizes 1k,10k,100k,1M] [--reps N] [--queries N]\n"
+            "                    [--deletes N] [--seed N] [--file path] [--out path]\n"
+            "Sizes range from 1 to 10M records.\n");
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opt;
+    memset(&opt, 0, sizeof(opt));
+    Bench_ParseSizes(&opt, "1k,10k,100k,1M");
+    opt.reps = 5;
+    opt.queries = 50;
+    opt.deletes = 100;
+    opt.seed = 20240101;
+    opt.file = "contacts_bench.tmp";
+    opt.out = stdout;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!value) { Bench_Usage(); return 2; }
+        if (strcmp(arg, "--sizes") == 0) {
+            if (!Bench_ParseSizes(&opt, value)) { Bench_Usage(); return 2; }
+        } else if (strcmp(arg, "--reps") == 0) {
+            opt.reps = atoi(value);
+        } else if (strcmp(arg, "--queries") == 0) {
+            opt.queries = atoi(value);
+        } else if (strcmp(arg, "--deletes") == 0) {
+            opt.deletes = atoi(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            opt.seed = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--file") == 0) {
+            opt.file = value;
+        } else if (strcmp(arg, "--out") == 0) {
+            opt.out = fopen(value, "w");
+            if (!opt.out) { fprintf(stderr, "Cannot open %s\n", value); return 1; }
+        } else {
+            Bench_Usage();
+            return 2;
+        }
+        i++;
+    }
+    if (opt.reps < 1) opt.reps = 1;
+    if (opt.queries < 1) opt.queries = 1;
+    if (opt.deletes < 1) opt.deletes = 1;
+
+    fprintf(opt.out, "{\n  \"benchmark\": \"ContactBench\",\n  \"seed\": %llu,\n  \"results\": [",
+            (unsigned long long)opt.seed);
+    for (int i = 0; i < opt.sizeCount; i++) {
+        Bench_RunSize(&opt, opt.sizes[i]);
+    }
+    fprintf(opt.out, "\n  ]\n}\n");
+
+    if (opt.out != stdout) fclose(opt.out);
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include "SynthContacts.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+// ------------------------------------------
+//          Value pools for generation
+// ------------------------------------------
+// Pools are ordered roughly by frequency; Synth_Skewed picks early entries
+// more often, which gives the long-tailed distribution seen in real books.
+
+static const char *s_firstNames[] = {
+    "James", "Mary", "John", "Patricia", "Robert", "Jennifer", "Michael", "Linda",
+    "William", "Elizabeth", "David", "Barbara", "Richard", "Susan", "Joseph", "Jessica",
+    "Thomas", "Sarah", "Charles", "Karen", "Muhammad", "Nur", "Ahmad", "Siti",
+    "Wei", "Mei", "Raj", "Priya", "Daniel", "Nancy", "Matthew", "Lisa",
+    "Anthony", "Betty", "Mark", "Margaret", "Donald", "Sandra", "Steven", "Ashley",
+    "Paul", "Kimberly", "Andrew", "Emily", "Joshua", "Donna", "Kenneth", "Michelle",
+    "Kevin", "Dorothy", "Brian", "Carol", "George", "Amanda", "Timothy", "Melissa",
+    "Aisyah", "Hafiz", "Farah", "Arjun", "Oliver", "Amelia", "Harry", "Isla"
+};
+
+static const char *s_lastNames[] = {
+    "Smith", "Jones", "Williams", "Taylor", "Brown", "Davies", "Evans", "Wilson",
+    "Thomas", "Johnson", "Roberts", "Robinson", "Thompson", "Wright", "Walker", "White",
+    "Tan", "Lim", "Lee", "Wong", "Ng", "Abdullah", "Ibrahim", "Rahman",
+    "Ismail", "Hassan", "Kumar", "Singh", "Hughes", "Green", "Hall", "Lewis",
+    "Harris", "Clarke", "Patel", "Jackson", "Wood", "Turner", "Martin", "Cooper",
+    "Hill", "Ward", "Morris", "Moore", "Clark", "Lee", "King", "Baker",
+    "Harrison", "Morgan", "Allen", "James", "Scott", "Phillips", "Watson", "Davis",
+    "Chong", "Yusof", "Osman", "Chandran", "Fernandez", "Murphy", "Kelly", "Price"
+};
+
+static const char *s_domains[] = {
+    "gmail.com", "yahoo.com", "outlook.com", "hotmail.co.uk", "corp.com",
+    "icloud.com", "live.com", "btinternet.com", "company.com.my", "example.org",
+    "university.ac.uk", "mail.my", "proton.me", "startup.io"
+};
+
+#define COUNT_OF(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+// ------------------------------------------
+// Seed the generator
+// ------------------------------------------
+void Synth_Seed(SynthRng *rng, uint64_t seed) {
+    rng->state = seed;
+}
+
+// ------------------------------------------
+// Next 64 random bits (splitmix64)
+// ------------------------------------------
+uint64_t Synth_Next(SynthRng *rng) {
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// ------------------------------------------
+// Uniform value in [0, bound)
+// ------------------------------------------
+uint32_t Synth_Below(SynthRng *rng, uint32_t bound) {
+    return (uint32_t)(((Synth_Next(rng) >> 32) * (uint64_t)bound) >> 32);
+}
+
+// ------------------------------------------
+// Value in [0, bound) biased towards 0 (quadratic skew)
+// ------------------------------------------
+static int Synth_Skewed(SynthRng *rng, int bound) {
+    double u = (double)(Synth_Next(rng) >> 11) * (1.0 / 9007199254740992.0);
+    return (int)(u * u * bound);
+}
+
+// ------------------------------------------
+// Append 'count' random digits to 'out'
+// ------------------------------------------
+static char *Synth_Digits(SynthRng *rng, char *out, int count) {
+    for (int i = 0; i < count; i++) {
+        *out++ = (char)('0' + Synth_Below(rng, 10));
+    }
+    *out = '\0';
+    return out;
+}
+
+// ------------------------------------------
+// Generate one contact
+// Names:  "First Last", sometimes with a middle initial
+// Phones: UK and Malaysian mobiles/landlines in several spellings
+// Emails: derived from the name, ~10% empty
+// Dates:  2000-01-01 .. 2025-12-28, ~15% empty
+// ------------------------------------------
+void Synth_Contact(SynthRng *rng, char *name, char *phone, char *email, char *date) {
+    const char *first = s_firstNames[Synth_Skewed(rng, COUNT_OF(s_firstNames))];
+    const char *last  = s_lastNames[Synth_Skewed(rng, COUNT_OF(s_lastNames))];
+
+    if (Synth_Below(rng, 100) < 30) {
+        snprintf(name, CONTACT_NAME_SIZE, "%s %c. %s", first, 'A' + Synth_Below(rng, 26), last);
+    } else {
+        snprintf(name, CONTACT_NAME_SIZE, "%s %s", first, last);
+    }
+
+    char *p = phone;
+    uint32_t kind = Synth_Below(rng, 100);
+    if (kind < 40) {
+        memcpy(p, "+44-7", 5); p = Synth_Digits(rng, p + 5, 3);
+        *p++ = '-';            Synth_Digits(rng, p, 6);
+    } else if (kind < 70) {
+        memcpy(p, "+60-1", 5); p = Synth_Digits(rng, p + 5, 1);
+        *p++ = '-';            Synth_Digits(rng, p, 7);
+    } else if (kind < 90) {
+        memcpy(p, "07", 2);    Synth_Digits(rng, p + 2, 9);
+    } else {
+        memcpy(p, "03-", 3);   Synth_Digits(rng, p + 3, 8);
+    }
+
+    if (Synth_Below(rng, 100) < 10) {
+        email[0] = '\0';
+    } else {
+        const char *domain = s_domains[Synth_Skewed(rng, COUNT_OF(s_domains))];
+        int len;
+        if (Synth_Below(rng, 2)) {
+            len = snprintf(email, CONTACT_EMAIL_SIZE, "%s.%s%u@%s", first, last, Synth_Below(rng, 100), domain);
+        } else {
+            len = snprintf(email, CONTACT_EMAIL_SIZE, "%c%s@%s", first[0], last, domain);
+        }
+        for (int i = 0; i < len && email[i] != '@'; i++) {
+            email[i] = (char)tolower((unsigned char)email[i]);
+        }
+    }
+
+    if (Synth_Below(rng, 100) < 15) {
+        date[0] = '\0';
+    } else {
+        snprintf(date, CONTACT_DATE_SIZE, "%04u-%02u-%02u",
+                 2000 + Synth_Below(rng, 26), 1 + Synth_Below(rng, 12), 1 + Synth_Below(rng, 28));
+    }
+}
+
+// ------------------------------------------
+// Append 'count' synthetic contacts to the store
+// ------------------------------------------
+int Synth_FillStore(ContactStore *store, int count, uint64_t seed) {
+    SynthRng rng;
+    char name[CONTACT_NAME_SIZE], phone[CONTACT_PHONE_SIZE];
+    char email[CONTACT_EMAIL_SIZE], date[CONTACT_DATE_SIZE];
+
+    Synth_Seed(&rng, seed);
+    for (int i = 0; i < count; i++) {
+        Synth_Contact(&rng, name, phone, email, date);
+        if (!Store_Add(store, name, phone, email, date)) {
+            return 0;
+        }
+    }
+    return 1;
+}
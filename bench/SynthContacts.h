@@ -0,0 +1,24 @@
+#ifndef SYNTH_CONTACTS_H
+#define SYNTH_CONTACTS_H
+
+#include <stdint.h>
+
+#include "ContactStore.h"
+
+// Deterministic pseudo random generator (splitmix64)
+typedef struct {
+    uint64_t state;
+} SynthRng;
+
+void     Synth_Seed(SynthRng *rng, uint64_t seed);
+uint64_t Synth_Next(SynthRng *rng);
+uint32_t Synth_Below(SynthRng *rng, uint32_t bound);
+
+// Generate one realistic contact into the caller's buffers (sized with the
+// CONTACT_*_SIZE constants). Every generated contact passes validation.
+void Synth_Contact(SynthRng *rng, char *name, char *phone, char *email, char *date);
+
+// Append 'count' synthetic contacts to 'store'. Returns 1 on success.
+int Synth_FillStore(ContactStore *store, int count, uint64_t seed);
+
+#endif // SYNTH_CONTACTS_H
@@ -0,0 +1,689 @@
+#include "Autocomplete.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define COMPLETE_MAX_KEY   CONTACT_NAME_SIZE  // Longer keys are not indexed
+#define COMPLETE_MAX_LOCI  8                  // Case variants of one prefix followed
+#define COMPLETE_GARBAGE   (64 * 1024)        // Label garbage tolerated before compacting
+
+static unsigned char Complete_Fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+// ------------------------------------------
+// Edge label of a node: its length, and a pointer to its bytes
+// ------------------------------------------
+static const unsigned char *Trie_Label(const CompleteTrie *trie, uint32_t node, int *length) {
+    const unsigned char *label = trie->labels + trie->nodes[node].label;
+    *length = label[0];
+    return label + 1;
+}
+
+// ------------------------------------------
+// Highest count in the subtree of 'node'
+// Children are ordered by this value, so it lies on the first-child chain.
+// ------------------------------------------
+static uint32_t Trie_Best(const CompleteTrie *trie, uint32_t node) {
+    uint32_t best = trie->nodes[node].count;
+    for (uint32_t c = trie->nodes[node].child; c != 0; c = trie->nodes[c].child) {
+        if (trie->nodes[c].count > best) best = trie->nodes[c].count;
+    }
+    return best;
+}
+
+static void Trie_Free(CompleteTrie *trie) {
+    free(trie->nodes);
+    free(trie->labels);
+    memset(trie, 0, sizeof(*trie));
+}
+
+// ------------------------------------------
+// Append a label. Returns 0 when out of memory.
+// 'bytes' may point into the pool itself.
+// ------------------------------------------
+static int Trie_PushLabel(CompleteTrie *trie, const unsigned char *bytes, int length, uint32_t *offset) {
+    if ((uint64_t)trie->labelSize + (uint32_t)length + 1 > trie->labelCapacity) {
+        uint64_t capacity = trie->labelCapacity ? (uint64_t)trie->labelCapacity + trie->labelCapacity / 2 : 4096;
+        if (capacity < (uint64_t)trie->labelSize + (uint32_t)length + 1) capacity = (uint64_t)trie->labelSize + (uint32_t)length + 1;
+        if (capacity > UINT32_MAX) return 0;
+        int inside = (trie->labels && bytes >= trie->labels && bytes < trie->labels + trie->labelSize);
+        size_t from = inside ? (size_t)(bytes - trie->labels) : 0;
+        unsigned char *labels = (unsigned char*)realloc(trie->labels, (size_t)capacity);
+        if (!labels) return 0;
+        trie->labels = labels;
+        trie->labelCapacity = (uint32_t)capacity;
+        if (inside) bytes = labels + from;
+    }
+    *offset = trie->labelSize;
+    trie->labels[trie->labelSize] = (unsigned char)length;
+    memcpy(trie->labels + trie->labelSize + 1, bytes, (size_t)length);
+    trie->labelSize += (uint32_t)length + 1;
+    return 1;
+}
+
+// ------------------------------------------
+// A fresh node, reusing a removed one if possible. 0 when out of memory
+// (0 is the root, never a new node).
+// ------------------------------------------
+static uint32_t Trie_NewNode(CompleteTrie *trie) {
+    uint32_t node = trie->freeNode;
+    if (node != 0) {
+        trie->freeNode = trie->nodes[node].sibling;
+    } else {
+        if (trie->nodeCount == trie->nodeCapacity) {
+            uint32_t capacity = trie->nodeCapacity ? trie->nodeCapacity + trie->nodeCapacity / 2 : 256;
+            CompleteNode *nodes = (CompleteNode*)realloc(trie->nodes, (size_t)capacity * sizeof(CompleteNode));
+            if (!nodes) return 0;
+            trie->nodes = nodes;
+            trie->nodeCapacity = capacity;
+        }
+        node = trie->nodeCount++;
+    }
+    memset(&trie->nodes[node], 0, sizeof(CompleteNode));
+    return node;
+}
+
+static void Trie_FreeNode(CompleteTrie *trie, uint32_t node) {
+    if (trie->nodes[node].label != 0) {
+        int length;
+        Trie_Label(trie, node, &length);
+        trie->garbage += (uint32_t)length + 1;
+    }
+    trie->nodes[node].label = 0;
+    trie->nodes[node].child = 0;
+    trie->nodes[node].count = 0;
+    trie->nodes[node].sibling = trie->freeNode;
+    trie->freeNode = node;
+}
+
+// ------------------------------------------
+// Root node with the empty label at offset 0
+// ------------------------------------------
+static int Trie_Ready(CompleteTrie *trie) {
+    uint32_t offset;
+    if (trie->labelSize == 0 && !Trie_PushLabel(trie, (const unsigned char*)"", 0, &offset)) return 0;
+    if (trie->nodeCount == 0) Trie_NewNode(trie);
+    return trie->nodeCount > 0;
+}
+
+// ------------------------------------------
+// Unlink 'node' from the children of 'parent'
+// ------------------------------------------
+static void Trie_Unlink(CompleteTrie *trie, uint32_t parent, uint32_t node) {
+    uint32_t *link = &trie->nodes[parent].child;
+    while (*link != node) link = &trie->nodes[*link].sibling;
+    *link = trie->nodes[node].sibling;
+    trie->nodes[node].sibling = 0;
+}
+
+// ------------------------------------------
+// Move 'node' to its place among the children of 'parent' after its
+// subtree's best count changed (ties keep the older key first)
+// ------------------------------------------
+static void Trie_Reposition(CompleteTrie *trie, uint32_t parent, uint32_t node) {
+    Trie_Unlink(trie, parent, node);
+    uint32_t best = Trie_Best(trie, node);
+    uint32_t *link = &trie->nodes[parent].child;
+    while (*link != 0 && Trie_Best(trie, *link) >= best) link = &trie->nodes[*link].sibling;
+    trie->nodes[node].sibling = *link;
+    *link = node;
+}
+
+// ------------------------------------------
+// Child of 'node' whose label starts with byte 'c', or 0
+// ------------------------------------------
+static uint32_t Trie_Child(const CompleteTrie *trie, uint32_t node, unsigned char c) {
+    for (uint32_t child = trie->nodes[node].child; child != 0; child = trie->nodes[child].sibling) {
+        if (trie->labels[trie->nodes[child].label + 1] == c) return child;
+    }
+    return 0;
+}
+
+// ------------------------------------------
+// Count 'amount' more contacts with 'key'. Without 'reorder' the
+// children are left unordered (Build orders them all at the end).
+// Returns 0 when out of memory.
+// ------------------------------------------
+static int Trie_Add(CompleteTrie *trie, const char *key, uint32_t amount, int reorder) {
+    size_t left = strlen(key);
+    if (left == 0 || left >= COMPLETE_MAX_KEY) return 1;
+    if (!Trie_Ready(trie)) return 0;
+
+    uint32_t path[COMPLETE_MAX_KEY];
+    int depth = 0;
+    const unsigned char *rest = (const unsigned char*)key;
+    uint32_t node = 0;
+    for (;;) {
+        uint32_t child = Trie_Child(trie, node, rest[0]);
+        if (child == 0) {
+            // New leaf holding the whole rest of the key
+            uint32_t leaf = Trie_NewNode(trie);
+            uint32_t offset;
+            if (leaf == 0) return 0;
+            if (!Trie_PushLabel(trie, rest, (int)left, &offset)) {
+                Trie_FreeNode(trie, leaf);
+                return 0;
+            }
+            trie->nodes[leaf].label = offset;
+            trie->nodes[leaf].count = amount;
+            trie->nodes[leaf].sibling = trie->nodes[node].child;
+            trie->nodes[node].child = leaf;
+            trie->keys++;
+            path[depth++] = leaf;
+            break;
+        }
+
+        int length;
+        const unsigned char *label = Trie_Label(trie, child, &length);
+        int common = 1;
+        while (common < length && (size_t)common < left && label[common] == rest[common]) common++;
+        if (common < length) {
+            // Split the edge: the tail moves to a new only child
+            uint32_t tail = Trie_NewNode(trie);
+            uint32_t offset;
+            if (tail == 0) return 0;
+            uint32_t from = trie->nodes[child].label + 1 + (uint32_t)common;
+            if (!Trie_PushLabel(trie, trie->labels + from, length - common, &offset)) {
+                Trie_FreeNode(trie, tail);
+                return 0;
+            }
+            trie->nodes[tail].label = offset;
+            trie->nodes[tail].child = trie->nodes[child].child;
+            trie->nodes[tail].count = trie->nodes[child].count;
+            trie->nodes[child].child = tail;
+            trie->nodes[child].count = 0;
+            trie->labels[trie->nodes[child].label] = (unsigned char)common;
+            trie->garbage += (uint32_t)(length - common);
+        }
+        path[depth++] = child;
+        if ((size_t)common == left) {
+            if (trie->nodes[child].count == 0) trie->keys++;
+            trie->nodes[child].count += amount;
+            break;
+        }
+        node = child;
+        rest += common;
+        left -= (size_t)common;
+    }
+
+    if (reorder) {
+        for (int i = depth - 1; i >= 0; i--) Trie_Reposition(trie, i > 0 ? path[i - 1] : 0, path[i]);
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Copy the live labels into a fresh pool, dropping the garbage
+// Free nodes point at the root's empty label (offset 0), which stays put.
+// ------------------------------------------
+static void Trie_CompactLabels(CompleteTrie *trie) {
+    uint32_t size = 0;
+    for (uint32_t node = 0; node < trie->nodeCount; node++) {
+        uint32_t from = trie->nodes[node].label;
+        if (node == 0 || from != 0) size += (uint32_t)trie->labels[from] + 1;
+    }
+    unsigned char *labels = (unsigned char*)malloc(size);
+    if (!labels) return;
+    size = 0;
+    for (uint32_t node = 0; node < trie->nodeCount; node++) {
+        uint32_t from = trie->nodes[node].label;
+        if (node != 0 && from == 0) continue;
+        uint32_t length = (uint32_t)trie->labels[from] + 1;
+        memcpy(labels + size, trie->labels + from, length);
+        trie->nodes[node].label = size;
+        size += length;
+    }
+    free(trie->labels);
+    trie->labels = labels;
+    trie->labelSize = size;
+    trie->labelCapacity = size;
+    trie->garbage = 0;
+}
+
+// ------------------------------------------
+// Count one contact less with 'key'
+// Nodes left without count or children go, and a node left with a single
+// child and no count takes over that child, so the trie stays compressed.
+// ------------------------------------------
+static void Trie_Remove(CompleteTrie *trie, const char *key) {
+    size_t left = strlen(key);
+    if (left == 0 || left >= COMPLETE_MAX_KEY || trie->nodeCount == 0) return;
+
+    uint32_t path[COMPLETE_MAX_KEY];
+    int depth = 0;
+    const unsigned char *rest = (const unsigned char*)key;
+    uint32_t node = 0;
+    for (;;) {
+        uint32_t child = Trie_Child(trie, node, rest[0]);
+        if (child == 0) return;
+        int length;
+        const unsigned char *label = Trie_Label(trie, child, &length);
+        if ((size_t)length > left || memcmp(label, rest, (size_t)length) != 0) return;
+        path[depth++] = child;
+        if ((size_t)length == left) break;
+        node = child;
+        rest += length;
+        left -= (size_t)length;
+    }
+    uint32_t last = path[depth - 1];
+    if (trie->nodes[last].count == 0) return;
+    if (--trie->nodes[last].count == 0) trie->keys--;
+
+    while (depth > 0 && trie->nodes[path[depth - 1]].count == 0 && trie->nodes[path[depth - 1]].child == 0) {
+        uint32_t gone = path[--depth];
+        Trie_Unlink(trie, depth > 0 ? path[depth - 1] : 0, gone);
+        Trie_FreeNode(trie, gone);
+    }
+    if (depth > 0) {
+        uint32_t keep = path[depth - 1];
+        uint32_t only = trie->nodes[keep].child;
+        if (trie->nodes[keep].count == 0 && only != 0 && trie->nodes[only].sibling == 0) {
+            int a, b;
+            Trie_Label(trie, keep, &a);
+            Trie_Label(trie, only, &b);
+            unsigned char merged[2 * COMPLETE_MAX_KEY];
+            uint32_t offset;
+            memcpy(merged, trie->labels + trie->nodes[keep].label + 1, (size_t)a);
+            memcpy(merged + a, trie->labels + trie->nodes[only].label + 1, (size_t)b);
+            if (a + b <= 255 && Trie_PushLabel(trie, merged, a + b, &offset)) {
+                trie->garbage += (uint32_t)a + 1;
+                trie->nodes[keep].label = offset;
+                trie->nodes[keep].count = trie->nodes[only].count;
+                trie->nodes[keep].child = trie->nodes[only].child;
+                Trie_FreeNode(trie, only);
+            }
+        }
+    }
+    for (int i = depth - 1; i >= 0; i--) Trie_Reposition(trie, i > 0 ? path[i - 1] : 0, path[i]);
+
+    if (trie->garbage > COMPLETE_GARBAGE && trie->garbage > trie->labelSize / 2) {
+        Trie_CompactLabels(trie);
+    }
+}
+
+// ------------------------------------------
+// Order every child list by best count, bottom up (after a bulk build)
+// ------------------------------------------
+static void Trie_Order(CompleteTrie *trie, uint32_t node) {
+    uint32_t children[256];  // Children start with distinct bytes
+    uint32_t best[256];
+    int count = 0;
+    for (uint32_t child = trie->nodes[node].child; child != 0; child = trie->nodes[child].sibling) {
+        Trie_Order(trie, child);
+        children[count] = child;
+        best[count] = Trie_Best(trie, child);
+        count++;
+    }
+    // Stable insertion sort, highest first
+    for (int i = 1; i < count; i++) {
+        uint32_t c = children[i], b = best[i];
+        int j = i;
+        while (j > 0 && best[j - 1] < b) {
+            children[j] = children[j - 1];
+            best[j] = best[j - 1];
+            j--;
+        }
+        children[j] = c;
+        best[j] = b;
+    }
+    uint32_t next = 0;
+    for (int i = count - 1; i >= 0; i--) {
+        trie->nodes[children[i]].sibling = next;
+        next = children[i];
+    }
+    trie->nodes[node].child = next;
+}
+
+// ------------------------------------------
+// Domain of an email, folded into 'buffer'; NULL if there is none
+// ------------------------------------------
+static const char *Complete_DomainKey(const char *email, char buffer[COMPLETE_MAX_KEY]) {
+    const char *domain = Autocomplete_Domain(email);
+    if (!domain) return NULL;
+    size_t length = strlen(domain);
+    if (length >= COMPLETE_MAX_KEY) return NULL;
+    for (size_t i = 0; i <= length; i++) buffer[i] = (char)Complete_Fold((unsigned char)domain[i]);
+    return buffer;
+}
+
+// ------------------------------------------
+// Initialize empty tries
+// ------------------------------------------
+void Autocomplete_Init(Autocomplete *ac) {
+    memset(ac, 0, sizeof(*ac));
+}
+
+// ------------------------------------------
+// Release all memory held by the tries
+// ------------------------------------------
+void Autocomplete_Free(Autocomplete *ac) {
+    for (int kind = 0; kind < COMPLETE_KIND_COUNT; kind++) Trie_Free(&ac->tries[kind]);
+    Autocomplete_Init(ac);
+}
+
+void Autocomplete_Invalidate(Autocomplete *ac) {
+    Autocomplete_Free(ac);
+    ac->stale = 1;
+}
+
+// Distinct key met while building: the first contact with it, and how
+// many contacts have it ('count' 0 marks a free slot)
+typedef struct {
+    uint32_t hash;
+    int      row;
+    uint32_t count;
+} CompleteTally;
+
+// ------------------------------------------
+// Key of 'kind' for a contact, NULL if it has none
+// ------------------------------------------
+static const char *Complete_Key(const ContactStore *store, int row, int kind, char buffer[COMPLETE_MAX_KEY]) {
+    if (kind == COMPLETE_DOMAIN) return Complete_DomainKey(Store_GetEmail(store, row), buffer);
+    const char *name = Store_GetName(store, row);
+    return name[0] ? name : NULL;
+}
+
+static uint32_t Complete_Hash(const char *key) {
+    uint32_t h = 2166136261u;  // FNV-1a
+    for (const unsigned char *p = (const unsigned char*)key; *p; p++) h = (h ^ *p) * 16777619u;
+    return h;
+}
+
+// ------------------------------------------
+// Add every key of 'kind' once, with its count
+// A million contacts hold far fewer distinct keys, so counting them in a
+// hash table first saves a trie walk per contact.
+// ------------------------------------------
+static int Complete_BuildTrie(CompleteTrie *trie, const ContactStore *store, int kind) {
+    char key[COMPLETE_MAX_KEY], other[COMPLETE_MAX_KEY];
+    uint32_t mask = 1023, used = 0;
+    CompleteTally *table = (CompleteTally*)calloc((size_t)mask + 1, sizeof(CompleteTally));
+    if (!table) return 0;
+
+    for (int row = 0; row < store->count; row++) {
+        if (Store_IsDeleted(store, row)) continue;
+        const char *k = Complete_Key(store, row, kind, key);
+        if (!k) continue;
+        uint32_t h = Complete_Hash(k);
+        uint32_t i = h & mask;
+        while (table[i].count != 0 &&
+               (table[i].hash != h || strcmp(Complete_Key(store, table[i].row, kind, other), k) != 0)) {
+            i = (i + 1) & mask;
+        }
+        if (table[i].count++ != 0) continue;
+        table[i].hash = h;
+        table[i].row = row;
+        if (++used * 2 <= mask) continue;
+
+        // Keep the table at most half full
+        uint32_t newMask = mask * 2 + 1;
+        CompleteTally *grown = (CompleteTally*)calloc((size_t)newMask + 1, sizeof(CompleteTally));
+        if (!grown) {
+            free(table);
+            return 0;
+        }
+        for (uint32_t s = 0; s <= mask; s++) {
+            if (table[s].count == 0) continue;
+            uint32_t j = table[s].hash & newMask;
+            while (grown[j].count != 0) j = (j + 1) & newMask;
+            grown[j] = table[s];
+        }
+        free(table);
+        table = grown;
+        mask = newMask;
+    }
+
+    int ok = 1;
+    for (uint32_t s = 0; ok && s <= mask; s++) {
+        if (table[s].count == 0) continue;
+        ok = Trie_Add(trie, Complete_Key(store, table[s].row, kind, key), table[s].count, 0);
+    }
+    free(table);
+    return ok;
+}
+
+// ------------------------------------------
+// Add the distinct keys of the store, then order the children once and
+// trim the arrays to size
+// ------------------------------------------
+int Autocomplete_Build(Autocomplete *ac, const ContactStore *store) {
+    Autocomplete_Free(ac);
+    for (int kind = 0; kind < COMPLETE_KIND_COUNT; kind++) {
+        if (!Complete_BuildTrie(&ac->tries[kind], store, kind)) {
+            Autocomplete_Invalidate(ac);
+            return 0;
+        }
+    }
+    for (int kind = 0; kind < COMPLETE_KIND_COUNT; kind++) {
+        CompleteTrie *trie = &ac->tries[kind];
+        if (trie->nodeCount == 0) continue;
+        Trie_Order(trie, 0);
+        CompleteNode *nodes = (CompleteNode*)realloc(trie->nodes, (size_t)trie->nodeCount * sizeof(CompleteNode));
+        if (nodes) {
+            trie->nodes = nodes;
+            trie->nodeCapacity = trie->nodeCount;
+        }
+        if (trie->garbage > 0) Trie_CompactLabels(trie);
+        unsigned char *labels = (unsigned char*)realloc(trie->labels, trie->labelSize);
+        if (labels) {
+            trie->labels = labels;
+            trie->labelCapacity = trie->labelSize;
+        }
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Count the keys of a contact that was just stored at 'row'
+// ------------------------------------------
+int Autocomplete_Insert(Autocomplete *ac, const ContactStore *store, int row) {
+    char domain[COMPLETE_MAX_KEY];
+    if (ac->stale) return 0;
+    const char *key = Complete_DomainKey(Store_GetEmail(store, row), domain);
+    if (!Trie_Add(&ac->tries[COMPLETE_NAME], Store_GetName(store, row), 1, 1) ||
+        (key && !Trie_Add(&ac->tries[COMPLETE_DOMAIN], key, 1, 1))) {
+        Autocomplete_Invalidate(ac);
+        return 0;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Uncount the keys of a contact that is about to change or go
+// ------------------------------------------
+void Autocomplete_Remove(Autocomplete *ac, const ContactStore *store, int row) {
+    char domain[COMPLETE_MAX_KEY];
+    if (ac->stale) return;
+    Trie_Remove(&ac->tries[COMPLETE_NAME], Store_GetName(store, row));
+    const char *key = Complete_DomainKey(Store_GetEmail(store, row), domain);
+    if (key) Trie_Remove(&ac->tries[COMPLETE_DOMAIN], key);
+}
+
+void Autocomplete_BeginUpdate(Autocomplete *ac, const ContactStore *store, int row) {
+    Autocomplete_Remove(ac, store, row);
+}
+
+int Autocomplete_EndUpdate(Autocomplete *ac, const ContactStore *store, int row) {
+    return Autocomplete_Insert(ac, store, row);
+}
+
+// A node reached by the walk: where a prefix ends, with the text leading to it
+typedef struct {
+    uint32_t node;
+    int      length;
+    char     text[COMPLETE_MAX_KEY];
+} CompleteLocus;
+
+// ------------------------------------------
+// Collect the nodes whose path spells 'prefix' (ignoring case) or runs
+// through its end. 'text' holds the 'length' bytes leading to 'node'.
+// ------------------------------------------
+static void Complete_FindLoci(const CompleteTrie *trie, uint32_t node, const unsigned char *prefix,
+                              char *text, int length, CompleteLocus *loci, int *count) {
+    for (uint32_t child = trie->nodes[node].child; child != 0 && *count < COMPLETE_MAX_LOCI;
+         child = trie->nodes[child].sibling) {
+        int labelLength;
+        const unsigned char *label = Trie_Label(trie, child, &labelLength);
+        int i = 0;
+        while (i < labelLength && prefix[i] && Complete_Fold(label[i]) == Complete_Fold(prefix[i])) i++;
+        if (i < labelLength && prefix[i]) continue;
+        if (length + labelLength >= COMPLETE_MAX_KEY) continue;
+        memcpy(text + length, label, (size_t)labelLength);
+        if (!prefix[i]) {
+            CompleteLocus *locus = &loci[(*count)++];
+            locus->node = child;
+            locus->length = length + labelLength;
+            memcpy(locus->text, text, (size_t)locus->length);
+        } else {
+            Complete_FindLoci(trie, child, prefix + i, text, length + labelLength, loci, count);
+        }
+    }
+}
+
+// Entry of the best-first walk: a whole subtree, or the key ending at a node
+typedef struct {
+    uint32_t node;
+    uint32_t priority;  // Best count of the subtree, or the key's count
+    int      parent;    // Item of the path above, -1 at a locus
+    short    locus;
+    char     key;       // The key at 'node' rather than its subtree
+    char     first;     // A locus itself: its siblings are not part of the walk
+} CompleteItem;
+
+static int Complete_Before(const CompleteItem *items, int a, int b) {
+    if (items[a].priority != items[b].priority) return items[a].priority > items[b].priority;
+    return items[a].key > items[b].key;
+}
+
+static void Complete_Push(CompleteItem *items, int *heap, int *heapSize, int item) {
+    int at = (*heapSize)++;
+    while (at > 0 && Complete_Before(items, item, heap[(at - 1) / 2])) {
+        heap[at] = heap[(at - 1) / 2];
+        at = (at - 1) / 2;
+    }
+    heap[at] = item;
+}
+
+static int Complete_Pop(const CompleteItem *items, int *heap, int *heapSize) {
+    int top = heap[0];
+    int last = heap[--(*heapSize)];
+    int at = 0;
+    for (;;) {
+        int child = 2 * at + 1;
+        if (child >= *heapSize) break;
+        if (child + 1 < *heapSize && Complete_Before(items, heap[child + 1], heap[child])) child++;
+        if (!Complete_Before(items, heap[child], last)) break;
+        heap[at] = heap[child];
+        at = child;
+    }
+    if (*heapSize > 0) heap[at] = last;
+    return top;
+}
+
+// ------------------------------------------
+// Spell out the key of a subtree item into 'out'
+// ------------------------------------------
+static void Complete_Text(const CompleteTrie *trie, const CompleteItem *items, int item,
+                          const CompleteLocus *loci, char *out) {
+    int chain[COMPLETE_MAX_KEY];
+    int depth = 0;
+    while (items[item].parent >= 0 && depth < COMPLETE_MAX_KEY) {
+        chain[depth++] = item;
+        item = items[item].parent;
+    }
+    const CompleteLocus *locus = &loci[items[item].locus];
+    int length = locus->length;
+    memcpy(out, locus->text, (size_t)length);
+    while (depth > 0) {
+        int labelLength;
+        const unsigned char *label = Trie_Label(trie, items[chain[--depth]].node, &labelLength);
+        if (length + labelLength >= COMPLETE_MAX_KEY) break;
+        memcpy(out + length, label, (size_t)labelLength);
+        length += labelLength;
+    }
+    out[length] = '\0';
+}
+
+// ------------------------------------------
+// Top completions of a prefix, best-first over the subtree counts
+// Every popped subtree pushes its own key, its first child and (below a
+// locus) its next sibling; children are ordered by best count, so the
+// walk never looks at a subtree that cannot beat what it has found.
+// ------------------------------------------
+int Autocomplete_Lookup(const Autocomplete *ac, CompleteKind kind, const char *prefix, Completion *results, int max) {
+    if (ac->stale) return -1;
+    const CompleteTrie *trie = &ac->tries[kind];
+    if (max > COMPLETE_MAX_RESULTS) max = COMPLETE_MAX_RESULTS;
+    if (!prefix) prefix = "";
+    if (trie->nodeCount == 0 || max <= 0 || strlen(prefix) >= COMPLETE_MAX_KEY) return 0;
+
+    CompleteLocus loci[COMPLETE_MAX_LOCI];
+    int lociCount = 0;
+    if (prefix[0] == '\0') {
+        loci[0].node = 0;
+        loci[0].length = 0;
+        lociCount = 1;
+    } else {
+        char text[COMPLETE_MAX_KEY];
+        Complete_FindLoci(trie, 0, (const unsigned char*)prefix, text, 0, loci, &lociCount);
+    }
+
+    // Each key found costs at most one pop per level of the trie, and a
+    // pop pushes at most three items
+    int capacity = lociCount + 3 * max * (COMPLETE_MAX_KEY + 1);
+    CompleteItem *items = (CompleteItem*)malloc((size_t)capacity * (sizeof(CompleteItem) + sizeof(int)));
+    if (!items) return 0;
+    int *heap = (int*)(items + capacity);
+    int itemCount = 0, heapSize = 0;
+    for (int l = 0; l < lociCount; l++) {
+        CompleteItem *item = &items[itemCount];
+        item->node = loci[l].node;
+        item->priority = Trie_Best(trie, loci[l].node);
+        item->parent = -1;
+        item->locus = (short)l;
+        item->key = 0;
+        item->first = 1;
+        Complete_Push(items, heap, &heapSize, itemCount++);
+    }
+
+    int found = 0;
+    while (heapSize > 0 && found < max && itemCount + 3 <= capacity) {
+        int top = Complete_Pop(items, heap, &heapSize);
+        CompleteItem item = items[top];
+        if (item.key) {
+            Complete_Text(trie, items, item.parent, loci, results[found].text);
+            results[found].count = (int)item.priority;
+            found++;
+            continue;
+        }
+        const CompleteNode *node = &trie->nodes[item.node];
+        if (node->count > 0) {
+            items[itemCount] = (CompleteItem){ item.node, node->count, top, item.locus, 1, 0 };
+            Complete_Push(items, heap, &heapSize, itemCount++);
+        }
+        if (node->child != 0) {
+            items[itemCount] = (CompleteItem){ node->child, Trie_Best(trie, node->child), top, item.locus, 0, 0 };
+            Complete_Push(items, heap, &heapSize, itemCount++);
+        }
+        if (!item.first && node->sibling != 0) {
+            items[itemCount] = (CompleteItem){ node->sibling, Trie_Best(trie, node->sibling), item.parent, item.locus, 0, 0 };
+            Complete_Push(items, heap, &heapSize, itemCount++);
+        }
+    }
+    free(items);
+    return found;
+}
+
+const char *Autocomplete_Domain(const char *email) {
+    const char *at = strrchr(email, '@');
+    return (at && at[1]) ? at + 1 : NULL;
+}
+
+size_t Autocomplete_MemoryBytes(const Autocomplete *ac) {
+    size_t bytes = 0;
+    for (int kind = 0; kind < COMPLETE_KIND_COUNT; kind++) {
+        bytes += (size_t)ac->tries[kind].nodeCapacity * sizeof(CompleteNode) + ac->tries[kind].labelCapacity;
+    }
+    return bytes;
+}
@@ -0,0 +1,92 @@
+#ifndef AUTOCOMPLETE_H
+#define AUTOCOMPLETE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ContactStore.h"
+
+// Prefix completion of names and email domains, most frequent first.
+//
+// Each kind of key lives in a radix trie (a trie whose single-child chains
+// are merged into one edge), counting the contacts that have each key.
+// Nodes are 16 bytes and edge labels are stored once in a byte pool, so
+// shared prefixes cost nothing per key. The children of a node are kept
+// ordered by the highest count found below them; the best key of any
+// subtree is then at the end of its first-child chain, and a top-k lookup
+// is a best-first walk that touches O(k * depth) nodes whatever the number
+// of keys.
+//
+// Names are matched ignoring ASCII case and suggested as stored; domains
+// (the text after the '@' of an email) are folded to lower case.
+//
+// Maintenance, in step with the store:
+//   Store_Add          -> Autocomplete_Insert(ac, store, store->count - 1)
+//   Store_Update(row)  -> Autocomplete_BeginUpdate before, Autocomplete_EndUpdate after
+//   Store_Delete(row)  -> Autocomplete_Remove before
+// Purges and reorders need nothing: keys are strings, not positions.
+
+typedef enum {
+    COMPLETE_NAME,
+    COMPLETE_DOMAIN,
+    COMPLETE_KIND_COUNT
+} CompleteKind;
+
+#define COMPLETE_MAX_RESULTS 16
+
+typedef struct {
+    uint32_t label;     // Offset of the edge label (length byte, then bytes)
+    uint32_t child;     // First child (0: none), highest subtree count first
+    uint32_t sibling;   // Next child of the same parent (0: none)
+    uint32_t count;     // Contacts whose key ends here
+} CompleteNode;
+
+typedef struct {
+    CompleteNode  *nodes;       // nodes[0] is the root, with an empty label
+    uint32_t       nodeCount;
+    uint32_t       nodeCapacity;
+    uint32_t       freeNode;    // Chain of removed nodes through 'sibling'
+    unsigned char *labels;
+    uint32_t       labelSize;
+    uint32_t       labelCapacity;
+    uint32_t       garbage;     // Label bytes no longer referenced
+    uint32_t       keys;        // Distinct keys with a count
+} CompleteTrie;
+
+typedef struct {
+    CompleteTrie tries[COMPLETE_KIND_COUNT];
+    int stale;      // Invalidated or out of memory during an update; needs a Build
+} Autocomplete;
+
+typedef struct {
+    char text[CONTACT_NAME_SIZE];
+    int  count;     // Contacts with this key
+} Completion;
+
+void Autocomplete_Init(Autocomplete *ac);
+void Autocomplete_Free(Autocomplete *ac);
+
+// Forget every key; lookups fail until the next Build (for callers that
+// replace the whole store and would rather build on first use)
+void Autocomplete_Invalidate(Autocomplete *ac);
+
+// (Re)build from the whole store. Returns 0 when out of memory (left stale).
+int Autocomplete_Build(Autocomplete *ac, const ContactStore *store);
+
+int  Autocomplete_Insert(Autocomplete *ac, const ContactStore *store, int row);
+void Autocomplete_BeginUpdate(Autocomplete *ac, const ContactStore *store, int row);
+int  Autocomplete_EndUpdate(Autocomplete *ac, const ContactStore *store, int row);
+void Autocomplete_Remove(Autocomplete *ac, const ContactStore *store, int row);
+
+// Up to 'max' (at most COMPLETE_MAX_RESULTS) keys of 'kind' starting with
+// 'prefix', most frequent first; an empty prefix lists the most frequent
+// keys. Returns their number, or -1 while stale.
+int Autocomplete_Lookup(const Autocomplete *ac, CompleteKind kind, const char *prefix, Completion *results, int max);
+
+// Domain of an email address: the text after its last '@', or NULL
+const char *Autocomplete_Domain(const char *email);
+
+// Bytes held by the tries (for the benchmarks)
+size_t Autocomplete_MemoryBytes(const Autocomplete *ac);
+
+#endif // AUTOCOMPLETE_H
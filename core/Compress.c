@@ -0,0 +1,157 @@
+#include "Compress.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define LZ_MIN_MATCH   4
+#define LZ_MAX_OFFSET  65535
+#define LZ_HASH_BITS   14
+
+// ------------------------------------------
+// Hash of the 4 bytes at 'p'
+// ------------------------------------------
+static uint32_t Lz_Hash(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// ------------------------------------------
+// Write a length that did not fit in its 4-bit token field
+// ------------------------------------------
+static unsigned char *Lz_PutLength(unsigned char *out, size_t len) {
+    while (len >= 255) {
+        *out++ = 255;
+        len -= 255;
+    }
+    *out++ = (unsigned char)len;
+    return out;
+}
+
+// ------------------------------------------
+// Emit one sequence: token, literals, and (if matchLen > 0) the match
+// ------------------------------------------
+static unsigned char *Lz_PutSequence(unsigned char *out, const unsigned char *literals, size_t litLen,
+                                     size_t offset, size_t matchLen) {
+    unsigned char *token = out++;
+    size_t matchCode = matchLen ? matchLen - LZ_MIN_MATCH : 0;
+
+    *token = (unsigned char)((litLen >= 15 ? 15 : litLen) << 4);
+    if (litLen >= 15) out = Lz_PutLength(out, litLen - 15);
+    memcpy(out, literals, litLen);
+    out += litLen;
+
+    if (matchLen) {
+        *token |= (unsigned char)(matchCode >= 15 ? 15 : matchCode);
+        *out++ = (unsigned char)(offset & 0xFF);
+        *out++ = (unsigned char)(offset >> 8);
+        if (matchCode >= 15) out = Lz_PutLength(out, matchCode - 15);
+    }
+    return out;
+}
+
+// ------------------------------------------
+// Greedy single-pass compressor with a 16K-entry hash table
+// ------------------------------------------
+size_t Lz_Compress(const unsigned char *in, size_t len, unsigned char *out) {
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    unsigned char *op = out;
+    size_t anchor = 0;   // Start of pending literals
+    size_t pos = 0;
+
+    // Positions are stored +1 so that 0 means "empty slot". After a run of
+    // misses the scan takes bigger steps, which keeps incompressible data fast.
+    size_t misses = 0;
+    while (len >= LZ_MIN_MATCH && pos <= len - LZ_MIN_MATCH) {
+        uint32_t h = Lz_Hash(in + pos);
+        size_t candidate = table[h];
+        table[h] = (uint32_t)(pos + 1);
+
+        uint32_t a, b;
+        memcpy(&b, in + pos, sizeof(b));
+        if (candidate != 0) memcpy(&a, in + candidate - 1, sizeof(a));
+        if (candidate == 0 || pos - (candidate - 1) > LZ_MAX_OFFSET || a != b) {
+            pos += 1 + (misses++ >> 6);
+            continue;
+        }
+        candidate--;
+        misses = 0;
+
+        // Extend the match 8 bytes at a time, then byte by byte
+        size_t matchLen = LZ_MIN_MATCH;
+        while (pos + matchLen + 8 <= len) {
+            uint64_t x, y;
+            memcpy(&x, in + candidate + matchLen, 8);
+            memcpy(&y, in + pos + matchLen, 8);
+            if (x != y) break;
+            matchLen += 8;
+        }
+        while (pos + matchLen < len && in[candidate + matchLen] == in[pos + matchLen]) {
+            matchLen++;
+        }
+
+        op = Lz_PutSequence(op, in + anchor, pos - anchor, pos - candidate, matchLen);
+        pos += matchLen;
+        anchor = pos;
+    }
+
+    // Trailing literals
+    return (size_t)(Lz_PutSequence(op, in + anchor, len - anchor, 0, 0) - out);
+}
+
+// ------------------------------------------
+// Read an extended length; returns 0 on truncated input
+// ------------------------------------------
+static int Lz_GetLength(const unsigned char **ip, const unsigned char *end, size_t *len) {
+    unsigned char b;
+    do {
+        if (*ip >= end) return 0;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 1;
+}
+
+// ------------------------------------------
+// Bounds-checked decompressor
+// ------------------------------------------
+int Lz_Decompress(const unsigned char *in, size_t inLen, unsigned char *out, size_t outLen) {
+    const unsigned char *ip = in;
+    const unsigned char *end = in + inLen;
+    size_t op = 0;
+
+    while (ip < end) {
+        unsigned char token = *ip++;
+
+        size_t litLen = token >> 4;
+        if (litLen == 15 && !Lz_GetLength(&ip, end, &litLen)) return 0;
+        if (litLen > (size_t)(end - ip) || litLen > outLen - op) return 0;
+        memcpy(out + op, ip, litLen);
+        ip += litLen;
+        op += litLen;
+
+        if (ip == end) break;  // Last sequence has no match
+
+        if (end - ip < 2) return 0;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t matchLen = token & 15;
+        if (matchLen == 15 && !Lz_GetLength(&ip, end, &matchLen)) return 0;
+        matchLen += LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > op || matchLen > outLen - op) return 0;
+        const unsigned char *src = out + op - offset;
+        if (offset >= matchLen) {
+            memcpy(out + op, src, matchLen);
+        } else {
+            // Overlapping match: byte by byte so it can repeat its own output
+            for (size_t i = 0; i < matchLen; i++) {
+                out[op + i] = src[i];
+            }
+        }
+        op += matchLen;
+    }
+    return op == outLen;
+}
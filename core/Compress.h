@@ -0,0 +1,21 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stddef.h>
+
+// Byte-oriented LZ77 block codec (LZ4-style sequences: literal run, then a
+// back reference of at least 4 bytes within the last 64 KB). Fast enough to
+// run on every save; only used for whole blocks.
+
+// Worst-case output size of Lz_Compress for 'len' input bytes
+#define LZ_COMPRESS_BOUND(len) ((len) + (len) / 255 + 16)
+
+// Compress 'len' bytes into 'out' (room for LZ_COMPRESS_BOUND(len) bytes).
+// Returns the compressed size.
+size_t Lz_Compress(const unsigned char *in, size_t len, unsigned char *out);
+
+// Decompress into exactly 'outLen' bytes. Returns 1 on success, 0 if the
+// input is corrupt or does not expand to 'outLen' bytes.
+int Lz_Decompress(const unsigned char *in, size_t inLen, unsigned char *out, size_t outLen);
+
+#endif // COMPRESS_H
@@ -0,0 +1,306 @@
+#include "ContactFile.h"
+#include "FileWriter.h"
+#include "Platform.h"
+#include "Rsa.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ------------------------------------------
+// Human readable text for a save/load status
+// ------------------------------------------
+const char *ContactFile_StatusMessage(ContactFileStatus status) {
+    switch (status) {
+        case CONTACT_FILE_OK:           return "Success.";
+        case CONTACT_FILE_NOT_FOUND:    return "No file found to load.";
+        case CONTACT_FILE_OPEN_FAILED:  return "Failed to open file for writing.";
+        case CONTACT_FILE_WRITE_FAILED: return "File write error.";
+        case CONTACT_FILE_TOO_LARGE:    return "Contact data too large!";
+        case CONTACT_FILE_NO_MEMORY:    return "Out of memory!";
+        case CONTACT_FILE_EMPTY:        return "No valid contacts found in the file.";
+        case CONTACT_FILE_CORRUPT:      return "The contacts file is damaged.";
+        case CONTACT_FILE_UNSUPPORTED:  return "The contacts file was written by a newer version.";
+        case CONTACT_FILE_BAD_PASSPHRASE: return "Wrong passphrase for the encrypted contacts file.";
+    }
+    return "Unknown error.";
+}
+
+// Plaintext bytes serialized and encrypted per batch
+#define SAVE_CHUNK_SIZE   (64 * 1024)
+// Longest possible "Name|Phone|Email|Date\n" line
+#define MAX_LINE_SIZE     (CONTACT_NAME_SIZE + CONTACT_PHONE_SIZE + CONTACT_EMAIL_SIZE + CONTACT_DATE_SIZE)
+
+// ------------------------------------------
+// Append "Name|Phone|Email|Date\n" for one contact, returns its length
+// ------------------------------------------
+static size_t ContactFile_FormatLine(const ContactStore *store, int index, char *out) {
+    const char *fields[4] = {
+        Store_GetName(store, index), Store_GetPhone(store, index),
+        Store_GetEmail(store, index), Store_GetDate(store, index)
+    };
+    char *p = out;
+    for (int f = 0; f < 4; f++) {
+        size_t len = strlen(fields[f]);
+        memcpy(p, fields[f], len);
+        p += len;
+        *p++ = (f < 3) ? '|' : '\n';
+    }
+    return (size_t)(p - out);
+}
+
+// ------------------------------------------
+// Encrypt a plaintext chunk straight into the writer's buffer
+// ------------------------------------------
+static void ContactFile_WriteChunk(FileWriter *w, const char *plain, size_t len) {
+    int *cipher = (int*)FileWriter_Reserve(w, len * sizeof(int));
+    RSA_EncryptBlock((const unsigned char*)plain, len, cipher);
+}
+
+// ------------------------------------------
+// Save all contacts to a file, RSA encrypted
+// Contacts are serialized and encrypted in fixed-size chunks and streamed
+// to "<filename>.tmp", which then replaces 'filename'. A failed or
+// interrupted save leaves the previous file untouched.
+// ------------------------------------------
+ContactFileStatus ContactFile_SaveRSA(const ContactStore *store, const char *filename) {
+    char *plain = (char*)malloc(SAVE_CHUNK_SIZE);
+    if (!plain) {
+        return CONTACT_FILE_NO_MEMORY;
+    }
+    FileWriter writer;
+    if (!FileWriter_OpenAtomic(&writer, filename)) {
+        free(plain);
+        return CONTACT_FILE_OPEN_FAILED;
+    }
+
+    // Serialize into the plaintext chunk, encrypting it whenever it fills up
+    size_t fill = 0;
+    for (int i = 0; i < store->count && !writer.failed; i++) {
+        if (Store_IsDeleted(store, i)) continue;
+        if (fill + MAX_LINE_SIZE > SAVE_CHUNK_SIZE) {
+            ContactFile_WriteChunk(&writer, plain, fill);
+            fill = 0;
+        }
+        fill += ContactFile_FormatLine(store, i, plain + fill);
+    }
+    ContactFile_WriteChunk(&writer, plain, fill);
+    free(plain);
+
+    return FileWriter_Commit(&writer) ? CONTACT_FILE_OK : CONTACT_FILE_WRITE_FAILED;
+}
+
+// Minimum decoded characters per loader thread
+#define LOAD_MIN_CHARS_PER_WORKER (1024 * 1024)
+
+// Records parsed by one loader thread
+typedef struct {
+    ContactRecord *records;
+    int    count;
+    int    capacity;
+    int    failed;
+} LoadChunk;
+
+// Shared state of a parallel load
+typedef struct {
+    const unsigned char *cipher;  // Mapped file, one int per character
+    char         *text;           // Decoded text: "\0" + decoded characters + "\0"
+    const size_t *bounds;         // workerCount+1 line-aligned character ranges
+    LoadChunk    *chunks;         // One per worker
+} LoadJob;
+
+// ------------------------------------------
+// Append a record to a loader chunk
+// ------------------------------------------
+static int LoadChunk_Push(LoadChunk *chunk, const ContactRecord *rec) {
+    if (chunk->count == chunk->capacity) {
+        int newCapacity = chunk->capacity ? chunk->capacity * 2 : 1024;
+        ContactRecord *newRecords = (ContactRecord*)realloc(chunk->records, (size_t)newCapacity * sizeof(ContactRecord));
+        if (!newRecords) return 0;
+        chunk->records = newRecords;
+        chunk->capacity = newCapacity;
+    }
+    chunk->records[chunk->count++] = *rec;
+    return 1;
+}
+
+// ------------------------------------------
+// Terminate a field in place and return its offset in the text
+// Separators become the '\0' terminators, overlong fields are cut at
+// 'maxSize'-1 characters like Store_Add does. Empty fields map to offset 0.
+// ------------------------------------------
+static uint32_t LoadChunk_Field(char *text, size_t start, size_t end, size_t maxSize) {
+    if (end == start) return 0;
+    if (end - start > maxSize - 1) end = start + maxSize - 1;
+    text[end] = '\0';
+    return (uint32_t)start;
+}
+
+// ------------------------------------------
+// Loader thread: decode one range of the file and parse its lines
+// The decoded text is parsed in place: fields are terminated where they
+// stand, and Store_Attach copies them into the field arenas.
+// Line format: Name|Phone|Email|Date (missing trailing fields are empty)
+// ------------------------------------------
+static void ContactFile_LoadWorker(void *context, int worker, int workerCount) {
+    LoadJob *job = (LoadJob*)context;
+    LoadChunk *chunk = &job->chunks[worker];
+    size_t begin = job->bounds[worker];
+    size_t end = job->bounds[worker + 1];
+    char *text = job->text;
+    (void)workerCount;
+
+    // Character i of the file lands at text[i + 1]
+    RSA_DecryptBlock(job->cipher + (begin - 1) * sizeof(int), end - begin, text + begin);
+
+    static const size_t fieldSizes[4] = {
+        CONTACT_NAME_SIZE, CONTACT_PHONE_SIZE, CONTACT_EMAIL_SIZE, CONTACT_DATE_SIZE
+    };
+    size_t pos = begin;
+    while (pos < end && !chunk->failed) {
+        size_t starts[4], ends[4];
+        int fields = 0;
+        size_t fieldStart = pos;
+
+        // Split the line at '|' into at most four fields
+        while (pos < end && text[pos] != '\n') {
+            if (text[pos] == '|' && fields < 3) {
+                starts[fields] = fieldStart;
+                ends[fields++] = pos;
+                fieldStart = pos + 1;
+            }
+            pos++;
+        }
+        starts[fields] = fieldStart;
+        ends[fields++] = pos;
+        if (fields == 4) {
+            // Extra separators in the date field are ignored
+            char *bar = (char*)memchr(text + starts[3], '|', ends[3] - starts[3]);
+            if (bar) ends[3] = (size_t)(bar - text);
+        }
+        pos++; // Skip the '\n'
+
+        // Only add if we have a valid name
+        if (ends[0] == starts[0]) continue;
+
+        uint32_t offsets[4] = { 0, 0, 0, 0 };
+        for (int f = 0; f < fields; f++) {
+            offsets[f] = LoadChunk_Field(text, starts[f], ends[f], fieldSizes[f]);
+        }
+        ContactRecord rec = { offsets[0], offsets[1], offsets[2], offsets[3], 0 };
+        if (!LoadChunk_Push(chunk, &rec)) chunk->failed = 1;
+    }
+}
+
+// ------------------------------------------
+// Load contacts from file, RSA decrypted
+// The file is memory mapped and split at record boundaries (the
+// ciphertext of '\n' is fixed, so no decoding is needed to find them).
+// Each range is decoded and parsed on its own thread into one shared
+// text buffer that Store_Attach then splits into the field arenas.
+// ------------------------------------------
+ContactFileStatus ContactFile_LoadRSA(ContactStore *out, const char *filename) {
+    Store_Init(out);
+
+    MappedFile map;
+    if (!Platform_MapFile(filename, &map)) {
+        return CONTACT_FILE_NOT_FOUND;
+    }
+
+    size_t length = map.size / sizeof(int);
+    if (length == 0) {
+        Platform_UnmapFile(&map);
+        return CONTACT_FILE_EMPTY;
+    }
+    if (length + 2 > UINT32_MAX) {
+        Platform_UnmapFile(&map);
+        return CONTACT_FILE_TOO_LARGE;
+    }
+
+    int workerCount = Platform_CpuCount();
+    if ((size_t)workerCount > length / LOAD_MIN_CHARS_PER_WORKER + 1) {
+        workerCount = (int)(length / LOAD_MIN_CHARS_PER_WORKER + 1);
+    }
+
+    char *text = (char*)malloc(length + 2);
+    size_t *bounds = (size_t*)malloc((size_t)(workerCount + 1) * sizeof(size_t));
+    LoadChunk *chunks = (LoadChunk*)calloc((size_t)workerCount, sizeof(LoadChunk));
+    if (!text || !bounds || !chunks) {
+        free(text);
+        free(bounds);
+        free(chunks);
+        Platform_UnmapFile(&map);
+        return CONTACT_FILE_NO_MEMORY;
+    }
+    text[0] = '\0';
+    text[length + 1] = '\0';
+
+    // Split points: just after the first '\n' at or past each even share
+    int newline;
+    RSA_InitTables();
+    RSA_EncryptBlock((const unsigned char*)"\n", 1, &newline);
+    bounds[0] = 1;
+    bounds[workerCount] = length + 1;
+    for (int w = 1; w < workerCount; w++) {
+        size_t i = length * (size_t)w / (size_t)workerCount;
+        if (i < bounds[w - 1] - 1) i = bounds[w - 1] - 1;
+        while (i < length) {
+            int c;
+            memcpy(&c, map.data + i * sizeof(int), sizeof(int));
+            i++;
+            if (c == newline) break;
+        }
+        bounds[w] = i + 1;
+    }
+
+    LoadJob job = { map.data, text, bounds, chunks };
+    Platform_RunParallel(workerCount, ContactFile_LoadWorker, &job);
+    Platform_UnmapFile(&map);
+
+    // Join the per-thread records in file order
+    size_t total = 0;
+    int failed = 0;
+    for (int w = 0; w < workerCount; w++) {
+        total += (size_t)chunks[w].count;
+        failed |= chunks[w].failed;
+    }
+
+    ContactFileStatus status = CONTACT_FILE_OK;
+    ContactRecord *records = NULL;
+    if (failed) {
+        status = CONTACT_FILE_NO_MEMORY;
+    } else if (total == 0) {
+        status = CONTACT_FILE_EMPTY;
+    } else if (total > INT32_MAX) {
+        status = CONTACT_FILE_TOO_LARGE;
+    } else if (workerCount == 1) {
+        records = chunks[0].records;
+        chunks[0].records = NULL;
+    } else {
+        records = (ContactRecord*)malloc(total * sizeof(ContactRecord));
+        if (records) {
+            size_t pos = 0;
+            for (int w = 0; w < workerCount; w++) {
+                memcpy(records + pos, chunks[w].records, (size_t)chunks[w].count * sizeof(ContactRecord));
+                pos += (size_t)chunks[w].count;
+            }
+        } else {
+            status = CONTACT_FILE_NO_MEMORY;
+        }
+    }
+
+    for (int w = 0; w < workerCount; w++) {
+        free(chunks[w].records);
+    }
+    free(chunks);
+    free(bounds);
+
+    if (status == CONTACT_FILE_OK) {
+        if (!Store_Attach(out, records, (int)total, text)) {
+            status = CONTACT_FILE_NO_MEMORY;
+        }
+    } else {
+        free(text);
+    }
+    return status;
+}
@@ -0,0 +1,66 @@
+#ifndef CONTACT_FILE_H
+#define CONTACT_FILE_H
+
+#include "ContactStore.h"
+
+// Result of a save or load. The core never shows UI, callers turn the
+// status into a message with ContactFile_StatusMessage.
+typedef enum {
+    CONTACT_FILE_OK = 0,
+    CONTACT_FILE_NOT_FOUND,     // Nothing to load
+    CONTACT_FILE_OPEN_FAILED,   // Could not create the output file
+    CONTACT_FILE_WRITE_FAILED,
+    CONTACT_FILE_TOO_LARGE,
+    CONTACT_FILE_NO_MEMORY,
+    CONTACT_FILE_EMPTY,         // File holds no valid contacts
+    CONTACT_FILE_CORRUPT,       // Damaged or truncated v2 file
+    CONTACT_FILE_UNSUPPORTED,   // v2 file from a newer version
+    CONTACT_FILE_BAD_PASSPHRASE // Encrypted file with a missing or wrong passphrase
+} ContactFileStatus;
+
+// Flags of the v2 binary format
+#define CONTACT_V2_COMPRESSED 0x0001   // Blocks are LZ compressed
+#define CONTACT_V2_ENCRYPTED  0x0002   // Blocks are sealed with ChaCha20-Poly1305
+#define CONTACT_V2_IDS        0x0004   // Records carry their contact ids (always written)
+
+#define CONTACT_SNAPSHOT_ID_SIZE 16
+
+const char *ContactFile_StatusMessage(ContactFileStatus status);
+
+// Serialize all contacts as "Name|Phone|Email|Date\n" lines and write
+// every character RSA encrypted as one int. The data is streamed in chunks
+// to a temporary file that atomically replaces 'filename' on success.
+ContactFileStatus ContactFile_SaveRSA(const ContactStore *store, const char *filename);
+
+// Read and decrypt a file written by ContactFile_SaveRSA into 'out'.
+// The file is memory mapped, decoded and parsed on several threads.
+// 'out' is always initialized; it only holds contacts when CONTACT_FILE_OK
+// is returned.
+ContactFileStatus ContactFile_LoadRSA(ContactStore *out, const char *filename);
+
+// Binary format v2: header with magic, version and record count, then
+// blocks of length-prefixed fields, optionally LZ compressed. About 4x
+// smaller than the RSA format before compression. Written atomically.
+// With CONTACT_V2_ENCRYPTED every block is authenticated and encrypted
+// with a key derived from 'passphrase' (ignored otherwise, may be NULL).
+// A file of no contacts loads as an empty store, not CONTACT_FILE_EMPTY:
+// it is the snapshot of a journal that may hold contacts added since.
+ContactFileStatus ContactFile_SaveV2(const ContactStore *store, const char *filename, int flags,
+                                     const char *passphrase);
+ContactFileStatus ContactFile_LoadV2(ContactStore *out, const char *filename, const char *passphrase);
+
+// Returns 1 if 'filename' starts with the v2 magic number
+int ContactFile_IsV2(const char *filename);
+
+// Returns 1 if 'filename' is an encrypted v2 file (a passphrase is needed)
+int ContactFile_IsEncrypted(const char *filename);
+
+// Identity of one save of an encrypted v2 file, different for every
+// save; journals use it to find the snapshot they belong to.
+// Returns 0 if 'filename' is not an encrypted v2 file.
+int ContactFile_SnapshotId(const char *filename, unsigned char id[CONTACT_SNAPSHOT_ID_SIZE]);
+
+// Load either format, detected from the file header
+ContactFileStatus ContactFile_Load(ContactStore *out, const char *filename, const char *passphrase);
+
+#endif // CONTACT_FILE_H
@@ -0,0 +1,642 @@
+#include "ContactFile.h"
+#include "Compress.h"
+#include "Crypto.h"
+#include "FileWriter.h"
+#include "Platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ------------------------------------------
+//            Binary format (v2)
+// ------------------------------------------
+// All integers are little-endian.
+//
+// File header (24 bytes):
+//   0  char[4]  magic "CMDB"
+//   4  uint16   version (2)
+//   6  uint16   flags (CONTACT_V2_COMPRESSED, CONTACT_V2_ENCRYPTED, CONTACT_V2_IDS)
+//   8  uint64   record count
+//  16  uint32   nominal raw block size
+//  20  uint32   reserved (0)
+//
+// Encrypted files continue the header (40 more bytes):
+//  24  uint8[16] PBKDF2 salt
+//  40  uint32    PBKDF2-HMAC-SHA256 iterations
+//  44  uint8[4]  nonce prefix
+//  48  uint8[16] key check: AEAD tag of an empty message over bytes 0..47
+//
+// Followed by blocks until the end of the file. Block header (12 bytes):
+//   0  uint32   raw size
+//   4  uint32   stored size (== raw size when the block is not compressed)
+//   8  uint32   records in the block
+//
+// Raw block payload: for every record the four fields name, phone, email,
+// date, each as a LEB128 length followed by that many bytes. With
+// CONTACT_V2_IDS every record starts with its contact id, as a LEB128
+// delta from the previous record of the block (from 0 for the first), so
+// ids survive a save and a load.
+//
+// Encryption runs after compression. The stored payload is ChaCha20-Poly1305
+// ciphertext followed by a 16-byte tag; the nonce is the prefix plus the
+// block's index in the file and the block header is the associated data,
+// so blocks cannot be altered, reordered or swapped between files.
+
+#define V2_HEADER_SIZE       24
+#define V2_CRYPTO_HEADER_SIZE 40
+#define V2_BLOCK_HEADER_SIZE 12
+#define V2_VERSION           2
+#define V2_BLOCK_SIZE        (64 * 1024)
+#define V2_MAX_BLOCK_SIZE    (16 * 1024 * 1024)
+// Longest encoded record: a 64-bit id delta, four 1-byte length prefixes
+// plus the fields
+#define V2_MAX_RECORD_SIZE   (10 + 4 + CONTACT_NAME_SIZE + CONTACT_PHONE_SIZE + CONTACT_EMAIL_SIZE + CONTACT_DATE_SIZE)
+#define V2_KNOWN_FLAGS       (CONTACT_V2_COMPRESSED | CONTACT_V2_ENCRYPTED | CONTACT_V2_IDS)
+
+#define V2_SALT_SIZE          16
+#define V2_NONCE_PREFIX_SIZE  4
+#define V2_KDF_ITERATIONS     100000
+#define V2_MAX_KDF_ITERATIONS 10000000
+#define V2_KEY_CHECK_INDEX    UINT64_MAX
+
+static const char V2_MAGIC[4] = { 'C', 'M', 'D', 'B' };
+
+// Per-file encryption state
+typedef struct {
+    uint8_t key[CRYPTO_KEY_SIZE];
+    uint8_t noncePrefix[V2_NONCE_PREFIX_SIZE];
+} V2Cipher;
+
+// ------------------------------------------
+// Little-endian helpers
+// ------------------------------------------
+static void Put16(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void Put32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void Put64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t Get16(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t Get32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t Get64(const unsigned char *p) {
+    return (uint64_t)Get32(p) | ((uint64_t)Get32(p + 4) << 32);
+}
+
+// ------------------------------------------
+// Does the file start with the v2 magic?
+// ------------------------------------------
+int ContactFile_IsV2(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return 0;
+    char magic[4];
+    int isV2 = (fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                memcmp(magic, V2_MAGIC, sizeof(magic)) == 0);
+    fclose(f);
+    return isV2;
+}
+
+// ------------------------------------------
+// Is the file an encrypted v2 file?
+// ------------------------------------------
+int ContactFile_IsEncrypted(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return 0;
+    unsigned char header[8];
+    int encrypted = (fread(header, 1, sizeof(header), f) == sizeof(header) &&
+                     memcmp(header, V2_MAGIC, 4) == 0 &&
+                     (Get16(header + 6) & CONTACT_V2_ENCRYPTED) != 0);
+    fclose(f);
+    return encrypted;
+}
+
+// ------------------------------------------
+// The key check tag of an encrypted v2 file: new random salt on every
+// save, so it tells saves apart
+// ------------------------------------------
+int ContactFile_SnapshotId(const char *filename, unsigned char id[CONTACT_SNAPSHOT_ID_SIZE]) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return 0;
+    unsigned char header[V2_HEADER_SIZE + V2_CRYPTO_HEADER_SIZE];
+    int ok = (fread(header, 1, sizeof(header), f) == sizeof(header) &&
+              memcmp(header, V2_MAGIC, 4) == 0 &&
+              (Get16(header + 6) & CONTACT_V2_ENCRYPTED) != 0);
+    fclose(f);
+    if (ok) memcpy(id, header + V2_HEADER_SIZE + 24, CONTACT_SNAPSHOT_ID_SIZE);
+    return ok;
+}
+
+// ------------------------------------------
+// Load any supported format, detected from the file header
+// ------------------------------------------
+ContactFileStatus ContactFile_Load(ContactStore *out, const char *filename, const char *passphrase) {
+    if (ContactFile_IsV2(filename)) {
+        return ContactFile_LoadV2(out, filename, passphrase);
+    }
+    return ContactFile_LoadRSA(out, filename);
+}
+
+// ------------------------------------------
+// Nonce of block 'index': the file's random prefix plus the index
+// ------------------------------------------
+static void V2_BlockNonce(const V2Cipher *cipher, uint64_t index, uint8_t nonce[CRYPTO_NONCE_SIZE]) {
+    memcpy(nonce, cipher->noncePrefix, V2_NONCE_PREFIX_SIZE);
+    Put64(nonce + V2_NONCE_PREFIX_SIZE, index);
+}
+
+// ------------------------------------------
+// Derive the file key and compute the key check tag over 'header'
+// (the first V2_HEADER_SIZE + 24 bytes, everything before the tag).
+// ------------------------------------------
+static void V2_DeriveKey(V2Cipher *cipher, const char *passphrase, const unsigned char *header,
+                         uint8_t check[CRYPTO_TAG_SIZE]) {
+    Pbkdf2_Sha256((const uint8_t*)passphrase, strlen(passphrase),
+                  header + V2_HEADER_SIZE, V2_SALT_SIZE, Get32(header + V2_HEADER_SIZE + 16),
+                  cipher->key, sizeof(cipher->key));
+    memcpy(cipher->noncePrefix, header + V2_HEADER_SIZE + 20, V2_NONCE_PREFIX_SIZE);
+
+    uint8_t nonce[CRYPTO_NONCE_SIZE];
+    V2_BlockNonce(cipher, V2_KEY_CHECK_INDEX, nonce);
+    Aead_Seal(cipher->key, nonce, header, V2_HEADER_SIZE + 24, NULL, 0, check);
+}
+
+// Raw blocks serialized on the calling thread, then compressed and/or
+// encrypted in parallel
+typedef struct {
+    unsigned char *raw;
+    unsigned char *packed;
+    size_t   rawSize;
+    size_t   packedSize;   // 0 when the block is stored raw
+    uint32_t records;
+    uint64_t lastId;       // Of its last record, for the id deltas
+    unsigned char header[V2_BLOCK_HEADER_SIZE];
+    uint8_t  tag[CRYPTO_TAG_SIZE];
+} V2PendingBlock;
+
+typedef struct {
+    V2PendingBlock *blocks;
+    int             count;
+    int             compress;
+    const V2Cipher *cipher;      // NULL when not encrypting
+    uint64_t        firstBlock;  // File-wide index of blocks[0]
+} V2PackJob;
+
+// ------------------------------------------
+// Packer thread: compress and seal an interleaved share of the pending blocks
+// ------------------------------------------
+static void V2_PackWorker(void *context, int worker, int workerCount) {
+    V2PackJob *job = (V2PackJob*)context;
+    for (int b = worker; b < job->count; b += workerCount) {
+        V2PendingBlock *block = &job->blocks[b];
+        if (job->compress) {
+            size_t packed = Lz_Compress(block->raw, block->rawSize, block->packed);
+            block->packedSize = (packed < block->rawSize) ? packed : 0;
+        }
+
+        unsigned char *payload = block->packedSize ? block->packed : block->raw;
+        size_t storedSize = block->packedSize ? block->packedSize : block->rawSize;
+        Put32(block->header, (uint32_t)block->rawSize);
+        Put32(block->header + 4, (uint32_t)storedSize);
+        Put32(block->header + 8, block->records);
+
+        if (job->cipher) {
+            uint8_t nonce[CRYPTO_NONCE_SIZE];
+            V2_BlockNonce(job->cipher, job->firstBlock + (uint64_t)b, nonce);
+            Aead_Seal(job->cipher->key, nonce, block->header, V2_BLOCK_HEADER_SIZE,
+                      payload, storedSize, block->tag);
+        }
+    }
+}
+
+// ------------------------------------------
+// Compress and encrypt (as configured), then write a batch of pending
+// blocks in order
+// ------------------------------------------
+static void V2_FlushBatch(FileWriter *w, V2PackJob *job, int count, int workerCount) {
+    job->count = count;
+    Platform_RunParallel(workerCount < count ? workerCount : count, V2_PackWorker, job);
+
+    for (int b = 0; b < count; b++) {
+        V2PendingBlock *block = &job->blocks[b];
+        FileWriter_Write(w, block->header, V2_BLOCK_HEADER_SIZE);
+        FileWriter_Write(w, block->packedSize ? block->packed : block->raw,
+                         block->packedSize ? block->packedSize : block->rawSize);
+        if (job->cipher) {
+            FileWriter_Write(w, block->tag, CRYPTO_TAG_SIZE);
+        }
+        block->rawSize = 0;
+        block->packedSize = 0;
+        block->records = 0;
+    }
+    job->firstBlock += (uint64_t)count;
+}
+
+// ------------------------------------------
+// Append a LEB128 number to a raw block
+// ------------------------------------------
+static unsigned char *V2_PutNumber(unsigned char *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+// ------------------------------------------
+// Append one length-prefixed field to a raw block
+// ------------------------------------------
+static unsigned char *V2_PutField(unsigned char *p, const char *str) {
+    size_t len = strlen(str);
+    p = V2_PutNumber(p, len);
+    memcpy(p, str, len);
+    return p + len;
+}
+
+// ------------------------------------------
+// Save all contacts in the v2 binary format
+// Records are serialized into fixed-size blocks; a batch of blocks is
+// compressed and encrypted on all cores and then streamed through an
+// atomic FileWriter.
+// ------------------------------------------
+ContactFileStatus ContactFile_SaveV2(const ContactStore *store, const char *filename, int flags,
+                                     const char *passphrase) {
+    int compress = (flags & CONTACT_V2_COMPRESSED) != 0;
+    int encrypt = (flags & CONTACT_V2_ENCRYPTED) != 0;
+    int workerCount = (compress || encrypt) ? Platform_CpuCount() : 1;
+    int batchSize = workerCount * 2;
+
+    if (encrypt && (!passphrase || !passphrase[0])) {
+        return CONTACT_FILE_BAD_PASSPHRASE;
+    }
+
+    // Header first: the encryption fields feed the key derivation
+    unsigned char header[V2_HEADER_SIZE + V2_CRYPTO_HEADER_SIZE];
+    size_t headerSize = encrypt ? sizeof(header) : V2_HEADER_SIZE;
+    memcpy(header, V2_MAGIC, 4);
+    Put16(header + 4, V2_VERSION);
+    Put16(header + 6, (uint32_t)((flags & (CONTACT_V2_COMPRESSED | CONTACT_V2_ENCRYPTED)) | CONTACT_V2_IDS));
+    Put64(header + 8, (uint64_t)Store_LiveCount(store));
+    Put32(header + 16, V2_BLOCK_SIZE);
+    Put32(header + 20, 0);
+
+    V2Cipher cipher;
+    if (encrypt) {
+        unsigned char *crypto = header + V2_HEADER_SIZE;
+        if (!Platform_RandomBytes(crypto, V2_SALT_SIZE) ||
+            !Platform_RandomBytes(crypto + 20, V2_NONCE_PREFIX_SIZE)) {
+            return CONTACT_FILE_WRITE_FAILED;
+        }
+        Put32(crypto + 16, V2_KDF_ITERATIONS);
+        V2_DeriveKey(&cipher, passphrase, header, crypto + 24);
+    }
+
+    V2PendingBlock *blocks = (V2PendingBlock*)calloc((size_t)batchSize, sizeof(V2PendingBlock));
+    int ok = (blocks != NULL);
+    for (int b = 0; ok && b < batchSize; b++) {
+        blocks[b].raw = (unsigned char*)malloc(V2_BLOCK_SIZE);
+        blocks[b].packed = compress ? (unsigned char*)malloc(LZ_COMPRESS_BOUND(V2_BLOCK_SIZE)) : NULL;
+        ok = blocks[b].raw && (!compress || blocks[b].packed);
+    }
+
+    FileWriter writer;
+    ContactFileStatus status = CONTACT_FILE_NO_MEMORY;
+    if (ok) {
+        status = FileWriter_OpenAtomic(&writer, filename) ? CONTACT_FILE_OK : CONTACT_FILE_OPEN_FAILED;
+    }
+
+    if (status == CONTACT_FILE_OK) {
+        FileWriter_Write(&writer, header, headerSize);
+
+        V2PackJob job = { blocks, 0, compress, encrypt ? &cipher : NULL, 0 };
+        int current = 0;
+        for (int i = 0; i < store->count && !writer.failed; i++) {
+            if (Store_IsDeleted(store, i)) continue;
+            V2PendingBlock *block = &blocks[current];
+            if (block->rawSize + V2_MAX_RECORD_SIZE > V2_BLOCK_SIZE) {
+                if (++current == batchSize) {
+                    V2_FlushBatch(&writer, &job, batchSize, workerCount);
+                    current = 0;
+                }
+                block = &blocks[current];
+            }
+            unsigned char *p = block->raw + block->rawSize;
+            uint64_t id = Store_GetId(store, i);
+            p = V2_PutNumber(p, id - (block->records ? block->lastId : 0));
+            block->lastId = id;
+            p = V2_PutField(p, Store_GetName(store, i));
+            p = V2_PutField(p, Store_GetPhone(store, i));
+            p = V2_PutField(p, Store_GetEmail(store, i));
+            p = V2_PutField(p, Store_GetDate(store, i));
+            block->rawSize = (size_t)(p - block->raw);
+            block->records++;
+        }
+        V2_FlushBatch(&writer, &job, blocks[current].records ? current + 1 : current, workerCount);
+
+        status = FileWriter_Commit(&writer) ? CONTACT_FILE_OK : CONTACT_FILE_WRITE_FAILED;
+    }
+
+    for (int b = 0; blocks && b < batchSize; b++) {
+        free(blocks[b].raw);
+        free(blocks[b].packed);
+    }
+    free(blocks);
+    if (encrypt) Crypto_Wipe(&cipher, sizeof(cipher));
+    return status;
+}
+
+// Location of one block inside the mapped file and inside the new store
+typedef struct {
+    const unsigned char *payload;  // Block header is just before it, the tag just after
+    uint64_t index;
+    uint32_t rawSize;
+    uint32_t storedSize;
+    uint32_t recordCount;
+    size_t   firstRecord;  // Index of its first record in the store
+    size_t   arenaOffset;  // Where its strings go; raw size is an upper bound
+} V2Block;
+
+// Shared state of a parallel v2 load
+typedef struct {
+    const V2Block *blocks;
+    int            blockCount;
+    const V2Cipher *cipher;    // NULL for plain files
+    int            ids;        // Records carry ids (CONTACT_V2_IDS)
+    char          *text;       // Arena being built
+    ContactRecord *records;
+    int           *failed;     // Per worker
+} V2LoadJob;
+
+// ------------------------------------------
+// Decode one raw block into the arena and record array
+// Returns 0 if the block is corrupt.
+// ------------------------------------------
+static int V2_DecodeBlock(const V2Block *block, const unsigned char *raw, int ids, char *text, ContactRecord *records) {
+    static const size_t fieldSizes[4] = {
+        CONTACT_NAME_SIZE, CONTACT_PHONE_SIZE, CONTACT_EMAIL_SIZE, CONTACT_DATE_SIZE
+    };
+    const unsigned char *p = raw;
+    const unsigned char *end = raw + block->rawSize;
+    size_t dst = block->arenaOffset;
+    uint64_t id = 0;
+
+    for (uint32_t r = 0; r < block->recordCount; r++) {
+        if (ids) {
+            uint64_t delta = 0;
+            int shift = 0;
+            unsigned char b;
+            do {
+                if (p >= end || shift > 63) return 0;
+                b = *p++;
+                delta |= (uint64_t)(b & 0x7F) << shift;
+                shift += 7;
+            } while (b & 0x80);
+            if (delta == 0 || delta >= CONTACT_ID_DELETED - id) return 0;
+            id += delta;
+        }
+        uint32_t offsets[4];
+        for (int f = 0; f < 4; f++) {
+            size_t len = 0;
+            int shift = 0;
+            unsigned char b;
+            do {
+                if (p >= end || shift > 28) return 0;
+                b = *p++;
+                len |= (size_t)(b & 0x7F) << shift;
+                shift += 7;
+            } while (b & 0x80);
+            if (len > (size_t)(end - p)) return 0;
+
+            size_t keep = len < fieldSizes[f] ? len : fieldSizes[f] - 1;
+            if (keep == 0) {
+                offsets[f] = 0;
+            } else {
+                memcpy(text + dst, p, keep);
+                text[dst + keep] = '\0';
+                offsets[f] = (uint32_t)dst;
+                dst += keep + 1;
+            }
+            p += len;
+        }
+        ContactRecord rec = { offsets[0], offsets[1], offsets[2], offsets[3], id };
+        records[block->firstRecord + r] = rec;
+    }
+    return p == end;
+}
+
+// ------------------------------------------
+// Grow a worker's scratch buffer. Returns 0 when out of memory.
+// ------------------------------------------
+static int V2_Reserve(unsigned char **buffer, size_t *capacity, size_t size) {
+    if (*capacity >= size) return 1;
+    free(*buffer);
+    *buffer = (unsigned char*)malloc(size);
+    *capacity = *buffer ? size : 0;
+    return *buffer != NULL;
+}
+
+// ------------------------------------------
+// Loader thread: decrypt, decompress and decode an interleaved share of the blocks
+// ------------------------------------------
+static void V2_LoadWorker(void *context, int worker, int workerCount) {
+    V2LoadJob *job = (V2LoadJob*)context;
+    unsigned char *scratch = NULL, *plain = NULL;
+    size_t scratchSize = 0, plainSize = 0;
+
+    for (int b = worker; b < job->blockCount && !job->failed[worker]; b += workerCount) {
+        const V2Block *block = &job->blocks[b];
+        const unsigned char *stored = block->payload;
+        if (job->cipher) {
+            // The mapping is read-only: authenticate and decrypt a copy
+            uint8_t nonce[CRYPTO_NONCE_SIZE];
+            if (!V2_Reserve(&plain, &plainSize, block->storedSize)) {
+                job->failed[worker] = 1;
+                break;
+            }
+            memcpy(plain, block->payload, block->storedSize);
+            V2_BlockNonce(job->cipher, block->index, nonce);
+            if (!Aead_Open(job->cipher->key, nonce, block->payload - V2_BLOCK_HEADER_SIZE, V2_BLOCK_HEADER_SIZE,
+                           plain, block->storedSize, block->payload + block->storedSize)) {
+                job->failed[worker] = 1;
+                break;
+            }
+            stored = plain;
+        }
+
+        const unsigned char *raw = stored;
+        if (block->storedSize != block->rawSize) {
+            if (!V2_Reserve(&scratch, &scratchSize, block->rawSize)) {
+                job->failed[worker] = 1;
+                break;
+            }
+            if (!Lz_Decompress(stored, block->storedSize, scratch, block->rawSize)) {
+                job->failed[worker] = 1;
+                break;
+            }
+            raw = scratch;
+        }
+        if (!V2_DecodeBlock(block, raw, job->ids, job->text, job->records)) {
+            job->failed[worker] = 1;
+            break;
+        }
+    }
+    free(scratch);
+    free(plain);
+}
+
+// ------------------------------------------
+// Load a v2 file
+// The block headers are walked once to size the arena; blocks are then
+// decoded in parallel, each into its own region of the arena.
+// ------------------------------------------
+ContactFileStatus ContactFile_LoadV2(ContactStore *out, const char *filename, const char *passphrase) {
+    Store_Init(out);
+
+    MappedFile map;
+    if (!Platform_MapFile(filename, &map)) {
+        return CONTACT_FILE_NOT_FOUND;
+    }
+    if (map.size < V2_HEADER_SIZE || memcmp(map.data, V2_MAGIC, 4) != 0) {
+        Platform_UnmapFile(&map);
+        return CONTACT_FILE_CORRUPT;
+    }
+    uint32_t flags = Get16(map.data + 6);
+    if (Get16(map.data + 4) != V2_VERSION || (flags & ~V2_KNOWN_FLAGS) != 0) {
+        Platform_UnmapFile(&map);
+        return CONTACT_FILE_UNSUPPORTED;
+    }
+    // A count of 0 is a valid empty snapshot (a checkpoint of a store whose
+    // contacts were all deleted): its journal may still add to it
+    uint64_t expected = Get64(map.data + 8);
+    if (expected > INT32_MAX) {
+        Platform_UnmapFile(&map);
+        return CONTACT_FILE_TOO_LARGE;
+    }
+
+    // Derive the key and check it before touching any block
+    V2Cipher cipher;
+    size_t tagSize = 0;
+    size_t pos = V2_HEADER_SIZE;
+    if (flags & CONTACT_V2_ENCRYPTED) {
+        if (map.size < V2_HEADER_SIZE + V2_CRYPTO_HEADER_SIZE) {
+            Platform_UnmapFile(&map);
+            return CONTACT_FILE_CORRUPT;
+        }
+        uint32_t iterations = Get32(map.data + V2_HEADER_SIZE + 16);
+        if (iterations == 0 || iterations > V2_MAX_KDF_ITERATIONS) {
+            Platform_UnmapFile(&map);
+            return CONTACT_FILE_UNSUPPORTED;
+        }
+        uint8_t check[CRYPTO_TAG_SIZE];
+        uint8_t diff = 0;
+        if (passphrase && passphrase[0]) {
+            V2_DeriveKey(&cipher, passphrase, map.data, check);
+            for (int i = 0; i < CRYPTO_TAG_SIZE; i++) diff |= (uint8_t)(check[i] ^ map.data[V2_HEADER_SIZE + 24 + i]);
+        }
+        if (!passphrase || !passphrase[0] || diff != 0) {
+            Crypto_Wipe(&cipher, sizeof(cipher));
+            Platform_UnmapFile(&map);
+            return CONTACT_FILE_BAD_PASSPHRASE;
+        }
+        tagSize = CRYPTO_TAG_SIZE;
+        pos += V2_CRYPTO_HEADER_SIZE;
+    }
+
+    // Walk the block headers
+    int blockCount = 0, blockCapacity = 64;
+    V2Block *blocks = (V2Block*)malloc((size_t)blockCapacity * sizeof(V2Block));
+    size_t records = 0;
+    size_t arenaSize = 1;
+    ContactFileStatus status = CONTACT_FILE_OK;
+    while (blocks && pos < map.size) {
+        if (map.size - pos < V2_BLOCK_HEADER_SIZE) { status = CONTACT_FILE_CORRUPT; break; }
+        V2Block block;
+        block.rawSize = Get32(map.data + pos);
+        block.storedSize = Get32(map.data + pos + 4);
+        block.recordCount = Get32(map.data + pos + 8);
+        block.payload = map.data + pos + V2_BLOCK_HEADER_SIZE;
+        block.index = (uint64_t)blockCount;
+        block.firstRecord = records;
+        block.arenaOffset = arenaSize;
+        pos += V2_BLOCK_HEADER_SIZE;
+        if (block.rawSize > V2_MAX_BLOCK_SIZE || block.storedSize > block.rawSize ||
+            block.storedSize + tagSize > map.size - pos || block.recordCount > block.rawSize / 4 ||
+            block.rawSize > (size_t)block.storedSize * 256) {
+            // LZ sequences cannot expand more than ~255x
+            status = CONTACT_FILE_CORRUPT;
+            break;
+        }
+        pos += block.storedSize + tagSize;
+        records += block.recordCount;
+        arenaSize += block.rawSize;
+
+        if (blockCount == blockCapacity) {
+            blockCapacity *= 2;
+            V2Block *grown = (V2Block*)realloc(blocks, (size_t)blockCapacity * sizeof(V2Block));
+            if (!grown) { free(blocks); blocks = NULL; break; }
+            blocks = grown;
+        }
+        blocks[blockCount++] = block;
+    }
+    if (!blocks) status = CONTACT_FILE_NO_MEMORY;
+    if (status == CONTACT_FILE_OK && records != expected) status = CONTACT_FILE_CORRUPT;
+    if (status == CONTACT_FILE_OK && arenaSize > UINT32_MAX) status = CONTACT_FILE_TOO_LARGE;
+
+    char *text = NULL;
+    ContactRecord *recs = NULL;
+    if (status == CONTACT_FILE_OK && records > 0) {
+        text = (char*)malloc(arenaSize);
+        recs = (ContactRecord*)malloc(records * sizeof(ContactRecord));
+        if (!text || !recs) status = CONTACT_FILE_NO_MEMORY;
+    }
+
+    if (status == CONTACT_FILE_OK && records > 0) {
+        int workerCount = Platform_CpuCount();
+        if (workerCount > blockCount) workerCount = blockCount;
+        int *failed = (int*)calloc((size_t)workerCount, sizeof(int));
+        if (failed) {
+            text[0] = '\0';
+            V2LoadJob job = { blocks, blockCount, tagSize ? &cipher : NULL, (flags & CONTACT_V2_IDS) != 0,
+                              text, recs, failed };
+            Platform_RunParallel(workerCount, V2_LoadWorker, &job);
+
+            for (int w = 0; w < workerCount; w++) {
+                if (failed[w]) status = CONTACT_FILE_CORRUPT;
+            }
+            // Ids must ascend across blocks too
+            for (size_t r = 1; status == CONTACT_FILE_OK && (flags & CONTACT_V2_IDS) && r < records; r++) {
+                if (recs[r].id <= recs[r - 1].id) status = CONTACT_FILE_CORRUPT;
+            }
+            if (status == CONTACT_FILE_OK) {
+                if (!Store_Attach(out, recs, (int)records, text)) {
+                    status = CONTACT_FILE_NO_MEMORY;
+                }
+                text = NULL;
+                recs = NULL;
+            }
+        } else {
+            status = CONTACT_FILE_NO_MEMORY;
+        }
+        free(failed);
+    }
+
+    free(text);
+    free(recs);
+    free(blocks);
+    if (tagSize) Crypto_Wipe(&cipher, sizeof(cipher));
+    Platform_UnmapFile(&map);
+    return status;
+}
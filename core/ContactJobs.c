@@ -0,0 +1,304 @@
+#include "ContactJobs.h"
+#include "Crypto.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ------------------------------------------
+// Heap copy of a string (NULL stays NULL). Returns 0 when out of memory.
+// ------------------------------------------
+static int ContactJob_CopyString(char **out, const char *text) {
+    *out = NULL;
+    if (!text) return 1;
+    size_t len = strlen(text) + 1;
+    *out = (char*)malloc(len);
+    if (!*out) return 0;
+    memcpy(*out, text, len);
+    return 1;
+}
+
+// ------------------------------------------
+// Build the three indexes over job->store, one progress step each.
+// Returns 0 if cancelled; an index out of memory leaves 'indexed' unset.
+// ------------------------------------------
+static int ContactJob_BuildIndexes(ContactJob *job, int step, int steps) {
+    int ok = 1;
+    if (Job_Cancelled(&job->job)) return 0;
+    ok = TrigramIndex_Build(&job->index, &job->store) && ok;
+    Job_Progress(&job->job, ++step, steps);
+    if (Job_Cancelled(&job->job)) return 0;
+    ok = SortIndex_Build(&job->sortIndex, &job->store) && ok;
+    Job_Progress(&job->job, ++step, steps);
+    if (Job_Cancelled(&job->job)) return 0;
+    ok = PhoneIndex_Build(&job->phoneIndex, &job->store) && ok;
+    Job_Progress(&job->job, ++step, steps);
+    job->indexed = ok;
+    return 1;
+}
+
+// ------------------------------------------
+// Load: read the file, replay its journal, build the indexes
+// ------------------------------------------
+static int ContactJob_RunLoad(ContactJob *job) {
+    Job_Progress(&job->job, 0, 5);
+    job->status = ContactFile_Load(&job->store, job->path, job->passphrase);
+    Job_Progress(&job->job, 1, 5);
+    if (job->status == CONTACT_FILE_OK && ContactFile_IsEncrypted(job->path)) {
+        if (Job_Cancelled(&job->job)) return 0;
+        // The changes made since the file was last written in full
+        job->status = Journal_Open(&job->journal, job->path, job->passphrase, &job->store);
+        if (job->status == CONTACT_FILE_NOT_FOUND) {
+            // Without a journal the next save is a full one
+            Journal_Create(&job->journal, job->path, job->passphrase);
+            job->status = CONTACT_FILE_OK;
+        }
+    }
+    Job_Progress(&job->job, 2, 5);
+    if (job->status != CONTACT_FILE_OK) return 1;
+    return ContactJob_BuildIndexes(job, 2, 5);
+}
+
+// ------------------------------------------
+// Save: write the snapshot, then start its journal
+// Not cancellable once writing: the file is replaced atomically at the end.
+// ------------------------------------------
+static int ContactJob_RunSave(ContactJob *job) {
+    Job_Progress(&job->job, 0, 2);
+    if (Job_Cancelled(&job->job)) return 0;
+    job->status = ContactFile_SaveV2(&job->store, job->path, job->flags, job->passphrase);
+    Job_Progress(&job->job, 1, 2);
+    if (job->status == CONTACT_FILE_OK && job->passphrase) {
+        // As after a load, failing this only makes the next save a full one
+        Journal_Create(&job->journal, job->path, job->passphrase);
+    }
+    Job_Progress(&job->job, 2, 2);
+    return 1;
+}
+
+// ------------------------------------------
+// Import: append to the snapshot, then index it
+// ------------------------------------------
+static int ContactJob_RunImport(ContactJob *job) {
+    Job_Progress(&job->job, 0, 4);
+    job->first = job->store.count;
+    job->status = Import_File(&job->store, job->path, job->importFormat, &job->import);
+    Job_Progress(&job->job, 1, 4);
+    if (job->store.count == job->first) return 1;
+    return ContactJob_BuildIndexes(job, 1, 4);
+}
+
+// ------------------------------------------
+// Export: stream the snapshot rows
+// ------------------------------------------
+static int ContactJob_RunExport(ContactJob *job) {
+    Job_Progress(&job->job, 0, 1);
+    if (Job_Cancelled(&job->job)) return 0;
+    job->status = Export_File(&job->store, job->rows, job->count, job->path, job->exportFormat, &job->exported);
+    Job_Progress(&job->job, 1, 1);
+    return 1;
+}
+
+// ------------------------------------------
+// Sort: every column order of the snapshot
+// ------------------------------------------
+static int ContactJob_RunSort(ContactJob *job) {
+    Job_Progress(&job->job, 0, 1);
+    if (Job_Cancelled(&job->job)) return 0;
+    job->status = SortIndex_Build(&job->sortIndex, &job->store) ? CONTACT_FILE_OK : CONTACT_FILE_NO_MEMORY;
+    Job_Progress(&job->job, 1, 1);
+    return 1;
+}
+
+// ------------------------------------------
+// Dedup: groups of likely duplicates in the snapshot
+// ------------------------------------------
+static int ContactJob_RunDedup(ContactJob *job) {
+    Job_Progress(&job->job, 0, 1);
+    if (Job_Cancelled(&job->job)) return 0;
+    job->status = Dedup_Find(&job->store, job->threshold, &job->dedup) ? CONTACT_FILE_OK : CONTACT_FILE_NO_MEMORY;
+    Job_Progress(&job->job, 1, 1);
+    return 1;
+}
+
+// ------------------------------------------
+// Merge: note what will be left behind, merge, then build the indexes
+// ------------------------------------------
+static int ContactJob_RunMerge(ContactJob *job) {
+    Job_Progress(&job->job, 0, 5);
+    if (Job_Cancelled(&job->job)) return 0;
+    int dropped = Dedup_Dropped(&job->store, &job->dedup, job->rows, job->count, NULL, 0);
+    if (dropped > 0) {
+        job->dropped = (DedupDropped*)malloc((size_t)dropped * sizeof(DedupDropped));
+        if (!job->dropped) {
+            job->status = CONTACT_FILE_NO_MEMORY;
+            return 1;
+        }
+        job->droppedCount = Dedup_Dropped(&job->store, &job->dedup, job->rows, job->count, job->dropped, dropped);
+    }
+    Job_Progress(&job->job, 1, 5);
+    if (Job_Cancelled(&job->job)) return 0;
+    job->merged = Dedup_Merge(&job->store, &job->dedup, job->rows, job->count);
+    Job_Progress(&job->job, 2, 5);
+    return ContactJob_BuildIndexes(job, 2, 5);
+}
+
+// ------------------------------------------
+// Worker entry: dispatch on the kind and time it
+// ------------------------------------------
+static int ContactJob_Run(Job *base) {
+    ContactJob *job = (ContactJob*)base;
+    double t0 = Platform_NowMs();
+    int completed = 1;
+    switch (job->kind) {
+        case CONTACT_JOB_LOAD:   completed = ContactJob_RunLoad(job);   break;
+        case CONTACT_JOB_SAVE:   completed = ContactJob_RunSave(job);   break;
+        case CONTACT_JOB_IMPORT: completed = ContactJob_RunImport(job); break;
+        case CONTACT_JOB_EXPORT: completed = ContactJob_RunExport(job); break;
+        case CONTACT_JOB_SORT:   completed = ContactJob_RunSort(job);   break;
+        case CONTACT_JOB_DEDUP:  completed = ContactJob_RunDedup(job);  break;
+        case CONTACT_JOB_MERGE:  completed = ContactJob_RunMerge(job);  break;
+    }
+    job->ms = Platform_NowMs() - t0;
+    return completed;
+}
+
+// ------------------------------------------
+// A job of 'kind' with its file and passphrase copied
+// ------------------------------------------
+static ContactJob *ContactJob_Create(ContactJobKind kind, const char *path, const char *passphrase) {
+    ContactJob *job = (ContactJob*)calloc(1, sizeof(ContactJob));
+    if (!job) return NULL;
+    job->job.run = ContactJob_Run;
+    job->kind = kind;
+    job->status = CONTACT_FILE_OK;
+    Store_Init(&job->store);
+    Journal_Init(&job->journal);
+    TrigramIndex_Init(&job->index);
+    SortIndex_Init(&job->sortIndex);
+    PhoneIndex_Init(&job->phoneIndex);
+    if (!ContactJob_CopyString(&job->path, path) ||
+        !ContactJob_CopyString(&job->passphrase, passphrase && passphrase[0] ? passphrase : NULL)) {
+        ContactJob_Free(job);
+        return NULL;
+    }
+    return job;
+}
+
+// ------------------------------------------
+// A job working on a copy of 'store'
+// ------------------------------------------
+static ContactJob *ContactJob_CreateSnapshot(ContactJobKind kind, const ContactStore *store, const char *path,
+                                             const char *passphrase) {
+    ContactJob *job = ContactJob_Create(kind, path, passphrase);
+    if (job && !Store_Copy(&job->store, store)) {
+        ContactJob_Free(job);
+        return NULL;
+    }
+    return job;
+}
+
+// ------------------------------------------
+// Job constructors
+// ------------------------------------------
+ContactJob *ContactJob_Load(const char *path, const char *passphrase) {
+    return ContactJob_Create(CONTACT_JOB_LOAD, path, passphrase);
+}
+
+ContactJob *ContactJob_Save(const ContactStore *store, const char *path, int flags, const char *passphrase) {
+    ContactJob *job = ContactJob_CreateSnapshot(CONTACT_JOB_SAVE, store, path, passphrase);
+    if (job) job->flags = flags;
+    return job;
+}
+
+ContactJob *ContactJob_Import(const ContactStore *store, const char *path, ImportFormat format) {
+    ContactJob *job = ContactJob_CreateSnapshot(CONTACT_JOB_IMPORT, store, path, NULL);
+    if (job) job->importFormat = format;
+    return job;
+}
+
+ContactJob *ContactJob_Export(const ContactStore *store, const int *rows, int count, const char *path,
+                              ExportFormat format) {
+    ContactJob *job = ContactJob_CreateSnapshot(CONTACT_JOB_EXPORT, store, path, NULL);
+    if (!job) return NULL;
+    job->exportFormat = format;
+    if (rows) {
+        job->rows = (int*)malloc((size_t)(count > 0 ? count : 1) * sizeof(int));
+        if (!job->rows) {
+            ContactJob_Free(job);
+            return NULL;
+        }
+        if (count > 0) memcpy(job->rows, rows, (size_t)count * sizeof(int));
+        job->count = count;
+    }
+    return job;
+}
+
+ContactJob *ContactJob_Sort(const ContactStore *store) {
+    return ContactJob_CreateSnapshot(CONTACT_JOB_SORT, store, NULL, NULL);
+}
+
+ContactJob *ContactJob_Dedup(const ContactStore *store, double threshold) {
+    ContactJob *job = ContactJob_CreateSnapshot(CONTACT_JOB_DEDUP, store, NULL, NULL);
+    if (job) job->threshold = threshold;
+    return job;
+}
+
+ContactJob *ContactJob_Merge(const ContactStore *store, DedupResult *result, const int *groups, int count) {
+    ContactJob *job = ContactJob_CreateSnapshot(CONTACT_JOB_MERGE, store, NULL, NULL);
+    if (!job) return NULL;
+    job->rows = (int*)malloc((size_t)(count > 0 ? count : 1) * sizeof(int));
+    if (!job->rows) {
+        ContactJob_Free(job);
+        return NULL;
+    }
+    if (count > 0) memcpy(job->rows, groups, (size_t)count * sizeof(int));
+    job->count = count;
+    job->dedup = *result;
+    memset(result, 0, sizeof(*result));
+    return job;
+}
+
+// ------------------------------------------
+// Release the job and the results left in it
+// ------------------------------------------
+void ContactJob_Free(ContactJob *job) {
+    if (!job) return;
+    Journal_Close(&job->journal);
+    TrigramIndex_Free(&job->index);
+    SortIndex_Free(&job->sortIndex);
+    PhoneIndex_Free(&job->phoneIndex);
+    Import_FreeResult(&job->import);
+    Dedup_FreeResult(&job->dedup);
+    free(job->dropped);
+    Store_Free(&job->store);
+    if (job->passphrase) {
+        Crypto_Wipe(job->passphrase, strlen(job->passphrase));
+        free(job->passphrase);
+    }
+    free(job->path);
+    free(job->rows);
+    free(job);
+}
+
+// ------------------------------------------
+// Only the snapshot writers tolerate edits while they run
+// ------------------------------------------
+int ContactJob_Exclusive(const ContactJob *job) {
+    return job->kind != CONTACT_JOB_EXPORT && job->kind != CONTACT_JOB_SAVE;
+}
+
+// ------------------------------------------
+// Progress message title
+// ------------------------------------------
+const char *ContactJob_Title(const ContactJob *job) {
+    switch (job->kind) {
+        case CONTACT_JOB_LOAD:   return "Loading";
+        case CONTACT_JOB_SAVE:   return "Saving";
+        case CONTACT_JOB_IMPORT: return "Importing";
+        case CONTACT_JOB_EXPORT: return "Exporting";
+        case CONTACT_JOB_SORT:   return "Sorting";
+        case CONTACT_JOB_DEDUP:  return "Finding duplicates";
+        case CONTACT_JOB_MERGE:  return "Merging duplicates";
+    }
+    return "Working";
+}
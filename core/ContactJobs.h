@@ -0,0 +1,102 @@
+#ifndef CONTACT_JOBS_H
+#define CONTACT_JOBS_H
+
+#include "ContactFile.h"
+#include "ContactStore.h"
+#include "Dedup.h"
+#include "Export.h"
+#include "Import.h"
+#include "JobQueue.h"
+#include "Journal.h"
+#include "PhoneIndex.h"
+#include "SortIndex.h"
+#include "TrigramIndex.h"
+
+// The long contact operations as JobQueue jobs.
+// A job never touches the caller's store: it works on a snapshot taken
+// when the job is made (save, export, import, sort, dedup, merge; see
+// Store_Copy, which shares the contact data instead of copying it) or on
+// a store of its own (load). What it produces - a loaded, imported or
+// merged store with its indexes already built, a sort index, duplicate
+// groups, an open journal - is left in the job for the caller to adopt
+// once the job is reported JOB_FINISHED: move the field out and
+// re-initialize it (for example "g_store = job->store;
+// Store_Init(&job->store);"), then ContactJob_Free.
+//
+// Results stated in store positions (indexes, the imported rows) are
+// positions of the snapshot, so they only apply to the caller's store if
+// it was not changed meanwhile. ContactJob_Exclusive tells which jobs need
+// that; a save or an export can run alongside edits (the journal a save
+// starts then only fits if the store did not change).
+//
+// Each job reports its steps as progress (file, journal, each index...)
+// and checks for cancellation between them.
+
+typedef enum {
+    CONTACT_JOB_LOAD = 1,   // File -> store, journal replayed, indexes built
+    CONTACT_JOB_SAVE,       // Snapshot -> v2 file, then a new empty journal
+    CONTACT_JOB_IMPORT,     // Snapshot + CSV/vCard -> store, indexes built
+    CONTACT_JOB_EXPORT,     // Snapshot rows -> CSV, vCard or JSON Lines
+    CONTACT_JOB_SORT,       // Snapshot -> sort index
+    CONTACT_JOB_DEDUP,      // Snapshot -> groups of likely duplicates
+    CONTACT_JOB_MERGE       // Snapshot + chosen groups -> merged store, indexes built
+} ContactJobKind;
+
+typedef struct {
+    Job            job;         // First: the Job* that JobQueue_Poll reports is the ContactJob*
+    ContactJobKind kind;
+    char          *path;
+    char          *passphrase;  // Copy, wiped when freed; NULL for none
+    int            flags;       // CONTACT_V2_* of a save
+    ImportFormat   importFormat;
+    ExportFormat   exportFormat;
+    ContactStore   store;       // The snapshot, or the store loaded or imported into
+    int           *rows;        // Export: snapshot positions in order (NULL: all);
+                                // merge: the group numbers to merge
+    int            count;
+    double         threshold;   // Dedup: pair score that makes duplicates
+    int            first;       // Import: position of the first imported contact
+
+    // Results, valid once JOB_FINISHED
+    ContactFileStatus status;
+    ImportResult   import;      // Import
+    int            exported;    // Export
+    DedupResult    dedup;       // Dedup; the groups a merge works from
+    int            merged;      // Merge: contacts merged away
+    DedupDropped  *dropped;     // Merge: values left behind (droppedCount of them)
+    int            droppedCount;
+    Journal        journal;     // Load and encrypted save: the file's open journal
+    TrigramIndex   index;       // Load and import
+    SortIndex      sortIndex;   // Load, import and sort
+    PhoneIndex     phoneIndex;  // Load and import
+    int            indexed;     // The indexes above were all built
+    double         ms;          // Time spent on the worker
+} ContactJob;
+
+// Make a job (not yet submitted). The store snapshot is taken and the
+// rows and strings copied here, on the calling thread. Return NULL when
+// out of memory.
+ContactJob *ContactJob_Load(const char *path, const char *passphrase);
+ContactJob *ContactJob_Save(const ContactStore *store, const char *path, int flags, const char *passphrase);
+ContactJob *ContactJob_Import(const ContactStore *store, const char *path, ImportFormat format);
+ContactJob *ContactJob_Export(const ContactStore *store, const int *rows, int count, const char *path,
+                              ExportFormat format);
+ContactJob *ContactJob_Sort(const ContactStore *store);
+ContactJob *ContactJob_Dedup(const ContactStore *store, double threshold);
+// Merge the chosen groups of a finished dedup job into a snapshot. Takes
+// over 'result' (left empty), whose positions must still be those of
+// 'store'. Indexes are rebuilt on the worker; the survivors and the
+// contacts merged away are the ones of the chosen groups, to journal.
+ContactJob *ContactJob_Merge(const ContactStore *store, DedupResult *result, const int *groups, int count);
+
+// Release the job and whatever results were not adopted (a journal still
+// in the job is closed). Never while it is queued or running.
+void ContactJob_Free(ContactJob *job);
+
+// Does the result only fit a store left unchanged while the job ran?
+int  ContactJob_Exclusive(const ContactJob *job);
+
+// "Loading", "Saving", ... for progress messages
+const char *ContactJob_Title(const ContactJob *job);
+
+#endif // CONTACT_JOBS_H
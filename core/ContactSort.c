@@ -0,0 +1,487 @@
+#include "ContactSort.h"
+#include "DateKey.h"
+#include "PhoneKey.h"
+#include "Platform.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ranges this short are finished by insertion sort
+#define SORT_INSERTION_MAX 32
+// Inputs from this size on are sorted by several workers
+#define SORT_PARALLEL_MIN 65536
+// Ranges handed out to the workers, at most
+#define SORT_MAX_TASKS 4096
+#define SORT_MAX_WORKERS 64
+
+// Key bytes carried inline by every item
+#define SORT_CACHE_BYTES 16
+
+// One contact being sorted; 'id' is its position in the input
+typedef struct {
+    uint64_t cache[2];  // Key bytes [depth & ~15, +16), big-endian, zero past the end
+    uint32_t id;
+    uint32_t length;    // Of the key
+} SortItem;
+
+// A range of items whose keys agree on their first 'depth' bytes
+typedef struct {
+    int      lo;
+    int      hi;
+    uint32_t depth;
+    int      worker;
+} SortTask;
+
+// Keys written by one worker before they are joined
+typedef struct {
+    unsigned char *data;
+    size_t used;
+    size_t capacity;
+} SortKeyBuffer;
+
+typedef struct {
+    const ContactStore *store;
+    const SortSpec *spec;
+    const int *rows;
+    int count;
+    SortItem *items;
+    SortItem *aux;        // Scatter buffer, as long as items
+    unsigned char *keys;  // Every collation key, in input order
+    uint32_t *offsets;    // Of each key in 'keys', by id
+    SortKeyBuffer *buffers;
+    SortTask *tasks;
+    int taskCount;
+    int phase;            // 0: keys, 1: sort tasks
+    int failed;
+} SortJob;
+
+// ------------------------------------------
+// ASCII case folding, as used by the search (branch free)
+// ------------------------------------------
+static unsigned char ContactSort_Fold(unsigned char c) {
+    return (unsigned char)(c + (((unsigned)(c - 'A') < 26u) << 5));
+}
+
+// ------------------------------------------
+// Value of 'column' for the contact at 'row'
+// ------------------------------------------
+static const char *ContactSort_Field(const ContactStore *store, int row, SortColumn column) {
+    switch (column) {
+        case SORT_BY_PHONE: return Store_GetPhone(store, row);
+        case SORT_BY_EMAIL: return Store_GetEmail(store, row);
+        case SORT_BY_DATE:  return Store_GetDate(store, row);
+        default:            return Store_GetName(store, row);
+    }
+}
+
+// ------------------------------------------
+// Parse "date-,name"-style column lists
+// ------------------------------------------
+int ContactSort_ParseSpec(SortSpec *spec, const char *text) {
+    static const char *const names[SORT_COLUMN_COUNT] = { "name", "phone", "email", "date" };
+    spec->count = 0;
+    while (*text) {
+        size_t len = strcspn(text, ",");
+        size_t nameLen = len;
+        int descending = 0;
+        if (nameLen > 0 && (text[nameLen - 1] == '-' || text[nameLen - 1] == '+')) {
+            descending = (text[nameLen - 1] == '-');
+            nameLen--;
+        }
+
+        int column = -1;
+        for (int c = 0; c < SORT_COLUMN_COUNT; c++) {
+            if (strlen(names[c]) == nameLen && strncmp(text, names[c], nameLen) == 0) column = c;
+        }
+        if (column < 0 || spec->count == CONTACT_SORT_MAX_KEYS) return 0;
+        spec->keys[spec->count].column = (SortColumn)column;
+        spec->keys[spec->count].descending = descending;
+        spec->count++;
+
+        text += len;
+        if (*text == ',') text++;
+    }
+    return spec->count > 0;
+}
+
+// ------------------------------------------
+// Cache the next key bytes of an item ('left' of them remain at 'p'),
+// big-endian, zero padded
+// ------------------------------------------
+static void ContactSort_Cache(SortItem *item, const unsigned char *p, uint32_t left) {
+    unsigned char bytes[SORT_CACHE_BYTES] = { 0 };
+    memcpy(bytes, p, left < SORT_CACHE_BYTES ? left : SORT_CACHE_BYTES);
+    for (int w = 0; w < 2; w++) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) {
+            value = (value << 8) | bytes[8 * w + i];
+        }
+        item->cache[w] = value;
+    }
+}
+
+// ------------------------------------------
+// Key byte of an item at 'depth' (within its cached block)
+// ------------------------------------------
+static unsigned ContactSort_Byte(const SortItem *item, uint32_t depth) {
+    uint32_t at = depth % SORT_CACHE_BYTES;
+    return (unsigned)(item->cache[at / 8] >> (56 - 8 * (at % 8))) & 0xFF;
+}
+
+// ------------------------------------------
+// Compare two keys that agree on their first 'depth' bytes and whose
+// caches hold the block of 'depth'
+// No key is a proper prefix of another (every column ends with a
+// terminator that its own bytes never take), so equal bytes up to the
+// shorter length mean equal keys.
+// ------------------------------------------
+static int ContactSort_Compare(const SortJob *job, const SortItem *a, const SortItem *b, uint32_t depth) {
+    if (a->cache[0] != b->cache[0]) return a->cache[0] < b->cache[0] ? -1 : 1;
+    if (a->cache[1] != b->cache[1]) return a->cache[1] < b->cache[1] ? -1 : 1;
+    uint32_t len = a->length < b->length ? a->length : b->length;
+    uint32_t next = depth - depth % SORT_CACHE_BYTES + SORT_CACHE_BYTES;
+    if (next >= len) return 0;
+    return memcmp(job->keys + job->offsets[a->id] + next, job->keys + job->offsets[b->id] + next, len - next);
+}
+
+// ------------------------------------------
+// Load the cache block of 'depth' when a range first reaches it
+// ------------------------------------------
+static void ContactSort_Refill(SortJob *job, int lo, int hi, uint32_t depth) {
+    if (depth % SORT_CACHE_BYTES == 0 && depth > 0) {
+        for (int i = lo; i < hi; i++) {
+            SortItem *item = &job->items[i];
+            ContactSort_Cache(item, job->keys + job->offsets[item->id] + depth, item->length - depth);
+        }
+    }
+}
+
+// ------------------------------------------
+// Stable insertion sort of a short range
+// ------------------------------------------
+static void ContactSort_Insertion(SortJob *job, int lo, int hi, uint32_t depth) {
+    SortItem *items = job->items;
+    for (int i = lo + 1; i < hi; i++) {
+        SortItem item = items[i];
+        int j = i;
+        while (j > lo && ContactSort_Compare(job, &items[j - 1], &item, depth) > 0) {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = item;
+    }
+}
+
+// ------------------------------------------
+// One stable counting pass over key byte 'depth' (already cached)
+// Writes the 256 bucket boundaries to 'bounds' and returns the number of
+// non-empty buckets. A range that falls in one bucket is left in place.
+// ------------------------------------------
+static int ContactSort_Split(SortJob *job, int lo, int hi, uint32_t depth, int bounds[257]) {
+    SortItem *items = job->items;
+    int counts[256];
+    memset(counts, 0, sizeof(counts));
+    for (int i = lo; i < hi; i++) {
+        counts[ContactSort_Byte(&items[i], depth)]++;
+    }
+
+    int used = 0;
+    bounds[0] = lo;
+    for (int b = 0; b < 256; b++) {
+        if (counts[b] > 0) used++;
+        bounds[b + 1] = bounds[b] + counts[b];
+    }
+    if (used == 1) return 1;
+
+    int next[256];
+    memcpy(next, bounds, sizeof(next));
+    for (int i = lo; i < hi; i++) {
+        job->aux[next[ContactSort_Byte(&items[i], depth)]++] = items[i];
+    }
+    memcpy(&items[lo], &job->aux[lo], (size_t)(hi - lo) * sizeof(SortItem));
+    return used;
+}
+
+// ------------------------------------------
+// Leading bytes of the cached block that agree across items [lo, hi)
+// (SORT_CACHE_BYTES when the caches are all equal)
+// ------------------------------------------
+static uint32_t ContactSort_SharedBytes(const SortItem *items, int lo, int hi) {
+    uint64_t diff[2] = { 0, 0 };
+    for (int i = lo + 1; i < hi; i++) {
+        diff[0] |= items[i].cache[0] ^ items[lo].cache[0];
+        diff[1] |= items[i].cache[1] ^ items[lo].cache[1];
+    }
+    uint32_t shared = 0;
+    while (shared < SORT_CACHE_BYTES && (diff[shared / 8] >> (56 - 8 * (shared % 8))) == 0) {
+        shared++;
+    }
+    return shared;
+}
+
+// ------------------------------------------
+// MSD radix sort of items [lo, hi) from key byte 'depth' on
+// ------------------------------------------
+static void ContactSort_Range(SortJob *job, int lo, int hi, uint32_t depth) {
+    while (hi - lo > 1) {
+        // Keys that agree up to their end are equal; keep input order
+        if (depth >= job->items[lo].length) return;
+        ContactSort_Refill(job, lo, hi, depth);
+        if (hi - lo <= SORT_INSERTION_MAX) {
+            ContactSort_Insertion(job, lo, hi, depth);
+            return;
+        }
+
+        // Skip the bytes of the cached block that every key shares
+        uint32_t shared = ContactSort_SharedBytes(job->items, lo, hi);
+        if (shared > depth % SORT_CACHE_BYTES) {
+            depth += shared - depth % SORT_CACHE_BYTES;
+            continue;
+        }
+
+        int bounds[257];
+        ContactSort_Split(job, lo, hi, depth, bounds);
+        for (int b = 0; b < 256; b++) {
+            if (bounds[b + 1] - bounds[b] > 1) {
+                ContactSort_Range(job, bounds[b], bounds[b + 1], depth + 1);
+            }
+        }
+        return;
+    }
+}
+
+// ------------------------------------------
+// Append the collation key of one contact to a worker's buffer
+// Ascending columns keep their folded bytes (never 0) and end with 0;
+// descending ones store 255 - byte (never 255) and end with 255.
+// Phones with a key collate by a class byte (1: no key, 2: national,
+// 3: international) and then their digits, or their text without a key.
+// Dates collate by a class byte (1: no DateKey, 2: a real date) and their
+// text, which for a real date is YYYY-MM-DD and so in day order.
+// Returns the key length, or 0 when out of memory.
+// ------------------------------------------
+static uint32_t ContactSort_WriteKey(const SortJob *job, int row, SortKeyBuffer *buffer) {
+    size_t start = buffer->used;
+    for (int k = 0; k < job->spec->count; k++) {
+        SortColumn column = job->spec->keys[k].column;
+        const char *text = ContactSort_Field(job->store, row, column);
+        char digits[PHONE_KEY_MAX_DIGITS];
+        unsigned char lead = 0;
+        size_t len;
+        if (column == SORT_BY_PHONE) {
+            uint64_t key = Store_GetPhoneKey(job->store, row);
+            if (key != PHONE_KEY_NONE) {
+                lead = (key & PHONE_KEY_INTERNATIONAL) ? 3 : 2;
+                len = (size_t)PhoneKey_Digits(key, digits);
+                text = digits;
+            } else {
+                lead = 1;
+                len = strlen(text);
+            }
+        } else if (column == SORT_BY_DATE) {
+            lead = Store_GetDay(job->store, row) != DATE_KEY_NONE ? 2 : 1;
+            len = strlen(text);
+        } else {
+            len = strlen(text);
+        }
+
+        size_t needed = len + 2;
+        if (buffer->used + needed > buffer->capacity) {
+            size_t capacity = buffer->capacity ? buffer->capacity * 2 : 65536;
+            while (capacity < buffer->used + needed) capacity *= 2;
+            unsigned char *data = (unsigned char*)realloc(buffer->data, capacity);
+            if (!data) return 0;
+            buffer->data = data;
+            buffer->capacity = capacity;
+        }
+
+        unsigned char flip = job->spec->keys[k].descending ? 0xFF : 0x00;
+        unsigned char *out = buffer->data + buffer->used;
+        if (lead != 0) *out++ = (unsigned char)(lead ^ flip);
+        for (size_t i = 0; i < len; i++) {
+            out[i] = (unsigned char)(ContactSort_Fold((unsigned char)text[i]) ^ flip);
+        }
+        out[len] = flip;
+        buffer->used += len + 1 + (lead != 0);
+    }
+    return (uint32_t)(buffer->used - start);
+}
+
+// ------------------------------------------
+// Worker: one phase of the sort over its share of the job
+// ------------------------------------------
+static void ContactSort_Worker(void *context, int worker, int workerCount) {
+    SortJob *job = (SortJob*)context;
+
+    if (job->phase == 0) {
+        // Keys of a contiguous share of the input, offsets local to the
+        // worker's buffer until they are joined
+        int begin = (int)((long long)job->count * worker / workerCount);
+        int end = (int)((long long)job->count * (worker + 1) / workerCount);
+        SortKeyBuffer *buffer = &job->buffers[worker];
+        for (int i = begin; i < end; i++) {
+            SortItem *item = &job->items[i];
+            job->offsets[i] = (uint32_t)buffer->used;
+            item->id = (uint32_t)i;
+            item->length = ContactSort_WriteKey(job, job->rows[i], buffer);
+            if (item->length == 0 || buffer->used > UINT32_MAX) {
+                job->failed = 1;
+                return;
+            }
+            ContactSort_Cache(item, buffer->data + job->offsets[i], item->length);
+        }
+    } else {
+        for (int t = 0; t < job->taskCount; t++) {
+            const SortTask *task = &job->tasks[t];
+            if (task->worker == worker) {
+                ContactSort_Range(job, task->lo, task->hi, task->depth);
+            }
+        }
+    }
+}
+
+// ------------------------------------------
+// Join the workers' key buffers into one
+// ------------------------------------------
+static int ContactSort_JoinKeys(SortJob *job, int workerCount) {
+    size_t total = 0;
+    for (int w = 0; w < workerCount; w++) {
+        total += job->buffers[w].used;
+    }
+    if (total > UINT32_MAX) return 0;
+
+    if (workerCount == 1) {
+        job->keys = job->buffers[0].data;
+        job->buffers[0].data = NULL;
+    } else {
+        job->keys = (unsigned char*)malloc(total > 0 ? total : 1);
+        if (!job->keys) return 0;
+        size_t base = 0;
+        for (int w = 0; w < workerCount; w++) {
+            int begin = (int)((long long)job->count * w / workerCount);
+            int end = (int)((long long)job->count * (w + 1) / workerCount);
+            memcpy(job->keys + base, job->buffers[w].data, job->buffers[w].used);
+            for (int i = begin; i < end; i++) {
+                job->offsets[i] += (uint32_t)base;
+            }
+            base += job->buffers[w].used;
+        }
+    }
+
+    return 1;
+}
+
+// ------------------------------------------
+// qsort comparator: larger tasks first
+// ------------------------------------------
+static int ContactSort_CompareTasks(const void *a, const void *b) {
+    int sizeA = ((const SortTask*)a)->hi - ((const SortTask*)a)->lo;
+    int sizeB = ((const SortTask*)b)->hi - ((const SortTask*)b)->lo;
+    return (sizeA < sizeB) - (sizeA > sizeB);
+}
+
+// ------------------------------------------
+// Split the input into ranges no larger than about 1/(2 * workers) of it,
+// then hand them out largest first to the least loaded worker
+// ------------------------------------------
+static int ContactSort_PlanTasks(SortJob *job, int workerCount) {
+    job->tasks = (SortTask*)malloc(SORT_MAX_TASKS * sizeof(SortTask));
+    if (!job->tasks) return 0;
+    job->taskCount = 1;
+    job->tasks[0].lo = 0;
+    job->tasks[0].hi = job->count;
+    job->tasks[0].depth = 0;
+
+    int target = job->count / (2 * workerCount);
+    while (job->taskCount + 256 <= SORT_MAX_TASKS) {
+        int largest = 0;
+        for (int t = 1; t < job->taskCount; t++) {
+            if (job->tasks[t].hi - job->tasks[t].lo > job->tasks[largest].hi - job->tasks[largest].lo) largest = t;
+        }
+        SortTask task = job->tasks[largest];
+        if (task.hi - task.lo <= target) break;
+
+        job->tasks[largest] = job->tasks[--job->taskCount];
+        if (task.depth >= job->items[task.lo].length) continue;
+        int bounds[257];
+        ContactSort_Refill(job, task.lo, task.hi, task.depth);
+        ContactSort_Split(job, task.lo, task.hi, task.depth, bounds);
+        for (int b = 0; b < 256; b++) {
+            if (bounds[b + 1] - bounds[b] > 1) {
+                SortTask *child = &job->tasks[job->taskCount++];
+                child->lo = bounds[b];
+                child->hi = bounds[b + 1];
+                child->depth = task.depth + 1;
+            }
+        }
+    }
+
+    qsort(job->tasks, (size_t)job->taskCount, sizeof(SortTask), ContactSort_CompareTasks);
+    long long load[SORT_MAX_WORKERS] = { 0 };
+    for (int t = 0; t < job->taskCount; t++) {
+        int lightest = 0;
+        for (int w = 1; w < workerCount; w++) {
+            if (load[w] < load[lightest]) lightest = w;
+        }
+        job->tasks[t].worker = lightest;
+        load[lightest] += job->tasks[t].hi - job->tasks[t].lo;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Sort store positions by a column list
+// ------------------------------------------
+int ContactSort_Rows(const ContactStore *store, const SortSpec *spec, int *rows, int count) {
+    if (count < 2 || spec->count == 0) return 1;
+
+    int workerCount = count >= SORT_PARALLEL_MIN ? Platform_CpuCount() : 1;
+    if (workerCount > SORT_MAX_WORKERS) workerCount = SORT_MAX_WORKERS;
+
+    SortJob job;
+    memset(&job, 0, sizeof(job));
+    job.store = store;
+    job.spec = spec;
+    job.count = count;
+    int *input = (int*)malloc((size_t)count * sizeof(int));
+    job.rows = input;
+    job.items = (SortItem*)malloc((size_t)count * sizeof(SortItem));
+    job.aux = (SortItem*)malloc((size_t)count * sizeof(SortItem));
+    job.offsets = (uint32_t*)malloc((size_t)count * sizeof(uint32_t));
+    job.buffers = (SortKeyBuffer*)calloc((size_t)workerCount, sizeof(SortKeyBuffer));
+    int ok = input && job.items && job.aux && job.offsets && job.buffers;
+
+    if (ok) {
+        memcpy(input, rows, (size_t)count * sizeof(int));
+        job.phase = 0;
+        Platform_RunParallel(workerCount, ContactSort_Worker, &job);
+        ok = !job.failed && ContactSort_JoinKeys(&job, workerCount);
+    }
+    if (ok) {
+        if (workerCount > 1) {
+            ok = ContactSort_PlanTasks(&job, workerCount);
+            job.phase = 1;
+            if (ok) Platform_RunParallel(workerCount, ContactSort_Worker, &job);
+        } else {
+            ContactSort_Range(&job, 0, count, 0);
+        }
+    }
+
+    if (ok) {
+        for (int i = 0; i < count; i++) {
+            rows[i] = input[job.items[i].id];
+        }
+    }
+    for (int w = 0; job.buffers && w < workerCount; w++) {
+        free(job.buffers[w].data);
+    }
+    free(job.buffers);
+    free(job.tasks);
+    free(job.keys);
+    free(job.offsets);
+    free(job.aux);
+    free(job.items);
+    free(input);
+    return ok;
+}
@@ -0,0 +1,41 @@
+#ifndef CONTACT_SORT_H
+#define CONTACT_SORT_H
+
+#include "ContactStore.h"
+#include "SortIndex.h"
+
+// Sort engine for bulk reorders (sort index builds, sorted exports).
+// Every contact gets one collation key up front: the case-folded bytes of
+// each sort column followed by a terminator, inverted for descending
+// columns, so that plain byte order is the requested order. The keys are
+// then sorted by an MSD radix sort that carries the next 16 key bytes
+// inline, so most passes never touch the strings. Large inputs are split
+// into independent ranges sorted by several workers.
+//
+// Phones collate by their PhoneKey digits and dates by their DateKey, in
+// the same order as SortIndex.
+// Sorts are stable: contacts comparing equal keep their input order.
+
+#define CONTACT_SORT_MAX_KEYS 8
+
+typedef struct {
+    SortColumn column;
+    int        descending;
+} SortKeySpec;
+
+// Columns to sort by, most significant first
+typedef struct {
+    SortKeySpec keys[CONTACT_SORT_MAX_KEYS];
+    int         count;
+} SortSpec;
+
+// Parse a comma separated column list such as "date-,name": a trailing
+// '-' sorts that column descending, '+' (or nothing) ascending.
+// Columns are name, phone, email and date. Returns 1 on success.
+int ContactSort_ParseSpec(SortSpec *spec, const char *text);
+
+// Reorder 'rows' (store positions) by 'spec'. Returns 0 when out of
+// memory, leaving 'rows' untouched.
+int ContactSort_Rows(const ContactStore *store, const SortSpec *spec, int *rows, int count);
+
+#endif // CONTACT_SORT_H
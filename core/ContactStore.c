@@ -0,0 +1,1000 @@
+#include "ContactStore.h"
+#include "DateKey.h"
+#include "PhoneKey.h"
+#include "Platform.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_PAGE_MASK  (ARENA_PAGE_SIZE - 1)
+#define STORE_CHUNK_MASK (STORE_CHUNK_SIZE - 1)
+
+// Memory behind one or more arena pages, freed with its last reference
+struct ArenaBlock {
+    volatile long refs;     // Page table entries pointing into it, in every store
+    char *data;
+};
+
+// STORE_CHUNK_SIZE records, a column per value, freed with its last reference
+struct RecordChunk {
+    volatile long refs;     // Stores holding it
+    uint64_t ids[STORE_CHUNK_SIZE];
+    uint32_t fields[CONTACT_FIELD_COUNT][STORE_CHUNK_SIZE];  // Offsets in store->fields
+    uint64_t phoneKeys[STORE_CHUNK_SIZE];   // PhoneKey of each phone
+    uint32_t days[STORE_CHUNK_SIZE];        // DateKey of each date
+    uint32_t domains[STORE_CHUNK_SIZE];     // Email domain ids
+};
+
+// The values of one contact, on their way into the columns
+typedef struct {
+    uint32_t fields[CONTACT_FIELD_COUNT];
+    uint64_t phoneKey;
+    uint32_t day;
+    uint32_t domain;
+} StoreRow;
+
+static const size_t s_fieldSizes[CONTACT_FIELD_COUNT] = {
+    CONTACT_NAME_SIZE, CONTACT_PHONE_SIZE, CONTACT_EMAIL_SIZE, CONTACT_DATE_SIZE
+};
+
+// ------------------------------------------
+// Initialize an empty string arena
+// Offset 0 is reserved for the shared empty string.
+// ------------------------------------------
+void Arena_Init(StringArena *arena) {
+    memset(arena, 0, sizeof(*arena));
+}
+
+// ------------------------------------------
+// Give up one page's reference to its block
+// ------------------------------------------
+static void Arena_DropBlock(ArenaBlock *block) {
+    if (Platform_AtomicDecrement(&block->refs) == 0) {
+        free(block->data);
+        free(block);
+    }
+}
+
+// ------------------------------------------
+// Release all memory held by the arena (or its share of it)
+// ------------------------------------------
+void Arena_Free(StringArena *arena) {
+    int interned = arena->interned;
+    for (uint32_t p = 0; p < arena->pageCount; p++) {
+        Arena_DropBlock(arena->blocks[p]);
+    }
+    free(arena->pages);
+    free(arena->blocks);
+    free(arena->set);
+    Arena_Init(arena);
+    arena->interned = interned;
+}
+
+// ------------------------------------------
+// Room in the page tables for 'pages' more pages
+// ------------------------------------------
+static int Arena_ReservePages(StringArena *arena, size_t pages) {
+    size_t needed = (size_t)arena->pageCount + pages;
+    if (needed > ((size_t)UINT32_MAX >> ARENA_PAGE_SHIFT) + 1) return 0;
+    if (needed <= arena->pageCapacity) return 1;
+
+    size_t newCapacity = arena->pageCapacity ? (size_t)arena->pageCapacity * 2 : 16;
+    while (newCapacity < needed) newCapacity *= 2;
+    char **starts = (char**)realloc(arena->pages, newCapacity * sizeof(char*));
+    if (!starts) return 0;
+    arena->pages = starts;
+    ArenaBlock **blocks = (ArenaBlock**)realloc(arena->blocks, newCapacity * sizeof(ArenaBlock*));
+    if (!blocks) return 0;
+    arena->blocks = blocks;
+    arena->pageCapacity = (uint32_t)newCapacity;
+    return 1;
+}
+
+// ------------------------------------------
+// Make room for 'bytes' more bytes of strings
+// Only the page tables grow here; pages are allocated as they fill.
+// Returns 0 on failure.
+// ------------------------------------------
+int Arena_Reserve(StringArena *arena, size_t bytes) {
+    return Arena_ReservePages(arena, bytes / (ARENA_PAGE_SIZE - CONTACT_NAME_SIZE) + 1);
+}
+
+// ------------------------------------------
+// Start a new page for the next strings
+// Pages start zeroed, so the tail that a string did not fit in reads as
+// empty strings. Page 0 starts with the shared empty string.
+// ------------------------------------------
+static int Arena_AddPage(StringArena *arena) {
+    if (!Arena_ReservePages(arena, 1)) return 0;
+    ArenaBlock *block = (ArenaBlock*)malloc(sizeof(ArenaBlock));
+    char *data = (char*)calloc(1, ARENA_PAGE_SIZE);
+    if (!block || !data) {
+        free(block);
+        free(data);
+        return 0;
+    }
+    block->refs = 1;
+    block->data = data;
+    uint32_t start = arena->pageCount << ARENA_PAGE_SHIFT;
+    arena->pages[arena->pageCount] = data;
+    arena->blocks[arena->pageCount] = block;
+    arena->pageCount++;
+    arena->used = start;
+    arena->limit = start + ARENA_PAGE_MASK + 1;  // Wraps to 0 after the last page
+    if (start == 0) {
+        arena->used = 1;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Make the page being filled this arena's own before writing to it
+// The part already written is copied; the copies keep the original.
+// ------------------------------------------
+static int Arena_UnshareTail(StringArena *arena) {
+    uint32_t last = arena->pageCount - 1;
+    ArenaBlock *shared = arena->blocks[last];
+    if (Platform_AtomicLoad(&shared->refs) == 1) return 1;
+
+    ArenaBlock *block = (ArenaBlock*)malloc(sizeof(ArenaBlock));
+    char *data = (char*)calloc(1, ARENA_PAGE_SIZE);
+    if (!block || !data) {
+        free(block);
+        free(data);
+        return 0;
+    }
+    memcpy(data, arena->pages[last], arena->used & ARENA_PAGE_MASK ? arena->used & ARENA_PAGE_MASK : ARENA_PAGE_SIZE);
+    block->refs = 1;
+    block->data = data;
+    arena->pages[last] = data;
+    arena->blocks[last] = block;
+    Arena_DropBlock(shared);
+    return 1;
+}
+
+// ------------------------------------------
+// Copy a string into the arena (truncated to maxLen-1 characters)
+// Returns its offset, 0 for an empty string or ARENA_INVALID on failure.
+// Amortized O(length).
+// ------------------------------------------
+uint32_t Arena_PushString(StringArena *arena, const char *str, size_t maxLen) {
+    if (arena->pageCount == 0 && !Arena_AddPage(arena)) return ARENA_INVALID;
+    if (!str || str[0] == '\0') return 0;
+
+    size_t len = strlen(str);
+    if (len > maxLen - 1) len = maxLen - 1;
+    if (len + 1 > ARENA_PAGE_SIZE) return ARENA_INVALID;
+
+    // A string never straddles two pages
+    uint32_t room = arena->limit ? arena->limit - arena->used : 0 - arena->used;
+    if (room < len + 1) {
+        if (!Arena_AddPage(arena)) return ARENA_INVALID;
+    } else if (!Arena_UnshareTail(arena)) {
+        return ARENA_INVALID;
+    }
+
+    uint32_t offset = arena->used;
+    char *dst = arena->pages[offset >> ARENA_PAGE_SHIFT] + (offset & ARENA_PAGE_MASK);
+    memcpy(dst, str, len);
+    dst[len] = '\0';
+    arena->used = offset + (uint32_t)len + 1;
+    return offset;
+}
+
+// ------------------------------------------
+// FNV-1a hash of the first 'len' bytes of a string
+// ------------------------------------------
+static uint32_t Arena_Hash(const char *str, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// ------------------------------------------
+// Slot of the interning set holding the first 'len' bytes of 'str', or
+// the free slot where they belong (linear probing)
+// ------------------------------------------
+static uint32_t Arena_Slot(const StringArena *arena, const char *str, size_t len) {
+    uint32_t mask = arena->setCapacity - 1;
+    uint32_t slot = Arena_Hash(str, len) & mask;
+    while (arena->set[slot] != 0) {
+        const char *known = Arena_String(arena, arena->set[slot]);
+        if (strncmp(known, str, len) == 0 && known[len] == '\0') break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// ------------------------------------------
+// Double the interning set, which is kept at most half full
+// ------------------------------------------
+static int Arena_GrowSet(StringArena *arena) {
+    uint32_t capacity = arena->setCapacity ? arena->setCapacity * 2 : 64;
+    uint32_t *set = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+    if (!set) return 0;
+    uint32_t *old = arena->set;
+    uint32_t oldCapacity = arena->setCapacity;
+    arena->set = set;
+    arena->setCapacity = capacity;
+    for (uint32_t i = 0; i < oldCapacity; i++) {
+        if (old[i] == 0) continue;
+        const char *str = Arena_String(arena, old[i]);
+        set[Arena_Slot(arena, str, strlen(str))] = old[i];
+    }
+    free(old);
+    return 1;
+}
+
+// ------------------------------------------
+// The one copy of a string in an interning arena, O(length)
+// ------------------------------------------
+uint32_t Arena_Intern(StringArena *arena, const char *str, size_t maxLen) {
+    if (!str || str[0] == '\0') return Arena_PushString(arena, str, maxLen);
+    size_t len = strlen(str);
+    if (len > maxLen - 1) len = maxLen - 1;
+    if ((arena->setCount + 1) * 2 > arena->setCapacity && !Arena_GrowSet(arena)) return ARENA_INVALID;
+
+    uint32_t slot = Arena_Slot(arena, str, len);
+    if (arena->set[slot] != 0) return arena->set[slot];
+    uint32_t offset = Arena_PushString(arena, str, maxLen);
+    if (offset == ARENA_INVALID) return ARENA_INVALID;
+    arena->set[slot] = offset;
+    arena->setCount++;
+    return offset;
+}
+
+// ------------------------------------------
+// Offset of an interned string, 0 if it is not there
+// ------------------------------------------
+uint32_t Arena_Find(const StringArena *arena, const char *str) {
+    if (arena->setCapacity == 0 || !str || str[0] == '\0') return 0;
+    return arena->set[Arena_Slot(arena, str, strlen(str))];
+}
+
+// ------------------------------------------
+// Mark the string at 'offset' as no longer referenced
+// Interned strings stay: other contacts may share them.
+// ------------------------------------------
+void Arena_Release(StringArena *arena, uint32_t offset) {
+    if (offset != 0 && !arena->interned) {
+        arena->garbage += (uint32_t)strlen(Arena_String(arena, offset)) + 1;
+    }
+}
+
+// ------------------------------------------
+// The string at 'offset', O(1)
+// ------------------------------------------
+const char *Arena_String(const StringArena *arena, uint32_t offset) {
+    return arena->pages[offset >> ARENA_PAGE_SHIFT] + (offset & ARENA_PAGE_MASK);
+}
+
+// ------------------------------------------
+// A whole page: full size, except the last which ends at the next string
+// ------------------------------------------
+const char *Arena_Page(const StringArena *arena, uint32_t page, uint32_t *size) {
+    *size = page + 1 < arena->pageCount ? ARENA_PAGE_SIZE : arena->used - (page << ARENA_PAGE_SHIFT);
+    return arena->pages[page];
+}
+
+// ------------------------------------------
+// Pages, page tables and interning set, shared pages included
+// ------------------------------------------
+size_t Arena_MemoryBytes(const StringArena *arena) {
+    return (size_t)arena->pageCount * ARENA_PAGE_SIZE +
+           (size_t)arena->pageCapacity * (sizeof(char*) + sizeof(ArenaBlock*)) +
+           (size_t)arena->setCapacity * sizeof(uint32_t);
+}
+
+// ------------------------------------------
+// Share every page of 'src' (one more reference each); the interning set
+// is copied
+// ------------------------------------------
+static int Arena_Copy(StringArena *dst, const StringArena *src) {
+    Arena_Init(dst);
+    dst->interned = src->interned;
+    if (src->pageCount == 0) return 1;
+    if (!Arena_ReservePages(dst, src->pageCount)) {
+        Arena_Free(dst);
+        return 0;
+    }
+    if (src->setCapacity) {
+        dst->set = (uint32_t*)malloc((size_t)src->setCapacity * sizeof(uint32_t));
+        if (!dst->set) {
+            Arena_Free(dst);
+            return 0;
+        }
+        memcpy(dst->set, src->set, (size_t)src->setCapacity * sizeof(uint32_t));
+        dst->setCapacity = src->setCapacity;
+        dst->setCount = src->setCount;
+    }
+    memcpy(dst->pages, src->pages, (size_t)src->pageCount * sizeof(char*));
+    memcpy(dst->blocks, src->blocks, (size_t)src->pageCount * sizeof(ArenaBlock*));
+    for (uint32_t p = 0; p < src->pageCount; p++) {
+        Platform_AtomicIncrement(&src->blocks[p]->refs);
+    }
+    dst->pageCount = src->pageCount;
+    dst->used = src->used;
+    dst->limit = src->limit;
+    dst->garbage = src->garbage;
+    return 1;
+}
+
+// ------------------------------------------
+// Initialize an empty contact store
+// ------------------------------------------
+void Store_Init(ContactStore *store) {
+    store->chunks = NULL;
+    store->chunkCount = 0;
+    store->chunkCapacity = 0;
+    store->count = 0;
+    store->deleted = 0;
+    store->nextId = 1;
+    for (int f = 0; f < CONTACT_FIELD_COUNT; f++) {
+        Arena_Init(&store->fields[f]);
+    }
+    store->fields[CONTACT_FIELD_DATE].interned = 1;
+    Arena_Init(&store->domains);
+    store->domains.interned = 1;
+}
+
+// ------------------------------------------
+// Give up a store's reference to a record chunk
+// ------------------------------------------
+static void Store_DropChunk(RecordChunk *chunk) {
+    if (Platform_AtomicDecrement(&chunk->refs) == 0) free(chunk);
+}
+
+// ------------------------------------------
+// Release all memory held by the store (or its share of it)
+// ------------------------------------------
+void Store_Free(ContactStore *store) {
+    for (int c = 0; c < store->chunkCount; c++) {
+        Store_DropChunk(store->chunks[c]);
+    }
+    free(store->chunks);
+    for (int f = 0; f < CONTACT_FIELD_COUNT; f++) {
+        Arena_Free(&store->fields[f]);
+    }
+    Arena_Free(&store->domains);
+    Store_Init(store);
+}
+
+// ------------------------------------------
+// Room in the chunk table for 'chunks' chunks in all
+// ------------------------------------------
+static int Store_ReserveChunks(ContactStore *store, int chunks) {
+    if (chunks <= store->chunkCapacity) return 1;
+    int newCapacity = store->chunkCapacity ? store->chunkCapacity : 16;
+    while (newCapacity < chunks) newCapacity *= 2;
+    RecordChunk **table = (RecordChunk**)realloc(store->chunks, (size_t)newCapacity * sizeof(RecordChunk*));
+    if (!table) return 0;
+    store->chunks = table;
+    store->chunkCapacity = newCapacity;
+    return 1;
+}
+
+// ------------------------------------------
+// A new chunk nobody else holds
+// ------------------------------------------
+static RecordChunk *Store_NewChunk(void) {
+    RecordChunk *chunk = (RecordChunk*)malloc(sizeof(RecordChunk));
+    if (chunk) chunk->refs = 1;
+    return chunk;
+}
+
+// ------------------------------------------
+// Copy the first 'count' records of a chunk, a column at a time
+// ------------------------------------------
+static void Store_CopyColumns(RecordChunk *dst, const RecordChunk *src, int count) {
+    memcpy(dst->ids, src->ids, (size_t)count * sizeof(uint64_t));
+    for (int f = 0; f < CONTACT_FIELD_COUNT; f++) {
+        memcpy(dst->fields[f], src->fields[f], (size_t)count * sizeof(uint32_t));
+    }
+    memcpy(dst->phoneKeys, src->phoneKeys, (size_t)count * sizeof(uint64_t));
+    memcpy(dst->days, src->days, (size_t)count * sizeof(uint32_t));
+    memcpy(dst->domains, src->domains, (size_t)count * sizeof(uint32_t));
+}
+
+// ------------------------------------------
+// Copy one record from slot 'from' of 'src' to slot 'to' of 'dst'
+// ------------------------------------------
+static void Store_CopyRecord(RecordChunk *dst, int to, const RecordChunk *src, int from) {
+    dst->ids[to] = src->ids[from];
+    for (int f = 0; f < CONTACT_FIELD_COUNT; f++) {
+        dst->fields[f][to] = src->fields[f][from];
+    }
+    dst->phoneKeys[to] = src->phoneKeys[from];
+    dst->days[to] = src->days[from];
+    dst->domains[to] = src->domains[from];
+}
+
+// ------------------------------------------
+// Make chunk 'c' this store's own before writing to it (copy-on-write)
+// Returns 0 when out of memory.
+// ------------------------------------------
+static int Store_UnshareChunk(ContactStore *store, int c) {
+    RecordChunk *shared = store->chunks[c];
+    if (Platform_AtomicLoad(&shared->refs) == 1) return 1;
+
+    RecordChunk *chunk = Store_NewChunk();
+    if (!chunk) return 0;
+    int used = store->count - (c << STORE_CHUNK_SHIFT);
+    if (used > STORE_CHUNK_SIZE) used = STORE_CHUNK_SIZE;
+    Store_CopyColumns(chunk, shared, used);
+    store->chunks[c] = chunk;
+    Store_DropChunk(shared);
+    return 1;
+}
+
+// ------------------------------------------
+// Chunk accessors: record 'index' is slot 'index & STORE_CHUNK_MASK'
+// ------------------------------------------
+static const RecordChunk *Store_Chunk(const ContactStore *store, int index) {
+    return store->chunks[index >> STORE_CHUNK_SHIFT];
+}
+
+// The chunk of 'index', unshared for writing; NULL when out of memory
+static RecordChunk *Store_WritableChunk(ContactStore *store, int index) {
+    if (!Store_UnshareChunk(store, index >> STORE_CHUNK_SHIFT)) return NULL;
+    return store->chunks[index >> STORE_CHUNK_SHIFT];
+}
+
+// ------------------------------------------
+// ASCII lower case copy of 'src' into 'dst' (CONTACT_EMAIL_SIZE bytes)
+// Returns 0 when it does not fit.
+// ------------------------------------------
+static int Store_FoldDomain(char *dst, const char *src) {
+    size_t len = 0;
+    for (; src[len]; len++) {
+        if (len == CONTACT_EMAIL_SIZE - 1) return 0;
+        char c = src[len];
+        dst[len] = (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+    }
+    dst[len] = '\0';
+    return 1;
+}
+
+// ------------------------------------------
+// Id of the domain of an email, interned on first sight
+// Returns 0 without a domain, ARENA_INVALID when out of memory.
+// ------------------------------------------
+static uint32_t Store_InternDomain(StringArena *domains, const char *email) {
+    const char *at = strrchr(email, '@');
+    char folded[CONTACT_EMAIL_SIZE];
+    if (!at || !Store_FoldDomain(folded, at + 1)) return 0;
+    return Arena_Intern(domains, folded, sizeof(folded));
+}
+
+// ------------------------------------------
+// Write a contact's values into its slot (the id is left alone)
+// ------------------------------------------
+static void Store_WriteRow(RecordChunk *chunk, int slot, const StoreRow *row) {
+    for (int f = 0; f < CONTACT_FIELD_COUNT; f++) {
+        chunk->fields[f][slot] = row->fields[f];
+    }
+    chunk->phoneKeys[slot] = row->phoneKey;
+    chunk->days[slot] = row->day;
+    chunk->domains[slot] = row->domain;
+}
+
+// ------------------------------------------
+// Release the strings of a row
+// ------------------------------------------
+static void Store_ReleaseFields(ContactStore *store, const uint32_t fields[CONTACT_FIELD_COUNT]) {
+    for (int f = 0; f < CONTACT_FIELD_COUNT; f++) {
+        if (fields[f] != ARENA_INVALID) Arena_Release(&store->fields[f], fields[f]);
+    }
+}
+
+// ------------------------------------------
+// Release the strings of the record in a slot
+// ------------------------------------------
+static void Store_ReleaseSlot(ContactStore *store, const RecordChunk *chunk, int slot) {
+    uint32_t fields[CONTACT_FIELD_COUNT];
+    for (int f = 0; f < CONTACT_FIELD_COUNT; f++) {
+        fields[f] = chunk->fields[f][slot];
+    }
+    Store_ReleaseFields(store, fields);
+}
+
+// ------------------------------------------
+// Copy the four fields of a contact into their arenas and parse the
+// values derived from them
+// On failure nothing is left referenced and 0 is returned.
+// ------------------------------------------
+static int Store_PushFields(ContactStore *store, StoreRow *row,
+                            const char *name, const char *phone, const char *email, const char *date) {
+    const char *values[CONTACT_FIELD_COUNT] = { name, phone, email, date };
+    int ok = 1;
+    for (int f = 0; f < CONTACT_FIELD_COUNT; f++) {
+        StringArena *arena = &store->fields[f];
+        row->fields[f] = arena->interned ? Arena_Intern(arena, values[f], s_fieldSizes[f])
+                                         : Arena_PushString(arena, values[f], s_fieldSizes[f]);
+        if (row->fields[f] == ARENA_INVALID) ok = 0;
+    }
+    if (ok) {
+        row->domain = Store_InternDomain(&store->domains, Arena_String(&store->fields[CONTACT_FIELD_EMAIL],
+                                                                       row->fields[CONTACT_FIELD_EMAIL]));
+        ok = row->domain != ARENA_INVALID;
+    }
+    if (!ok) {
+        Store_ReleaseFields(store, row->fields);
+        return 0;
+    }
+    row->phoneKey = PhoneKey_Parse(Arena_String(&store->fields[CONTACT_FIELD_PHONE], row->fields[CONTACT_FIELD_PHONE]));
+    row->day = DateKey_Parse(Arena_String(&store->fields[CONTACT_FIELD_DATE], row->fields[CONTACT_FIELD_DATE]));
+    return 1;
+}
+
+// Offset of one field of a loaded record in the loaded text
+static uint32_t Store_RecordField(const ContactRecord *rec, int field) {
+    switch (field) {
+        case CONTACT_FIELD_PHONE: return rec->phone;
+        case CONTACT_FIELD_EMAIL: return rec->email;
+        case CONTACT_FIELD_DATE:  return rec->date;
+        default:                  return rec->name;
+    }
+}
+
+// Shared state of Store_Attach; each field belongs to one worker
+typedef struct {
+    ContactStore        *store;
+    const ContactRecord *records;
+    const char          *text;
+    int                  failed[CONTACT_FIELD_COUNT];
+} StoreAttachJob;
+
+// ------------------------------------------
+// Worker: copy the loaded strings of its fields into their arenas and
+// parse the values derived from them, a chunk at a time
+// ------------------------------------------
+static void Store_AttachWorker(void *context, int worker, int workerCount) {
+    StoreAttachJob *job = (StoreAttachJob*)context;
+    ContactStore *store = job->store;
+    for (int f = worker; f < CONTACT_FIELD_COUNT; f += workerCount) {
+        StringArena *arena = &store->fields[f];
+        for (int c = 0; c < store->chunkCount && !job->failed[f]; c++) {
+            RecordChunk *chunk = store->chunks[c];
+            const ContactRecord *records = job->records + ((size_t)c << STORE_CHUNK_SHIFT);
+            int n = store->count - (c << STORE_CHUNK_SHIFT);
+            if (n > STORE_CHUNK_SIZE) n = STORE_CHUNK_SIZE;
+
+            uint32_t *offsets = chunk->fields[f];
+            for (int i = 0; i < n; i++) {
+                const char *str = job->text + Store_RecordField(&records[i], f);
+                offsets[i] = arena->interned ? Arena_Intern(arena, str, s_fieldSizes[f])
+                                             : Arena_PushString(arena, str, s_fieldSizes[f]);
+                if (offsets[i] == ARENA_INVALID) {
+                    job->failed[f] = 1;
+                    break;
+                }
+            }
+            if (job->failed[f]) break;
+
+            if (f == CONTACT_FIELD_PHONE) {
+                for (int i = 0; i < n; i++) chunk->phoneKeys[i] = PhoneKey_Parse(Arena_String(arena, offsets[i]));
+            } else if (f == CONTACT_FIELD_DATE) {
+                for (int i = 0; i < n; i++) chunk->days[i] = DateKey_Parse(Arena_String(arena, offsets[i]));
+            } else if (f == CONTACT_FIELD_EMAIL) {
+                for (int i = 0; i < n; i++) {
+                    chunk->domains[i] = Store_InternDomain(&store->domains, Arena_String(arena, offsets[i]));
+                    if (chunk->domains[i] == ARENA_INVALID) job->failed[f] = 1;
+                }
+            }
+        }
+    }
+}
+
+// ------------------------------------------
+// Replace the store contents with loaded records and their text
+// Both buffers must come from malloc and are freed here. Records with id
+// 0 get fresh ids in order; the others keep theirs (ascending). 'text[0]'
+// must be '\0'. Each field's strings are copied into its own arena, and
+// its phone keys, dates or domains parsed, on a worker of its own.
+// ------------------------------------------
+int Store_Attach(ContactStore *store, ContactRecord *records, int count, char *text) {
+    Store_Free(store);
+    int chunks = (int)(((size_t)count + STORE_CHUNK_MASK) >> STORE_CHUNK_SHIFT);
+    int ok = Store_ReserveChunks(store, chunks);
+    for (int c = 0; ok && c < chunks; c++) {
+        RecordChunk *chunk = Store_NewChunk();
+        if (!chunk) {
+            ok = 0;
+            break;
+        }
+        store->chunks[store->chunkCount++] = chunk;
+    }
+
+    if (ok) {
+        store->count = count;
+        for (int i = 0; i < count; i++) {
+            uint64_t id = records[i].id ? records[i].id : store->nextId;
+            store->chunks[i >> STORE_CHUNK_SHIFT]->ids[i & STORE_CHUNK_MASK] = id;
+            store->nextId = id + 1;
+        }
+
+        StoreAttachJob job;
+        memset(&job, 0, sizeof(job));
+        job.store = store;
+        job.records = records;
+        job.text = text;
+        int workerCount = Platform_CpuCount();
+        if (workerCount > CONTACT_FIELD_COUNT) workerCount = CONTACT_FIELD_COUNT;
+        Platform_RunParallel(workerCount, Store_AttachWorker, &job);
+        for (int f = 0; f < CONTACT_FIELD_COUNT; f++) {
+            if (job.failed[f]) ok = 0;
+        }
+    }
+    free(records);
+    free(text);
+    if (!ok) {
+        Store_Free(store);
+        return 0;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Compact a field's arena once more than half of it is garbage
+// ------------------------------------------
+static void Store_CompactField(ContactStore *store, int field);
+
+static void Store_MaybeCompact(ContactStore *store) {
+    for (int f = 0; f < CONTACT_FIELD_COUNT; f++) {
+        const StringArena *arena = &store->fields[f];
+        if (arena->used > 65536 && arena->garbage > arena->used / 2) {
+            Store_CompactField(store, f);
+        }
+    }
+}
+
+// ------------------------------------------
+// Share every chunk and page: O(n / STORE_CHUNK_SIZE), no record or
+// string is copied
+// ------------------------------------------
+int Store_Copy(ContactStore *dst, const ContactStore *src) {
+    Store_Init(dst);
+    int ok = Store_ReserveChunks(dst, src->chunkCount) && Arena_Copy(&dst->domains, &src->domains);
+    for (int f = 0; ok && f < CONTACT_FIELD_COUNT; f++) {
+        ok = Arena_Copy(&dst->fields[f], &src->fields[f]);
+    }
+    if (!ok) {
+        Store_Free(dst);
+        return 0;
+    }
+    if (src->chunkCount > 0) memcpy(dst->chunks, src->chunks, (size_t)src->chunkCount * sizeof(RecordChunk*));
+    for (int c = 0; c < src->chunkCount; c++) {
+        Platform_AtomicIncrement(&src->chunks[c]->refs);
+    }
+    dst->chunkCount = src->chunkCount;
+    dst->count = src->count;
+    dst->deleted = src->deleted;
+    dst->nextId = src->nextId;
+    return 1;
+}
+
+// ------------------------------------------
+// Append a new contact to the store
+// Returns 1 on success, 0 if memory could not be allocated.
+// ------------------------------------------
+int Store_Add(ContactStore *store, const char *name, const char *phone, const char *email, const char *date) {
+    return Store_AddId(store, store->nextId, name, phone, email, date);
+}
+
+// ------------------------------------------
+// Make room for 'records' more contacts holding 'bytes' of strings
+// (terminators included), so a batch of Store_Add calls does not
+// reallocate the tables. Returns 0 when out of memory.
+// ------------------------------------------
+int Store_Reserve(ContactStore *store, int records, size_t bytes) {
+    if (records > INT_MAX - store->count) return 0;
+    int needed = (int)(((size_t)store->count + (size_t)records + STORE_CHUNK_MASK) >> STORE_CHUNK_SHIFT);
+    int ok = Store_ReserveChunks(store, needed);
+    for (int f = 0; ok && f < CONTACT_FIELD_COUNT; f++) {
+        ok = Arena_Reserve(&store->fields[f], bytes);
+    }
+    return ok;
+}
+
+// ------------------------------------------
+// Chunk for the next record: a new one, or the last one unshared
+// ------------------------------------------
+static RecordChunk *Store_AppendChunk(ContactStore *store) {
+    if (store->count == INT_MAX) return NULL;
+    int c = store->count >> STORE_CHUNK_SHIFT;
+    if (c == store->chunkCount) {
+        if (!Store_ReserveChunks(store, c + 1)) return NULL;
+        RecordChunk *chunk = Store_NewChunk();
+        if (!chunk) return NULL;
+        store->chunks[store->chunkCount++] = chunk;
+    }
+    return Store_WritableChunk(store, store->count);
+}
+
+// ------------------------------------------
+// Append a contact under a given id, e.g. one replayed from a journal
+// Returns 0 if 'id' is not above every id so far or out of memory.
+// ------------------------------------------
+int Store_AddId(ContactStore *store, uint64_t id, const char *name, const char *phone, const char *email, const char *date) {
+    if (id < store->nextId || id >= CONTACT_ID_DELETED) return 0;
+
+    StoreRow row;
+    if (!Store_PushFields(store, &row, name, phone, email, date)) return 0;
+    RecordChunk *chunk = Store_AppendChunk(store);
+    if (!chunk) {
+        Store_ReleaseFields(store, row.fields);
+        return 0;
+    }
+    int slot = store->count & STORE_CHUNK_MASK;
+    Store_WriteRow(chunk, slot, &row);
+    chunk->ids[slot] = id;
+    store->nextId = id + 1;
+    store->count++;
+    return 1;
+}
+
+// ------------------------------------------
+// Replace the fields of the contact at 'index'
+// Returns 1 on success, 0 on a bad index or allocation failure.
+// ------------------------------------------
+int Store_Update(ContactStore *store, int index, const char *name, const char *phone, const char *email, const char *date) {
+    if (index < 0 || index >= store->count || Store_IsDeleted(store, index)) return 0;
+
+    StoreRow row;
+    if (!Store_PushFields(store, &row, name, phone, email, date)) return 0;
+    RecordChunk *chunk = Store_WritableChunk(store, index);
+    if (!chunk) {
+        Store_ReleaseFields(store, row.fields);
+        return 0;
+    }
+    int slot = index & STORE_CHUNK_MASK;
+    Store_ReleaseSlot(store, chunk, slot);
+    Store_WriteRow(chunk, slot, &row);
+    Store_MaybeCompact(store);
+    return 1;
+}
+
+// ------------------------------------------
+// Turn the contact at 'index' into a tombstone
+// Nothing moves: positions held by indexes and views stay valid, and the
+// empty fields keep the tombstone out of every substring match.
+// ------------------------------------------
+int Store_Delete(ContactStore *store, int index) {
+    if (index < 0 || index >= store->count || Store_IsDeleted(store, index)) return 0;
+
+    RecordChunk *chunk = Store_WritableChunk(store, index);
+    if (!chunk) return 0;
+    int slot = index & STORE_CHUNK_MASK;
+    Store_ReleaseSlot(store, chunk, slot);
+    StoreRow empty = { { 0, 0, 0, 0 }, PHONE_KEY_NONE, DATE_KEY_NONE, 0 };
+    Store_WriteRow(chunk, slot, &empty);
+    chunk->ids[slot] |= CONTACT_ID_DELETED;
+    store->deleted++;
+    Store_MaybeCompact(store);
+    return 1;
+}
+
+// ------------------------------------------
+// Purge once a quarter of the records are tombstones
+// ------------------------------------------
+int Store_NeedsPurge(const ContactStore *store) {
+    return store->deleted > 0 && store->deleted >= store->count / STORE_PURGE_RATIO;
+}
+
+// ------------------------------------------
+// Slide the live records down over the tombstones, in one pass
+// Chunks before the first tombstone are left alone (and stay shared).
+// ------------------------------------------
+int Store_Purge(ContactStore *store, int *remap) {
+    int first = 0;
+    while (first < store->count && !Store_IsDeleted(store, first)) first++;
+    for (int c = first >> STORE_CHUNK_SHIFT; first < store->count && c < store->chunkCount; c++) {
+        if (!Store_UnshareChunk(store, c)) return 0;
+    }
+
+    if (remap) {
+        for (int i = 0; i < first; i++) remap[i] = i;
+    }
+    int live = first;
+    for (int i = first; i < store->count; i++) {
+        if (Store_IsDeleted(store, i)) {
+            if (remap) remap[i] = -1;
+            continue;
+        }
+        if (remap) remap[i] = live;
+        Store_CopyRecord(store->chunks[live >> STORE_CHUNK_SHIFT], live & STORE_CHUNK_MASK,
+                         Store_Chunk(store, i), i & STORE_CHUNK_MASK);
+        live++;
+    }
+    int chunks = (live + STORE_CHUNK_MASK) >> STORE_CHUNK_SHIFT;
+    while (store->chunkCount > chunks) {
+        Store_DropChunk(store->chunks[--store->chunkCount]);
+    }
+    store->count = live;
+    store->deleted = 0;
+    return 1;
+}
+
+// ------------------------------------------
+// Put the records in the order given by 'rows'; the strings stay in place
+// ------------------------------------------
+int Store_Permute(ContactStore *store, const int *rows) {
+    if (store->count == 0) return 1;
+    RecordChunk **table = (RecordChunk**)calloc((size_t)store->chunkCount, sizeof(RecordChunk*));
+    int ok = table != NULL;
+    for (int c = 0; ok && c < store->chunkCount; c++) {
+        table[c] = Store_NewChunk();
+        ok = table[c] != NULL;
+    }
+    if (!ok) {
+        for (int c = 0; table && c < store->chunkCount; c++) free(table[c]);
+        free(table);
+        return 0;
+    }
+
+    for (int i = 0; i < store->count; i++) {
+        RecordChunk *chunk = table[i >> STORE_CHUNK_SHIFT];
+        int slot = i & STORE_CHUNK_MASK;
+        Store_CopyRecord(chunk, slot, Store_Chunk(store, rows[i]), rows[i] & STORE_CHUNK_MASK);
+        chunk->ids[slot] = (chunk->ids[slot] & CONTACT_ID_DELETED) | (uint64_t)(i + 1);
+    }
+    store->nextId = (uint64_t)store->count + 1;
+    for (int c = 0; c < store->chunkCount; c++) {
+        Store_DropChunk(store->chunks[c]);
+    }
+    free(store->chunks);
+    store->chunks = table;
+    store->chunkCapacity = store->chunkCount;
+    return 1;
+}
+
+// ------------------------------------------
+// Rebuild one field's arena with only the strings still referenced
+// O(live bytes). Keeps the old arena if the new one (or unshared copies
+// of the chunks, whose offsets change) cannot be allocated.
+// ------------------------------------------
+static void Store_CompactField(ContactStore *store, int field) {
+    for (int c = 0; c < store->chunkCount; c++) {
+        if (!Store_UnshareChunk(store, c)) return;
+    }
+
+    StringArena *arena = &store->fields[field];
+    StringArena fresh;
+    Arena_Init(&fresh);
+    for (int i = 0; i < store->count; i++) {
+        uint32_t offset = Store_GetOffset(store, i, (ContactField)field);
+        if (Arena_PushString(&fresh, Arena_String(arena, offset), s_fieldSizes[field]) == ARENA_INVALID) {
+            Arena_Free(&fresh);
+            return;
+        }
+    }
+
+    // Second pass: all allocations succeeded, so the offsets can be
+    // rewritten by laying the strings out again the same way: in order,
+    // moving to the next page when one does not fit
+    uint32_t pos = 1;
+    for (int i = 0; i < store->count; i++) {
+        uint32_t *offset = &store->chunks[i >> STORE_CHUNK_SHIFT]->fields[field][i & STORE_CHUNK_MASK];
+        size_t len = strlen(Arena_String(arena, *offset));
+        if (len > s_fieldSizes[field] - 1) len = s_fieldSizes[field] - 1;
+        if (len == 0) {
+            *offset = 0;
+            continue;
+        }
+        uint32_t size = (uint32_t)len + 1;
+        if ((pos & ARENA_PAGE_MASK) + size > ARENA_PAGE_SIZE) pos = (pos | ARENA_PAGE_MASK) + 1;
+        *offset = pos;
+        pos += size;
+    }
+
+    Arena_Free(arena);
+    *arena = fresh;
+}
+
+// ------------------------------------------
+// Rebuild the field arenas with only the strings that are still
+// referenced; interned ones never hold garbage
+// ------------------------------------------
+void Store_Compact(ContactStore *store) {
+    for (int f = 0; f < CONTACT_FIELD_COUNT; f++) {
+        if (!store->fields[f].interned) Store_CompactField(store, f);
+    }
+}
+
+// ------------------------------------------
+// Ids and tombstones
+// ------------------------------------------
+uint64_t Store_GetId(const ContactStore *store, int index) {
+    return Store_Chunk(store, index)->ids[index & STORE_CHUNK_MASK] & ~CONTACT_ID_DELETED;
+}
+
+int Store_IsDeleted(const ContactStore *store, int index) {
+    return (Store_Chunk(store, index)->ids[index & STORE_CHUNK_MASK] & CONTACT_ID_DELETED) != 0;
+}
+
+int Store_LiveCount(const ContactStore *store) {
+    return store->count - store->deleted;
+}
+
+// ------------------------------------------
+// Position of the contact with 'id', by binary search (ids ascend)
+// ------------------------------------------
+int Store_FindId(const ContactStore *store, uint64_t id) {
+    int lo = 0, hi = store->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (Store_GetId(store, mid) < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < store->count && Store_GetId(store, lo) == id && !Store_IsDeleted(store, lo)) return lo;
+    return -1;
+}
+
+// ------------------------------------------
+// Field accessors, O(1)
+// ------------------------------------------
+uint32_t Store_GetOffset(const ContactStore *store, int index, ContactField field) {
+    return Store_Chunk(store, index)->fields[field][index & STORE_CHUNK_MASK];
+}
+
+const uint32_t *Store_Column(const ContactStore *store, int index, ContactField field, int *count) {
+    int slot = index & STORE_CHUNK_MASK;
+    *count = store->count - index < STORE_CHUNK_SIZE - slot ? store->count - index : STORE_CHUNK_SIZE - slot;
+    return Store_Chunk(store, index)->fields[field] + slot;
+}
+
+const char *Store_GetName(const ContactStore *store, int index) {
+    return Arena_String(&store->fields[CONTACT_FIELD_NAME], Store_GetOffset(store, index, CONTACT_FIELD_NAME));
+}
+
+const char *Store_GetPhone(const ContactStore *store, int index) {
+    return Arena_String(&store->fields[CONTACT_FIELD_PHONE], Store_GetOffset(store, index, CONTACT_FIELD_PHONE));
+}
+
+const char *Store_GetEmail(const ContactStore *store, int index) {
+    return Arena_String(&store->fields[CONTACT_FIELD_EMAIL], Store_GetOffset(store, index, CONTACT_FIELD_EMAIL));
+}
+
+const char *Store_GetDate(const ContactStore *store, int index) {
+    return Arena_String(&store->fields[CONTACT_FIELD_DATE], Store_GetOffset(store, index, CONTACT_FIELD_DATE));
+}
+
+uint64_t Store_GetPhoneKey(const ContactStore *store, int index) {
+    return Store_Chunk(store, index)->phoneKeys[index & STORE_CHUNK_MASK];
+}
+
+uint32_t Store_GetDay(const ContactStore *store, int index) {
+    return Store_Chunk(store, index)->days[index & STORE_CHUNK_MASK];
+}
+
+uint32_t Store_GetDomain(const ContactStore *store, int index) {
+    return Store_Chunk(store, index)->domains[index & STORE_CHUNK_MASK];
+}
+
+// ------------------------------------------
+// Id of a domain, folded the way the stored ones are
+// ------------------------------------------
+uint32_t Store_FindDomain(const ContactStore *store, const char *domain) {
+    char folded[CONTACT_EMAIL_SIZE];
+    if (!Store_FoldDomain(folded, domain)) return 0;
+    return Arena_Find(&store->domains, folded);
+}
+
+// ------------------------------------------
+// Memory held by the store, chunks and pages shared with copies included
+// ------------------------------------------
+size_t Store_MemoryBytes(const ContactStore *store) {
+    size_t bytes = (size_t)store->chunkCount * sizeof(RecordChunk) +
+                   (size_t)store->chunkCapacity * sizeof(RecordChunk*) +
+                   Arena_MemoryBytes(&store->domains);
+    for (int f = 0; f < CONTACT_FIELD_COUNT; f++) {
+        bytes += Arena_MemoryBytes(&store->fields[f]);
+    }
+    return bytes;
+}
@@ -0,0 +1,195 @@
+#ifndef CONTACT_STORE_H
+#define CONTACT_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ------------------------------------------
+//               Data Structures
+// ------------------------------------------
+
+// Maximum field sizes accepted from the UI (including the terminating '\0')
+#define CONTACT_NAME_SIZE   100
+#define CONTACT_PHONE_SIZE  30
+#define CONTACT_EMAIL_SIZE  100
+#define CONTACT_DATE_SIZE   11  // Expected format: "YYYY-MM-DD" or empty
+
+#define ARENA_INVALID UINT32_MAX
+
+// Fields of a contact. Each has a column of its own: its strings in a
+// string arena of their own and their offsets in an array per chunk, so
+// a scan of one field reads that field's bytes and nothing else.
+typedef enum {
+    CONTACT_FIELD_NAME,
+    CONTACT_FIELD_PHONE,
+    CONTACT_FIELD_EMAIL,
+    CONTACT_FIELD_DATE,
+    CONTACT_FIELD_COUNT
+} ContactField;
+
+// Strings are stored in 64 KiB pages and records in chunks of 1024. Both
+// are reference counted and shared between a store and its copies, so
+// Store_Copy is a snapshot that copies no contact data: the first change
+// to a shared chunk or page copies just that one (copy-on-write). A copy
+// then costs memory in proportion to the changes made since it was taken.
+#define ARENA_PAGE_SHIFT   16
+#define ARENA_PAGE_SIZE    (1u << ARENA_PAGE_SHIFT)
+#define STORE_CHUNK_SHIFT  10
+#define STORE_CHUNK_SIZE   (1 << STORE_CHUNK_SHIFT)
+
+typedef struct ArenaBlock ArenaBlock;
+typedef struct RecordChunk RecordChunk;
+
+// String arena: strings live in append-only pages addressed by a 32-bit
+// offset (page number, then position in the page). Offset 0 always holds
+// an empty string, so empty fields cost no arena space. A string never
+// straddles pages and the bytes of a page past its last string are 0, so
+// a page can be scanned as one block of '\0'-separated text.
+// Strings are never changed in place; those replaced by updates or
+// deletes are counted as garbage and reclaimed by Store_Compact once they
+// dominate.
+// An interning arena (Arena_Intern) keeps one copy of each distinct
+// string, found through a hash set of offsets; its strings are never
+// released, so their offsets double as ids.
+typedef struct {
+    char       **pages;     // Start of each page of offsets
+    ArenaBlock **blocks;    // Block holding each page (one reference per page)
+    uint32_t pageCount;
+    uint32_t pageCapacity;
+    uint32_t used;          // Offset of the next string
+    uint32_t limit;         // End of the page being filled
+    uint32_t garbage;       // Bytes belonging to strings that are no longer referenced
+    int       interned;     // Strings are interned (set before the first one)
+    uint32_t *set;          // Interning hash set of offsets, 0 for a free slot
+    uint32_t  setCapacity;  // Power of two
+    uint32_t  setCount;
+} StringArena;
+
+// Set in the id of a deleted record (a tombstone)
+#define CONTACT_ID_DELETED (UINT64_C(1) << 63)
+
+// Purge tombstones once they are this fraction (1/n) of the records
+#define STORE_PURGE_RATIO 4
+
+// A contact as the file loaders hand it to Store_Attach: offsets of its
+// fields in the loaded text, and its id (0 for a fresh one).
+// Ids are 64-bit, never reused and ascending in store order, so they stay
+// valid across sorts, deletes and purges while positions do not.
+typedef struct {
+    uint32_t name;
+    uint32_t phone;
+    uint32_t email;
+    uint32_t date;
+    uint64_t id;
+} ContactRecord;
+
+// Growable contact store, kept as columns (structure of arrays)
+// A chunk holds, per contact, its id, the offsets of its four fields in
+// their arenas, and values parsed once when the contact is stored: its
+// phone number as a PhoneKey, its date as a DateKey day number and its
+// email domain (40 bytes per contact in all). Repeated values are
+// interned: the date arena keeps one copy of each date, and domains, case
+// folded, are ids into a dictionary shared by the whole store.
+// Costs (n = number of contacts, L = length of the strings involved):
+// - Add:     amortized O(L)
+// - Update:  amortized O(L), old strings become garbage
+// - Delete:  O(1); the record stays behind as a tombstone (empty fields)
+// - Purge:   O(n) move of 40 bytes per record that drops the tombstones
+// - Copy:    O(n / 1024) chunk and page references, plus the interning
+//            sets (O(distinct dates and domains)); no contact data
+// - Iterate: O(n), Store_GetName/... are O(1); skip Store_IsDeleted rows
+// The first change to a chunk or page shared with a copy costs one more
+// chunk (40 KiB) or page (64 KiB), which can fail when out of memory.
+// The store keeps insertion order; sorted views come from SortIndex.
+// Positions stay put until Store_Purge, which reports where each went.
+typedef struct {
+    RecordChunk **chunks;   // Records i << STORE_CHUNK_SHIFT onwards in chunks[i]
+    int chunkCount;
+    int chunkCapacity;
+    int count;          // Records, tombstones included
+    int deleted;        // Tombstones among them
+    uint64_t nextId;
+    StringArena fields[CONTACT_FIELD_COUNT];  // Strings of each field (dates interned)
+    StringArena domains;                      // Interned email domains, ASCII lower case
+} ContactStore;
+
+// String arena
+void Arena_Init(StringArena *arena);
+void Arena_Free(StringArena *arena);
+int      Arena_Reserve(StringArena *arena, size_t bytes);
+uint32_t Arena_PushString(StringArena *arena, const char *str, size_t maxLen);
+// Offset of the copy of 'str' in an interning arena, pushed if it is new
+// (ARENA_INVALID when out of memory); Arena_Find only looks (0 if absent)
+uint32_t Arena_Intern(StringArena *arena, const char *str, size_t maxLen);
+uint32_t Arena_Find(const StringArena *arena, const char *str);
+void Arena_Release(StringArena *arena, uint32_t offset);
+const char *Arena_String(const StringArena *arena, uint32_t offset);
+// Page 'page' and the number of its bytes in use, for scans
+const char *Arena_Page(const StringArena *arena, uint32_t page, uint32_t *size);
+// Bytes held by the pages and tables
+size_t Arena_MemoryBytes(const StringArena *arena);
+
+// Contact store
+void Store_Init(ContactStore *store);
+void Store_Free(ContactStore *store);
+int  Store_Add(ContactStore *store, const char *name, const char *phone, const char *email, const char *date);
+int  Store_AddId(ContactStore *store, uint64_t id, const char *name, const char *phone, const char *email, const char *date);
+int  Store_Reserve(ContactStore *store, int records, size_t bytes);
+int  Store_Update(ContactStore *store, int index, const char *name, const char *phone, const char *email, const char *date);
+// Returns 0 on a bad index or when out of memory (nothing changes)
+int  Store_Delete(ContactStore *store, int index);
+void Store_Compact(ContactStore *store);
+// Does the dead ratio call for a Store_Purge?
+int  Store_NeedsPurge(const ContactStore *store);
+// Drop the tombstones, keeping the order of the live records. If 'remap'
+// is given (store->count entries), it receives the new position of every
+// old one, -1 for tombstones, so indexes can follow without a rebuild.
+// Returns 0 when out of memory (nothing moves and 'remap' is not set).
+int  Store_Purge(ContactStore *store, int *remap);
+// Reorder the records so position i holds the contact previously at
+// rows[i] ('rows' is a permutation of the store). Ids are renumbered in
+// the new order and indexes over the store must be rebuilt.
+// Returns 0 when out of memory (nothing moves).
+int  Store_Permute(ContactStore *store, const int *rows);
+// Replace the contents with a loaded file's records and text (see the
+// .c file). Returns 0 when out of memory; the buffers are freed either way.
+int  Store_Attach(ContactStore *store, ContactRecord *records, int count, char *text);
+// Snapshot: an independent store sharing every chunk and page with 'src'
+// until either of them changes it, so another thread can read or save
+// the copy while 'src' keeps being edited. 'src' itself is not changed,
+// but must not be edited while the copy is made. Returns 0 when out of
+// memory ('dst' is left empty).
+int  Store_Copy(ContactStore *dst, const ContactStore *src);
+
+// Ids: 0 is never a contact. Store_FindId is O(log n) and returns -1 for
+// unknown and deleted ids.
+uint64_t Store_GetId(const ContactStore *store, int index);
+int  Store_FindId(const ContactStore *store, uint64_t id);
+int  Store_IsDeleted(const ContactStore *store, int index);
+int  Store_LiveCount(const ContactStore *store);
+
+const char *Store_GetName(const ContactStore *store, int index);
+const char *Store_GetPhone(const ContactStore *store, int index);
+const char *Store_GetEmail(const ContactStore *store, int index);
+const char *Store_GetDate(const ContactStore *store, int index);
+// PhoneKey of the phone number, PHONE_KEY_NONE for tombstones
+uint64_t Store_GetPhoneKey(const ContactStore *store, int index);
+// DateKey of the date, DATE_KEY_NONE when it is empty or not a real
+// YYYY-MM-DD date, and for tombstones
+uint32_t Store_GetDay(const ContactStore *store, int index);
+// Email domain (after the last '@', ASCII lower case) as an id into
+// store->domains, 0 when there is none. Store_FindDomain gives the id of
+// a domain (any case), 0 when no contact has it.
+uint32_t Store_GetDomain(const ContactStore *store, int index);
+uint32_t Store_FindDomain(const ContactStore *store, const char *domain);
+
+// Column access for scans: the offset of a contact's field in
+// store->fields[field]. Tombstones have offset 0 in every field.
+// Store_Column gives the offsets from record 'index' to the end of its
+// chunk (*count of them) as one array.
+uint32_t Store_GetOffset(const ContactStore *store, int index, ContactField field);
+const uint32_t *Store_Column(const ContactStore *store, int index, ContactField field, int *count);
+// Bytes held by the store: chunks, arenas and interning sets
+size_t Store_MemoryBytes(const ContactStore *store);
+
+#endif // CONTACT_STORE_H
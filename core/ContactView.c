@@ -0,0 +1,164 @@
+#include "ContactView.h"
+#include "Search.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ------------------------------------------
+// Initialize an empty view
+// ------------------------------------------
+void ContactView_Init(ContactView *view) {
+    memset(view, 0, sizeof(*view));
+    view->sortColumn = SORT_NONE;
+}
+
+// ------------------------------------------
+// Release the row mapping
+// ------------------------------------------
+void ContactView_Free(ContactView *view) {
+    free(view->rows);
+    ContactView_Init(view);
+}
+
+// ------------------------------------------
+// Room for 'count' rows. Returns 0 when out of memory.
+// ------------------------------------------
+static int ContactView_Reserve(ContactView *view, int count) {
+    if (count <= view->capacity) return 1;
+    int *rows = (int*)realloc(view->rows, (size_t)count * sizeof(int));
+    if (!rows) return 0;
+    view->rows = rows;
+    view->capacity = count;
+    return 1;
+}
+
+// ------------------------------------------
+// Bring filtered rows into the view's sort order
+// ------------------------------------------
+static void ContactView_Arrange(ContactView *view, const ContactStore *store) {
+    if (view->sort && !view->showAll) {
+        SortIndex_Arrange(view->sort, store, view->sortColumn, view->rows, view->count);
+    }
+}
+
+// ------------------------------------------
+// Show the whole store without building a mapping
+// Tombstones are skipped through a list of the live positions.
+// ------------------------------------------
+int ContactView_ShowAll(ContactView *view, const ContactStore *store) {
+    if (store->deleted > 0) {
+        if (!ContactView_Reserve(view, store->count)) return 0;
+        int live = 0;
+        for (int i = 0; i < store->count; i++) {
+            if (!Store_IsDeleted(store, i)) view->rows[live++] = i;
+        }
+    }
+    view->showAll = 1;
+    view->dense = (store->deleted == 0);
+    view->count = Store_LiveCount(store);
+    return 1;
+}
+
+// ------------------------------------------
+// Show a copy of 'rows'
+// ------------------------------------------
+int ContactView_SetRows(ContactView *view, const ContactStore *store, const int *rows, int count) {
+    if (!ContactView_Reserve(view, count)) return 0;
+    if (count > 0) {
+        memcpy(view->rows, rows, (size_t)count * sizeof(int));
+    }
+    view->showAll = 0;
+    view->count = count;
+    ContactView_Arrange(view, store);
+    return 1;
+}
+
+// ------------------------------------------
+// Search straight into the row mapping
+// ------------------------------------------
+int ContactView_Filter(ContactView *view, const ContactStore *store, const TrigramIndex *index, const char *query) {
+    if (!query || query[0] == '\0') {
+        return ContactView_ShowAll(view, store);
+    }
+    if (!ContactView_Reserve(view, store->count > 0 ? store->count : 1)) return 0;
+    view->count = Search_Contacts(store, index, query, view->rows);
+    view->showAll = 0;
+    ContactView_Arrange(view, store);
+    return 1;
+}
+
+// ------------------------------------------
+// Switch the sort order; O(1) for the whole store
+// ------------------------------------------
+void ContactView_SetSort(ContactView *view, const ContactStore *store, const SortIndex *sort, SortColumn column) {
+    view->sort = sort;
+    view->sortColumn = column;
+    ContactView_Arrange(view, store);
+}
+
+// ------------------------------------------
+// Compact the rows over contacts that are gone
+// ------------------------------------------
+int ContactView_RemoveDeleted(ContactView *view, const ContactStore *store) {
+    if (view->showAll) return ContactView_ShowAll(view, store);
+    int kept = 0;
+    for (int i = 0; i < view->count; i++) {
+        int index = view->rows[i];
+        if (index >= 0 && index < store->count && !Store_IsDeleted(store, index)) {
+            view->rows[kept++] = index;
+        }
+    }
+    view->count = kept;
+    return 1;
+}
+
+// ------------------------------------------
+// Move the rows to the positions of their contacts after a purge
+// ------------------------------------------
+void ContactView_Purge(ContactView *view, const int *remap) {
+    if (view->showAll) {
+        // The purged store has no tombstones left
+        view->dense = 1;
+        return;
+    }
+    int kept = 0;
+    for (int i = 0; i < view->count; i++) {
+        if (remap[view->rows[i]] >= 0) view->rows[kept++] = remap[view->rows[i]];
+    }
+    view->count = kept;
+}
+
+// ------------------------------------------
+// Visible row -> store position
+// Contacts may have been deleted or purged since the view was filled, so
+// positions are checked against the store rather than trusted.
+// ------------------------------------------
+int ContactView_IndexOfRow(const ContactView *view, const ContactStore *store, int row) {
+    if (row < 0 || row >= view->count) return -1;
+    int index = -1;
+    const int *order = view->showAll && view->sort ? SortIndex_Order(view->sort, view->sortColumn) : NULL;
+    if (!view->showAll) {
+        index = view->rows[row];
+    } else if (order) {
+        if (row < view->sort->count) index = order[row];
+    } else {
+        index = view->dense ? row : view->rows[row];
+    }
+    if (index < 0 || index >= store->count || Store_IsDeleted(store, index)) return -1;
+    return index;
+}
+
+// ------------------------------------------
+// Cell text for the ListView
+// ------------------------------------------
+const char *ContactView_Text(const ContactView *view, const ContactStore *store, int row, int column) {
+    int index = ContactView_IndexOfRow(view, store, row);
+    if (index < 0) return "";
+    switch (column) {
+        case VIEW_COLUMN_NAME:  return Store_GetName(store, index);
+        case VIEW_COLUMN_PHONE: return Store_GetPhone(store, index);
+        case VIEW_COLUMN_EMAIL: return Store_GetEmail(store, index);
+        case VIEW_COLUMN_DATE:  return Store_GetDate(store, index);
+        default:                return "";
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef CONTACT_VIEW_H
+#define CONTACT_VIEW_H
+
+#include "ContactStore.h"
+#include "SortIndex.h"
+#include "TrigramIndex.h"
+
+// View-model behind the virtual (owner-data) ListView.
+// Maps each visible row to a store position and serves the cell text on
+// demand, so the control never holds copies of the contacts: a refresh
+// only changes the row count and the control asks for the rows it paints.
+// Showing the whole store needs no mapping array at all, even when sorted:
+// rows then come straight from the maintained sort order. Only tombstones
+// in store order need one, until the store is purged.
+
+typedef enum {
+    VIEW_COLUMN_NAME,
+    VIEW_COLUMN_PHONE,
+    VIEW_COLUMN_EMAIL,
+    VIEW_COLUMN_DATE,
+    VIEW_COLUMN_COUNT
+} ContactViewColumn;
+
+typedef struct {
+    int *rows;      // Store position of each visible row, unless showAll
+    int  count;     // Visible rows
+    int  capacity;
+    int  showAll;   // Row i is the i-th live contact of the sort order
+    int  dense;     // With showAll and no sort: row i is store position i
+    const SortIndex *sort;
+    SortColumn sortColumn;
+} ContactView;
+
+void ContactView_Init(ContactView *view);
+void ContactView_Free(ContactView *view);
+
+// Show every contact of the store, in the view's sort order. O(1) unless
+// the store holds tombstones. Returns 0 when out of memory.
+int ContactView_ShowAll(ContactView *view, const ContactStore *store);
+
+// Show the given (distinct) store positions, in the view's sort order.
+// Returns 0 when out of memory (the view is left unchanged).
+int ContactView_SetRows(ContactView *view, const ContactStore *store, const int *rows, int count);
+
+// Show the contacts matching 'query' (see Search_Contacts); an empty or
+// NULL query shows all. Returns 0 when out of memory.
+int ContactView_Filter(ContactView *view, const ContactStore *store, const TrigramIndex *index, const char *query);
+
+// Display rows in 'column' order from 'sort' (SORT_NONE: store order).
+// A filtered view is rearranged in place, without searching again.
+void ContactView_SetSort(ContactView *view, const ContactStore *store, const SortIndex *sort, SortColumn column);
+
+// Drop the rows of contacts deleted since the view was filled, in one
+// pass. Returns 0 when out of memory.
+int ContactView_RemoveDeleted(ContactView *view, const ContactStore *store);
+
+// Follow a Store_Purge (see Store_Purge for 'remap')
+void ContactView_Purge(ContactView *view, const int *remap);
+
+// Store position shown on visible row 'row', or -1 if there is none
+int ContactView_IndexOfRow(const ContactView *view, const ContactStore *store, int row);
+
+// Text of one cell; "" for rows or columns that do not exist
+const char *ContactView_Text(const ContactView *view, const ContactStore *store, int row, int column);
+
+#endif // CONTACT_VIEW_H
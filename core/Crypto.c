@@ -0,0 +1,541 @@
+#include "Crypto.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CRYPTO_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// ------------------------------------------
+// Little-endian helpers
+// ------------------------------------------
+static uint32_t Load32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void Store32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void Store64(uint8_t *p, uint64_t v) {
+    Store32(p, (uint32_t)v);
+    Store32(p + 4, (uint32_t)(v >> 32));
+}
+
+// ------------------------------------------
+// Wipe key material through a volatile pointer
+// ------------------------------------------
+void Crypto_Wipe(void *p, size_t len) {
+    volatile uint8_t *v = (volatile uint8_t*)p;
+    while (len--) *v++ = 0;
+}
+
+// ------------------------------------------
+//                 ChaCha20
+// ------------------------------------------
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define CHACHA_QR(a, b, c, d)                      \
+    a += b; d ^= a; d = ROTL32(d, 16);             \
+    c += d; b ^= c; b = ROTL32(b, 12);             \
+    a += b; d ^= a; d = ROTL32(d, 8);              \
+    c += d; b ^= c; b = ROTL32(b, 7)
+
+// ------------------------------------------
+// Initial state: constants, key, block counter, nonce
+// ------------------------------------------
+static void ChaCha20_Setup(uint32_t state[16], const uint8_t key[32], uint32_t counter, const uint8_t nonce[12]) {
+    state[0] = 0x61707865;  // "expand 32-byte k"
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++) state[4 + i] = Load32(key + 4 * i);
+    state[12] = counter;
+    for (int i = 0; i < 3; i++) state[13 + i] = Load32(nonce + 4 * i);
+}
+
+// ------------------------------------------
+// One 64-byte keystream block (portable path)
+// ------------------------------------------
+static void ChaCha20_Block(const uint32_t state[16], uint8_t out[64]) {
+    uint32_t x[16];
+    memcpy(x, state, sizeof(x));
+    for (int round = 0; round < 10; round++) {
+        CHACHA_QR(x[0], x[4], x[8],  x[12]);
+        CHACHA_QR(x[1], x[5], x[9],  x[13]);
+        CHACHA_QR(x[2], x[6], x[10], x[14]);
+        CHACHA_QR(x[3], x[7], x[11], x[15]);
+        CHACHA_QR(x[0], x[5], x[10], x[15]);
+        CHACHA_QR(x[1], x[6], x[11], x[12]);
+        CHACHA_QR(x[2], x[7], x[8],  x[13]);
+        CHACHA_QR(x[3], x[4], x[9],  x[14]);
+    }
+    for (int i = 0; i < 16; i++) Store32(out + 4 * i, x[i] + state[i]);
+}
+
+#ifdef CRYPTO_SSE2
+
+#define ROTL128(v, n) _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+
+#define CHACHA_QR128(a, b, c, d)                                                   \
+    a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL128(d, 16);          \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL128(b, 12);          \
+    a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL128(d, 8);           \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL128(b, 7)
+
+// ------------------------------------------
+// Four consecutive blocks XORed into 256 bytes (SSE2 path)
+// Each vector holds one state word for four blocks; the results are
+// transposed back into block order while XORing.
+// ------------------------------------------
+static void ChaCha20_Xor4(uint32_t state[16], const uint8_t *in, uint8_t *out) {
+    __m128i x[16], orig[16];
+    for (int i = 0; i < 16; i++) x[i] = _mm_set1_epi32((int)state[i]);
+    x[12] = _mm_add_epi32(x[12], _mm_set_epi32(3, 2, 1, 0));
+    memcpy(orig, x, sizeof(x));
+
+    for (int round = 0; round < 10; round++) {
+        CHACHA_QR128(x[0], x[4], x[8],  x[12]);
+        CHACHA_QR128(x[1], x[5], x[9],  x[13]);
+        CHACHA_QR128(x[2], x[6], x[10], x[14]);
+        CHACHA_QR128(x[3], x[7], x[11], x[15]);
+        CHACHA_QR128(x[0], x[5], x[10], x[15]);
+        CHACHA_QR128(x[1], x[6], x[11], x[12]);
+        CHACHA_QR128(x[2], x[7], x[8],  x[13]);
+        CHACHA_QR128(x[3], x[4], x[9],  x[14]);
+    }
+
+    for (int j = 0; j < 16; j += 4) {
+        __m128i a = _mm_add_epi32(x[j],     orig[j]);
+        __m128i b = _mm_add_epi32(x[j + 1], orig[j + 1]);
+        __m128i c = _mm_add_epi32(x[j + 2], orig[j + 2]);
+        __m128i d = _mm_add_epi32(x[j + 3], orig[j + 3]);
+        __m128i ab0 = _mm_unpacklo_epi32(a, b), ab1 = _mm_unpackhi_epi32(a, b);
+        __m128i cd0 = _mm_unpacklo_epi32(c, d), cd1 = _mm_unpackhi_epi32(c, d);
+        __m128i words[4] = {
+            _mm_unpacklo_epi64(ab0, cd0), _mm_unpackhi_epi64(ab0, cd0),
+            _mm_unpacklo_epi64(ab1, cd1), _mm_unpackhi_epi64(ab1, cd1)
+        };
+        for (int k = 0; k < 4; k++) {
+            size_t at = (size_t)k * 64 + (size_t)j * 4;
+            __m128i m = _mm_loadu_si128((const __m128i*)(in + at));
+            _mm_storeu_si128((__m128i*)(out + at), _mm_xor_si128(m, words[k]));
+        }
+    }
+    state[12] += 4;
+}
+
+#endif // CRYPTO_SSE2
+
+// ------------------------------------------
+// XOR the keystream into a buffer
+// ------------------------------------------
+void ChaCha20_Xor(const uint8_t key[CRYPTO_KEY_SIZE], uint32_t counter,
+                  const uint8_t nonce[CRYPTO_NONCE_SIZE],
+                  const uint8_t *in, uint8_t *out, size_t len) {
+    uint32_t state[16];
+    uint8_t block[64];
+    ChaCha20_Setup(state, key, counter, nonce);
+
+#ifdef CRYPTO_SSE2
+    while (len >= 256) {
+        ChaCha20_Xor4(state, in, out);
+        in += 256;
+        out += 256;
+        len -= 256;
+    }
+#endif
+    while (len > 0) {
+        size_t n = len < 64 ? len : 64;
+        ChaCha20_Block(state, block);
+        for (size_t i = 0; i < n; i++) out[i] = (uint8_t)(in[i] ^ block[i]);
+        state[12]++;
+        in += n;
+        out += n;
+        len -= n;
+    }
+    Crypto_Wipe(state, sizeof(state));
+    Crypto_Wipe(block, sizeof(block));
+}
+
+// ------------------------------------------
+//                 Poly1305
+// ------------------------------------------
+// 26-bit limbs with 64-bit products, so the same code runs on 32-bit
+// targets and compilers without a 128-bit integer type.
+
+typedef struct {
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+    uint8_t  buffer[16];
+    size_t   leftover;
+} Poly1305;
+
+static void Poly1305_Init(Poly1305 *st, const uint8_t key[32]) {
+    st->r[0] = (Load32(key +  0)     ) & 0x3ffffff;
+    st->r[1] = (Load32(key +  3) >> 2) & 0x3ffff03;
+    st->r[2] = (Load32(key +  6) >> 4) & 0x3ffc0ff;
+    st->r[3] = (Load32(key +  9) >> 6) & 0x3f03fff;
+    st->r[4] = (Load32(key + 12) >> 8) & 0x00fffff;
+    memset(st->h, 0, sizeof(st->h));
+    for (int i = 0; i < 4; i++) st->pad[i] = Load32(key + 16 + 4 * i);
+    st->leftover = 0;
+}
+
+// ------------------------------------------
+// Absorb whole 16-byte blocks ('hibit' is 0 only for the padded final block)
+// ------------------------------------------
+static void Poly1305_Blocks(Poly1305 *st, const uint8_t *m, size_t bytes, uint32_t hibit) {
+    const uint32_t r0 = st->r[0], r1 = st->r[1], r2 = st->r[2], r3 = st->r[3], r4 = st->r[4];
+    const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2], h3 = st->h[3], h4 = st->h[4];
+
+    while (bytes >= 16) {
+        h0 += (Load32(m +  0)     ) & 0x3ffffff;
+        h1 += (Load32(m +  3) >> 2) & 0x3ffffff;
+        h2 += (Load32(m +  6) >> 4) & 0x3ffffff;
+        h3 += (Load32(m +  9) >> 6) & 0x3ffffff;
+        h4 += (Load32(m + 12) >> 8) | hibit;
+
+        uint64_t d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+        uint64_t d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+        uint64_t d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+        uint64_t d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+        uint64_t d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+
+        uint32_t c;
+        c = (uint32_t)(d0 >> 26); h0 = (uint32_t)d0 & 0x3ffffff;
+        d1 += c; c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & 0x3ffffff;
+        d2 += c; c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & 0x3ffffff;
+        d3 += c; c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & 0x3ffffff;
+        d4 += c; c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & 0x3ffffff;
+        h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+        h1 += c;
+
+        m += 16;
+        bytes -= 16;
+    }
+    st->h[0] = h0; st->h[1] = h1; st->h[2] = h2; st->h[3] = h3; st->h[4] = h4;
+}
+
+static void Poly1305_Update(Poly1305 *st, const uint8_t *m, size_t bytes) {
+    if (bytes == 0) return;
+    if (st->leftover) {
+        size_t want = 16 - st->leftover;
+        if (want > bytes) want = bytes;
+        memcpy(st->buffer + st->leftover, m, want);
+        st->leftover += want;
+        m += want;
+        bytes -= want;
+        if (st->leftover < 16) return;
+        Poly1305_Blocks(st, st->buffer, 16, 1u << 24);
+        st->leftover = 0;
+    }
+    size_t whole = bytes & ~(size_t)15;
+    if (whole) {
+        Poly1305_Blocks(st, m, whole, 1u << 24);
+        m += whole;
+        bytes -= whole;
+    }
+    if (bytes) {
+        memcpy(st->buffer, m, bytes);
+        st->leftover = bytes;
+    }
+}
+
+static void Poly1305_Finish(Poly1305 *st, uint8_t tag[16]) {
+    if (st->leftover) {
+        size_t i = st->leftover;
+        st->buffer[i++] = 1;
+        while (i < 16) st->buffer[i++] = 0;
+        Poly1305_Blocks(st, st->buffer, 16, 0);
+    }
+
+    uint32_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2], h3 = st->h[3], h4 = st->h[4];
+    uint32_t c;
+    c = h1 >> 26; h1 &= 0x3ffffff;
+    h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+    h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+    h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+
+    // g = h - p; pick g when h >= p, without branching
+    uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+    uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+    uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+    uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+    uint32_t g4 = h4 + c - (1u << 26);
+
+    uint32_t mask = (g4 >> 31) - 1;
+    g0 &= mask; g1 &= mask; g2 &= mask; g3 &= mask; g4 &= mask;
+    mask = ~mask;
+    h0 = (h0 & mask) | g0;
+    h1 = (h1 & mask) | g1;
+    h2 = (h2 & mask) | g2;
+    h3 = (h3 & mask) | g3;
+    h4 = (h4 & mask) | g4;
+
+    h0 = h0 | (h1 << 26);
+    h1 = (h1 >> 6)  | (h2 << 20);
+    h2 = (h2 >> 12) | (h3 << 14);
+    h3 = (h3 >> 18) | (h4 << 8);
+
+    uint64_t f;
+    f = (uint64_t)h0 + st->pad[0];             Store32(tag +  0, (uint32_t)f);
+    f = (uint64_t)h1 + st->pad[1] + (f >> 32); Store32(tag +  4, (uint32_t)f);
+    f = (uint64_t)h2 + st->pad[2] + (f >> 32); Store32(tag +  8, (uint32_t)f);
+    f = (uint64_t)h3 + st->pad[3] + (f >> 32); Store32(tag + 12, (uint32_t)f);
+
+    Crypto_Wipe(st, sizeof(*st));
+}
+
+// ------------------------------------------
+// One-shot Poly1305 MAC
+// ------------------------------------------
+void Poly1305_Mac(const uint8_t key[32], const uint8_t *msg, size_t len, uint8_t tag[16]) {
+    Poly1305 st;
+    Poly1305_Init(&st, key);
+    Poly1305_Update(&st, msg, len);
+    Poly1305_Finish(&st, tag);
+}
+
+// ------------------------------------------
+//            ChaCha20-Poly1305 AEAD
+// ------------------------------------------
+
+// ------------------------------------------
+// Tag over aad || pad || ciphertext || pad || lengths (RFC 8439 2.8)
+// ------------------------------------------
+static void Aead_Tag(const uint8_t key[CRYPTO_KEY_SIZE], const uint8_t nonce[CRYPTO_NONCE_SIZE],
+                     const uint8_t *aad, size_t aadLen,
+                     const uint8_t *cipher, size_t len, uint8_t tag[CRYPTO_TAG_SIZE]) {
+    static const uint8_t zeros[16] = { 0 };
+    uint8_t polyKey[64];
+    memset(polyKey, 0, sizeof(polyKey));
+    ChaCha20_Xor(key, 0, nonce, polyKey, polyKey, sizeof(polyKey));
+
+    Poly1305 st;
+    Poly1305_Init(&st, polyKey);
+    Poly1305_Update(&st, aad, aadLen);
+    Poly1305_Update(&st, zeros, (16 - aadLen % 16) % 16);
+    Poly1305_Update(&st, cipher, len);
+    Poly1305_Update(&st, zeros, (16 - len % 16) % 16);
+
+    uint8_t lengths[16];
+    Store64(lengths, (uint64_t)aadLen);
+    Store64(lengths + 8, (uint64_t)len);
+    Poly1305_Update(&st, lengths, sizeof(lengths));
+    Poly1305_Finish(&st, tag);
+    Crypto_Wipe(polyKey, sizeof(polyKey));
+}
+
+// ------------------------------------------
+// Encrypt in place and produce the tag
+// ------------------------------------------
+void Aead_Seal(const uint8_t key[CRYPTO_KEY_SIZE], const uint8_t nonce[CRYPTO_NONCE_SIZE],
+               const uint8_t *aad, size_t aadLen,
+               uint8_t *data, size_t len, uint8_t tag[CRYPTO_TAG_SIZE]) {
+    ChaCha20_Xor(key, 1, nonce, data, data, len);
+    Aead_Tag(key, nonce, aad, aadLen, data, len, tag);
+}
+
+// ------------------------------------------
+// Verify the tag (constant time), then decrypt in place
+// ------------------------------------------
+int Aead_Open(const uint8_t key[CRYPTO_KEY_SIZE], const uint8_t nonce[CRYPTO_NONCE_SIZE],
+              const uint8_t *aad, size_t aadLen,
+              uint8_t *data, size_t len, const uint8_t tag[CRYPTO_TAG_SIZE]) {
+    uint8_t expected[CRYPTO_TAG_SIZE];
+    Aead_Tag(key, nonce, aad, aadLen, data, len, expected);
+
+    uint8_t diff = 0;
+    for (int i = 0; i < CRYPTO_TAG_SIZE; i++) diff |= (uint8_t)(expected[i] ^ tag[i]);
+    if (diff != 0) {
+        return 0;
+    }
+    ChaCha20_Xor(key, 1, nonce, data, data, len);
+    return 1;
+}
+
+// ------------------------------------------
+//                 SHA-256
+// ------------------------------------------
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;     // Bytes absorbed
+    uint8_t  buffer[64];
+    size_t   used;
+} Sha256Ctx;
+
+static const uint32_t s_sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR32(v, n) (((v) >> (n)) | ((v) << (32 - (n))))
+
+static void Sha256_Init(Sha256Ctx *ctx) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+static void Sha256_Compress(uint32_t state[8], const uint8_t block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[4 * i] << 24) | ((uint32_t)block[4 * i + 1] << 16) |
+               ((uint32_t)block[4 * i + 2] << 8) | (uint32_t)block[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) + ((e & f) ^ (~e & g)) + s_sha256K[i] + w[i];
+        uint32_t t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+static void Sha256_Update(Sha256Ctx *ctx, const uint8_t *data, size_t len) {
+    ctx->length += len;
+    while (len > 0) {
+        if (ctx->used == 0 && len >= 64) {
+            Sha256_Compress(ctx->state, data);
+            data += 64;
+            len -= 64;
+            continue;
+        }
+        size_t n = 64 - ctx->used;
+        if (n > len) n = len;
+        memcpy(ctx->buffer + ctx->used, data, n);
+        ctx->used += n;
+        data += n;
+        len -= n;
+        if (ctx->used == 64) {
+            Sha256_Compress(ctx->state, ctx->buffer);
+            ctx->used = 0;
+        }
+    }
+}
+
+static void Sha256_Final(Sha256Ctx *ctx, uint8_t digest[32]) {
+    uint64_t bits = ctx->length * 8;
+    uint8_t pad = 0x80;
+    Sha256_Update(ctx, &pad, 1);
+    pad = 0;
+    while (ctx->used != 56) Sha256_Update(ctx, &pad, 1);
+    uint8_t lengthBytes[8];
+    for (int i = 0; i < 8; i++) lengthBytes[i] = (uint8_t)(bits >> (56 - 8 * i));
+    Sha256_Update(ctx, lengthBytes, 8);
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i]     = (uint8_t)(ctx->state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(ctx->state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(ctx->state[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)ctx->state[i];
+    }
+}
+
+// ------------------------------------------
+// One-shot SHA-256
+// ------------------------------------------
+void Sha256(const uint8_t *data, size_t len, uint8_t digest[32]) {
+    Sha256Ctx ctx;
+    Sha256_Init(&ctx);
+    Sha256_Update(&ctx, data, len);
+    Sha256_Final(&ctx, digest);
+}
+
+// ------------------------------------------
+// HMAC-SHA256 with the keyed inner/outer states prepared once
+// ------------------------------------------
+typedef struct {
+    Sha256Ctx inner;
+    Sha256Ctx outer;
+} HmacSha256;
+
+static void Hmac_Init(HmacSha256 *hmac, const uint8_t *key, size_t keyLen) {
+    uint8_t block[64];
+    memset(block, 0, sizeof(block));
+    if (keyLen > 64) {
+        Sha256(key, keyLen, block);
+    } else {
+        memcpy(block, key, keyLen);
+    }
+
+    for (int i = 0; i < 64; i++) block[i] ^= 0x36;
+    Sha256_Init(&hmac->inner);
+    Sha256_Update(&hmac->inner, block, 64);
+    for (int i = 0; i < 64; i++) block[i] ^= 0x36 ^ 0x5c;
+    Sha256_Init(&hmac->outer);
+    Sha256_Update(&hmac->outer, block, 64);
+    Crypto_Wipe(block, sizeof(block));
+}
+
+static void Hmac_Compute(const HmacSha256 *hmac, const uint8_t *a, size_t aLen,
+                         const uint8_t *b, size_t bLen, uint8_t mac[32]) {
+    Sha256Ctx ctx = hmac->inner;
+    Sha256_Update(&ctx, a, aLen);
+    if (bLen) Sha256_Update(&ctx, b, bLen);
+    Sha256_Final(&ctx, mac);
+
+    ctx = hmac->outer;
+    Sha256_Update(&ctx, mac, 32);
+    Sha256_Final(&ctx, mac);
+}
+
+// ------------------------------------------
+// PBKDF2-HMAC-SHA256 (RFC 8018)
+// ------------------------------------------
+void Pbkdf2_Sha256(const uint8_t *password, size_t passwordLen,
+                   const uint8_t *salt, size_t saltLen,
+                   uint32_t iterations, uint8_t *out, size_t outLen) {
+    HmacSha256 hmac;
+    Hmac_Init(&hmac, password, passwordLen);
+
+    for (uint32_t blockIndex = 1; outLen > 0; blockIndex++) {
+        uint8_t counter[4] = {
+            (uint8_t)(blockIndex >> 24), (uint8_t)(blockIndex >> 16),
+            (uint8_t)(blockIndex >> 8), (uint8_t)blockIndex
+        };
+        uint8_t u[32], t[32];
+        Hmac_Compute(&hmac, salt, saltLen, counter, sizeof(counter), u);
+        memcpy(t, u, sizeof(t));
+        for (uint32_t i = 1; i < iterations; i++) {
+            Hmac_Compute(&hmac, u, sizeof(u), NULL, 0, u);
+            for (int k = 0; k < 32; k++) t[k] ^= u[k];
+        }
+
+        size_t n = outLen < sizeof(t) ? outLen : sizeof(t);
+        memcpy(out, t, n);
+        out += n;
+        outLen -= n;
+        Crypto_Wipe(u, sizeof(u));
+        Crypto_Wipe(t, sizeof(t));
+    }
+    Crypto_Wipe(&hmac, sizeof(hmac));
+}
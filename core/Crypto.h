@@ -0,0 +1,47 @@
+#ifndef CRYPTO_H
+#define CRYPTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Self-contained authenticated encryption for contact files:
+// ChaCha20-Poly1305 (RFC 8439) with a key derived from a passphrase by
+// PBKDF2-HMAC-SHA256. ChaCha20 runs four blocks at a time with SSE2 when
+// the compiler targets it, and falls back to portable C otherwise.
+
+#define CRYPTO_KEY_SIZE   32
+#define CRYPTO_NONCE_SIZE 12
+#define CRYPTO_TAG_SIZE   16
+
+// XOR 'len' bytes of ChaCha20 keystream (starting at block 'counter') into 'out'.
+// 'in' and 'out' may be the same buffer.
+void ChaCha20_Xor(const uint8_t key[CRYPTO_KEY_SIZE], uint32_t counter,
+                  const uint8_t nonce[CRYPTO_NONCE_SIZE],
+                  const uint8_t *in, uint8_t *out, size_t len);
+
+// One-shot Poly1305 MAC
+void Poly1305_Mac(const uint8_t key[32], const uint8_t *msg, size_t len, uint8_t tag[16]);
+
+// AEAD seal: encrypts 'len' bytes in place and writes the tag.
+void Aead_Seal(const uint8_t key[CRYPTO_KEY_SIZE], const uint8_t nonce[CRYPTO_NONCE_SIZE],
+               const uint8_t *aad, size_t aadLen,
+               uint8_t *data, size_t len, uint8_t tag[CRYPTO_TAG_SIZE]);
+
+// AEAD open: verifies the tag, then decrypts 'len' bytes in place.
+// Returns 1 on success, 0 (data untouched) if authentication fails.
+int Aead_Open(const uint8_t key[CRYPTO_KEY_SIZE], const uint8_t nonce[CRYPTO_NONCE_SIZE],
+              const uint8_t *aad, size_t aadLen,
+              uint8_t *data, size_t len, const uint8_t tag[CRYPTO_TAG_SIZE]);
+
+// SHA-256
+void Sha256(const uint8_t *data, size_t len, uint8_t digest[32]);
+
+// PBKDF2-HMAC-SHA256 key derivation
+void Pbkdf2_Sha256(const uint8_t *password, size_t passwordLen,
+                   const uint8_t *salt, size_t saltLen,
+                   uint32_t iterations, uint8_t *out, size_t outLen);
+
+// Zero key material in a way the compiler cannot optimize away
+void Crypto_Wipe(void *p, size_t len);
+
+#endif // CRYPTO_H
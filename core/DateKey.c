@@ -0,0 +1,140 @@
+#include "DateKey.h"
+
+#include <string.h>
+
+// Days from 0000-03-01 to 0000-01-01 are -60; the key of that day is 1
+#define DATE_KEY_MARCH_OFFSET 61
+
+// ------------------------------------------
+// Calendar helpers
+// ------------------------------------------
+static int DateKey_IsLeap(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int DateKey_DaysInMonth(int year, int month) {
+    static const unsigned char s_days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return month == 2 && DateKey_IsLeap(year) ? 29 : s_days[month - 1];
+}
+
+// Value of 'count' decimal digits, -1 if any character is not one
+static int DateKey_Number(const char *p, int count) {
+    int value = 0;
+    for (int i = 0; i < count; i++) {
+        if (p[i] < '0' || p[i] > '9') return -1;
+        value = value * 10 + (p[i] - '0');
+    }
+    return value;
+}
+
+// ------------------------------------------
+// Key of a calendar day
+// Counts in 400-year eras that start on March 1st, so the leap day is the
+// last of its year and the day of the year follows from the month alone.
+// ------------------------------------------
+uint32_t DateKey_FromCivil(int year, int month, int day) {
+    if (year < 0 || year > 9999 || month < 1 || month > 12) return DATE_KEY_NONE;
+    if (day < 1 || day > DateKey_DaysInMonth(year, month)) return DATE_KEY_NONE;
+
+    int y = year - (month <= 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yearOfEra = y - era * 400;
+    int dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return (uint32_t)(era * 146097 + dayOfEra + DATE_KEY_MARCH_OFFSET);
+}
+
+// ------------------------------------------
+// Parse "YYYY-MM-DD"
+// The first eight bytes ("YYYY-MM-") are checked and converted as one
+// 64-bit word: the separators by mask, the digits by their high nibbles,
+// and neighbouring digits paired into two-digit numbers by one multiply
+// and shift, with no branch per character.
+// ------------------------------------------
+uint32_t DateKey_Parse(const char *date) {
+    if (!date || strlen(date) != 10) return DATE_KEY_NONE;
+
+    // Byte i of the text in byte i of the word, whatever the byte order
+    const unsigned char *p = (const unsigned char *)date;
+    uint64_t word = 0;
+    for (int i = 7; i >= 0; i--) {
+        word = (word << 8) | p[i];
+    }
+
+    const uint64_t separators = UINT64_C(0xFF0000FF00000000);
+    const uint64_t nibbles    = UINT64_C(0x00F0F000F0F0F0F0);
+    const uint64_t zeros      = UINT64_C(0x0030300030303030);
+    if ((word & separators) != UINT64_C(0x2D00002D00000000)) return DATE_KEY_NONE;
+    uint64_t digits = word & ~separators;
+    // '0'..'9' have high nibble 3, and keep it after adding 6
+    if ((digits & nibbles) != zeros) return DATE_KEY_NONE;
+    if (((digits + UINT64_C(0x0006060006060606)) & nibbles) != zeros) return DATE_KEY_NONE;
+    digits &= UINT64_C(0x000F0F000F0F0F0F);
+
+    // Byte i becomes 10 * digit i + digit i+1 (at most 99, no carries)
+    uint64_t pairs = digits * 10 + (digits >> 8);
+    int year  = (int)(pairs & 0xFF) * 100 + (int)((pairs >> 16) & 0xFF);
+    int month = (int)((pairs >> 40) & 0xFF);
+
+    unsigned tens = (unsigned)p[8] - '0';
+    unsigned ones = (unsigned)p[9] - '0';
+    if (tens > 9 || ones > 9) return DATE_KEY_NONE;
+    return DateKey_FromCivil(year, month, (int)(tens * 10 + ones));
+}
+
+// ------------------------------------------
+// Text of a key (the inverse of DateKey_FromCivil)
+// ------------------------------------------
+void DateKey_Format(uint32_t key, char text[DATE_KEY_TEXT]) {
+    if (key == DATE_KEY_NONE || key >= DATE_KEY_END) {
+        text[0] = '\0';
+        return;
+    }
+    int days = (int)key - DATE_KEY_MARCH_OFFSET;
+    int era = (days >= 0 ? days : days - 146096) / 146097;
+    int dayOfEra = days - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int shifted = (5 * dayOfYear + 2) / 153;
+    int day = dayOfYear - (153 * shifted + 2) / 5 + 1;
+    int month = shifted < 10 ? shifted + 3 : shifted - 9;
+    int year = yearOfEra + era * 400 + (month <= 2);
+
+    text[0] = (char)('0' + year / 1000);
+    text[1] = (char)('0' + year / 100 % 10);
+    text[2] = (char)('0' + year / 10 % 10);
+    text[3] = (char)('0' + year % 10);
+    text[4] = '-';
+    text[5] = (char)('0' + month / 10);
+    text[6] = (char)('0' + month % 10);
+    text[7] = '-';
+    text[8] = (char)('0' + day / 10);
+    text[9] = (char)('0' + day % 10);
+    text[10] = '\0';
+}
+
+// ------------------------------------------
+// Key range of a year, a month or a day
+// ------------------------------------------
+int DateKey_PrefixRange(const char *prefix, uint32_t *low, uint32_t *high) {
+    size_t len = strlen(prefix);
+    int year = len >= 4 ? DateKey_Number(prefix, 4) : -1;
+    if (year < 0) return 0;
+
+    if (len == 4) {
+        *low = DateKey_FromCivil(year, 1, 1);
+        *high = *low + (DateKey_IsLeap(year) ? 366u : 365u);
+        return 1;
+    }
+    if (len == 7 && prefix[4] == '-') {
+        int month = DateKey_Number(prefix + 5, 2);
+        *low = DateKey_FromCivil(year, month, 1);
+        if (*low == DATE_KEY_NONE) return 0;
+        *high = *low + (uint32_t)DateKey_DaysInMonth(year, month);
+        return 1;
+    }
+    *low = DateKey_Parse(prefix);
+    if (*low == DATE_KEY_NONE) return 0;
+    *high = *low + 1;
+    return 1;
+}
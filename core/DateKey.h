@@ -0,0 +1,32 @@
+#ifndef DATE_KEY_H
+#define DATE_KEY_H
+
+#include <stdint.h>
+
+// Dates ("YYYY-MM-DD") reduced to a 32-bit day number, so that sorting and
+// range tests compare integers instead of text.
+// The key counts days from 0000-01-01, which is 1; consecutive dates have
+// consecutive keys, so "the dates from A to B" is the key range
+// [key(A), key(B) + 1). Only real dates of the proleptic Gregorian
+// calendar in exactly that format have a key.
+// 0 is "no date": empty text, another format or a day that does not
+// exist (2023-02-29).
+
+#define DATE_KEY_NONE  0u
+#define DATE_KEY_TEXT  11   // "YYYY-MM-DD" and its terminator
+#define DATE_KEY_END   3652426u  // One past 9999-12-31
+
+uint32_t DateKey_Parse(const char *date);
+
+// Key of year/month/day, DATE_KEY_NONE when that day does not exist
+uint32_t DateKey_FromCivil(int year, int month, int day);
+
+// "YYYY-MM-DD", or "" for DATE_KEY_NONE
+void DateKey_Format(uint32_t key, char text[DATE_KEY_TEXT]);
+
+// Keys of the dates starting with 'prefix', a year ("2024"), a month
+// ("2024-07") or a full date: those in [*low, *high). Returns 0 when the
+// prefix is none of these.
+int DateKey_PrefixRange(const char *prefix, uint32_t *low, uint32_t *high);
+
+#endif // DATE_KEY_H
@@ -0,0 +1,858 @@
+#include "Dedup.h"
+#include "PhoneKey.h"
+#include "Platform.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Min-hashes per name, and the bands they are cut into
+#define DEDUP_HASHES 8
+#define DEDUP_BANDS  4
+// Block keys per contact: phone, email and the name bands
+#define DEDUP_KEYS   (2 + DEDUP_BANDS)
+// Name bigrams kept, at most (a name of CONTACT_NAME_SIZE never has more)
+#define DEDUP_MAX_SHINGLES (2 * CONTACT_NAME_SIZE)
+#define DEDUP_MAX_WORKERS 64
+
+// Kind of a block, in the top two bits of its key (so no key is 0)
+enum {
+    DEDUP_BLOCK_PHONE = 1,
+    DEDUP_BLOCK_EMAIL = 2,
+    DEDUP_BLOCK_NAME  = 3
+};
+#define DEDUP_KIND_SHIFT 30
+
+// What the scoring needs besides the store, per live contact
+typedef struct {
+    uint64_t email;   // Hash of the trimmed, case-folded email; 0 if none
+    uint64_t date;    // Hash of the date; 0 if none
+    uint64_t name;    // First 8 folded letters of the name, big-endian
+    uint64_t phone;   // PhoneKey of the phone number
+    uint16_t *bigrams;    // Sorted, distinct name bigrams
+    int       bigramCount;
+} DedupProfile;
+
+// One block membership: a block key and a contact (index into the live rows)
+typedef struct {
+    uint32_t key;
+    uint32_t contact;
+} DedupEntry;
+
+typedef struct {
+    uint32_t start;
+    uint32_t length;
+} DedupBlock;
+
+typedef struct {
+    uint32_t a;
+    uint32_t b;
+    float    score;
+} DedupPair;
+
+// Block member, copied next to the others so that scoring a block reads
+// one array instead of the whole store
+typedef struct {
+    DedupProfile profile;
+    uint32_t     contact;
+} DedupNeighbour;
+
+// Sort key of an oversized block's member
+typedef struct {
+    uint64_t order;
+    uint32_t contact;
+} DedupOrder;
+
+// Per-worker buffers for scoring blocks
+typedef struct {
+    DedupNeighbour *members;
+    DedupOrder     *order;
+    size_t          capacity;
+} DedupScratch;
+
+// Pairs found by one worker
+typedef struct {
+    DedupPair *pairs;
+    size_t     count;
+    size_t     capacity;
+    long long  scored;
+    int        failed;
+} DedupOutput;
+
+typedef struct {
+    const ContactStore *store;
+    const int    *rows;         // Live store positions
+    int           live;
+    DedupProfile *profiles;     // By contact
+    DedupEntry   *entries;      // DEDUP_KEYS per contact (key 0: none), then sorted by key
+    uint16_t     *bigrams;      // Room for the name bigrams of every contact
+    DedupBlock   *blocks;
+    int           blockCount;
+    float         threshold;
+    int           phase;        // 0: profiles and keys, 1: blocks
+    DedupOutput   outputs[DEDUP_MAX_WORKERS];
+} DedupJob;
+
+// ------------------------------------------
+// 64-bit finalizer (splitmix64)
+// ------------------------------------------
+static uint64_t Dedup_Mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= UINT64_C(0xBF58476D1CE4E5B9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94D049BB133111EB);
+    x ^= x >> 31;
+    return x;
+}
+
+// ------------------------------------------
+// ASCII case folding, as used by the search
+// ------------------------------------------
+static unsigned char Dedup_Fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+// ------------------------------------------
+// Letters and digits (and any non-ASCII byte) make up name tokens
+// ------------------------------------------
+static int Dedup_IsWordByte(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+// ------------------------------------------
+// Bounds of 's' without surrounding spaces
+// ------------------------------------------
+static size_t Dedup_Trim(const char **s) {
+    const char *p = *s;
+    while (*p == ' ' || *p == '\t') p++;
+    size_t len = strlen(p);
+    while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\t')) len--;
+    *s = p;
+    return len;
+}
+
+// ------------------------------------------
+// Hash of the trimmed, case-folded text; 0 for empty text
+// ------------------------------------------
+static uint64_t Dedup_HashText(const char *s) {
+    size_t len = Dedup_Trim(&s);
+    if (len == 0) return 0;
+    uint64_t h = UINT64_C(0xCBF29CE484222325);
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ Dedup_Fold((unsigned char)s[i])) * UINT64_C(0x100000001B3);
+    }
+    h = Dedup_Mix(h);
+    return h ? h : 1;
+}
+
+// ------------------------------------------
+// Same text once trimmed and case-folded?
+// ------------------------------------------
+static int Dedup_SameText(const char *a, const char *b) {
+    size_t lenA = Dedup_Trim(&a);
+    size_t lenB = Dedup_Trim(&b);
+    if (lenA != lenB) return 0;
+    for (size_t i = 0; i < lenA; i++) {
+        if (Dedup_Fold((unsigned char)a[i]) != Dedup_Fold((unsigned char)b[i])) return 0;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Bigrams of the name tokens of at least 'minLength' bytes, with the
+// token start (1) and end (2) as pseudo-characters. Returns their number.
+// ------------------------------------------
+static int Dedup_CollectShingles(const char *name, size_t minLength, uint16_t *out) {
+    const unsigned char *p = (const unsigned char *)name;
+    int n = 0;
+    while (*p) {
+        while (*p && !Dedup_IsWordByte(*p)) p++;
+        const unsigned char *start = p;
+        while (*p && Dedup_IsWordByte(*p)) p++;
+        size_t len = (size_t)(p - start);
+        if (len == 0 || len < minLength) continue;
+        if (n + (int)len + 1 > DEDUP_MAX_SHINGLES) break;
+
+        unsigned prev = 1;
+        for (size_t i = 0; i < len; i++) {
+            unsigned c = Dedup_Fold(start[i]);
+            out[n++] = (uint16_t)((prev << 8) | c);
+            prev = c;
+        }
+        out[n++] = (uint16_t)((prev << 8) | 2);
+    }
+    return n;
+}
+
+// ------------------------------------------
+// Sorted, distinct name bigrams. Initials are ignored unless the name
+// has nothing else. Returns their number.
+// ------------------------------------------
+static int Dedup_NameShingles(const char *name, uint16_t out[DEDUP_MAX_SHINGLES]) {
+    int n = Dedup_CollectShingles(name, 2, out);
+    if (n == 0) n = Dedup_CollectShingles(name, 1, out);
+
+    for (int i = 1; i < n; i++) {
+        uint16_t v = out[i];
+        int j = i;
+        while (j > 0 && out[j - 1] > v) {
+            out[j] = out[j - 1];
+            j--;
+        }
+        out[j] = v;
+    }
+    int distinct = 0;
+    for (int i = 0; i < n; i++) {
+        if (distinct == 0 || out[distinct - 1] != out[i]) out[distinct++] = out[i];
+    }
+    return distinct;
+}
+
+// ------------------------------------------
+// Jaccard similarity of two names' bigram sets
+// ------------------------------------------
+static float Dedup_NameSimilarity(const DedupProfile *a, const DedupProfile *b) {
+    const uint16_t *x = a->bigrams;
+    const uint16_t *y = b->bigrams;
+    int nx = a->bigramCount;
+    int ny = b->bigramCount;
+    if (nx == 0 || ny == 0) return 0.0f;
+
+    int i = 0, j = 0, common = 0;
+    while (i < nx && j < ny) {
+        if (x[i] == y[j]) {
+            common++;
+            i++;
+            j++;
+        } else if (x[i] < y[j]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    return (float)common / (float)(nx + ny - common);
+}
+
+// ------------------------------------------
+// Block key of a kind from a hash
+// ------------------------------------------
+static uint32_t Dedup_Key(int kind, uint64_t hash) {
+    return ((uint32_t)kind << DEDUP_KIND_SHIFT) | (uint32_t)(hash & ((1u << DEDUP_KIND_SHIFT) - 1));
+}
+
+// ------------------------------------------
+// Profile and block keys of contact 'c'
+// ------------------------------------------
+static void Dedup_Prepare(DedupJob *job, int c) {
+    const ContactStore *store = job->store;
+    int row = job->rows[c];
+    DedupProfile *profile = &job->profiles[c];
+    DedupEntry *keys = &job->entries[(size_t)c * DEDUP_KEYS];
+    const char *name = Store_GetName(store, row);
+
+    profile->email = Dedup_HashText(Store_GetEmail(store, row));
+    profile->date = Dedup_HashText(Store_GetDate(store, row));
+    profile->name = 0;
+    int letters = 0;
+    for (const unsigned char *p = (const unsigned char *)name; *p && letters < 8; p++) {
+        if (!Dedup_IsWordByte(*p)) continue;
+        profile->name |= (uint64_t)Dedup_Fold(*p) << (56 - 8 * letters);
+        letters++;
+    }
+
+    for (int k = 0; k < DEDUP_KEYS; k++) {
+        keys[k].key = 0;
+        keys[k].contact = (uint32_t)c;
+    }
+    profile->phone = Store_GetPhoneKey(store, row);
+    if (profile->phone != PHONE_KEY_NONE) keys[0].key = Dedup_Key(DEDUP_BLOCK_PHONE, Dedup_Mix(profile->phone));
+    if (profile->email != 0) keys[1].key = Dedup_Key(DEDUP_BLOCK_EMAIL, profile->email);
+
+    // MinHash over the name bigrams, banded for LSH
+    uint16_t shingles[DEDUP_MAX_SHINGLES];
+    int n = Dedup_NameShingles(name, shingles);
+    memcpy(profile->bigrams, shingles, (size_t)n * sizeof(uint16_t));
+    profile->bigramCount = n;
+    if (n == 0) return;
+    uint32_t mins[DEDUP_HASHES];
+    for (int h = 0; h < DEDUP_HASHES; h++) {
+        mins[h] = UINT32_MAX;
+    }
+    for (int s = 0; s < n; s++) {
+        for (int h = 0; h < DEDUP_HASHES; h++) {
+            uint32_t v = (uint32_t)(Dedup_Mix(shingles[s] + (uint64_t)(h + 1) * UINT64_C(0x9E3779B97F4A7C15)) >> 32);
+            if (v < mins[h]) mins[h] = v;
+        }
+    }
+    const int rowsPerBand = DEDUP_HASHES / DEDUP_BANDS;
+    for (int b = 0; b < DEDUP_BANDS; b++) {
+        uint64_t band = (uint64_t)b;
+        for (int r = 0; r < rowsPerBand; r++) {
+            band = Dedup_Mix(band ^ ((uint64_t)mins[b * rowsPerBand + r] << 8));
+        }
+        keys[2 + b].key = Dedup_Key(DEDUP_BLOCK_NAME, band);
+    }
+}
+
+// ------------------------------------------
+// Score a candidate pair and keep it if it reaches the threshold
+// ------------------------------------------
+static void Dedup_Consider(const DedupJob *job, DedupOutput *out, const DedupNeighbour *a, const DedupNeighbour *b) {
+    const ContactStore *store = job->store;
+    const DedupProfile *pa = &a->profile;
+    const DedupProfile *pb = &b->profile;
+    out->scored++;
+
+    // Equal hashes first; the store is only read for pairs that can make it
+    float bound = 0.5f;
+    if (pa->phone != PHONE_KEY_NONE && pa->phone == pb->phone) bound += 0.3f;
+    if (pa->email != 0 && pa->email == pb->email) bound += 0.3f;
+    if (pa->date != 0 && pa->date == pb->date) bound += 0.1f;
+    if (bound < job->threshold) return;
+
+    int ra = job->rows[a->contact];
+    int rb = job->rows[b->contact];
+    float score = 0.0f;
+    if (pa->phone != PHONE_KEY_NONE && pa->phone == pb->phone) score += 0.3f;
+    if (pa->email != 0 && pa->email == pb->email &&
+        Dedup_SameText(Store_GetEmail(store, ra), Store_GetEmail(store, rb))) {
+        score += 0.3f;
+    }
+    if (pa->date != 0 && pa->date == pb->date &&
+        Dedup_SameText(Store_GetDate(store, ra), Store_GetDate(store, rb))) {
+        score += 0.1f;
+    }
+    if (score + 0.5f < job->threshold) return;
+    score += 0.5f * Dedup_NameSimilarity(pa, pb);
+    if (score > 1.0f) score = 1.0f;
+    if (score < job->threshold) return;
+
+    if (out->count == out->capacity) {
+        size_t capacity = out->capacity ? out->capacity * 2 : 1024;
+        DedupPair *pairs = (DedupPair*)realloc(out->pairs, capacity * sizeof(DedupPair));
+        if (!pairs) {
+            out->failed = 1;
+            return;
+        }
+        out->pairs = pairs;
+        out->capacity = capacity;
+    }
+    DedupPair *pair = &out->pairs[out->count++];
+    pair->a = a->contact < b->contact ? a->contact : b->contact;
+    pair->b = a->contact < b->contact ? b->contact : a->contact;
+    pair->score = score;
+}
+
+// ------------------------------------------
+// qsort comparator for neighbourhood order
+// ------------------------------------------
+static int Dedup_CompareOrder(const void *x, const void *y) {
+    const DedupOrder *a = (const DedupOrder *)x;
+    const DedupOrder *b = (const DedupOrder *)y;
+    if (a->order != b->order) return a->order < b->order ? -1 : 1;
+    return (a->contact > b->contact) - (a->contact < b->contact);
+}
+
+// ------------------------------------------
+// Score the pairs of one block: all of them in a small block, the
+// DEDUP_WINDOW next neighbours in a large one (by date for name blocks,
+// by name for phone and email blocks)
+// ------------------------------------------
+static void Dedup_ScoreBlock(const DedupJob *job, DedupOutput *out, const DedupBlock *block, DedupScratch *scratch) {
+    const DedupEntry *entries = &job->entries[block->start];
+    uint32_t n = block->length;
+    if (n > scratch->capacity) {
+        DedupNeighbour *members = (DedupNeighbour*)realloc(scratch->members, n * sizeof(DedupNeighbour));
+        if (members) scratch->members = members;
+        DedupOrder *order = (DedupOrder*)realloc(scratch->order, n * sizeof(DedupOrder));
+        if (order) scratch->order = order;
+        if (!members || !order) {
+            out->failed = 1;
+            return;
+        }
+        scratch->capacity = n;
+    }
+    DedupNeighbour *members = scratch->members;
+
+    if (n <= DEDUP_MAX_BLOCK) {
+        for (uint32_t i = 0; i < n; i++) {
+            members[i].profile = job->profiles[entries[i].contact];
+            members[i].contact = entries[i].contact;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            for (uint32_t j = i + 1; j < n; j++) {
+                Dedup_Consider(job, out, &members[i], &members[j]);
+            }
+        }
+        return;
+    }
+
+    DedupOrder *order = scratch->order;
+    int byDate = (entries[0].key >> DEDUP_KIND_SHIFT) == DEDUP_BLOCK_NAME;
+    for (uint32_t i = 0; i < n; i++) {
+        const DedupProfile *profile = &job->profiles[entries[i].contact];
+        order[i].order = byDate ? profile->date : profile->name;
+        order[i].contact = entries[i].contact;
+    }
+    qsort(order, n, sizeof(DedupOrder), Dedup_CompareOrder);
+    for (uint32_t i = 0; i < n; i++) {
+        members[i].profile = job->profiles[order[i].contact];
+        members[i].contact = order[i].contact;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t last = i + DEDUP_WINDOW < n - 1 ? i + DEDUP_WINDOW : n - 1;
+        for (uint32_t j = i + 1; j <= last; j++) {
+            Dedup_Consider(job, out, &members[i], &members[j]);
+        }
+    }
+}
+
+// ------------------------------------------
+// Worker: profiles of a contiguous share of the contacts, or every
+// workerCount-th block
+// ------------------------------------------
+static void Dedup_Worker(void *context, int worker, int workerCount) {
+    DedupJob *job = (DedupJob*)context;
+    if (job->phase == 0) {
+        int begin = (int)((long long)job->live * worker / workerCount);
+        int end = (int)((long long)job->live * (worker + 1) / workerCount);
+        for (int c = begin; c < end; c++) {
+            Dedup_Prepare(job, c);
+        }
+        return;
+    }
+
+    DedupOutput *out = &job->outputs[worker];
+    DedupScratch scratch;
+    memset(&scratch, 0, sizeof(scratch));
+    for (int b = worker; b < job->blockCount && !out->failed; b += workerCount) {
+        Dedup_ScoreBlock(job, out, &job->blocks[b], &scratch);
+    }
+    free(scratch.members);
+    free(scratch.order);
+}
+
+// ------------------------------------------
+// Drop the empty keys and sort the rest by key (two stable 16-bit
+// counting passes), so every block is one run. Returns the entry count,
+// or -1 when out of memory.
+// ------------------------------------------
+static long long Dedup_SortEntries(DedupJob *job) {
+    size_t total = (size_t)job->live * DEDUP_KEYS;
+    size_t used = 0;
+    for (size_t i = 0; i < total; i++) {
+        if (job->entries[i].key != 0) job->entries[used++] = job->entries[i];
+    }
+
+    DedupEntry *aux = (DedupEntry*)malloc((used > 0 ? used : 1) * sizeof(DedupEntry));
+    size_t *counts = (size_t*)malloc(65536 * sizeof(size_t));
+    if (!aux || !counts) {
+        free(aux);
+        free(counts);
+        return -1;
+    }
+    DedupEntry *from = job->entries;
+    DedupEntry *to = aux;
+    for (int shift = 0; shift < 32; shift += 16) {
+        memset(counts, 0, 65536 * sizeof(size_t));
+        for (size_t i = 0; i < used; i++) {
+            counts[(from[i].key >> shift) & 0xFFFF]++;
+        }
+        size_t sum = 0;
+        for (size_t d = 0; d < 65536; d++) {
+            size_t c = counts[d];
+            counts[d] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < used; i++) {
+            to[counts[(from[i].key >> shift) & 0xFFFF]++] = from[i];
+        }
+        DedupEntry *swap = from;
+        from = to;
+        to = swap;
+    }
+    // Two passes end back in job->entries
+    free(aux);
+    free(counts);
+    return (long long)used;
+}
+
+// ------------------------------------------
+// Union-find root, with path halving
+// ------------------------------------------
+static uint32_t Dedup_Root(uint32_t *parent, uint32_t x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+// ------------------------------------------
+// qsort comparator: best pairs first, then in contact order, so the
+// groups do not depend on the number of workers
+// ------------------------------------------
+static int Dedup_ComparePairs(const void *x, const void *y) {
+    const DedupPair *a = (const DedupPair *)x;
+    const DedupPair *b = (const DedupPair *)y;
+    if (a->score != b->score) return a->score > b->score ? -1 : 1;
+    if (a->a != b->a) return a->a < b->a ? -1 : 1;
+    return (a->b > b->b) - (a->b < b->b);
+}
+
+// Groups being ranked
+typedef struct {
+    float score;
+    int   size;
+    int   first;   // Offset of the group in the unranked members
+} DedupRank;
+
+// ------------------------------------------
+// qsort comparator: best score, then larger, then earlier groups first
+// ------------------------------------------
+static int Dedup_CompareRanks(const void *x, const void *y) {
+    const DedupRank *a = (const DedupRank *)x;
+    const DedupRank *b = (const DedupRank *)y;
+    if (a->score != b->score) return a->score > b->score ? -1 : 1;
+    if (a->size != b->size) return a->size > b->size ? -1 : 1;
+    return (a->first > b->first) - (a->first < b->first);
+}
+
+// ------------------------------------------
+// Filled fields of a contact, to pick a group's survivor
+// ------------------------------------------
+static int Dedup_Filled(const ContactStore *store, int row) {
+    return (Store_GetPhone(store, row)[0] != '\0') + (Store_GetEmail(store, row)[0] != '\0') +
+           (Store_GetDate(store, row)[0] != '\0');
+}
+
+// ------------------------------------------
+// Join the pairs into groups, pick survivors and rank the groups
+// Returns 0 when out of memory.
+// ------------------------------------------
+static int Dedup_Group(DedupJob *job, int workerCount, DedupResult *result) {
+    uint32_t live = (uint32_t)job->live;
+    size_t pairCount = 0;
+    for (int w = 0; w < workerCount; w++) {
+        pairCount += job->outputs[w].count;
+    }
+    uint32_t *parent = (uint32_t*)malloc((live > 0 ? live : 1) * sizeof(uint32_t));
+    int *group = (int*)malloc((live > 0 ? live : 1) * sizeof(int));
+    DedupPair *pairs = (DedupPair*)malloc((pairCount > 0 ? pairCount : 1) * sizeof(DedupPair));
+    if (!parent || !group || !pairs) {
+        free(parent);
+        free(group);
+        free(pairs);
+        return 0;
+    }
+    pairCount = 0;
+    for (int w = 0; w < workerCount; w++) {
+        memcpy(pairs + pairCount, job->outputs[w].pairs, job->outputs[w].count * sizeof(DedupPair));
+        pairCount += job->outputs[w].count;
+    }
+    qsort(pairs, pairCount, sizeof(DedupPair), Dedup_ComparePairs);
+
+    // Best pairs first; group[root] is the group size
+    for (uint32_t c = 0; c < live; c++) {
+        parent[c] = c;
+        group[c] = 1;
+    }
+    for (size_t i = 0; i < pairCount; i++) {
+        uint32_t ra = Dedup_Root(parent, pairs[i].a);
+        uint32_t rb = Dedup_Root(parent, pairs[i].b);
+        if (ra == rb || group[ra] + group[rb] > DEDUP_MAX_GROUP) continue;
+        uint32_t root = ra < rb ? ra : rb;
+        uint32_t child = ra < rb ? rb : ra;
+        parent[child] = root;
+        group[root] += group[child];
+    }
+
+    int groupCount = 0;
+    int memberCount = 0;
+    for (uint32_t c = 0; c < live; c++) {
+        if (parent[c] == c && group[c] >= 2) {
+            memberCount += group[c];
+            groupCount++;
+        }
+    }
+
+    int *start = (int*)malloc((size_t)(groupCount + 1) * sizeof(int));
+    int *members = (int*)malloc((size_t)(memberCount > 0 ? memberCount : 1) * sizeof(int));
+    DedupRank *ranks = (DedupRank*)malloc((size_t)(groupCount > 0 ? groupCount : 1) * sizeof(DedupRank));
+    result->members = (int*)malloc((size_t)(memberCount > 0 ? memberCount : 1) * sizeof(int));
+    result->groupStart = (int*)malloc((size_t)(groupCount + 1) * sizeof(int));
+    result->groupScore = (float*)malloc((size_t)(groupCount > 0 ? groupCount : 1) * sizeof(float));
+    int ok = start && members && ranks && result->members && result->groupStart && result->groupScore;
+    if (ok) {
+        // group[root] becomes the group number (-1: no group)
+        int g = 0, offset = 0;
+        for (uint32_t c = 0; c < live; c++) {
+            if (parent[c] != c) continue;
+            if (group[c] >= 2) {
+                ranks[g].size = group[c];
+                ranks[g].first = offset;
+                ranks[g].score = 0.0f;
+                start[g] = offset;
+                offset += group[c];
+                group[c] = g++;
+            } else {
+                group[c] = -1;
+            }
+        }
+        // Members in store order
+        for (uint32_t c = 0; c < live; c++) {
+            int gc = group[Dedup_Root(parent, c)];
+            if (gc >= 0) members[start[gc]++] = job->rows[c];
+        }
+        for (size_t i = 0; i < pairCount; i++) {
+            uint32_t root = Dedup_Root(parent, pairs[i].a);
+            if (root != Dedup_Root(parent, pairs[i].b)) continue;
+            DedupRank *rank = &ranks[group[root]];
+            if (pairs[i].score > rank->score) rank->score = pairs[i].score;
+        }
+
+        qsort(ranks, (size_t)groupCount, sizeof(DedupRank), Dedup_CompareRanks);
+        int at = 0;
+        for (g = 0; g < groupCount; g++) {
+            const int *from = members + ranks[g].first;
+            int *to = result->members + at;
+            int best = 0;
+            for (int m = 1; m < ranks[g].size; m++) {
+                if (Dedup_Filled(job->store, from[m]) > Dedup_Filled(job->store, from[best])) best = m;
+            }
+            // Survivor first, the others in store order
+            to[0] = from[best];
+            for (int m = 0, k = 1; m < ranks[g].size; m++) {
+                if (m != best) to[k++] = from[m];
+            }
+            result->groupStart[g] = at;
+            result->groupScore[g] = ranks[g].score;
+            at += ranks[g].size;
+        }
+        result->groupStart[groupCount] = at;
+        result->groupCount = groupCount;
+    }
+    free(parent);
+    free(group);
+    free(pairs);
+    free(start);
+    free(members);
+    free(ranks);
+    return ok;
+}
+
+// ------------------------------------------
+// Find groups of likely duplicates
+// ------------------------------------------
+int Dedup_Find(const ContactStore *store, double threshold, DedupResult *result) {
+    memset(result, 0, sizeof(*result));
+    double t0 = Platform_NowMs();
+
+    DedupJob job;
+    memset(&job, 0, sizeof(job));
+    job.store = store;
+    job.threshold = (float)threshold;
+    int live = Store_LiveCount(store);
+    int *rows = (int*)malloc((size_t)(live > 0 ? live : 1) * sizeof(int));
+    job.profiles = (DedupProfile*)malloc((size_t)(live > 0 ? live : 1) * sizeof(DedupProfile));
+    job.entries = (DedupEntry*)malloc((size_t)(live > 0 ? live : 1) * DEDUP_KEYS * sizeof(DedupEntry));
+    int ok = rows && job.profiles && job.entries;
+    size_t room = 0;
+    if (ok) {
+        // A token of n bytes has n + 1 bigrams, so a name has at most
+        // twice its length
+        for (int i = 0; i < store->count; i++) {
+            if (Store_IsDeleted(store, i)) continue;
+            size_t length = 2 * strlen(Store_GetName(store, i));
+            job.profiles[job.live].bigramCount = (int)(length < DEDUP_MAX_SHINGLES ? length : DEDUP_MAX_SHINGLES);
+            room += (size_t)job.profiles[job.live].bigramCount;
+            rows[job.live++] = i;
+        }
+        job.rows = rows;
+        job.bigrams = (uint16_t*)malloc((room > 0 ? room : 1) * sizeof(uint16_t));
+        ok = job.bigrams != NULL;
+    }
+    size_t at = 0;
+    for (int c = 0; ok && c < job.live; c++) {
+        job.profiles[c].bigrams = job.bigrams + at;
+        at += (size_t)job.profiles[c].bigramCount;
+    }
+
+    int workerCount = Platform_CpuCount();
+    if (workerCount > DEDUP_MAX_WORKERS) workerCount = DEDUP_MAX_WORKERS;
+    if (ok) {
+        job.phase = 0;
+        Platform_RunParallel(workerCount, Dedup_Worker, &job);
+    }
+
+    long long used = ok ? Dedup_SortEntries(&job) : -1;
+    ok = used >= 0;
+    if (ok) {
+        // Runs of two or more equal keys are the blocks
+        int blockCapacity = 0;
+        for (long long i = 0; i < used; ) {
+            long long j = i + 1;
+            while (j < used && job.entries[j].key == job.entries[i].key) j++;
+            if (j - i >= 2) blockCapacity++;
+            i = j;
+        }
+        job.blocks = (DedupBlock*)malloc((size_t)(blockCapacity > 0 ? blockCapacity : 1) * sizeof(DedupBlock));
+        ok = job.blocks != NULL;
+        for (long long i = 0; ok && i < used; ) {
+            long long j = i + 1;
+            while (j < used && job.entries[j].key == job.entries[i].key) j++;
+            if (j - i >= 2) {
+                job.blocks[job.blockCount].start = (uint32_t)i;
+                job.blocks[job.blockCount].length = (uint32_t)(j - i);
+                job.blockCount++;
+            }
+            i = j;
+        }
+    }
+    if (ok) {
+        job.phase = 1;
+        Platform_RunParallel(workerCount, Dedup_Worker, &job);
+        for (int w = 0; w < workerCount; w++) {
+            if (job.outputs[w].failed) ok = 0;
+            result->pairs += job.outputs[w].scored;
+        }
+        result->blocks = job.blockCount;
+    }
+    if (ok) ok = Dedup_Group(&job, workerCount, result);
+
+    for (int w = 0; w < workerCount; w++) {
+        free(job.outputs[w].pairs);
+    }
+    free(job.blocks);
+    free(job.entries);
+    free(job.bigrams);
+    free(job.profiles);
+    free(rows);
+    if (!ok) Dedup_FreeResult(result);
+    result->ms = Platform_NowMs() - t0;
+    return ok;
+}
+
+// ------------------------------------------
+// Release the groups
+// ------------------------------------------
+void Dedup_FreeResult(DedupResult *result) {
+    free(result->members);
+    free(result->groupStart);
+    free(result->groupScore);
+    memset(result, 0, sizeof(*result));
+}
+
+// Fields a merge fills in from the other members of a group
+static const ContactField s_mergedFields[DEDUP_MERGED_FIELDS] = {
+    CONTACT_FIELD_PHONE, CONTACT_FIELD_EMAIL, CONTACT_FIELD_DATE
+};
+
+// ------------------------------------------
+// Text of one field of a contact
+// ------------------------------------------
+static const char *Dedup_Value(const ContactStore *store, int row, ContactField field) {
+    switch (field) {
+        case CONTACT_FIELD_PHONE: return Store_GetPhone(store, row);
+        case CONTACT_FIELD_EMAIL: return Store_GetEmail(store, row);
+        case CONTACT_FIELD_DATE:  return Store_GetDate(store, row);
+        default:                  return Store_GetName(store, row);
+    }
+}
+
+// ------------------------------------------
+// Do two contacts hold the same value of a field, as far as a merge is
+// concerned? Phones compare as numbers, the rest trimmed and case-folded.
+// ------------------------------------------
+static int Dedup_SameValue(const ContactStore *store, ContactField field, int a, int b) {
+    if (field == CONTACT_FIELD_PHONE) {
+        uint64_t key = Store_GetPhoneKey(store, a);
+        if (key != PHONE_KEY_NONE && key == Store_GetPhoneKey(store, b)) return 1;
+    }
+    return Dedup_SameText(Dedup_Value(store, a, field), Dedup_Value(store, b, field));
+}
+
+// ------------------------------------------
+// Where each merged field of group 'g' comes from: the survivor, or for
+// an empty field the first other member that has one (-1: none). The
+// values of the other members that differ from it are left behind; they
+// are counted in *count and stored in 'dropped' while there is room.
+// ------------------------------------------
+static void Dedup_Sources(const ContactStore *store, const DedupResult *result, int g,
+                          int sources[DEDUP_MERGED_FIELDS], DedupDropped *dropped, int capacity, int *count) {
+    const int *members = result->members + result->groupStart[g];
+    int size = result->groupStart[g + 1] - result->groupStart[g];
+    for (int f = 0; f < DEDUP_MERGED_FIELDS; f++) {
+        sources[f] = Dedup_Value(store, members[0], s_mergedFields[f])[0] != '\0' ? members[0] : -1;
+    }
+    for (int m = 1; m < size; m++) {
+        if (Store_IsDeleted(store, members[m])) continue;
+        for (int f = 0; f < DEDUP_MERGED_FIELDS; f++) {
+            const char *value = Dedup_Value(store, members[m], s_mergedFields[f]);
+            if (value[0] == '\0') continue;
+            if (sources[f] < 0) {
+                sources[f] = members[m];
+            } else if (!Dedup_SameValue(store, s_mergedFields[f], sources[f], members[m])) {
+                if (*count < capacity) {
+                    DedupDropped *out = &dropped[*count];
+                    out->group = g;
+                    out->row = members[m];
+                    out->field = s_mergedFields[f];
+                    strncpy(out->value, value, sizeof(out->value) - 1);
+                    out->value[sizeof(out->value) - 1] = '\0';
+                }
+                (*count)++;
+            }
+        }
+    }
+}
+
+// ------------------------------------------
+// Values a merge of the groups would leave behind
+// ------------------------------------------
+int Dedup_Dropped(const ContactStore *store, const DedupResult *result, const int *groups, int count,
+                  DedupDropped *dropped, int capacity) {
+    int total = groups ? count : result->groupCount;
+    int found = 0;
+    for (int i = 0; i < total; i++) {
+        int g = groups ? groups[i] : i;
+        if (g < 0 || g >= result->groupCount) continue;
+        if (Store_IsDeleted(store, result->members[result->groupStart[g]])) continue;
+        int sources[DEDUP_MERGED_FIELDS];
+        Dedup_Sources(store, result, g, sources, dropped, capacity, &found);
+    }
+    return found;
+}
+
+// ------------------------------------------
+// Apply merge groups in one batch
+// ------------------------------------------
+int Dedup_Merge(ContactStore *store, const DedupResult *result, const int *groups, int count) {
+    int total = groups ? count : result->groupCount;
+    int deleted = 0;
+    for (int i = 0; i < total; i++) {
+        int g = groups ? groups[i] : i;
+        if (g < 0 || g >= result->groupCount) continue;
+        const int *members = result->members + result->groupStart[g];
+        int size = result->groupStart[g + 1] - result->groupStart[g];
+        int keep = members[0];
+        if (Store_IsDeleted(store, keep)) continue;
+
+        // Copies: the update may move the arena
+        char values[DEDUP_MERGED_FIELDS][CONTACT_EMAIL_SIZE];
+        char name[CONTACT_NAME_SIZE];
+        int sources[DEDUP_MERGED_FIELDS];
+        int dropped = 0, changed = 0;
+        Dedup_Sources(store, result, g, sources, NULL, 0, &dropped);
+        strcpy(name, Store_GetName(store, keep));
+        for (int f = 0; f < DEDUP_MERGED_FIELDS; f++) {
+            strcpy(values[f], sources[f] >= 0 ? Dedup_Value(store, sources[f], s_mergedFields[f]) : "");
+            changed |= sources[f] >= 0 && sources[f] != keep;
+        }
+        if (changed && !Store_Update(store, keep, name, values[0], values[1], values[2])) continue;
+        for (int m = 1; m < size; m++) {
+            if (Store_IsDeleted(store, members[m])) continue;
+            if (Store_Delete(store, members[m])) deleted++;
+        }
+    }
+    return deleted;
+}
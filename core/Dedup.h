@@ -0,0 +1,77 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include "ContactStore.h"
+
+// Duplicate detection without comparing every pair of contacts.
+// Contacts are first grouped into blocks that share something:
+//   - the same phone number (PhoneKey, so any spelling),
+//   - the same email address, ignoring case and surrounding spaces,
+//   - a MinHash/LSH band of their name: each name token (initials
+//     dropped, case folded) is cut into character bigrams, 8 min-hashes
+//     are taken over them and every pair of min-hashes is one band, so
+//     name variants ("Jon Smith", "John Smith", "Smith, John") tend to
+//     share at least one band.
+// Only contacts within a block are scored, on all cores, one block per
+// worker at a time. Blocks larger than DEDUP_MAX_BLOCK (common names,
+// switchboard numbers) are sorted by another field and each contact is
+// scored against its DEDUP_WINDOW next neighbours only.
+//
+// Score of a pair, at most 1:
+//   0.5 x Jaccard similarity of the name bigrams
+//   + 0.3 if the phone numbers are the same
+//   + 0.3 if the emails are the same
+//   + 0.1 if the dates are the same
+// Pairs at or above the threshold are joined into groups, best pairs
+// first. A group stops growing at DEDUP_MAX_GROUP contacts, so a chain of
+// look-alikes (a family sharing one email) cannot snowball into one group.
+
+#define DEDUP_DEFAULT_THRESHOLD 0.6
+#define DEDUP_MAX_BLOCK         128
+#define DEDUP_WINDOW            16
+#define DEDUP_MAX_GROUP         16
+
+typedef struct {
+    int   *members;     // Store positions of every group, back to back;
+                        // the suggested survivor comes first in each group
+    int   *groupStart;  // groupCount + 1 offsets into 'members'
+    float *groupScore;  // Best pair score in each group
+    int    groupCount;  // Ranked: best score first, then larger groups
+    int    blocks;      // Blocks of two or more contacts
+    long long pairs;    // Pairs scored
+    double ms;          // Wall time of Dedup_Find
+} DedupResult;
+
+// Find the groups of likely duplicates among the live contacts.
+// 'result' is always initialized; free it with Dedup_FreeResult.
+// Returns 0 when out of memory (no groups).
+int  Dedup_Find(const ContactStore *store, double threshold, DedupResult *result);
+void Dedup_FreeResult(DedupResult *result);
+
+// Merge groups of 'result' in one batch: 'groups' lists the group numbers
+// to apply ('count' of them), or NULL for every group. The survivor of a
+// group takes the phone, email and date it lacks from the others (first
+// one found) and the others are deleted. The store must not have changed
+// since Dedup_Find. Indexes over the store need a Build afterwards.
+// Returns the number of contacts deleted; a group whose survivor cannot
+// be updated (out of memory) is left alone.
+int  Dedup_Merge(ContactStore *store, const DedupResult *result, const int *groups, int count);
+
+// A value a merge leaves behind: a contact merged away had a phone, email
+// or date that differs from the one its survivor keeps (phones compare as
+// numbers, emails ignoring case)
+#define DEDUP_MERGED_FIELDS 3
+typedef struct {
+    int          group;
+    int          row;       // Store position of the contact merged away
+    ContactField field;
+    char         value[CONTACT_EMAIL_SIZE];
+} DedupDropped;
+
+// List what Dedup_Merge of the same groups would leave behind, before
+// merging them, in group order. Returns how many values there are; the
+// first 'capacity' are stored ('dropped' may be NULL to count them).
+int  Dedup_Dropped(const ContactStore *store, const DedupResult *result, const int *groups, int count,
+                   DedupDropped *dropped, int capacity);
+
+#endif // DEDUP_H
@@ -0,0 +1,337 @@
+#include "Export.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EXPORT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Space reserved per record: the worst case of every format with every
+// field at its maximum length and every byte escaped
+#define EXPORT_RECORD_MAX   4096
+// Longest vCard line before it is folded, in octets
+#define VCARD_LINE_OCTETS   75
+
+// Bytes a format has to escape or quote
+typedef struct {
+    char special[4];   // Unused slots are '\0', which never occurs inside a field
+    int  controls;     // Also every byte below 0x20
+} ExportEscapes;
+
+static const ExportEscapes s_csvEscapes   = { { ',', '"', '\n', '\r' }, 0 };
+static const ExportEscapes s_vcardEscapes = { { ',', ';', '\\', '\0' }, 1 };
+static const ExportEscapes s_jsonEscapes  = { { '"', '\\', '\0', '\0' }, 1 };
+
+static const char CSV_HEADER[] = "Name,Phone,Email,Date\r\n";
+
+// ------------------------------------------
+// Length of the prefix of 's' that needs no escaping
+// ------------------------------------------
+static size_t Export_CleanLength(const char *s, size_t len, const ExportEscapes *esc) {
+    size_t i = 0;
+#ifdef EXPORT_SSE2
+    const __m128i s0 = _mm_set1_epi8(esc->special[0]);
+    const __m128i s1 = _mm_set1_epi8(esc->special[1]);
+    const __m128i s2 = _mm_set1_epi8(esc->special[2]);
+    const __m128i s3 = _mm_set1_epi8(esc->special[3]);
+    const __m128i lastControl = _mm_set1_epi8(esc->controls ? 0x1F : 0);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, s0), _mm_cmpeq_epi8(v, s1)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, s2), _mm_cmpeq_epi8(v, s3)));
+        // Unsigned v <= lastControl; with controls off that only matches '\0'
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_min_epu8(v, lastControl), v));
+        if (_mm_movemask_epi8(hit) != 0) break;
+    }
+#endif
+    for (; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if ((esc->controls && c < 0x20) || c == (unsigned char)esc->special[0] ||
+            c == (unsigned char)esc->special[1] || c == (unsigned char)esc->special[2] ||
+            c == (unsigned char)esc->special[3]) {
+            break;
+        }
+    }
+    return i;
+}
+
+// ------------------------------------------
+// Append 'value' in decimal
+// ------------------------------------------
+static char *Export_Decimal(char *p, uint64_t value) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (n > 0) *p++ = digits[--n];
+    return p;
+}
+
+// ------------------------------------------
+// Append a literal
+// ------------------------------------------
+static char *Export_Text(char *p, const char *text, size_t len) {
+    memcpy(p, text, len);
+    return p + len;
+}
+
+// ------------------------------------------
+// CSV field, quoted only when it holds a separator, quote or line break
+// ------------------------------------------
+static char *Export_CsvField(char *p, const char *s) {
+    size_t len = strlen(s);
+    size_t clean = Export_CleanLength(s, len, &s_csvEscapes);
+    if (clean == len) return Export_Text(p, s, len);
+
+    *p++ = '"';
+    p = Export_Text(p, s, clean);
+    for (size_t i = clean; i < len; i++) {
+        if (s[i] == '"') *p++ = '"';
+        *p++ = s[i];
+    }
+    *p++ = '"';
+    return p;
+}
+
+// ------------------------------------------
+// JSON string literal
+// ------------------------------------------
+static char *Export_JsonString(char *p, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    size_t len = strlen(s);
+    *p++ = '"';
+    size_t i = 0;
+    for (;;) {
+        size_t clean = Export_CleanLength(s + i, len - i, &s_jsonEscapes);
+        p = Export_Text(p, s + i, clean);
+        i += clean;
+        if (i == len) break;
+
+        unsigned char c = (unsigned char)s[i++];
+        *p++ = '\\';
+        switch (c) {
+            case '"':  *p++ = '"';  break;
+            case '\\': *p++ = '\\'; break;
+            case '\n': *p++ = 'n';  break;
+            case '\r': *p++ = 'r';  break;
+            case '\t': *p++ = 't';  break;
+            default:
+                p = Export_Text(p, "u00", 3);
+                *p++ = hex[c >> 4];
+                *p++ = hex[c & 15];
+                break;
+        }
+    }
+    *p++ = '"';
+    return p;
+}
+
+// ------------------------------------------
+// vCard 3.0 text value: ',', ';', '\' and line breaks escaped
+// ------------------------------------------
+static char *Export_VCardText(char *p, const char *s, size_t len) {
+    size_t i = 0;
+    for (;;) {
+        size_t clean = Export_CleanLength(s + i, len - i, &s_vcardEscapes);
+        p = Export_Text(p, s + i, clean);
+        i += clean;
+        if (i == len) break;
+
+        char c = s[i++];
+        if (c == '\n') {
+            p = Export_Text(p, "\\n", 2);
+        } else if (c == ',' || c == ';' || c == '\\') {
+            *p++ = '\\';
+            *p++ = c;
+        } else if (c != '\r') {
+            *p++ = c;
+        }
+    }
+    return p;
+}
+
+// ------------------------------------------
+// End the vCard line that starts at 'start', folding it every 75 octets
+// (never inside a UTF-8 sequence)
+// ------------------------------------------
+static char *Export_VCardEndLine(char *start, char *p) {
+    size_t len = (size_t)(p - start);
+    if (len > VCARD_LINE_OCTETS) {
+        char line[EXPORT_RECORD_MAX];
+        memcpy(line, start, len);
+        p = start;
+        size_t i = 0;
+        size_t room = VCARD_LINE_OCTETS;
+        while (len - i > room) {
+            size_t cut = i + room;
+            while (cut > i + 1 && ((unsigned char)line[cut] & 0xC0) == 0x80) cut--;
+            p = Export_Text(p, line + i, cut - i);
+            p = Export_Text(p, "\r\n ", 3);
+            i = cut;
+            room = VCARD_LINE_OCTETS - 1;   // The leading space counts
+        }
+        p = Export_Text(p, line + i, len - i);
+    }
+    *p++ = '\r';
+    *p++ = '\n';
+    return p;
+}
+
+// ------------------------------------------
+// One vCard property line, skipped when the value is empty
+// ------------------------------------------
+static char *Export_VCardProperty(char *p, const char *property, const char *value) {
+    size_t len = strlen(value);
+    if (len == 0) return p;
+    char *start = p;
+    p = Export_Text(p, property, strlen(property));
+    p = Export_VCardText(p, value, len);
+    return Export_VCardEndLine(start, p);
+}
+
+// ------------------------------------------
+// Encode contact 'row' at 'p'; returns the end of the record
+// ------------------------------------------
+static char *Export_Record(char *p, const ContactStore *store, int row, ExportFormat format) {
+    const char *name = Store_GetName(store, row);
+    const char *phone = Store_GetPhone(store, row);
+    const char *email = Store_GetEmail(store, row);
+    const char *date = Store_GetDate(store, row);
+
+    if (format == EXPORT_VCARD) {
+        p = Export_Text(p, "BEGIN:VCARD\r\nVERSION:3.0\r\n", 26);
+        char *start = p;
+        p = Export_VCardText(Export_Text(p, "FN:", 3), name, strlen(name));
+        p = Export_VCardEndLine(start, p);
+
+        // N is required by 3.0: the last word is taken as the family name
+        const char *space = strrchr(name, ' ');
+        const char *family = space ? space + 1 : name;
+        start = p;
+        p = Export_VCardText(Export_Text(p, "N:", 2), family, strlen(family));
+        *p++ = ';';
+        p = Export_VCardText(p, name, space ? (size_t)(space - name) : 0);
+        p = Export_VCardEndLine(start, Export_Text(p, ";;;", 3));
+
+        p = Export_VCardProperty(p, "TEL:", phone);
+        p = Export_VCardProperty(p, "EMAIL:", email);
+        p = Export_VCardProperty(p, "BDAY:", date);
+        return Export_Text(p, "END:VCARD\r\n", 11);
+    }
+
+    if (format == EXPORT_JSONL) {
+        p = Export_Decimal(Export_Text(p, "{\"id\":", 6), Store_GetId(store, row));
+        p = Export_JsonString(Export_Text(p, ",\"name\":", 8), name);
+        p = Export_JsonString(Export_Text(p, ",\"phone\":", 9), phone);
+        p = Export_JsonString(Export_Text(p, ",\"email\":", 9), email);
+        p = Export_JsonString(Export_Text(p, ",\"date\":", 8), date);
+        return Export_Text(p, "}\n", 2);
+    }
+
+    p = Export_CsvField(p, name);
+    *p++ = ',';
+    p = Export_CsvField(p, phone);
+    *p++ = ',';
+    p = Export_CsvField(p, email);
+    *p++ = ',';
+    p = Export_CsvField(p, date);
+    return Export_Text(p, "\r\n", 2);
+}
+
+// ------------------------------------------
+// Write the rows of a view, a position list or the whole store
+// ------------------------------------------
+static int Export_Run(FileWriter *w, const ContactStore *store, const ContactView *view,
+                      const int *rows, int count, ExportFormat format) {
+    if (format == EXPORT_AUTO) format = EXPORT_CSV;
+    if (format == EXPORT_CSV) FileWriter_Write(w, CSV_HEADER, sizeof(CSV_HEADER) - 1);
+
+    int total = view ? view->count : rows ? count : store->count;
+    int written = 0;
+    for (int i = 0; i < total && !w->failed; i++) {
+        int row = view ? ContactView_IndexOfRow(view, store, i) : rows ? rows[i] : i;
+        if (row < 0 || row >= store->count || Store_IsDeleted(store, row)) continue;
+
+        char *start = FileWriter_Reserve(w, EXPORT_RECORD_MAX);
+        char *end = Export_Record(start, store, row, format);
+        FileWriter_Unreserve(w, EXPORT_RECORD_MAX - (size_t)(end - start));
+        written++;
+    }
+    return written;
+}
+
+// ------------------------------------------
+// Does 'filename' end in 'ext' (lower case, with the dot)?
+// ------------------------------------------
+static int Export_HasExtension(const char *filename, const char *ext) {
+    size_t len = strlen(filename);
+    size_t extLen = strlen(ext);
+    if (len < extLen) return 0;
+    const char *tail = filename + len - extLen;
+    for (size_t i = 0; i < extLen; i++) {
+        if (tolower((unsigned char)tail[i]) != ext[i]) return 0;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Format from the file extension
+// ------------------------------------------
+ExportFormat Export_FormatFor(const char *filename, ExportFormat format) {
+    if (format != EXPORT_AUTO) return format;
+    if (Export_HasExtension(filename, ".vcf") || Export_HasExtension(filename, ".vcard")) return EXPORT_VCARD;
+    if (Export_HasExtension(filename, ".jsonl") || Export_HasExtension(filename, ".ndjson") ||
+        Export_HasExtension(filename, ".json")) {
+        return EXPORT_JSONL;
+    }
+    return EXPORT_CSV;
+}
+
+// ------------------------------------------
+// Stream a position list (or the whole store) to a writer
+// ------------------------------------------
+int Export_Write(FileWriter *w, const ContactStore *store, const int *rows, int count, ExportFormat format) {
+    return Export_Run(w, store, NULL, rows, count, format);
+}
+
+// ------------------------------------------
+// Stream a view to a writer
+// ------------------------------------------
+int Export_WriteView(FileWriter *w, const ContactStore *store, const ContactView *view, ExportFormat format) {
+    return Export_Run(w, store, view, NULL, 0, format);
+}
+
+// ------------------------------------------
+// Export to a file through an atomic writer
+// ------------------------------------------
+static ContactFileStatus Export_ToFile(const ContactStore *store, const ContactView *view, const int *rows,
+                                       int count, const char *filename, ExportFormat format, int *exported) {
+    if (exported) *exported = 0;
+    FileWriter w;
+    if (!FileWriter_OpenAtomic(&w, filename)) return CONTACT_FILE_OPEN_FAILED;
+    int written = Export_Run(&w, store, view, rows, count, Export_FormatFor(filename, format));
+    if (!FileWriter_Commit(&w)) return CONTACT_FILE_WRITE_FAILED;
+    if (exported) *exported = written;
+    return CONTACT_FILE_OK;
+}
+
+// ------------------------------------------
+// Export a position list (or the whole store) to a file
+// ------------------------------------------
+ContactFileStatus Export_File(const ContactStore *store, const int *rows, int count,
+                              const char *filename, ExportFormat format, int *exported) {
+    return Export_ToFile(store, NULL, rows, count, filename, format, exported);
+}
+
+// ------------------------------------------
+// Export a view to a file
+// ------------------------------------------
+ContactFileStatus Export_View(const ContactStore *store, const ContactView *view,
+                              const char *filename, ExportFormat format, int *exported) {
+    return Export_ToFile(store, view, NULL, 0, filename, format, exported);
+}
@@ -0,0 +1,51 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include "ContactFile.h"
+#include "ContactStore.h"
+#include "ContactView.h"
+#include "FileWriter.h"
+
+// Streaming export to CSV, vCard 3.0 and JSON Lines.
+// Contacts are encoded straight from the store's strings into the
+// FileWriter buffer, one record at a time, so an export allocates nothing
+// per contact and never holds more than the writer's buffer. Fields that
+// need no escaping (nearly all of them) are found 16 bytes at a time and
+// copied whole.
+// Any subset in any order can be written without copying it: a list of
+// store positions (search results, a sort order) or a ContactView as the
+// list shows it.
+//
+// CSV: header row "Name,Phone,Email,Date", CRLF line ends, RFC 4180
+// quoting for fields holding ',', '"' or line breaks.
+// vCard: FN, N, TEL, EMAIL and BDAY with 3.0 escapes; lines longer than
+// 75 octets are folded.
+// JSON Lines: {"id":..,"name":..,"phone":..,"email":..,"date":..} per line.
+// Strings are written as stored, without transcoding.
+
+typedef enum {
+    EXPORT_AUTO = 0,    // From the extension: .vcf/.vcard, .jsonl/.ndjson/.json, else CSV
+    EXPORT_CSV,
+    EXPORT_VCARD,
+    EXPORT_JSONL
+} ExportFormat;
+
+// Resolve EXPORT_AUTO for 'filename'; other formats are returned as is
+ExportFormat Export_FormatFor(const char *filename, ExportFormat format);
+
+// Write the store positions 'rows' ('count' of them) in that order, or
+// every contact in store order when 'rows' is NULL. Deleted contacts are
+// skipped. Returns the number of contacts written; check w->failed.
+int Export_Write(FileWriter *w, const ContactStore *store, const int *rows, int count, ExportFormat format);
+
+// Write the rows of 'view' in display order
+int Export_WriteView(FileWriter *w, const ContactStore *store, const ContactView *view, ExportFormat format);
+
+// Export_Write/Export_WriteView to 'filename', replaced atomically.
+// 'exported' (may be NULL) receives the number of contacts written.
+ContactFileStatus Export_File(const ContactStore *store, const int *rows, int count,
+                              const char *filename, ExportFormat format, int *exported);
+ContactFileStatus Export_View(const ContactStore *store, const ContactView *view,
+                              const char *filename, ExportFormat format, int *exported);
+
+#endif // EXPORT_H
@@ -0,0 +1,129 @@
+#include "FileWriter.h"
+#include "Platform.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ------------------------------------------
+// Wrap an open stream
+// ------------------------------------------
+int FileWriter_InitStream(FileWriter *w, FILE *file) {
+    memset(w, 0, sizeof(*w));
+    w->file = file;
+    w->capacity = FILE_WRITER_BUFFER_SIZE;
+    w->buffer = (char*)malloc(w->capacity);
+    return w->buffer != NULL;
+}
+
+// ------------------------------------------
+// Open a temp file next to 'filename' for an atomic replace
+// ------------------------------------------
+int FileWriter_OpenAtomic(FileWriter *w, const char *filename) {
+    memset(w, 0, sizeof(*w));
+    size_t nameLen = strlen(filename);
+    w->target = (char*)malloc(nameLen + 1);
+    w->tmpName = (char*)malloc(nameLen + 5);
+    w->capacity = FILE_WRITER_BUFFER_SIZE;
+    w->buffer = (char*)malloc(w->capacity);
+    if (w->target && w->tmpName && w->buffer) {
+        memcpy(w->target, filename, nameLen + 1);
+        memcpy(w->tmpName, filename, nameLen);
+        memcpy(w->tmpName + nameLen, ".tmp", 5);
+        w->file = fopen(w->tmpName, "wb");
+    }
+    if (!w->file) {
+        free(w->target);
+        free(w->tmpName);
+        free(w->buffer);
+        memset(w, 0, sizeof(*w));
+        return 0;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Hand the buffered bytes to the file
+// ------------------------------------------
+void FileWriter_Flush(FileWriter *w) {
+    if (w->used > 0 && !w->failed) {
+        if (fwrite(w->buffer, 1, w->used, w->file) != w->used) {
+            w->failed = 1;
+        }
+    }
+    w->used = 0;
+}
+
+// ------------------------------------------
+// Append bytes; writes larger than the buffer bypass it
+// ------------------------------------------
+void FileWriter_Write(FileWriter *w, const void *data, size_t len) {
+    if (w->used + len > w->capacity) {
+        FileWriter_Flush(w);
+    }
+    if (len >= w->capacity) {
+        if (!w->failed && fwrite(data, 1, len, w->file) != len) {
+            w->failed = 1;
+        }
+        return;
+    }
+    memcpy(w->buffer + w->used, data, len);
+    w->used += len;
+}
+
+// ------------------------------------------
+// Reserve space for in-place encoding
+// ------------------------------------------
+char *FileWriter_Reserve(FileWriter *w, size_t len) {
+    if (w->used + len > w->capacity) {
+        FileWriter_Flush(w);
+    }
+    char *p = w->buffer + w->used;
+    w->used += len;
+    return p;
+}
+
+// ------------------------------------------
+// Return the unused tail of a reservation
+// ------------------------------------------
+void FileWriter_Unreserve(FileWriter *w, size_t len) {
+    w->used -= len;
+}
+
+// ------------------------------------------
+// Release the writer's memory
+// ------------------------------------------
+static void FileWriter_Free(FileWriter *w) {
+    free(w->buffer);
+    free(w->tmpName);
+    free(w->target);
+    memset(w, 0, sizeof(*w));
+}
+
+// ------------------------------------------
+// Finish writing; atomic writers replace their target
+// ------------------------------------------
+int FileWriter_Commit(FileWriter *w) {
+    FileWriter_Flush(w);
+    int ok = !w->failed;
+    if (w->tmpName) {
+        ok = ok && Platform_SyncFile(w->file);
+        if (fclose(w->file) != 0) ok = 0;
+        if (ok) ok = Platform_ReplaceFile(w->tmpName, w->target);
+        if (!ok) remove(w->tmpName);
+    } else if (fflush(w->file) != 0) {
+        ok = 0;
+    }
+    FileWriter_Free(w);
+    return ok;
+}
+
+// ------------------------------------------
+// Drop the output
+// ------------------------------------------
+void FileWriter_Abort(FileWriter *w) {
+    if (w->tmpName) {
+        fclose(w->file);
+        remove(w->tmpName);
+    }
+    FileWriter_Free(w);
+}
@@ -0,0 +1,47 @@
+#ifndef FILE_WRITER_H
+#define FILE_WRITER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Large output buffer in front of a FILE, so the OS sees a few big writes
+// instead of one per value. Errors are sticky: check 'failed' (or the
+// result of FileWriter_Commit) once at the end.
+typedef struct {
+    FILE  *file;
+    char  *buffer;
+    size_t used;
+    size_t capacity;
+    int    failed;
+    char  *tmpName;   // Set for atomic writers
+    char  *target;
+} FileWriter;
+
+#define FILE_WRITER_BUFFER_SIZE (1024 * 1024)
+
+// Wrap an already open stream (e.g. stdout). Returns 1 on success.
+int  FileWriter_InitStream(FileWriter *w, FILE *file);
+
+// Open "<filename>.tmp" for an atomic replace of 'filename'.
+// Returns 1 on success.
+int  FileWriter_OpenAtomic(FileWriter *w, const char *filename);
+
+void FileWriter_Write(FileWriter *w, const void *data, size_t len);
+void FileWriter_Flush(FileWriter *w);
+
+// Atomic writers: flush, sync and rename the temp file over the target.
+// Stream writers: flush only. Frees the writer; returns 1 on success.
+int  FileWriter_Commit(FileWriter *w);
+
+// Discard everything written (removes the temp file of atomic writers)
+void FileWriter_Abort(FileWriter *w);
+
+// Reserve 'len' bytes in the buffer and return a pointer to them, for
+// encoders that write in place. 'len' must not exceed the capacity.
+char *FileWriter_Reserve(FileWriter *w, size_t len);
+
+// Give back the last 'len' bytes of the latest reservation, for encoders
+// that reserve their worst case and write less
+void FileWriter_Unreserve(FileWriter *w, size_t len);
+
+#endif // FILE_WRITER_H
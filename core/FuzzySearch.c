@@ -0,0 +1,234 @@
+#include "FuzzySearch.h"
+#include "Platform.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUZZY_NO_MATCH     0xFF
+#define FUZZY_LANE_QUERY   16      // Longest query matched four names at a time
+#define FUZZY_PARALLEL_MIN 16384   // Fewer names are not worth a thread
+
+// 16-bit lanes: the low and the high bit of each
+#define FUZZY_LANE_LOW  UINT64_C(0x0001000100010001)
+#define FUZZY_LANE_HIGH UINT64_C(0x8000800080008000)
+
+typedef struct {
+    const ContactStore *store;
+    const int *rows;              // Positions to match, NULL for the whole store
+    int count;                    // Entries of 'rows', or store->count
+    int length;                   // Query characters
+    int maxDistance;
+    unsigned char *distance;      // Per entry: best distance or FUZZY_NO_MATCH
+    uint64_t peq[256];            // Bit i set where the query has that character at i
+} FuzzyJob;
+
+// ------------------------------------------
+// Lowest edit distance between the query and a substring of 'text'
+// Myers' bit-parallel column update, one word per text character. 'pv'
+// and 'mv' encode the +1/-1 vertical deltas of the column, and 'score'
+// follows its last cell: the distance of the best match ending here.
+// ------------------------------------------
+static int Fuzzy_Distance(const FuzzyJob *job, const unsigned char *text) {
+    uint64_t top = UINT64_C(1) << (job->length - 1);
+    uint64_t pv = ~UINT64_C(0), mv = 0;
+    int score = job->length, best = job->length;
+    for (; *text && best > 0; text++) {
+        uint64_t eq = job->peq[*text];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & top) score++;
+        else if (mh & top) score--;
+        // No carry into the first row: a match may start anywhere
+        ph <<= 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        if (score < best) best = score;
+    }
+    return best;
+}
+
+// ------------------------------------------
+// Lane-wise a + b, carries stay inside each 16-bit lane
+// ------------------------------------------
+static uint64_t Fuzzy_LaneAdd(uint64_t a, uint64_t b) {
+    return ((a & ~FUZZY_LANE_HIGH) + (b & ~FUZZY_LANE_HIGH)) ^ ((a ^ b) & FUZZY_LANE_HIGH);
+}
+
+// ------------------------------------------
+// Fuzzy_Distance of four names at once (query of at most 16 characters)
+// Same update, with every shift masked at the lane borders. A name that
+// ends early is fed '\0', which matches nothing and so cannot lower its
+// best distance. Scores stay below 2^15, so plain adds and subtracts of
+// 0/1 per lane never cross lanes, and the lane-wise minimum can borrow
+// from each lane's high bit.
+// ------------------------------------------
+static void Fuzzy_Distance4(const FuzzyJob *job, const unsigned char *text[4], int best[4]) {
+    const uint64_t *peq = job->peq;
+    const unsigned char *t0 = text[0], *t1 = text[1], *t2 = text[2], *t3 = text[3];
+    int shift = job->length - 1;
+    uint64_t pv = ~UINT64_C(0), mv = 0;
+    uint64_t score = FUZZY_LANE_LOW * (uint64_t)job->length;
+    uint64_t low = score;
+    while ((*t0 | *t1 | *t2 | *t3) != 0) {
+        uint64_t eq = peq[*t0] | (peq[*t1] << 16) | (peq[*t2] << 32) | (peq[*t3] << 48);
+        t0 += (*t0 != 0);
+        t1 += (*t1 != 0);
+        t2 += (*t2 != 0);
+        t3 += (*t3 != 0);
+
+        uint64_t xv = eq | mv;
+        uint64_t xh = (Fuzzy_LaneAdd(eq & pv, pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        score += (ph >> shift) & FUZZY_LANE_LOW;
+        score -= (mh >> shift) & FUZZY_LANE_LOW;
+        ph = (ph << 1) & ~FUZZY_LANE_LOW;
+        mh = (mh << 1) & ~FUZZY_LANE_LOW;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+
+        // low = min(low, score) per lane
+        uint64_t ge = (((low | FUZZY_LANE_HIGH) - score) & FUZZY_LANE_HIGH) >> 15;
+        low ^= (low ^ score) & (ge * 0xFFFF);
+    }
+    for (int lane = 0; lane < 4; lane++) {
+        best[lane] = (int)((low >> (16 * lane)) & 0xFFFF);
+    }
+}
+
+// ------------------------------------------
+// Match entries [begin, end) of the job
+// ------------------------------------------
+static void Fuzzy_Match(FuzzyJob *job, int begin, int end) {
+    const unsigned char *none = (const unsigned char*)"";
+    int i = begin;
+    if (job->length <= FUZZY_LANE_QUERY) {
+        for (; i < end; i += 4) {
+            const unsigned char *text[4];
+            int best[4];
+            for (int lane = 0; lane < 4; lane++) {
+                int entry = i + lane;
+                if (entry >= end) {
+                    text[lane] = none;
+                } else {
+                    int row = job->rows ? job->rows[entry] : entry;
+                    text[lane] = (const unsigned char*)Store_GetName(job->store, row);
+                }
+            }
+            Fuzzy_Distance4(job, text, best);
+            for (int lane = 0; lane < 4 && i + lane < end; lane++) {
+                job->distance[i + lane] = best[lane] <= job->maxDistance ? (unsigned char)best[lane] : FUZZY_NO_MATCH;
+            }
+        }
+        return;
+    }
+    for (; i < end; i++) {
+        int row = job->rows ? job->rows[i] : i;
+        int best = Fuzzy_Distance(job, (const unsigned char*)Store_GetName(job->store, row));
+        job->distance[i] = best <= job->maxDistance ? (unsigned char)best : FUZZY_NO_MATCH;
+    }
+}
+
+// ------------------------------------------
+// One worker: a contiguous share of the entries, in groups of four
+// ------------------------------------------
+static void Fuzzy_Worker(void *context, int worker, int workerCount) {
+    FuzzyJob *job = (FuzzyJob*)context;
+    int groups = (job->count + 3) / 4;
+    int begin = (int)((int64_t)groups * worker / workerCount) * 4;
+    int end = (int)((int64_t)groups * (worker + 1) / workerCount) * 4;
+    if (end > job->count) end = job->count;
+    if (begin < end) Fuzzy_Match(job, begin, end);
+}
+
+// ------------------------------------------
+// Allowed typos for a query length: short queries tolerate none, or
+// nearly every name would match
+// ------------------------------------------
+int FuzzySearch_DefaultDistance(size_t length) {
+    if (length < 4) return 0;
+    return length < 8 ? 1 : 2;
+}
+
+// ------------------------------------------
+// Typo-tolerant search over the names
+// ------------------------------------------
+
+int FuzzySearch_Names(const ContactStore *store, const TrigramIndex *index, const char *query,
+                      int maxDistance, int workerCount, int *results, int *distances) {
+    if (!query || query[0] == '\0') return -1;
+    size_t length = strlen(query);
+    if (length > FUZZY_MAX_QUERY) return -1;
+    if (maxDistance > FUZZY_MAX_DISTANCE) maxDistance = FUZZY_MAX_DISTANCE;
+    if (maxDistance > (int)length - 1) maxDistance = (int)length - 1;
+    if (maxDistance < 0) maxDistance = 0;
+
+    FuzzyJob *job = (FuzzyJob*)calloc(1, sizeof(FuzzyJob));
+    if (!job) return -1;
+    job->store = store;
+    job->length = (int)length;
+    job->maxDistance = maxDistance;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)query[i];
+        job->peq[c] |= UINT64_C(1) << i;
+        if (c >= 'A' && c <= 'Z') job->peq[c + ('a' - 'A')] |= UINT64_C(1) << i;
+        if (c >= 'a' && c <= 'z') job->peq[c - ('a' - 'A')] |= UINT64_C(1) << i;
+    }
+
+    // Narrow the names down through the trigram index when it can help.
+    // The candidates are copied out of 'results', which the ranking fills.
+    int *candidates = NULL;
+    job->count = store->count;
+    if (index) {
+        int count = TrigramIndex_FuzzyCandidates(index, store, query, maxDistance, results);
+        if (count >= 0) {
+            candidates = (int*)malloc((size_t)(count > 0 ? count : 1) * sizeof(int));
+            if (!candidates) {
+                free(job);
+                return -1;
+            }
+            memcpy(candidates, results, (size_t)count * sizeof(int));
+            job->rows = candidates;
+            job->count = count;
+        }
+    }
+    job->distance = (unsigned char*)malloc((size_t)(job->count > 0 ? job->count : 1));
+    if (!job->distance) {
+        free(candidates);
+        free(job);
+        return -1;
+    }
+
+    int workers = workerCount;
+    if (workers > job->count / FUZZY_PARALLEL_MIN) workers = job->count / FUZZY_PARALLEL_MIN;
+    if (workers > 1) {
+        Platform_RunParallel(workers, Fuzzy_Worker, job);
+    } else {
+        Fuzzy_Match(job, 0, job->count);
+    }
+
+    // Rank: a counting sort on the distance keeps store order within one
+    int start[FUZZY_MAX_DISTANCE + 2];
+    memset(start, 0, sizeof(start));
+    for (int i = 0; i < job->count; i++) {
+        if (job->distance[i] != FUZZY_NO_MATCH) start[job->distance[i] + 1]++;
+    }
+    for (int d = 1; d <= maxDistance + 1; d++) start[d] += start[d - 1];
+    int matches = start[maxDistance + 1];
+    for (int i = 0; i < job->count; i++) {
+        int d = job->distance[i];
+        if (d == FUZZY_NO_MATCH) continue;
+        int at = start[d]++;
+        results[at] = job->rows ? job->rows[i] : i;
+        if (distances) distances[at] = d;
+    }
+
+    free(candidates);
+    free(job->distance);
+    free(job);
+    return matches;
+}
@@ -0,0 +1,40 @@
+#ifndef FUZZY_SEARCH_H
+#define FUZZY_SEARCH_H
+
+#include <stddef.h>
+
+#include "ContactStore.h"
+#include "TrigramIndex.h"
+
+// Typo-tolerant name search: finds the contacts whose name contains a
+// substring within 'k' edits (insertions, deletions, substitutions) of the
+// query, ignoring ASCII case, so "Jonh" finds "John".
+//
+// Each name is matched with Myers' bit-parallel algorithm: one machine
+// word holds a whole column of the edit distance table, so a name costs a
+// few word operations per character whatever k is. Queries of up to 16
+// characters are batched four names at a time, one 16-bit lane per name
+// in a 64-bit word. The trigram index, when given and fresh, rules out the
+// names that share too few trigrams with the query (q-gram lemma) before
+// any matching; without it the whole store is scanned, split across
+// workers.
+
+#define FUZZY_MAX_QUERY    64  // Characters; one machine word per column
+#define FUZZY_MAX_DISTANCE 8
+
+// A sensible k for a query of 'length' characters: 0 below 4 characters,
+// 1 up to 7, then 2
+int FuzzySearch_DefaultDistance(size_t length);
+
+// Contacts whose name matches 'query' within 'maxDistance' edits (clamped
+// to FUZZY_MAX_DISTANCE and below the query length), best first and in
+// store order within a distance. Writes their positions to 'results',
+// which must have room for store->count entries, and their distances to
+// 'distances' unless it is NULL. 'index' may be NULL. Up to 'workerCount'
+// threads share a scan of a large store.
+// Returns the number of matches, or -1 for an empty query, one longer than
+// FUZZY_MAX_QUERY, or when out of memory.
+int FuzzySearch_Names(const ContactStore *store, const TrigramIndex *index, const char *query,
+                      int maxDistance, int workerCount, int *results, int *distances);
+
+#endif // FUZZY_SEARCH_H
@@ -0,0 +1,752 @@
+#include "Import.h"
+#include "Platform.h"
+#include "Validation.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Input bytes per worker and batch
+#define IMPORT_CHUNK_SIZE   (1024 * 1024)
+// CSV columns looked at; the rest of a row is skipped
+#define IMPORT_MAX_COLUMNS  64
+// Longest unfolded vCard line kept; longer ones (photos) are cut
+#define IMPORT_LINE_SIZE    4096
+// Longest field of any kind, terminator included
+#define IMPORT_FIELD_SIZE   (CONTACT_NAME_SIZE > CONTACT_EMAIL_SIZE ? CONTACT_NAME_SIZE : CONTACT_EMAIL_SIZE)
+
+// What a column or property holds
+enum {
+    ROLE_IGNORE = 0,
+    ROLE_NAME,
+    ROLE_FIRST,
+    ROLE_LAST,
+    ROLE_PHONE,
+    ROLE_EMAIL,
+    ROLE_DATE,
+    ROLE_COUNT
+};
+
+// One field being parsed; whatever does not fit sets 'overflow'
+typedef struct {
+    char   text[IMPORT_FIELD_SIZE];
+    size_t len;
+    int    overflow;
+} ImportField;
+
+// An accepted row: offsets into its chunk's text (0 = empty)
+typedef struct {
+    uint32_t field[4];
+} ImportRow;
+
+// One worker's share of a batch
+typedef struct {
+    size_t     begin, end;     // Byte range of the file
+    char      *text;           // Accepted fields, '\0' terminated; text[0] is ""
+    size_t     textUsed;
+    size_t     textCapacity;
+    ImportRow *rows;
+    int        rowCount;
+    int        rowCapacity;
+    ImportRejection *rejected; // Lines relative to the chunk (0-based)
+    int        rejectedCount;
+    int        rejectedCapacity;
+    long long  lines;          // Newlines in the range
+    int        failed;         // Out of memory
+} ImportChunk;
+
+typedef struct {
+    const unsigned char *data;
+    size_t       size;
+    ImportFormat format;
+    char         delimiter;
+    int          columns;
+    int          roles[IMPORT_MAX_COLUMNS];
+    ImportChunk *chunks;
+} ImportJob;
+
+// ------------------------------------------
+// Field helpers
+// ------------------------------------------
+static void ImportField_Clear(ImportField *field) {
+    field->len = 0;
+    field->overflow = 0;
+    field->text[0] = '\0';
+}
+
+static void ImportField_Put(ImportField *field, char c) {
+    if (field->len < IMPORT_FIELD_SIZE - 1) {
+        field->text[field->len++] = c;
+    } else {
+        field->overflow = 1;
+    }
+}
+
+// Drop trailing blanks and terminate
+static void ImportField_End(ImportField *field) {
+    while (field->len > 0 && (field->text[field->len - 1] == ' ' || field->text[field->len - 1] == '\t')) {
+        field->len--;
+    }
+    field->text[field->len] = '\0';
+}
+
+// ------------------------------------------
+// Case-insensitive comparison of 'len' bytes with a lowercase literal
+// ------------------------------------------
+static int Import_Equals(const char *text, size_t len, const char *lower) {
+    size_t n = strlen(lower);
+    if (len != n) return 0;
+    for (size_t i = 0; i < n; i++) {
+        char c = text[i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (c != lower[i]) return 0;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Per-chunk output
+// ------------------------------------------
+static void ImportChunk_Reject(ImportChunk *chunk, long long line, ImportReason reason) {
+    if (chunk->rejectedCount == chunk->rejectedCapacity) {
+        int newCapacity = chunk->rejectedCapacity ? chunk->rejectedCapacity * 2 : 256;
+        ImportRejection *grown = (ImportRejection*)realloc(chunk->rejected, (size_t)newCapacity * sizeof(ImportRejection));
+        if (!grown) {
+            chunk->failed = 1;
+            return;
+        }
+        chunk->rejected = grown;
+        chunk->rejectedCapacity = newCapacity;
+    }
+    chunk->rejected[chunk->rejectedCount].line = line;
+    chunk->rejected[chunk->rejectedCount].reason = reason;
+    chunk->rejectedCount++;
+}
+
+static uint32_t ImportChunk_PushText(ImportChunk *chunk, const ImportField *field) {
+    if (field->len == 0) return 0;
+    size_t needed = (chunk->textUsed ? chunk->textUsed : 1) + field->len + 1;
+    if (needed > chunk->textCapacity) {
+        size_t newCapacity = chunk->textCapacity ? chunk->textCapacity * 2 : 64 * 1024;
+        while (newCapacity < needed) newCapacity *= 2;
+        char *grown = (char*)realloc(chunk->text, newCapacity);
+        if (!grown) {
+            chunk->failed = 1;
+            return 0;
+        }
+        grown[0] = '\0';
+        chunk->text = grown;
+        chunk->textCapacity = newCapacity;
+    }
+    if (chunk->textUsed == 0) chunk->textUsed = 1;
+    uint32_t offset = (uint32_t)chunk->textUsed;
+    memcpy(chunk->text + offset, field->text, field->len + 1);
+    chunk->textUsed = needed;
+    return offset;
+}
+
+// ------------------------------------------
+// Validate one parsed row or card and keep it, or note why not
+// 'fields' is indexed by role.
+// ------------------------------------------
+static void ImportChunk_Finish(ImportChunk *chunk, ImportField *fields, long long line, int malformed) {
+    ImportField *name = &fields[ROLE_NAME];
+    ImportField *phone = &fields[ROLE_PHONE];
+    ImportField *email = &fields[ROLE_EMAIL];
+    ImportField *date = &fields[ROLE_DATE];
+
+    // "First Last" when there is no full name
+    if (name->len == 0 && !name->overflow) {
+        const ImportField *parts[2] = { &fields[ROLE_FIRST], &fields[ROLE_LAST] };
+        for (int p = 0; p < 2; p++) {
+            if (parts[p]->len == 0) continue;
+            if (name->len > 0) ImportField_Put(name, ' ');
+            for (size_t i = 0; i < parts[p]->len; i++) ImportField_Put(name, parts[p]->text[i]);
+            name->overflow |= parts[p]->overflow;
+        }
+        name->text[name->len] = '\0';
+    }
+
+    // Exports format numbers for reading: "+44 (20) 7946.0958"
+    size_t kept = 0;
+    for (size_t i = 0; i < phone->len; i++) {
+        char c = phone->text[i];
+        if (c != ' ' && c != '.' && c != '(' && c != ')') phone->text[kept++] = c;
+    }
+    phone->len = kept;
+    phone->text[kept] = '\0';
+
+    // Outlook writes "0/0/00" for a contact without a birthday
+    if (strcmp(date->text, "0/0/00") == 0) {
+        date->len = 0;
+        date->text[0] = '\0';
+    }
+
+    ImportReason reason = 0;
+    if (malformed) {
+        reason = IMPORT_REJECT_MALFORMED;
+    } else if (!name->overflow && !ValidateName(name->text)) {
+        reason = IMPORT_REJECT_NAME;
+    } else if (name->overflow || phone->overflow || email->overflow || date->overflow ||
+               phone->len >= CONTACT_PHONE_SIZE || email->len >= CONTACT_EMAIL_SIZE ||
+               date->len >= CONTACT_DATE_SIZE) {
+        reason = IMPORT_REJECT_TOO_LONG;
+    } else if (!ValidatePhone(phone->text)) {
+        reason = IMPORT_REJECT_PHONE;
+    } else if (!ValidateEmail(email->text)) {
+        reason = IMPORT_REJECT_EMAIL;
+    } else if (!ValidateDate(date->text)) {
+        reason = IMPORT_REJECT_DATE;
+    }
+    if (reason) {
+        ImportChunk_Reject(chunk, line, reason);
+        return;
+    }
+
+    if (chunk->rowCount == chunk->rowCapacity) {
+        int newCapacity = chunk->rowCapacity ? chunk->rowCapacity * 2 : 1024;
+        ImportRow *grown = (ImportRow*)realloc(chunk->rows, (size_t)newCapacity * sizeof(ImportRow));
+        if (!grown) {
+            chunk->failed = 1;
+            return;
+        }
+        chunk->rows = grown;
+        chunk->rowCapacity = newCapacity;
+    }
+    ImportRow *row = &chunk->rows[chunk->rowCount++];
+    row->field[0] = ImportChunk_PushText(chunk, name);
+    row->field[1] = ImportChunk_PushText(chunk, phone);
+    row->field[2] = ImportChunk_PushText(chunk, email);
+    row->field[3] = ImportChunk_PushText(chunk, date);
+}
+
+// ------------------------------------------
+// End of the CSV row starting at 'pos' (after its newline)
+// Tracks quotes exactly like Import_CsvRow, without copying anything,
+// to cut batches at row boundaries.
+// ------------------------------------------
+static size_t Import_CsvRowEnd(const unsigned char *data, size_t pos, size_t end, char delimiter) {
+    int atStart = 1, inQuotes = 0;
+    while (pos < end) {
+        unsigned char c = data[pos++];
+        if (inQuotes) {
+            if (c == '"') {
+                if (pos < end && data[pos] == '"') pos++;
+                else inQuotes = 0;
+            }
+        } else if (c == '\n') {
+            return pos;
+        } else if (c == (unsigned char)delimiter) {
+            atStart = 1;
+        } else if (c == '"' && atStart) {
+            inQuotes = 1;
+            atStart = 0;
+        } else if (c != ' ' && c != '\t' && c != '\r') {
+            atStart = 0;
+        }
+    }
+    return end;
+}
+
+// ------------------------------------------
+// Parse the CSV row starting at 'pos' and return the position after it
+// Column c goes to slots[c] (skipped when NULL). Leading and trailing
+// blanks are dropped; quoted fields may hold separators, "" and line
+// breaks (which become spaces). '*lines' counts the newlines consumed.
+// ------------------------------------------
+static size_t Import_CsvRow(const unsigned char *data, size_t pos, size_t end, char delimiter,
+                            ImportField **slots, long long *lines, int *columns, int *blank, int *malformed) {
+    int column = 0, atStart = 1, inQuotes = 0, content = 0;
+    ImportField *field = slots[0];
+    while (pos < end) {
+        char c = (char)data[pos++];
+        if (inQuotes) {
+            if (c == '"') {
+                if (pos < end && data[pos] == '"') {
+                    pos++;
+                    if (field) ImportField_Put(field, '"');
+                } else {
+                    inQuotes = 0;
+                }
+            } else if (c == '\n') {
+                (*lines)++;
+                if (field) ImportField_Put(field, ' ');
+            } else if (c != '\r' && field) {
+                ImportField_Put(field, c);
+            }
+            continue;
+        }
+        if (c == '\n') {
+            (*lines)++;
+            break;
+        }
+        if (c == delimiter) {
+            if (field) ImportField_End(field);
+            column++;
+            field = column < IMPORT_MAX_COLUMNS ? slots[column] : NULL;
+            atStart = 1;
+            content = 1;
+        } else if (c == '"' && atStart) {
+            inQuotes = 1;
+            atStart = 0;
+            content = 1;
+        } else if (c == '\r' || (atStart && (c == ' ' || c == '\t'))) {
+            // Line ends and leading blanks
+        } else {
+            atStart = 0;
+            content = 1;
+            if (field) ImportField_Put(field, c);
+        }
+    }
+    if (field) ImportField_End(field);
+    *columns = column + 1;
+    *blank = !content;
+    *malformed = inQuotes;
+    return pos;
+}
+
+// ------------------------------------------
+// Worker: parse and validate the CSV rows of one chunk
+// ------------------------------------------
+static void Import_ParseCsv(const ImportJob *job, ImportChunk *chunk) {
+    ImportField fields[ROLE_COUNT];
+    ImportField *slots[IMPORT_MAX_COLUMNS];
+    for (int c = 0; c < IMPORT_MAX_COLUMNS; c++) {
+        int role = c < job->columns ? job->roles[c] : ROLE_IGNORE;
+        slots[c] = role != ROLE_IGNORE ? &fields[role] : NULL;
+    }
+
+    size_t pos = chunk->begin;
+    while (pos < chunk->end && !chunk->failed) {
+        for (int r = 0; r < ROLE_COUNT; r++) ImportField_Clear(&fields[r]);
+        long long line = chunk->lines;
+        int columns, blank, malformed;
+        pos = Import_CsvRow(job->data, pos, chunk->end, job->delimiter, slots, &chunk->lines,
+                            &columns, &blank, &malformed);
+        if (!blank) ImportChunk_Finish(chunk, fields, line, malformed);
+    }
+}
+
+// ------------------------------------------
+// Read one unfolded vCard line into 'line' (CRs dropped)
+// Lines starting with a space or tab continue the previous one.
+// ------------------------------------------
+static size_t Import_VCardLine(const unsigned char *data, size_t pos, size_t end, char *line,
+                               size_t *len, int *truncated, long long *lines) {
+    size_t n = 0;
+    *truncated = 0;
+    for (;;) {
+        while (pos < end && data[pos] != '\n') {
+            if (data[pos] != '\r') {
+                if (n < IMPORT_LINE_SIZE - 1) line[n++] = (char)data[pos];
+                else *truncated = 1;
+            }
+            pos++;
+        }
+        if (pos < end) {
+            pos++;
+            (*lines)++;
+        }
+        if (pos < end && (data[pos] == ' ' || data[pos] == '\t')) {
+            pos++;
+            continue;
+        }
+        break;
+    }
+    while (n > 0 && (line[n - 1] == ' ' || line[n - 1] == '\t')) n--;
+    line[n] = '\0';
+    *len = n;
+    return pos;
+}
+
+// ------------------------------------------
+// Decode a vCard text value into 'field'
+// Escapes: \n -> space, \, \; \\ -> the character. With 'component' set,
+// stops at the first unescaped ';' and returns where the next starts.
+// ------------------------------------------
+static size_t Import_VCardText(ImportField *field, const char *value, size_t len, int component) {
+    size_t i = 0;
+    while (i < len) {
+        char c = value[i++];
+        if (c == '\\' && i < len) {
+            c = value[i++];
+            if (c == 'n' || c == 'N') c = ' ';
+        } else if (c == ';' && component) {
+            break;
+        }
+        ImportField_Put(field, c);
+    }
+    ImportField_End(field);
+    return i;
+}
+
+// ------------------------------------------
+// Take the value of one vCard property, if it is one we keep
+// ------------------------------------------
+static void Import_VCardProperty(ImportField *fields, const char *line, size_t len, int truncated) {
+    // Name, without a "group." prefix
+    size_t i = 0, nameStart = 0;
+    while (i < len && line[i] != ';' && line[i] != ':') {
+        if (line[i] == '.') nameStart = i + 1;
+        i++;
+    }
+    const char *name = line + nameStart;
+    size_t nameLen = i - nameStart;
+
+    // Parameters; quoted values may hold ':'
+    int quoted = 0;
+    while (i < len && (quoted || line[i] != ':')) {
+        if (line[i] == '"') quoted = !quoted;
+        i++;
+    }
+    if (i >= len) return;
+    const char *value = line + i + 1;
+    size_t valueLen = len - i - 1;
+
+    ImportField *field;
+    if (Import_Equals(name, nameLen, "n")) {
+        // Family;Given;Additional;Prefix;Suffix
+        if (fields[ROLE_LAST].len > 0 || fields[ROLE_FIRST].len > 0) return;
+        size_t used = Import_VCardText(&fields[ROLE_LAST], value, valueLen, 1);
+        Import_VCardText(&fields[ROLE_FIRST], value + used, valueLen - used, 1);
+        if (truncated) fields[ROLE_LAST].overflow = 1;
+        return;
+    } else if (Import_Equals(name, nameLen, "fn")) {
+        field = &fields[ROLE_NAME];
+    } else if (Import_Equals(name, nameLen, "tel")) {
+        field = &fields[ROLE_PHONE];
+        // vCard 4.0 may give a URI: "tel:+44-20-7946-0958;ext=1"
+        if (valueLen >= 4 && Import_Equals(value, 4, "tel:")) {
+            value += 4;
+            valueLen -= 4;
+            const char *params = (const char*)memchr(value, ';', valueLen);
+            if (params) valueLen = (size_t)(params - value);
+        }
+    } else if (Import_Equals(name, nameLen, "email")) {
+        field = &fields[ROLE_EMAIL];
+    } else if (Import_Equals(name, nameLen, "bday")) {
+        field = &fields[ROLE_DATE];
+        // Date only: "19960415T..." or "1996-04-15T..."
+        const char *time = (const char*)memchr(value, 'T', valueLen);
+        if (time) valueLen = (size_t)(time - value);
+    } else {
+        return;
+    }
+    if (field->len > 0 || field->overflow) return;  // First one wins
+
+    Import_VCardText(field, value, valueLen, 0);
+    if (truncated) field->overflow = 1;
+
+    // Basic format dates: "19960415" -> "1996-04-15"
+    if (field == &fields[ROLE_DATE] && field->len == 8 && strspn(field->text, "0123456789") == 8) {
+        memmove(field->text + 8, field->text + 6, 2);
+        memmove(field->text + 5, field->text + 4, 2);
+        field->text[4] = '-';
+        field->text[7] = '-';
+        field->len = 10;
+        field->text[10] = '\0';
+    }
+}
+
+// ------------------------------------------
+// Worker: parse and validate the vCards of one chunk
+// Text outside BEGIN:VCARD ... END:VCARD is skipped.
+// ------------------------------------------
+static void Import_ParseVCards(const ImportJob *job, ImportChunk *chunk) {
+    ImportField fields[ROLE_COUNT];
+    char line[IMPORT_LINE_SIZE];
+    int inCard = 0;
+    long long cardLine = 0;
+    size_t pos = chunk->begin;
+    while (pos < chunk->end && !chunk->failed) {
+        long long lineNumber = chunk->lines;
+        size_t len;
+        int truncated;
+        pos = Import_VCardLine(job->data, pos, chunk->end, line, &len, &truncated, &chunk->lines);
+        if (Import_Equals(line, len, "begin:vcard")) {
+            if (inCard) ImportChunk_Reject(chunk, cardLine, IMPORT_REJECT_MALFORMED);
+            for (int r = 0; r < ROLE_COUNT; r++) ImportField_Clear(&fields[r]);
+            cardLine = lineNumber;
+            inCard = 1;
+        } else if (inCard && Import_Equals(line, len, "end:vcard")) {
+            ImportChunk_Finish(chunk, fields, cardLine, 0);
+            inCard = 0;
+        } else if (inCard) {
+            Import_VCardProperty(fields, line, len, truncated);
+        }
+    }
+    if (inCard) ImportChunk_Reject(chunk, cardLine, IMPORT_REJECT_MALFORMED);
+}
+
+// ------------------------------------------
+// Worker entry point
+// ------------------------------------------
+static void Import_Worker(void *context, int worker, int workerCount) {
+    ImportJob *job = (ImportJob*)context;
+    (void)workerCount;
+    if (job->format == IMPORT_VCARD) {
+        Import_ParseVCards(job, &job->chunks[worker]);
+    } else {
+        Import_ParseCsv(job, &job->chunks[worker]);
+    }
+}
+
+// ------------------------------------------
+// First record boundary at or after 'target' (and after 'begin')
+// CSV rows are followed from 'begin' since quotes may hide line breaks;
+// vCards start at a "BEGIN:VCARD" line, which is found directly.
+// ------------------------------------------
+static size_t Import_Boundary(const ImportJob *job, size_t begin, size_t target) {
+    if (target >= job->size) return job->size;
+    if (job->format == IMPORT_CSV) {
+        size_t pos = begin;
+        while (pos < target) pos = Import_CsvRowEnd(job->data, pos, job->size, job->delimiter);
+        return pos;
+    }
+    size_t pos = target > begin + 1 ? target - 1 : begin;
+    while (pos < job->size) {
+        const unsigned char *newline = (const unsigned char*)memchr(job->data + pos, '\n', job->size - pos);
+        if (!newline) break;
+        pos = (size_t)(newline - job->data) + 1;
+        if (job->size - pos >= 11 && Import_Equals((const char*)job->data + pos, 11, "begin:vcard")) return pos;
+    }
+    return job->size;
+}
+
+// ------------------------------------------
+// Role of a CSV header cell
+// ------------------------------------------
+static int Import_HeaderRole(const ImportField *cell) {
+    char lower[IMPORT_FIELD_SIZE];
+    for (size_t i = 0; i <= cell->len; i++) {
+        char c = cell->text[i];
+        lower[i] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+    if (strcmp(lower, "name") == 0 || strcmp(lower, "full name") == 0 || strcmp(lower, "fullname") == 0 ||
+        strcmp(lower, "display name") == 0 || strcmp(lower, "fn") == 0) {
+        return ROLE_NAME;
+    }
+    // Columns describing another one: Google's "E-mail 1 - Label" and
+    // "Phone 1 - Type" come before their "- Value", and its "Phonetic
+    // Middle Name" is no phone; Outlook's "E-mail Type" and "E-mail Display
+    // Name" follow "E-mail Address"
+    if (strstr(lower, "label") || strstr(lower, "type") || strstr(lower, "display") ||
+        strstr(lower, "phonetic") || strstr(lower, "yomi")) {
+        return ROLE_IGNORE;
+    }
+    if (strstr(lower, "first") || strstr(lower, "given")) return ROLE_FIRST;
+    if (strstr(lower, "last") || strstr(lower, "family") || strstr(lower, "surname")) return ROLE_LAST;
+    if (strstr(lower, "mail")) return ROLE_EMAIL;
+    if (strstr(lower, "phone") || strstr(lower, "mobile") || strcmp(lower, "tel") == 0) return ROLE_PHONE;
+    if (strstr(lower, "birth") || strstr(lower, "date") || strcmp(lower, "bday") == 0 ||
+        strcmp(lower, "dob") == 0) {
+        return ROLE_DATE;
+    }
+    return ROLE_IGNORE;
+}
+
+// ------------------------------------------
+// Separator and columns of a CSV file
+// Returns where the data rows start: after the header row, if the first
+// row names any known column.
+// ------------------------------------------
+static size_t Import_CsvLayout(ImportJob *job, size_t pos, long long *lines) {
+    // The separator that occurs most often on the first line
+    const unsigned char *data = job->data;
+    int commas = 0, semicolons = 0, tabs = 0;
+    for (size_t i = pos; i < job->size && data[i] != '\n'; i++) {
+        commas += data[i] == ',';
+        semicolons += data[i] == ';';
+        tabs += data[i] == '\t';
+    }
+    job->delimiter = (semicolons > commas && semicolons >= tabs) ? ';' : (tabs > commas ? '\t' : ',');
+
+    ImportField cells[IMPORT_MAX_COLUMNS];
+    ImportField *slots[IMPORT_MAX_COLUMNS];
+    for (int c = 0; c < IMPORT_MAX_COLUMNS; c++) {
+        ImportField_Clear(&cells[c]);
+        slots[c] = &cells[c];
+    }
+    long long headerLines = 0;
+    int columns, blank, malformed;
+    size_t next = Import_CsvRow(data, pos, job->size, job->delimiter, slots, &headerLines,
+                                &columns, &blank, &malformed);
+    if (columns > IMPORT_MAX_COLUMNS) columns = IMPORT_MAX_COLUMNS;
+
+    // A header names the name column or at least two known ones, which
+    // a row of data is unlikely to do
+    int used[ROLE_COUNT] = { 0 };
+    int known = 0;
+    for (int c = 0; c < columns; c++) {
+        int role = Import_HeaderRole(&cells[c]);
+        if (role != ROLE_IGNORE && used[role]) role = ROLE_IGNORE;  // First column wins
+        used[role] = 1;
+        job->roles[c] = role;
+        known += role != ROLE_IGNORE;
+    }
+    if ((known >= 2 || used[ROLE_NAME]) && !malformed) {
+        job->columns = columns;
+        *lines = headerLines;
+        return next;
+    }
+
+    static const int defaultRoles[4] = { ROLE_NAME, ROLE_PHONE, ROLE_EMAIL, ROLE_DATE };
+    memcpy(job->roles, defaultRoles, sizeof(defaultRoles));
+    job->columns = 4;
+    return pos;
+}
+
+// ------------------------------------------
+// Format from the extension, else from the first bytes
+// ------------------------------------------
+static ImportFormat Import_Detect(const char *filename, const unsigned char *data, size_t size) {
+    const char *dot = strrchr(filename, '.');
+    if (dot && (Import_Equals(dot, strlen(dot), ".vcf") || Import_Equals(dot, strlen(dot), ".vcard"))) {
+        return IMPORT_VCARD;
+    }
+    if (dot && Import_Equals(dot, strlen(dot), ".csv")) return IMPORT_CSV;
+    size_t i = 0;
+    while (i < size && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n')) i++;
+    if (size - i >= 11 && Import_Equals((const char*)data + i, 11, "begin:vcard")) return IMPORT_VCARD;
+    return IMPORT_CSV;
+}
+
+// ------------------------------------------
+// Append the output of a batch to the store and the result, in order
+// ------------------------------------------
+static ContactFileStatus Import_Merge(ContactStore *store, ImportChunk *chunks, int chunkCount,
+                                      long long *line, ImportResult *result) {
+    size_t rows = 0, bytes = 0, rejected = 0;
+    for (int w = 0; w < chunkCount; w++) {
+        if (chunks[w].failed) return CONTACT_FILE_NO_MEMORY;
+        rows += (size_t)chunks[w].rowCount;
+        rejected += (size_t)chunks[w].rejectedCount;
+        if (chunks[w].textUsed > 0) bytes += chunks[w].textUsed - 1;
+    }
+    if (rows + rejected > (size_t)(INT_MAX - result->rows) || rows > (size_t)(INT_MAX - store->count)) {
+        return CONTACT_FILE_TOO_LARGE;
+    }
+    if (!Store_Reserve(store, (int)rows, bytes)) return CONTACT_FILE_NO_MEMORY;
+    if (rejected > 0) {
+        ImportRejection *grown = (ImportRejection*)realloc(result->rejected,
+                                 ((size_t)result->rejectedCount + rejected) * sizeof(ImportRejection));
+        if (!grown) return CONTACT_FILE_NO_MEMORY;
+        result->rejected = grown;
+    }
+
+    for (int w = 0; w < chunkCount; w++) {
+        ImportChunk *chunk = &chunks[w];
+        for (int r = 0; r < chunk->rowCount; r++) {
+            const uint32_t *field = chunk->rows[r].field;
+            if (!Store_Add(store, chunk->text + field[0], chunk->text + field[1],
+                           chunk->text + field[2], chunk->text + field[3])) {
+                return CONTACT_FILE_NO_MEMORY;
+            }
+            result->imported++;
+        }
+        for (int r = 0; r < chunk->rejectedCount; r++) {
+            ImportRejection *out = &result->rejected[result->rejectedCount++];
+            out->line = *line + chunk->rejected[r].line + 1;
+            out->reason = chunk->rejected[r].reason;
+        }
+        result->rows += chunk->rowCount + chunk->rejectedCount;
+        *line += chunk->lines;
+
+        chunk->textUsed = chunk->text ? 1 : 0;
+        chunk->rowCount = 0;
+        chunk->rejectedCount = 0;
+        chunk->lines = 0;
+    }
+    return CONTACT_FILE_OK;
+}
+
+// ------------------------------------------
+// Import a CSV or vCard file into the store
+// ------------------------------------------
+ContactFileStatus Import_File(ContactStore *store, const char *filename, ImportFormat format,
+                              ImportResult *result) {
+    memset(result, 0, sizeof(*result));
+    double t0 = Platform_NowMs();
+
+    MappedFile map;
+    if (!Platform_MapFile(filename, &map)) return CONTACT_FILE_NOT_FOUND;
+
+    ImportJob job;
+    memset(&job, 0, sizeof(job));
+    job.data = map.data;
+    job.size = map.size;
+    job.format = format != IMPORT_AUTO ? format : Import_Detect(filename, map.data, map.size);
+    result->format = job.format;
+
+    // UTF-8 byte order mark
+    size_t pos = 0;
+    if (job.size >= 3 && memcmp(job.data, "\xEF\xBB\xBF", 3) == 0) pos = 3;
+    long long line = 0;
+    if (job.format == IMPORT_CSV && pos < job.size) pos = Import_CsvLayout(&job, pos, &line);
+
+    int workerCount = Platform_CpuCount();
+    if ((size_t)workerCount > job.size / IMPORT_CHUNK_SIZE + 1) {
+        workerCount = (int)(job.size / IMPORT_CHUNK_SIZE + 1);
+    }
+    job.chunks = (ImportChunk*)calloc((size_t)workerCount, sizeof(ImportChunk));
+    ContactFileStatus status = job.chunks ? CONTACT_FILE_OK : CONTACT_FILE_NO_MEMORY;
+
+    while (status == CONTACT_FILE_OK && pos < job.size) {
+        for (int w = 0; w < workerCount; w++) {
+            job.chunks[w].begin = pos;
+            pos = Import_Boundary(&job, pos, pos + IMPORT_CHUNK_SIZE);
+            job.chunks[w].end = pos;
+        }
+        Platform_RunParallel(workerCount, Import_Worker, &job);
+        status = Import_Merge(store, job.chunks, workerCount, &line, result);
+    }
+    if (status == CONTACT_FILE_OK && result->rows == 0) status = CONTACT_FILE_EMPTY;
+
+    for (int w = 0; job.chunks && w < workerCount; w++) {
+        free(job.chunks[w].text);
+        free(job.chunks[w].rows);
+        free(job.chunks[w].rejected);
+    }
+    free(job.chunks);
+    Platform_UnmapFile(&map);
+    result->ms = Platform_NowMs() - t0;
+    return status;
+}
+
+// ------------------------------------------
+// Release the rejection list
+// ------------------------------------------
+void Import_FreeResult(ImportResult *result) {
+    free(result->rejected);
+    result->rejected = NULL;
+    result->rejectedCount = 0;
+}
+
+// ------------------------------------------
+// Human readable reason for a rejected row
+// ------------------------------------------
+const char *Import_ReasonText(ImportReason reason) {
+    switch (reason) {
+        case IMPORT_REJECT_NAME:      return "missing name";
+        case IMPORT_REJECT_PHONE:     return "invalid phone";
+        case IMPORT_REJECT_EMAIL:     return "invalid email";
+        case IMPORT_REJECT_DATE:      return "invalid date";
+        case IMPORT_REJECT_TOO_LONG:  return "field too long";
+        case IMPORT_REJECT_MALFORMED: return "malformed record";
+    }
+    return "unknown";
+}
+
+// ------------------------------------------
+// Write the rejection report
+// ------------------------------------------
+int Import_WriteReport(const ImportResult *result, const char *filename) {
+    FILE *f = fopen(filename, "w");
+    if (!f) return 0;
+    int ok = fprintf(f, "line,reason\n") > 0;
+    for (int i = 0; ok && i < result->rejectedCount; i++) {
+        ok = fprintf(f, "%lld,%s\n", result->rejected[i].line, Import_ReasonText(result->rejected[i].reason)) > 0;
+    }
+    return (fclose(f) == 0) && ok;
+}
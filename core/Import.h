@@ -0,0 +1,67 @@
+#ifndef IMPORT_H
+#define IMPORT_H
+
+#include "ContactFile.h"
+#include "ContactStore.h"
+
+// Bulk import of CSV and vCard (3.0/4.0) exports.
+// The file is memory mapped and read front to back in batches of one
+// chunk per worker, cut at record boundaries, so memory stays bounded
+// whatever the file size. Every chunk is parsed and validated
+// (ValidateName/ValidatePhone/ValidateEmail/ValidateDate) on its own
+// thread; the accepted rows of a batch are then appended to the store in
+// file order with one reservation. Rows that fail are listed with their line number.
+//
+// CSV: RFC 4180 quoting, ',' ';' or tab separated (detected from the
+// first line). A header row naming the columns (name, first/last name,
+// phone, email, date or birthday) is recognized; the first column of each
+// kind is used, skipping those that describe another ("E-mail 1 - Label",
+// "E-mail Type"), as in Google and Outlook exports. Without a header the
+// columns are name, phone, email, date.
+// vCard: FN (or N), the first TEL and EMAIL, and BDAY; folded lines and
+// escapes are decoded, other properties are skipped.
+// Spaces, dots and parentheses in phone numbers are layout and dropped.
+
+typedef enum {
+    IMPORT_AUTO = 0,    // From the extension (.csv, .vcf), else the content
+    IMPORT_CSV,
+    IMPORT_VCARD
+} ImportFormat;
+
+typedef enum {
+    IMPORT_REJECT_NAME = 1,     // No name
+    IMPORT_REJECT_PHONE,        // ValidatePhone failed
+    IMPORT_REJECT_EMAIL,        // ValidateEmail failed
+    IMPORT_REJECT_DATE,         // ValidateDate failed
+    IMPORT_REJECT_TOO_LONG,     // A field does not fit the store
+    IMPORT_REJECT_MALFORMED     // Unterminated quote, vCard without END
+} ImportReason;
+
+typedef struct {
+    long long    line;   // 1-based line where the row or card starts
+    ImportReason reason;
+} ImportRejection;
+
+typedef struct {
+    ImportFormat format;        // As detected
+    int          rows;          // Rows or cards read (header and blank lines excluded)
+    int          imported;
+    int          rejectedCount;
+    ImportRejection *rejected;  // In file order
+    double       ms;            // Wall time of the whole import
+} ImportResult;
+
+// Append the contacts of 'filename' to 'store' (new ids, after the
+// existing contacts). 'result' is always initialized; free it with
+// Import_FreeResult. On an error the contacts of the batches before it
+// stay imported (result->imported).
+ContactFileStatus Import_File(ContactStore *store, const char *filename, ImportFormat format,
+                              ImportResult *result);
+void Import_FreeResult(ImportResult *result);
+
+const char *Import_ReasonText(ImportReason reason);
+
+// Write the rejections as "line,reason" CSV. Returns 1 on success.
+int Import_WriteReport(const ImportResult *result, const char *filename);
+
+#endif // IMPORT_H
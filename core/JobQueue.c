@@ -0,0 +1,220 @@
+#include "JobQueue.h"
+
+#include <string.h>
+
+// ------------------------------------------
+// Tell the owner that something changed (worker thread, no lock held)
+// ------------------------------------------
+static void JobQueue_Notify(JobQueue *queue) {
+    if (queue->notify) queue->notify(queue->notifyContext);
+}
+
+// ------------------------------------------
+// Worker thread: run queued jobs in order until there are none
+// ------------------------------------------
+static void JobQueue_WorkerMain(void *context) {
+    JobWorker *worker = (JobWorker*)context;
+    JobQueue *queue = worker->queue;
+    for (;;) {
+        Platform_Lock(queue->lock);
+        Job *job = queue->jobs;
+        while (job && job->state != JOB_QUEUED) job = job->next;
+        if (!job) {
+            worker->exiting = 1;
+            queue->running--;
+            Platform_Unlock(queue->lock);
+            return;
+        }
+        job->state = JOB_RUNNING;
+        job->changed = 1;
+        Platform_Unlock(queue->lock);
+        JobQueue_Notify(queue);
+
+        int completed = job->run(job);
+
+        // The owner may free the job as soon as the lock is released
+        Platform_Lock(queue->lock);
+        job->state = completed ? JOB_FINISHED : JOB_CANCELLED;
+        job->changed = 1;
+        Platform_Unlock(queue->lock);
+        JobQueue_Notify(queue);
+    }
+}
+
+// ------------------------------------------
+// Set up an empty queue; no thread starts before the first job
+// ------------------------------------------
+int JobQueue_Init(JobQueue *queue, int workerCount, JobNotify notify, void *notifyContext) {
+    memset(queue, 0, sizeof(*queue));
+    queue->lock = Platform_CreateLock();
+    if (!queue->lock) return 0;
+    if (workerCount < 1) workerCount = 1;
+    if (workerCount > JOB_MAX_WORKERS) workerCount = JOB_MAX_WORKERS;
+    queue->workerCount = workerCount;
+    for (int i = 0; i < JOB_MAX_WORKERS; i++) {
+        queue->workers[i].queue = queue;
+    }
+    queue->notify = notify;
+    queue->notifyContext = notifyContext;
+    return 1;
+}
+
+// ------------------------------------------
+// Cancel everything, wait for the workers, release the lock
+// ------------------------------------------
+void JobQueue_Free(JobQueue *queue) {
+    if (!queue->lock) return;
+    Platform_Lock(queue->lock);
+    for (Job *job = queue->jobs; job; job = job->next) {
+        job->cancel = 1;
+        if (job->state == JOB_QUEUED) job->state = JOB_CANCELLED;
+    }
+    Platform_Unlock(queue->lock);
+    JobQueue_Wait(queue);
+    Platform_FreeLock(queue->lock);
+    memset(queue, 0, sizeof(*queue));
+}
+
+// ------------------------------------------
+// Start a worker thread in a free slot; called with the lock held.
+// Returns 0 if the thread cannot be started.
+// ------------------------------------------
+static int JobQueue_StartWorker(JobQueue *queue) {
+    for (int i = 0; i < queue->workerCount; i++) {
+        JobWorker *worker = &queue->workers[i];
+        if (worker->thread && worker->exiting) {
+            // It holds no lock any more and is about to return
+            Platform_JoinThread(worker->thread);
+            worker->thread = NULL;
+        }
+        if (worker->thread) continue;
+        worker->exiting = 0;
+        worker->thread = Platform_StartThread(JobQueue_WorkerMain, worker);
+        if (!worker->thread) return 0;
+        queue->running++;
+        return 1;
+    }
+    return 0;
+}
+
+// ------------------------------------------
+// Append a job and make sure a worker will pick it up
+// ------------------------------------------
+int JobQueue_Submit(JobQueue *queue, Job *job) {
+    job->state = JOB_QUEUED;
+    job->done = 0;
+    job->total = 0;
+    job->cancel = 0;
+    job->changed = 0;
+    job->next = NULL;
+    job->queue = queue;
+
+    Platform_Lock(queue->lock);
+    Job **tail = &queue->jobs;
+    while (*tail) tail = &(*tail)->next;
+    *tail = job;
+    job->id = ++queue->nextId;
+    int ok = 1;
+    if (queue->running < queue->workerCount && !JobQueue_StartWorker(queue) && queue->running == 0) {
+        // Nobody would ever run it
+        *tail = NULL;
+        ok = 0;
+    }
+    Platform_Unlock(queue->lock);
+    return ok;
+}
+
+// ------------------------------------------
+// Ask a job to stop; a queued one is cancelled at once
+// ------------------------------------------
+void JobQueue_Cancel(JobQueue *queue, Job *job) {
+    Platform_Lock(queue->lock);
+    for (Job *j = queue->jobs; j; j = j->next) {
+        if (j != job) continue;
+        job->cancel = 1;
+        if (job->state == JOB_QUEUED) {
+            job->state = JOB_CANCELLED;
+            job->changed = 1;
+        }
+        break;
+    }
+    Platform_Unlock(queue->lock);
+}
+
+// ------------------------------------------
+// Report the next change; finished jobs leave the queue
+// ------------------------------------------
+int JobQueue_Poll(JobQueue *queue, JobEvent *event) {
+    int found = 0;
+    Platform_Lock(queue->lock);
+    for (Job **link = &queue->jobs; *link; link = &(*link)->next) {
+        Job *job = *link;
+        if (!job->changed) continue;
+        job->changed = 0;
+        event->job = job;
+        event->state = job->state;
+        event->done = job->done;
+        event->total = job->total;
+        if (job->state == JOB_FINISHED || job->state == JOB_CANCELLED) {
+            *link = job->next;
+            job->next = NULL;
+        }
+        found = 1;
+        break;
+    }
+    Platform_Unlock(queue->lock);
+    return found;
+}
+
+// ------------------------------------------
+// Jobs still to run or running
+// ------------------------------------------
+int JobQueue_Pending(JobQueue *queue) {
+    int pending = 0;
+    Platform_Lock(queue->lock);
+    for (Job *job = queue->jobs; job; job = job->next) {
+        if (job->state == JOB_QUEUED || job->state == JOB_RUNNING) pending++;
+    }
+    Platform_Unlock(queue->lock);
+    return pending;
+}
+
+// ------------------------------------------
+// Wait for the workers; they end once nothing is queued
+// Only the owner's thread starts workers, so none appears meanwhile.
+// ------------------------------------------
+void JobQueue_Wait(JobQueue *queue) {
+    for (int i = 0; i < JOB_MAX_WORKERS; i++) {
+        JobWorker *worker = &queue->workers[i];
+        if (!worker->thread) continue;
+        Platform_JoinThread(worker->thread);
+        worker->thread = NULL;
+        worker->exiting = 0;
+    }
+}
+
+// ------------------------------------------
+// Record the progress of a running job
+// ------------------------------------------
+void Job_Progress(Job *job, int done, int total) {
+    JobQueue *queue = job->queue;
+    Platform_Lock(queue->lock);
+    int changed = job->done != done || job->total != total;
+    if (changed) {
+        job->done = done;
+        job->total = total;
+        job->changed = 1;
+    }
+    Platform_Unlock(queue->lock);
+    if (changed) JobQueue_Notify(queue);
+}
+
+// ------------------------------------------
+// Has the owner asked this job to stop?
+// ------------------------------------------
+int Job_Cancelled(Job *job) {
+    Platform_Lock(job->queue->lock);
+    int cancel = job->cancel;
+    Platform_Unlock(job->queue->lock);
+    return cancel;
+}
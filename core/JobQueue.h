@@ -0,0 +1,106 @@
+#ifndef JOB_QUEUE_H
+#define JOB_QUEUE_H
+
+#include "Platform.h"
+
+// Background jobs, so that a UI thread never blocks on a long operation.
+// Jobs are queued and run in order on a small pool of worker threads,
+// started on demand and ended once the queue is empty. The UI side never
+// waits: it submits, asks for cancellation, and polls for what changed.
+// A worker reports progress and completion through the 'notify' callback
+// (called on the worker thread, outside any lock): a Win32 UI posts
+// itself a message there and calls JobQueue_Poll when it arrives; a
+// command line tool or a test can poll or JobQueue_Wait instead.
+//
+// Cancellation is cooperative: the job's run function checks
+// Job_Cancelled between its steps and stops early. A job still queued
+// when it is cancelled never runs.
+
+#define JOB_MAX_WORKERS 4
+
+typedef enum {
+    JOB_QUEUED = 0,
+    JOB_RUNNING,
+    JOB_FINISHED,       // Ran to the end; its results are valid
+    JOB_CANCELLED       // Stopped early or never ran; results are not valid
+} JobState;
+
+typedef struct Job Job;
+typedef struct JobQueue JobQueue;
+
+// Runs on a worker thread. Returns 0 if it stopped because it was cancelled.
+typedef int  (*JobRun)(Job *job);
+typedef void (*JobNotify)(void *context);
+
+// Embed a Job at the start of a larger struct holding the inputs and
+// results of the work; the queue never frees it.
+struct Job {
+    JobRun   run;
+    int      id;         // Set by JobQueue_Submit, counting from 1
+    // Shared with the worker, under the queue's lock
+    JobState state;
+    int      done;       // Progress: 'done' steps out of 'total'
+    int      total;
+    int      cancel;
+    int      changed;    // Progress or state not yet polled
+    Job     *next;
+    JobQueue *queue;
+};
+
+typedef struct {
+    JobQueue       *queue;
+    PlatformThread *thread;      // NULL when the slot is free
+    int             exiting;     // Found nothing to do and is ending
+} JobWorker;
+
+struct JobQueue {
+    PlatformLock   *lock;
+    Job            *jobs;        // Submitted and not yet polled as finished, in order
+    JobWorker       workers[JOB_MAX_WORKERS];
+    int             workerCount; // Worker threads allowed
+    int             running;     // Worker threads not ending
+    int             nextId;
+    JobNotify       notify;
+    void           *notifyContext;
+};
+
+// What JobQueue_Poll reports
+typedef struct {
+    Job     *job;
+    JobState state;
+    int      done;
+    int      total;
+} JobEvent;
+
+// 'workerCount' threads at most (1 runs the jobs one after the other).
+// Returns 0 when out of memory.
+int  JobQueue_Init(JobQueue *queue, int workerCount, JobNotify notify, void *notifyContext);
+
+// Cancel every job, wait for the workers and release the queue. Jobs not
+// yet polled as finished are dropped from it (their owner frees them).
+void JobQueue_Free(JobQueue *queue);
+
+// Queue 'job' (run set, the rest zeroed). Returns 0 if no worker can be
+// started; the job is then not queued.
+int  JobQueue_Submit(JobQueue *queue, Job *job);
+
+// Ask 'job' to stop. It is reported as JOB_CANCELLED, unless it was
+// already past its last check.
+void JobQueue_Cancel(JobQueue *queue, Job *job);
+
+// The next job whose progress or state changed since the last poll.
+// Returns 0 when there is none. Once a job is reported JOB_FINISHED or
+// JOB_CANCELLED it has left the queue and belongs to the caller again.
+int  JobQueue_Poll(JobQueue *queue, JobEvent *event);
+
+// Jobs queued or running
+int  JobQueue_Pending(JobQueue *queue);
+
+// Block until every queued job has run (for tools and shutdown)
+void JobQueue_Wait(JobQueue *queue);
+
+// Called by a job's run function, on the worker thread
+void Job_Progress(Job *job, int done, int total);
+int  Job_Cancelled(Job *job);
+
+#endif // JOB_QUEUE_H
@@ -0,0 +1,577 @@
+#include "Journal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ------------------------------------------
+//              Journal format
+// ------------------------------------------
+// All integers are little-endian.
+//
+// Header (72 bytes):
+//   0  char[4]   magic "CMJL"
+//   4  uint16    version (1)
+//   6  uint16    reserved (0)
+//   8  uint64    sequence number of the first record
+//  16  uint8[16] id of the snapshot it belongs to (ContactFile_SnapshotId)
+//  32  uint8[16] PBKDF2 salt
+//  48  uint32    PBKDF2-HMAC-SHA256 iterations
+//  52  uint32    reserved (0)
+//  56  uint8[16] key check: AEAD tag of an empty message over bytes 0..55
+//
+// Followed by records until the end of the file:
+//   0  uint32    payload size
+//   4  uint8[12] nonce
+//  16  payload, ChaCha20-Poly1305 ciphertext with the first 16 bytes as
+//      associated data, then a 16-byte tag
+//
+// Payload:
+//   0  uint64    sequence number (one more than the previous record)
+//   8  uint8     JournalOp
+//   9  uint64    contact id
+//  17  adds and updates: name, phone, email and date, each as a LEB128
+//      length followed by that many bytes
+//
+// Replay stops at the first record that is incomplete, fails to
+// authenticate or is out of sequence: a crash can only tear the end.
+
+#define JOURNAL_VERSION         1
+#define JOURNAL_RECORD_HEADER   16
+#define JOURNAL_FIXED_PAYLOAD   17
+#define JOURNAL_MAX_PAYLOAD     (JOURNAL_FIXED_PAYLOAD + 4 * 2 + CONTACT_NAME_SIZE + CONTACT_PHONE_SIZE + \
+                                 CONTACT_EMAIL_SIZE + CONTACT_DATE_SIZE)
+#define JOURNAL_SALT_SIZE       16
+#define JOURNAL_KDF_ITERATIONS  100000
+#define JOURNAL_MAX_KDF_ITERATIONS 10000000
+
+static const char JOURNAL_MAGIC[4] = { 'C', 'M', 'J', 'L' };
+
+// ------------------------------------------
+// Little-endian helpers
+// ------------------------------------------
+static void Journal_Put32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void Journal_Put64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t Journal_Get32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t Journal_Get64(const unsigned char *p) {
+    return (uint64_t)Journal_Get32(p) | ((uint64_t)Journal_Get32(p + 4) << 32);
+}
+
+// ------------------------------------------
+// "<snapshotPath><suffix>", malloc'd
+// ------------------------------------------
+static char *Journal_Path(const char *snapshotPath, const char *suffix) {
+    size_t base = strlen(snapshotPath), extra = strlen(suffix);
+    char *path = (char*)malloc(base + extra + 1);
+    if (!path) return NULL;
+    memcpy(path, snapshotPath, base);
+    memcpy(path + base, suffix, extra + 1);
+    return path;
+}
+
+// ------------------------------------------
+// Key check tag over the first 56 header bytes
+// ------------------------------------------
+static void Journal_KeyCheck(const uint8_t key[CRYPTO_KEY_SIZE], const unsigned char *header,
+                             uint8_t check[CRYPTO_TAG_SIZE]) {
+    uint8_t nonce[CRYPTO_NONCE_SIZE];
+    memset(nonce, 0xFF, sizeof(nonce));  // Records never use an all-ones nonce
+    Aead_Seal(key, nonce, header, 56, NULL, 0, check);
+}
+
+// ------------------------------------------
+// Point a header at a snapshot and its first record, and reseal it
+// ------------------------------------------
+static void Journal_BindHeader(unsigned char *header, const uint8_t key[CRYPTO_KEY_SIZE], uint64_t firstSeq,
+                               const unsigned char snapshotId[CONTACT_SNAPSHOT_ID_SIZE]) {
+    Journal_Put64(header + 8, firstSeq);
+    memcpy(header + 16, snapshotId, CONTACT_SNAPSHOT_ID_SIZE);
+    Journal_KeyCheck(key, header, header + 56);
+}
+
+// ------------------------------------------
+// Does the journal at 'path' belong to the snapshot 'snapshotId'?
+// ------------------------------------------
+static int Journal_BelongsTo(const char *path, const unsigned char snapshotId[CONTACT_SNAPSHOT_ID_SIZE]) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    unsigned char header[JOURNAL_HEADER_SIZE];
+    int belongs = (fread(header, 1, sizeof(header), f) == sizeof(header) &&
+                   memcmp(header, JOURNAL_MAGIC, 4) == 0 &&
+                   memcmp(header + 16, snapshotId, CONTACT_SNAPSHOT_ID_SIZE) == 0);
+    fclose(f);
+    return belongs;
+}
+
+// ------------------------------------------
+// Initialize a closed journal
+// ------------------------------------------
+void Journal_Init(Journal *journal) {
+    memset(journal, 0, sizeof(*journal));
+}
+
+// ------------------------------------------
+// Take over an open journal file for appending
+// ------------------------------------------
+static ContactFileStatus Journal_Attach(Journal *journal, FILE *file, const char *snapshotPath,
+                                        const unsigned char *header, const uint8_t key[CRYPTO_KEY_SIZE],
+                                        uint64_t nextSeq, uint64_t size, int records) {
+    journal->snapshotPath = Journal_Path(snapshotPath, "");
+    if (!journal->snapshotPath || !Platform_RandomBytes(journal->noncePrefix, sizeof(journal->noncePrefix)) ||
+        fseek(file, 0, SEEK_END) != 0) {
+        fclose(file);
+        free(journal->snapshotPath);
+        Journal_Init(journal);
+        return CONTACT_FILE_OPEN_FAILED;
+    }
+    journal->file = file;
+    memcpy(journal->header, header, JOURNAL_HEADER_SIZE);
+    memcpy(journal->key, key, CRYPTO_KEY_SIZE);
+    journal->nextSeq = nextSeq;
+    journal->size = size;
+    journal->records = records;
+    journal->pending = 0;
+    journal->failed = 0;
+    return CONTACT_FILE_OK;
+}
+
+// ------------------------------------------
+// Read one LEB128-prefixed field into a '\0' terminated buffer
+// ------------------------------------------
+static const unsigned char *Journal_GetField(const unsigned char *p, const unsigned char *end,
+                                             char *out, size_t size) {
+    size_t len = 0;
+    int shift = 0;
+    unsigned char b;
+    do {
+        if (p >= end || shift > 28) return NULL;
+        b = *p++;
+        len |= (size_t)(b & 0x7F) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    if (len >= size || len > (size_t)(end - p)) return NULL;
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return p + len;
+}
+
+// ------------------------------------------
+// Apply one decrypted record to the store
+// ------------------------------------------
+static ContactFileStatus Journal_Apply(ContactStore *store, const unsigned char *payload, size_t len) {
+    char name[CONTACT_NAME_SIZE], phone[CONTACT_PHONE_SIZE];
+    char email[CONTACT_EMAIL_SIZE], date[CONTACT_DATE_SIZE];
+    JournalOp op = (JournalOp)payload[8];
+    uint64_t id = Journal_Get64(payload + 9);
+    const unsigned char *end = payload + len;
+
+    if (op == JOURNAL_DELETE) {
+        int row = Store_FindId(store, id);
+        if (row < 0 || len != JOURNAL_FIXED_PAYLOAD) return CONTACT_FILE_CORRUPT;
+        return Store_Delete(store, row) ? CONTACT_FILE_OK : CONTACT_FILE_NO_MEMORY;
+    }
+    if (op != JOURNAL_ADD && op != JOURNAL_UPDATE) return CONTACT_FILE_CORRUPT;
+
+    const unsigned char *p = payload + JOURNAL_FIXED_PAYLOAD;
+    p = Journal_GetField(p, end, name, sizeof(name));
+    if (p) p = Journal_GetField(p, end, phone, sizeof(phone));
+    if (p) p = Journal_GetField(p, end, email, sizeof(email));
+    if (p) p = Journal_GetField(p, end, date, sizeof(date));
+    if (p != end) return CONTACT_FILE_CORRUPT;
+
+    if (op == JOURNAL_ADD) {
+        if (id < store->nextId) return CONTACT_FILE_CORRUPT;
+        return Store_AddId(store, id, name, phone, email, date) ? CONTACT_FILE_OK : CONTACT_FILE_NO_MEMORY;
+    }
+    int row = Store_FindId(store, id);
+    if (row < 0) return CONTACT_FILE_CORRUPT;
+    return Store_Update(store, row, name, phone, email, date) ? CONTACT_FILE_OK : CONTACT_FILE_NO_MEMORY;
+}
+
+// ------------------------------------------
+// Put a checkpoint that was interrupted by a crash right
+// The .next journal only counts once its snapshot is in place.
+// ------------------------------------------
+static int Journal_Recover(const char *snapshotPath, const unsigned char snapshotId[CONTACT_SNAPSHOT_ID_SIZE]) {
+    char *path = Journal_Path(snapshotPath, ".journal");
+    char *next = Journal_Path(snapshotPath, ".journal.next");
+    char *checkpoint = Journal_Path(snapshotPath, ".checkpoint");
+    int ok = path && next && checkpoint;
+    if (ok) {
+        if (Journal_BelongsTo(next, snapshotId)) {
+            ok = Platform_ReplaceFile(next, path);
+        } else {
+            remove(next);
+        }
+        remove(checkpoint);
+    }
+    free(path);
+    free(next);
+    free(checkpoint);
+    return ok;
+}
+
+// ------------------------------------------
+// Replay the journal of a snapshot and keep it open
+// ------------------------------------------
+ContactFileStatus Journal_Open(Journal *journal, const char *snapshotPath, const char *passphrase,
+                               ContactStore *store) {
+    Journal_Close(journal);
+    unsigned char snapshotId[CONTACT_SNAPSHOT_ID_SIZE];
+    if (!ContactFile_SnapshotId(snapshotPath, snapshotId)) return CONTACT_FILE_NOT_FOUND;
+    if (!passphrase || !passphrase[0]) return CONTACT_FILE_BAD_PASSPHRASE;
+    if (!Journal_Recover(snapshotPath, snapshotId)) return CONTACT_FILE_NO_MEMORY;
+
+    char *path = Journal_Path(snapshotPath, ".journal");
+    if (!path) return CONTACT_FILE_NO_MEMORY;
+    MappedFile map;
+    if (!Platform_MapFile(path, &map)) {
+        free(path);
+        return CONTACT_FILE_NOT_FOUND;
+    }
+
+    // A journal of an older snapshot holds nothing that is not in this one
+    ContactFileStatus status = CONTACT_FILE_OK;
+    const unsigned char *header = map.data;
+    if (map.size < JOURNAL_HEADER_SIZE || memcmp(header, JOURNAL_MAGIC, 4) != 0 ||
+        memcmp(header + 16, snapshotId, CONTACT_SNAPSHOT_ID_SIZE) != 0) {
+        status = CONTACT_FILE_NOT_FOUND;
+    } else if ((header[4] | (header[5] << 8)) != JOURNAL_VERSION) {
+        status = CONTACT_FILE_UNSUPPORTED;
+    } else {
+        uint32_t iterations = Journal_Get32(header + 48);
+        if (iterations == 0 || iterations > JOURNAL_MAX_KDF_ITERATIONS) status = CONTACT_FILE_UNSUPPORTED;
+    }
+
+    uint8_t key[CRYPTO_KEY_SIZE];
+    if (status == CONTACT_FILE_OK) {
+        uint8_t check[CRYPTO_TAG_SIZE];
+        uint8_t diff = 0;
+        Pbkdf2_Sha256((const uint8_t*)passphrase, strlen(passphrase), header + 32, JOURNAL_SALT_SIZE,
+                      Journal_Get32(header + 48), key, sizeof(key));
+        Journal_KeyCheck(key, header, check);
+        for (int i = 0; i < CRYPTO_TAG_SIZE; i++) diff |= (uint8_t)(check[i] ^ header[56 + i]);
+        // The snapshot has already taken this passphrase: a journal of the
+        // same snapshot that does not is damaged, not locked differently
+        if (diff != 0) status = CONTACT_FILE_CORRUPT;
+    }
+
+    uint64_t seq = 0;
+    size_t pos = JOURNAL_HEADER_SIZE;
+    int records = 0;
+    if (status == CONTACT_FILE_OK) {
+        unsigned char payload[JOURNAL_MAX_PAYLOAD];
+        seq = Journal_Get64(header + 8);
+        while (status == CONTACT_FILE_OK && map.size - pos >= JOURNAL_RECORD_HEADER + CRYPTO_TAG_SIZE) {
+            const unsigned char *record = map.data + pos;
+            uint32_t len = Journal_Get32(record);
+            if (len < JOURNAL_FIXED_PAYLOAD || len > JOURNAL_MAX_PAYLOAD ||
+                map.size - pos - JOURNAL_RECORD_HEADER - CRYPTO_TAG_SIZE < len) {
+                break;
+            }
+            memcpy(payload, record + JOURNAL_RECORD_HEADER, len);
+            if (!Aead_Open(key, record + 4, record, JOURNAL_RECORD_HEADER, payload, len,
+                           record + JOURNAL_RECORD_HEADER + len) ||
+                Journal_Get64(payload) != seq) {
+                break;
+            }
+            status = Journal_Apply(store, payload, len);
+            seq++;
+            records++;
+            pos += JOURNAL_RECORD_HEADER + len + CRYPTO_TAG_SIZE;
+        }
+        Crypto_Wipe(payload, sizeof(payload));
+    }
+    unsigned char kept[JOURNAL_HEADER_SIZE];
+    if (map.size >= JOURNAL_HEADER_SIZE) memcpy(kept, header, JOURNAL_HEADER_SIZE);
+    uint64_t fileSize = map.size;
+    Platform_UnmapFile(&map);
+
+    // Cut off a torn tail, then append after the last good record
+    if (status == CONTACT_FILE_OK) {
+        FILE *file = fopen(path, "r+b");
+        if (!file || (pos < fileSize && !Platform_TruncateFile(file, pos))) {
+            if (file) fclose(file);
+            status = CONTACT_FILE_OPEN_FAILED;
+        } else {
+            status = Journal_Attach(journal, file, snapshotPath, kept, key, seq, pos, records);
+        }
+        if (store->deleted > 0) Store_Purge(store, NULL);
+    }
+    Crypto_Wipe(key, sizeof(key));
+    free(path);
+    return status;
+}
+
+// ------------------------------------------
+// Write a fresh journal for the snapshot at 'snapshotPath'
+// ------------------------------------------
+ContactFileStatus Journal_Create(Journal *journal, const char *snapshotPath, const char *passphrase) {
+    Journal_Close(journal);
+    unsigned char snapshotId[CONTACT_SNAPSHOT_ID_SIZE];
+    if (!ContactFile_SnapshotId(snapshotPath, snapshotId)) return CONTACT_FILE_UNSUPPORTED;
+    if (!passphrase || !passphrase[0]) return CONTACT_FILE_BAD_PASSPHRASE;
+
+    unsigned char header[JOURNAL_HEADER_SIZE];
+    uint8_t key[CRYPTO_KEY_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, JOURNAL_MAGIC, 4);
+    header[4] = JOURNAL_VERSION;
+    Journal_Put32(header + 48, JOURNAL_KDF_ITERATIONS);
+    if (!Platform_RandomBytes(header + 32, JOURNAL_SALT_SIZE)) return CONTACT_FILE_WRITE_FAILED;
+    Pbkdf2_Sha256((const uint8_t*)passphrase, strlen(passphrase), header + 32, JOURNAL_SALT_SIZE,
+                  JOURNAL_KDF_ITERATIONS, key, sizeof(key));
+    Journal_BindHeader(header, key, 1, snapshotId);
+
+    // Header to a temp file first, so a crash never leaves a headless journal
+    char *path = Journal_Path(snapshotPath, ".journal");
+    char *tmp = Journal_Path(snapshotPath, ".journal.tmp");
+    ContactFileStatus status = (path && tmp) ? CONTACT_FILE_OK : CONTACT_FILE_NO_MEMORY;
+    FILE *file = NULL;
+    if (status == CONTACT_FILE_OK) {
+        file = fopen(tmp, "wb");
+        if (!file) status = CONTACT_FILE_OPEN_FAILED;
+    }
+    if (status == CONTACT_FILE_OK) {
+        int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) && Platform_SyncFile(file);
+        ok = (fclose(file) == 0) && ok;
+        if (!ok || !Platform_ReplaceFile(tmp, path)) {
+            remove(tmp);
+            status = CONTACT_FILE_WRITE_FAILED;
+        }
+    }
+    if (status == CONTACT_FILE_OK) {
+        file = fopen(path, "r+b");
+        status = file ? Journal_Attach(journal, file, snapshotPath, header, key, 1, sizeof(header), 0)
+                      : CONTACT_FILE_OPEN_FAILED;
+    }
+    Crypto_Wipe(key, sizeof(key));
+    free(path);
+    free(tmp);
+    return status;
+}
+
+// ------------------------------------------
+// Append one change
+// ------------------------------------------
+int Journal_Append(Journal *journal, JournalOp op, const ContactStore *store, int row) {
+    if (!journal->file || journal->failed) return 0;
+
+    unsigned char record[JOURNAL_RECORD_HEADER + JOURNAL_MAX_PAYLOAD + CRYPTO_TAG_SIZE];
+    unsigned char *payload = record + JOURNAL_RECORD_HEADER;
+    Journal_Put64(payload, journal->nextSeq);
+    payload[8] = (unsigned char)op;
+    Journal_Put64(payload + 9, Store_GetId(store, row));
+    unsigned char *p = payload + JOURNAL_FIXED_PAYLOAD;
+    if (op != JOURNAL_DELETE) {
+        const char *fields[4] = {
+            Store_GetName(store, row), Store_GetPhone(store, row), Store_GetEmail(store, row), Store_GetDate(store, row)
+        };
+        for (int f = 0; f < 4; f++) {
+            size_t len = strlen(fields[f]);
+            if (len >= 0x80) *p++ = (unsigned char)(len | 0x80);
+            *p++ = (unsigned char)(len >= 0x80 ? len >> 7 : len);
+            memcpy(p, fields[f], len);
+            p += len;
+        }
+    }
+
+    // Nonce: random per open, then the record's sequence number
+    uint32_t len = (uint32_t)(p - payload);
+    Journal_Put32(record, len);
+    memcpy(record + 4, journal->noncePrefix, sizeof(journal->noncePrefix));
+    Journal_Put32(record + 12, (uint32_t)journal->nextSeq);
+    Aead_Seal(journal->key, record + 4, record, JOURNAL_RECORD_HEADER, payload, len, payload + len);
+
+    size_t total = JOURNAL_RECORD_HEADER + len + CRYPTO_TAG_SIZE;
+    if (fwrite(record, 1, total, journal->file) != total || fflush(journal->file) != 0) {
+        journal->failed = 1;
+        return 0;
+    }
+    journal->nextSeq++;
+    journal->size += total;
+    journal->records++;
+    journal->pending++;
+    if (journal->pending >= JOURNAL_GROUP_RECORDS) return Journal_Commit(journal);
+    return 1;
+}
+
+// ------------------------------------------
+// Group commit: one sync for every record appended since the last one
+// ------------------------------------------
+int Journal_Commit(Journal *journal) {
+    if (!journal->file) return 1;
+    if (journal->pending > 0 && !journal->failed) {
+        if (!Platform_SyncFile(journal->file)) journal->failed = 1;
+        journal->pending = 0;
+    }
+    return !journal->failed;
+}
+
+// ------------------------------------------
+// Replay time grows with the journal; a checkpoint resets it
+// ------------------------------------------
+int Journal_NeedsCheckpoint(const Journal *journal, const ContactStore *store) {
+    return journal->file && !journal->failed && journal->records >= JOURNAL_CHECKPOINT_MIN &&
+           journal->records >= Store_LiveCount(store) / 4;
+}
+
+// ------------------------------------------
+// Sync and close the journal file
+// ------------------------------------------
+void Journal_Close(Journal *journal) {
+    if (journal->file) {
+        Journal_Commit(journal);
+        fclose(journal->file);
+    }
+    free(journal->snapshotPath);
+    Crypto_Wipe(journal->key, sizeof(journal->key));
+    Journal_Init(journal);
+}
+
+// ------------------------------------------
+// Background thread of a checkpoint: save the copy as a v2 snapshot
+// ------------------------------------------
+static void Journal_CheckpointMain(void *context) {
+    JournalCheckpoint *checkpoint = (JournalCheckpoint*)context;
+    checkpoint->status = ContactFile_SaveV2(&checkpoint->copy, checkpoint->path,
+                                            CONTACT_V2_COMPRESSED | CONTACT_V2_ENCRYPTED, checkpoint->passphrase);
+}
+
+// ------------------------------------------
+// Release what a checkpoint holds
+// ------------------------------------------
+static void Journal_CheckpointFree(JournalCheckpoint *checkpoint) {
+    Store_Free(&checkpoint->copy);
+    if (checkpoint->passphrase) {
+        Crypto_Wipe(checkpoint->passphrase, strlen(checkpoint->passphrase));
+        free(checkpoint->passphrase);
+    }
+    free(checkpoint->path);
+    memset(checkpoint, 0, sizeof(*checkpoint));
+}
+
+// ------------------------------------------
+// Cut the journal and save the store as it is now, in the background
+// ------------------------------------------
+int Journal_StartCheckpoint(JournalCheckpoint *checkpoint, Journal *journal, const ContactStore *store,
+                            const char *passphrase) {
+    memset(checkpoint, 0, sizeof(*checkpoint));
+    if (!journal->file || journal->failed || !passphrase || !passphrase[0]) return 0;
+
+    checkpoint->passphrase = Journal_Path(passphrase, "");
+    checkpoint->path = Journal_Path(journal->snapshotPath, ".checkpoint");
+    if (!checkpoint->passphrase || !checkpoint->path || !Store_Copy(&checkpoint->copy, store)) {
+        Journal_CheckpointFree(checkpoint);
+        return 0;
+    }
+    checkpoint->cutSize = journal->size;
+    checkpoint->cutSeq = journal->nextSeq;
+    checkpoint->cutRecords = journal->records;
+    checkpoint->thread = Platform_StartThread(Journal_CheckpointMain, checkpoint);
+    if (!checkpoint->thread) {
+        Journal_CheckpointFree(checkpoint);
+        return 0;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Has the background save finished?
+// ------------------------------------------
+int Journal_CheckpointDone(JournalCheckpoint *checkpoint) {
+    return !checkpoint->thread || Platform_ThreadFinished(checkpoint->thread);
+}
+
+// ------------------------------------------
+// Write the journal of the new snapshot: the records after the cut
+// ------------------------------------------
+static ContactFileStatus Journal_WriteNext(const JournalCheckpoint *checkpoint, Journal *journal,
+                                           const char *next, const unsigned char *header) {
+    FILE *out = fopen(next, "wb");
+    if (!out) return CONTACT_FILE_OPEN_FAILED;
+    int ok = fwrite(header, 1, JOURNAL_HEADER_SIZE, out) == JOURNAL_HEADER_SIZE;
+
+    unsigned char buffer[64 * 1024];
+    uint64_t left = journal->size - checkpoint->cutSize;
+    ok = ok && Platform_SeekFile(journal->file, checkpoint->cutSize);
+    while (ok && left > 0) {
+        size_t chunk = left < sizeof(buffer) ? (size_t)left : sizeof(buffer);
+        ok = fread(buffer, 1, chunk, journal->file) == chunk && fwrite(buffer, 1, chunk, out) == chunk;
+        left -= chunk;
+    }
+    ok = fseek(journal->file, 0, SEEK_END) == 0 && ok;
+    ok = ok && Platform_SyncFile(out);
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) remove(next);
+    return ok ? CONTACT_FILE_OK : CONTACT_FILE_WRITE_FAILED;
+}
+
+// ------------------------------------------
+// Switch to the new snapshot and its journal
+// Order matters for crash safety: the .next journal is complete before
+// the snapshot moves, and Journal_Open adopts it if the move happened.
+// ------------------------------------------
+static ContactFileStatus Journal_Switch(JournalCheckpoint *checkpoint, Journal *journal) {
+    unsigned char snapshotId[CONTACT_SNAPSHOT_ID_SIZE];
+    if (!Journal_Commit(journal) || !ContactFile_SnapshotId(checkpoint->path, snapshotId)) {
+        return CONTACT_FILE_WRITE_FAILED;
+    }
+
+    unsigned char header[JOURNAL_HEADER_SIZE];
+    memcpy(header, journal->header, sizeof(header));
+    Journal_BindHeader(header, journal->key, checkpoint->cutSeq, snapshotId);
+
+    char *path = Journal_Path(journal->snapshotPath, ".journal");
+    char *next = Journal_Path(journal->snapshotPath, ".journal.next");
+    ContactFileStatus status = (path && next) ? Journal_WriteNext(checkpoint, journal, next, header)
+                                              : CONTACT_FILE_NO_MEMORY;
+    if (status == CONTACT_FILE_OK && !Platform_ReplaceFile(checkpoint->path, journal->snapshotPath)) {
+        remove(next);
+        status = CONTACT_FILE_WRITE_FAILED;
+    }
+
+    // From here on the new snapshot is the current one
+    if (status == CONTACT_FILE_OK) {
+        uint64_t size = JOURNAL_HEADER_SIZE + (journal->size - checkpoint->cutSize);
+        int records = journal->records - checkpoint->cutRecords;
+        uint8_t key[CRYPTO_KEY_SIZE];
+        char *snapshotPath = Journal_Path(journal->snapshotPath, "");
+        memcpy(key, journal->key, sizeof(key));
+        Journal_Close(journal);
+
+        FILE *file = NULL;
+        if (snapshotPath && Platform_ReplaceFile(next, path)) file = fopen(path, "r+b");
+        status = file ? Journal_Attach(journal, file, snapshotPath, header, key, checkpoint->cutSeq + (uint64_t)records,
+                                       size, records)
+                      : CONTACT_FILE_WRITE_FAILED;
+        Crypto_Wipe(key, sizeof(key));
+        free(snapshotPath);
+    }
+    free(path);
+    free(next);
+    return status;
+}
+
+// ------------------------------------------
+// Complete a checkpoint on the calling thread
+// ------------------------------------------
+ContactFileStatus Journal_FinishCheckpoint(JournalCheckpoint *checkpoint, Journal *journal) {
+    Platform_JoinThread(checkpoint->thread);
+    checkpoint->thread = NULL;
+
+    ContactFileStatus status = checkpoint->status;
+    if (status == CONTACT_FILE_OK && (!journal->file || journal->failed)) status = CONTACT_FILE_WRITE_FAILED;
+    if (status == CONTACT_FILE_OK) status = Journal_Switch(checkpoint, journal);
+    if (status != CONTACT_FILE_OK && checkpoint->path) remove(checkpoint->path);
+    Journal_CheckpointFree(checkpoint);
+    return status;
+}
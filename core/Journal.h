@@ -0,0 +1,112 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ContactFile.h"
+#include "ContactStore.h"
+#include "Crypto.h"
+#include "Platform.h"
+
+// Append-only change journal next to an encrypted v2 snapshot.
+// Adds, updates and deletes are appended as small encrypted records, so
+// saving one edit costs O(change) I/O instead of rewriting the file.
+// Records are written through to the OS at once and synced to disk in
+// groups (Journal_Commit); a crash loses at most the records appended
+// since the last commit.
+//
+// Loading replays the journal on top of its snapshot. A checkpoint
+// writes a new snapshot from a copy of the store on a background thread
+// and then switches to a new journal holding only the records appended
+// meanwhile. Every step leaves a snapshot and a journal on disk that
+// together hold every committed change.
+//
+// Files, for a snapshot "contacts.txt":
+//   contacts.txt.journal         the journal of contacts.txt
+//   contacts.txt.checkpoint      snapshot being written by a checkpoint
+//   contacts.txt.journal.next    journal of that snapshot, until it is in place
+
+// Sync at least this often while records are pending (the group commit
+// window) and whenever this many records are pending
+#define JOURNAL_COMMIT_MS       250
+#define JOURNAL_GROUP_RECORDS   256
+// Checkpoint once the journal holds this many records and a quarter as
+// many as there are contacts
+#define JOURNAL_CHECKPOINT_MIN  1024
+
+#define JOURNAL_HEADER_SIZE     72
+
+typedef enum {
+    JOURNAL_ADD = 1,
+    JOURNAL_UPDATE,
+    JOURNAL_DELETE
+} JournalOp;
+
+typedef struct {
+    FILE    *file;            // NULL while no journal is open
+    char    *snapshotPath;
+    unsigned char header[JOURNAL_HEADER_SIZE];
+    uint8_t  key[CRYPTO_KEY_SIZE];
+    uint8_t  noncePrefix[8];  // Random per open; the record counter follows
+    uint64_t nextSeq;
+    uint64_t size;            // Bytes in the file
+    int      records;         // Records in the file
+    int      pending;         // Appended since the last commit
+    int      failed;          // Sticky write error; the journal needs a full save
+} Journal;
+
+typedef struct {
+    ContactStore     copy;
+    PlatformThread  *thread;
+    char            *passphrase;
+    char            *path;        // The .checkpoint file
+    uint64_t         cutSize;     // Journal bytes folded into the copy
+    uint64_t         cutSeq;
+    int              cutRecords;
+    ContactFileStatus status;
+} JournalCheckpoint;
+
+void Journal_Init(Journal *journal);
+
+// Open the journal of the snapshot at 'snapshotPath' and replay it onto
+// 'store' (just loaded from that snapshot), leaving it open for appends.
+// A torn record at the end (a crash while writing) is cut off.
+// Returns CONTACT_FILE_NOT_FOUND if there is no journal for this snapshot;
+// then call Journal_Create. A journal whose header fails its key check is
+// CONTACT_FILE_CORRUPT: the passphrase is the one the snapshot accepted.
+ContactFileStatus Journal_Open(Journal *journal, const char *snapshotPath, const char *passphrase,
+                               ContactStore *store);
+
+// Start an empty journal for the snapshot just saved at 'snapshotPath',
+// replacing any older one
+ContactFileStatus Journal_Create(Journal *journal, const char *snapshotPath, const char *passphrase);
+
+// Append the change just made to contact 'row' (after Store_Add,
+// Store_Update or Store_Delete). Commits by itself once
+// JOURNAL_GROUP_RECORDS are pending. Returns 0 on a write error.
+int  Journal_Append(Journal *journal, JournalOp op, const ContactStore *store, int row);
+
+// Sync the pending records to disk. Returns 0 on a write error.
+int  Journal_Commit(Journal *journal);
+
+int  Journal_NeedsCheckpoint(const Journal *journal, const ContactStore *store);
+
+// Commit and close
+void Journal_Close(Journal *journal);
+
+// Copy the store and start writing it as the next snapshot in the
+// background. Returns 0 if that cannot start (nothing changes).
+int  Journal_StartCheckpoint(JournalCheckpoint *checkpoint, Journal *journal, const ContactStore *store,
+                             const char *passphrase);
+
+// Poll: is the background save done? Never blocks.
+int  Journal_CheckpointDone(JournalCheckpoint *checkpoint);
+
+// Wait for the background save, then put the new snapshot and its journal
+// in place: O(records appended since the start). On failure the journal
+// keeps going on the old snapshot, unless it is closed (journal->file is
+// NULL), which means the next save must be a full one.
+ContactFileStatus Journal_FinishCheckpoint(JournalCheckpoint *checkpoint, Journal *journal);
+
+#endif // JOURNAL_H
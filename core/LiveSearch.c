@@ -0,0 +1,154 @@
+#include "LiveSearch.h"
+#include "Platform.h"
+#include "Search.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Candidates checked between two looks at the clock (roughly 0.1 ms)
+#define LIVE_SEARCH_SLICE 1024
+
+// ------------------------------------------
+// Initialize an idle search
+// ------------------------------------------
+void LiveSearch_Init(LiveSearch *search) {
+    memset(search, 0, sizeof(*search));
+    search->complete = 1;
+}
+
+// ------------------------------------------
+// Release the result buffers
+// ------------------------------------------
+void LiveSearch_Free(LiveSearch *search) {
+    free(search->results);
+    free(search->candidates);
+    LiveSearch_Init(search);
+}
+
+// ------------------------------------------
+// Room for 'count' results and candidates. Returns 0 when out of memory.
+// ------------------------------------------
+static int LiveSearch_Reserve(LiveSearch *search, int count) {
+    if (count <= search->capacity) return 1;
+    int *results = (int*)realloc(search->results, (size_t)count * sizeof(int));
+    if (!results) return 0;
+    search->results = results;
+    int *candidates = (int*)realloc(search->candidates, (size_t)count * sizeof(int));
+    if (!candidates) return 0;
+    search->candidates = candidates;
+    search->capacity = count;
+    return 1;
+}
+
+// ------------------------------------------
+// Start a new search, refining the previous one when possible
+// ------------------------------------------
+int LiveSearch_Start(LiveSearch *search, const ContactStore *store, const TrigramIndex *index, const char *query) {
+    if (!query) query = "";
+    size_t len = strlen(query);
+    if (!LiveSearch_Reserve(search, store->count > 0 ? store->count : 1)) {
+        LiveSearch_Cancel(search);
+        return 0;
+    }
+
+    if (len >= sizeof(search->query)) {
+        // Longer than any field: complete with no matches
+        search->query[0] = '\0';
+        search->length = 0;
+        search->count = 0;
+        search->candidateCount = 0;
+        search->next = 0;
+        search->scanAll = 0;
+        search->active = 1;
+        search->complete = 1;
+        search->valid = 1;
+        return 1;
+    }
+
+    char folded[sizeof(search->query)];
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)query[i];
+        folded[i] = (char)((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+    }
+    folded[len] = '\0';
+
+    int refine = search->active && search->valid && search->length > 0 &&
+                 strstr(folded, search->query) != NULL;
+    if (refine) {
+        // Every contact that can still match: the matches so far, followed
+        // by the candidates not checked yet (both ascending)
+        int pending;
+        if (search->scanAll) {
+            pending = store->count - search->next;
+            memcpy(search->candidates, search->results, (size_t)search->count * sizeof(int));
+            for (int i = 0; i < pending; i++) search->candidates[search->count + i] = search->next + i;
+        } else {
+            pending = search->candidateCount - search->next;
+            memmove(search->candidates + search->count, search->candidates + search->next, (size_t)pending * sizeof(int));
+            memcpy(search->candidates, search->results, (size_t)search->count * sizeof(int));
+        }
+        search->candidateCount = search->count + pending;
+        search->scanAll = 0;
+        search->exact = 0;
+    } else if (len == 0) {
+        search->scanAll = 1;
+        search->exact = 1;
+    } else {
+        int count = index ? TrigramIndex_Candidates(index, store, folded, search->candidates, &search->exact) : -1;
+        search->scanAll = (count < 0);
+        search->candidateCount = count < 0 ? 0 : count;
+        if (count < 0) search->exact = 0;
+    }
+
+    memcpy(search->query, folded, len + 1);
+    search->length = len;
+    search->count = 0;
+    search->next = 0;
+    search->active = 1;
+    search->complete = 0;
+    search->valid = 1;
+    return 1;
+}
+
+// ------------------------------------------
+// Check candidates for at most 'budgetMs'
+// ------------------------------------------
+int LiveSearch_Step(LiveSearch *search, const ContactStore *store, double budgetMs) {
+    if (!search->active || !search->valid || search->complete) return 1;
+
+    double deadline = Platform_NowMs() + budgetMs;
+    int total = search->scanAll ? store->count : search->candidateCount;
+    while (search->next < total) {
+        int end = search->next + LIVE_SEARCH_SLICE;
+        if (end > total) end = total;
+        for (int i = search->next; i < end; i++) {
+            int row = search->scanAll ? i : search->candidates[i];
+            // Tombstones have empty fields, so only the match-all scan sees them
+            int match = search->exact ? !Store_IsDeleted(store, row)
+                                      : Search_ContactContains(store, row, search->query, search->length);
+            if (match) {
+                search->results[search->count++] = row;
+            }
+        }
+        search->next = end;
+        if (end < total && Platform_NowMs() >= deadline) return 0;
+    }
+    search->complete = 1;
+    return 1;
+}
+
+// ------------------------------------------
+// Drop the search in progress
+// ------------------------------------------
+void LiveSearch_Cancel(LiveSearch *search) {
+    search->active = 0;
+    search->complete = 1;
+    search->count = 0;
+}
+
+// ------------------------------------------
+// Forget results that refer to an older version of the store
+// ------------------------------------------
+void LiveSearch_Invalidate(LiveSearch *search) {
+    search->valid = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef LIVE_SEARCH_H
+#define LIVE_SEARCH_H
+
+#include <stddef.h>
+
+#include "ContactStore.h"
+#include "TrigramIndex.h"
+
+// Search-as-you-type engine. A search is started for every keystroke and
+// then advanced in time-boxed steps, so the caller (the UI message loop)
+// never blocks for longer than its budget and can drop a stale search the
+// moment a newer keystroke arrives.
+//
+// When the new query contains the previous one, only the contacts that
+// matched so far (plus any not yet examined) are re-checked instead of
+// the whole store. The trigram index, if given, supplies the candidates
+// of a fresh query.
+//
+// Results are store positions, so any change to the store invalidates
+// them: call LiveSearch_Invalidate after adds, updates, deletes, sorts
+// and loads.
+
+typedef struct {
+    char   query[TRIGRAM_MAX_QUERY];  // Case-folded query being searched
+    size_t length;
+    int   *results;       // Matches found so far, ascending
+    int    count;
+    int   *candidates;    // Positions to check, unless scanAll is set
+    int    candidateCount;
+    int    scanAll;       // Check every contact of the store in order
+    int    next;          // Next candidate to check
+    int    capacity;      // Of both buffers
+    int    exact;         // Candidates match without checking
+    int    active;        // A search has been started and not cancelled
+    int    complete;
+    int    valid;         // Results still describe the store
+} LiveSearch;
+
+void LiveSearch_Init(LiveSearch *search);
+void LiveSearch_Free(LiveSearch *search);
+
+// Begin searching for 'query' (an empty query matches every contact),
+// replacing any search in progress. 'index' may be NULL.
+// Returns 0 when out of memory.
+int LiveSearch_Start(LiveSearch *search, const ContactStore *store, const TrigramIndex *index, const char *query);
+
+// Check candidates until done or until 'budgetMs' has elapsed.
+// Returns 1 once the search is complete (results and count are final).
+int LiveSearch_Step(LiveSearch *search, const ContactStore *store, double budgetMs);
+
+// Drop the search in progress; the next start does not reuse its results
+void LiveSearch_Cancel(LiveSearch *search);
+
+// The store changed: results can no longer be refined
+void LiveSearch_Invalidate(LiveSearch *search);
+
+#endif // LIVE_SEARCH_H
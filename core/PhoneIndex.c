@@ -0,0 +1,184 @@
+#include "PhoneIndex.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Smallest table; tables grow by doubling
+#define PHONE_INDEX_MIN_SLOTS 64
+
+// ------------------------------------------
+// Home slot of a key (Fibonacci hashing)
+// ------------------------------------------
+static uint32_t PhoneIndex_Home(const PhoneIndex *index, uint64_t key) {
+    return (uint32_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & index->slotMask;
+}
+
+// ------------------------------------------
+// Initialize an empty index
+// ------------------------------------------
+void PhoneIndex_Init(PhoneIndex *index) {
+    memset(index, 0, sizeof(*index));
+}
+
+// ------------------------------------------
+// Release the table
+// ------------------------------------------
+void PhoneIndex_Free(PhoneIndex *index) {
+    free(index->slots);
+    PhoneIndex_Init(index);
+}
+
+// ------------------------------------------
+// Put a pair in the first free slot of its probe sequence
+// The table must have a free slot.
+// ------------------------------------------
+static void PhoneIndex_Place(PhoneIndex *index, uint64_t key, uint64_t id) {
+    uint32_t i = PhoneIndex_Home(index, key);
+    while (index->slots[i].key != PHONE_KEY_NONE) {
+        i = (i + 1) & index->slotMask;
+    }
+    index->slots[i].key = key;
+    index->slots[i].id = id;
+    index->used++;
+}
+
+// ------------------------------------------
+// Move every pair to a table of 'slotCount' slots (a power of two).
+// Returns 0 when out of memory, leaving the table as it was.
+// ------------------------------------------
+static int PhoneIndex_Resize(PhoneIndex *index, uint32_t slotCount) {
+    PhoneSlot *slots = (PhoneSlot*)calloc(slotCount, sizeof(PhoneSlot));
+    if (!slots) return 0;
+    PhoneSlot *old = index->slots;
+    uint32_t oldCount = old ? index->slotMask + 1 : 0;
+    index->slots = slots;
+    index->slotMask = slotCount - 1;
+    index->used = 0;
+    for (uint32_t i = 0; i < oldCount; i++) {
+        if (old[i].key != PHONE_KEY_NONE) PhoneIndex_Place(index, old[i].key, old[i].id);
+    }
+    free(old);
+    return 1;
+}
+
+// ------------------------------------------
+// Index every live contact with a phone number
+// ------------------------------------------
+int PhoneIndex_Build(PhoneIndex *index, const ContactStore *store) {
+    uint32_t keyed = 0;
+    for (int i = 0; i < store->count; i++) {
+        if (Store_GetPhoneKey(store, i) != PHONE_KEY_NONE) keyed++;
+    }
+    uint32_t slotCount = PHONE_INDEX_MIN_SLOTS;
+    while (slotCount / 2 < keyed) slotCount *= 2;
+
+    free(index->slots);
+    PhoneIndex_Init(index);
+    index->stale = 1;
+    if (!PhoneIndex_Resize(index, slotCount)) return 0;
+    for (int i = 0; i < store->count; i++) {
+        uint64_t key = Store_GetPhoneKey(store, i);
+        if (key != PHONE_KEY_NONE) PhoneIndex_Place(index, key, Store_GetId(store, i));
+    }
+    index->stale = 0;
+    return 1;
+}
+
+// ------------------------------------------
+// Index the contact at 'row'
+// Returns 0 when out of memory (the index turns stale).
+// ------------------------------------------
+int PhoneIndex_Insert(PhoneIndex *index, const ContactStore *store, int row) {
+    if (index->stale) return 0;
+    uint64_t key = Store_GetPhoneKey(store, row);
+    if (key == PHONE_KEY_NONE) return 1;
+
+    uint32_t slotCount = index->slots ? index->slotMask + 1 : 0;
+    if ((index->used + 1) * 2 > slotCount &&
+        !PhoneIndex_Resize(index, slotCount ? slotCount * 2 : PHONE_INDEX_MIN_SLOTS) &&
+        index->used + 1 >= slotCount) {
+        index->stale = 1;
+        return 0;
+    }
+    PhoneIndex_Place(index, key, Store_GetId(store, row));
+    return 1;
+}
+
+// ------------------------------------------
+// Unindex the contact at 'row' (still in the store)
+// The pairs after it in the probe run are shifted back over the hole.
+// ------------------------------------------
+void PhoneIndex_Remove(PhoneIndex *index, const ContactStore *store, int row) {
+    uint64_t key = Store_GetPhoneKey(store, row);
+    if (index->stale || !index->slots || key == PHONE_KEY_NONE) return;
+
+    uint64_t id = Store_GetId(store, row);
+    uint32_t i = PhoneIndex_Home(index, key);
+    while (index->slots[i].key != key || index->slots[i].id != id) {
+        if (index->slots[i].key == PHONE_KEY_NONE) return;
+        i = (i + 1) & index->slotMask;
+    }
+
+    index->used--;
+    for (;;) {
+        index->slots[i].key = PHONE_KEY_NONE;
+        uint32_t j = i;
+        for (;;) {
+            j = (j + 1) & index->slotMask;
+            if (index->slots[j].key == PHONE_KEY_NONE) return;
+            // The pair at j may fill the hole unless its home lies
+            // cyclically in (i, j]
+            uint32_t home = PhoneIndex_Home(index, index->slots[j].key);
+            int between = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+            if (!between) break;
+        }
+        index->slots[i] = index->slots[j];
+        i = j;
+    }
+}
+
+// ------------------------------------------
+// Updates: unindex the old number, index the new one
+// ------------------------------------------
+void PhoneIndex_BeginUpdate(PhoneIndex *index, const ContactStore *store, int row) {
+    PhoneIndex_Remove(index, store, row);
+}
+
+int PhoneIndex_EndUpdate(PhoneIndex *index, const ContactStore *store, int row) {
+    return PhoneIndex_Insert(index, store, row);
+}
+
+// ------------------------------------------
+// Ids of the contacts with a phone key
+// ------------------------------------------
+int PhoneIndex_Find(const PhoneIndex *index, uint64_t key, uint64_t *ids, int max) {
+    if (index->stale) return -1;
+    if (key == PHONE_KEY_NONE || !index->slots) return 0;
+
+    int found = 0;
+    for (uint32_t i = PhoneIndex_Home(index, key); index->slots[i].key != PHONE_KEY_NONE;
+         i = (i + 1) & index->slotMask) {
+        if (index->slots[i].key != key) continue;
+        if (found < max) ids[found] = index->slots[i].id;
+        found++;
+    }
+    return found;
+}
+
+// ------------------------------------------
+// Store positions of the contacts with a phone number
+// ------------------------------------------
+int PhoneIndex_Owners(const PhoneIndex *index, const ContactStore *store, const char *phone, int *rows, int max) {
+    if (index->stale) return -1;
+    uint64_t key = PhoneKey_Parse(phone);
+    if (key == PHONE_KEY_NONE || !index->slots) return 0;
+
+    int found = 0;
+    for (uint32_t i = PhoneIndex_Home(index, key); index->slots[i].key != PHONE_KEY_NONE && found < max;
+         i = (i + 1) & index->slotMask) {
+        if (index->slots[i].key != key) continue;
+        int row = Store_FindId(store, index->slots[i].id);
+        if (row != -1) rows[found++] = row;
+    }
+    return found;
+}
@@ -0,0 +1,55 @@
+#ifndef PHONE_INDEX_H
+#define PHONE_INDEX_H
+
+#include <stdint.h>
+
+#include "ContactStore.h"
+#include "PhoneKey.h"
+
+// Hash index from phone keys (see PhoneKey.h) to the contacts holding
+// that number, for O(1) "who owns this number" lookups and duplicate
+// checks. Open addressing with linear probing over (key, id) pairs kept
+// at most half full; a number shared by several contacts has one slot per
+// contact. Removals shift the following slots back, so there are no
+// deleted markers and probes stay short.
+//
+// Slots hold ids rather than positions, so a Store_Purge needs no update.
+// Reordering the store (Store_Permute) requires a Build.
+//   Store_Add          -> PhoneIndex_Insert(index, store, store->count - 1)
+//   Store_Update(row)  -> PhoneIndex_BeginUpdate before, PhoneIndex_EndUpdate after
+//   Store_Delete(row)  -> PhoneIndex_Remove before
+
+typedef struct {
+    uint64_t key;   // PHONE_KEY_NONE marks a free slot
+    uint64_t id;
+} PhoneSlot;
+
+typedef struct {
+    PhoneSlot *slots;
+    uint32_t   slotMask;  // Slot count - 1 (a power of two)
+    uint32_t   used;      // Occupied slots
+    int        stale;     // Out of memory during an update; needs a Build
+} PhoneIndex;
+
+void PhoneIndex_Init(PhoneIndex *index);
+void PhoneIndex_Free(PhoneIndex *index);
+
+// (Re)index the whole store. Returns 0 when out of memory (the index is
+// left stale).
+int PhoneIndex_Build(PhoneIndex *index, const ContactStore *store);
+
+int  PhoneIndex_Insert(PhoneIndex *index, const ContactStore *store, int row);
+void PhoneIndex_BeginUpdate(PhoneIndex *index, const ContactStore *store, int row);
+int  PhoneIndex_EndUpdate(PhoneIndex *index, const ContactStore *store, int row);
+void PhoneIndex_Remove(PhoneIndex *index, const ContactStore *store, int row);
+
+// Ids of the contacts whose phone has 'key': writes up to 'max' of them
+// to 'ids' (in no particular order) and returns how many there are in
+// all, 0 for PHONE_KEY_NONE, or -1 while the index is stale.
+int PhoneIndex_Find(const PhoneIndex *index, uint64_t key, uint64_t *ids, int max);
+
+// Store positions (up to 'max') of the contacts with the number 'phone',
+// in any spelling. Returns their number, or -1 while the index is stale.
+int PhoneIndex_Owners(const PhoneIndex *index, const ContactStore *store, const char *phone, int *rows, int max);
+
+#endif // PHONE_INDEX_H
@@ -0,0 +1,90 @@
+#include "PhoneKey.h"
+
+#define PHONE_KEY_DIGIT_SHIFT 5
+#define PHONE_KEY_COUNT_MASK  UINT64_C(31)
+
+// ------------------------------------------
+// Normalize a phone number to its key
+// ------------------------------------------
+uint64_t PhoneKey_Parse(const char *phone) {
+    const unsigned char *p = (const unsigned char *)phone;
+    while (*p == ' ' || *p == '\t') p++;
+
+    uint64_t key = PHONE_KEY_NONE;
+    if (*p == '+') {
+        key = PHONE_KEY_INTERNATIONAL;
+        p++;
+    } else if (p[0] == '0' && p[1] == '0') {
+        key = PHONE_KEY_INTERNATIONAL;
+        p += 2;
+    }
+
+    uint64_t value = 0;
+    int count = 0;
+    for (; *p; p++) {
+        if (*p >= '0' && *p <= '9') {
+            if (count == PHONE_KEY_MAX_DIGITS) return PHONE_KEY_NONE;
+            value = value * 10 + (uint64_t)(*p - '0');
+            count++;
+        } else if (*p != ' ' && *p != '\t' && *p != '-' && *p != '.' && *p != '/' && *p != '(' && *p != ')') {
+            return PHONE_KEY_NONE;
+        }
+    }
+    if (count == 0) return PHONE_KEY_NONE;
+
+    for (int i = count; i < PHONE_KEY_MAX_DIGITS; i++) {
+        value *= 10;
+    }
+    return key | (value << PHONE_KEY_DIGIT_SHIFT) | (uint64_t)count;
+}
+
+// ------------------------------------------
+// Unpack the digits of a key
+// ------------------------------------------
+int PhoneKey_Digits(uint64_t key, char digits[PHONE_KEY_MAX_DIGITS]) {
+    int count = (int)(key & PHONE_KEY_COUNT_MASK);
+    uint64_t value = (key & ~PHONE_KEY_INTERNATIONAL) >> PHONE_KEY_DIGIT_SHIFT;
+    char all[PHONE_KEY_MAX_DIGITS];
+    for (int i = PHONE_KEY_MAX_DIGITS - 1; i >= 0; i--) {
+        all[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    for (int i = 0; i < count; i++) {
+        digits[i] = all[i];
+    }
+    return count;
+}
+
+// ------------------------------------------
+// Canonical text of a key
+// ------------------------------------------
+void PhoneKey_Format(uint64_t key, char text[PHONE_KEY_MAX_DIGITS + 2]) {
+    char *p = text;
+    if (key != PHONE_KEY_NONE && (key & PHONE_KEY_INTERNATIONAL)) *p++ = '+';
+    p += PhoneKey_Digits(key, p);
+    *p = '\0';
+}
+
+// ------------------------------------------
+// Digit count of a key
+// ------------------------------------------
+int PhoneKey_Count(uint64_t key) {
+    return (int)(key & PHONE_KEY_COUNT_MASK);
+}
+
+// ------------------------------------------
+// Key range of the numbers sharing a prefix
+// The digits are padded with zeros to a fixed width, so the numbers that
+// start with n given digits are the padded values from the prefix's own
+// up to the next n-digit value, exclusive.
+// ------------------------------------------
+int PhoneKey_PrefixRange(uint64_t prefix, uint64_t *low, uint64_t *high) {
+    if (prefix == PHONE_KEY_NONE) return 0;
+    uint64_t step = 1;
+    for (int i = PhoneKey_Count(prefix); i < PHONE_KEY_MAX_DIGITS; i++) {
+        step *= 10;
+    }
+    *low = prefix & ~PHONE_KEY_COUNT_MASK;
+    *high = *low + (step << PHONE_KEY_DIGIT_SHIFT);
+    return 1;
+}
@@ -0,0 +1,44 @@
+#ifndef PHONE_KEY_H
+#define PHONE_KEY_H
+
+#include <stdint.h>
+
+// Phone numbers reduced to a 64-bit key, so that spellings of the same
+// number ("+44-20-1234", "+44 2012 34", "0044 (20) 1234") compare equal
+// in one integer compare.
+// Only the digits count: spaces, '-', '.', '/' and parentheses are layout.
+// A leading '+' or "00" marks an international (E.164) number; without
+// one the number is national and stays distinct from its international
+// spelling, since the country it belongs to is unknown.
+//
+// Layout: bit 59 international, bits 5..58 the digits as a 16-digit number
+// padded with zeros on the right, bits 0..4 the digit count. Ordering keys
+// as integers therefore orders national numbers before international ones
+// and each group digit by digit, like the digit strings.
+// 0 is "no number": empty text, no digits, more than 16 digits, or any
+// other character.
+
+#define PHONE_KEY_NONE           UINT64_C(0)
+#define PHONE_KEY_INTERNATIONAL  (UINT64_C(1) << 59)
+#define PHONE_KEY_MAX_DIGITS     16
+
+uint64_t PhoneKey_Parse(const char *phone);
+
+// The digits of 'key' (PHONE_KEY_MAX_DIGITS at most, no terminator).
+// Returns their count, 0 for PHONE_KEY_NONE.
+int PhoneKey_Digits(uint64_t key, char digits[PHONE_KEY_MAX_DIGITS]);
+
+// Canonical spelling: "+" and the digits for international numbers, the
+// digits alone otherwise; "" for PHONE_KEY_NONE
+void PhoneKey_Format(uint64_t key, char text[PHONE_KEY_MAX_DIGITS + 2]);
+
+// Keys of the numbers starting with the digits of 'prefix' (a key, with
+// the same national or international mark): those in [*low, *high) that
+// have at least PhoneKey_Count(prefix) digits. Such keys are contiguous in
+// key order. Returns 0 for PHONE_KEY_NONE.
+int PhoneKey_PrefixRange(uint64_t prefix, uint64_t *low, uint64_t *high);
+
+// Number of digits of 'key', 0 for PHONE_KEY_NONE
+int PhoneKey_Count(uint64_t key);
+
+#endif // PHONE_KEY_H
@@ -0,0 +1,442 @@
+#include "Platform.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <bcrypt.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// ------------------------------------------
+// Flush a stdio stream all the way to the disk
+// ------------------------------------------
+int Platform_SyncFile(FILE *f) {
+    if (fflush(f) != 0) return 0;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+// ------------------------------------------
+// Replace 'target' with 'source' in one step
+// rename() cannot overwrite an existing file on Windows, so MoveFileEx is used there.
+// ------------------------------------------
+int Platform_ReplaceFile(const char *source, const char *target) {
+#ifdef _WIN32
+    return MoveFileExA(source, target, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(source, target) == 0;
+#endif
+}
+
+// ------------------------------------------
+// Truncate an open file
+// ------------------------------------------
+int Platform_TruncateFile(FILE *f, uint64_t size) {
+    if (fflush(f) != 0) return 0;
+#ifdef _WIN32
+    return _chsize_s(_fileno(f), (__int64)size) == 0;
+#else
+    return ftruncate(fileno(f), (off_t)size) == 0;
+#endif
+}
+
+// ------------------------------------------
+// Seek with a 64-bit offset
+// ------------------------------------------
+int Platform_SeekFile(FILE *f, uint64_t offset) {
+#ifdef _WIN32
+    if (offset > (uint64_t)INT64_MAX) return 0;
+    return _fseeki64(f, (__int64)offset, SEEK_SET) == 0;
+#else
+    if ((uint64_t)(off_t)offset != offset || (off_t)offset < 0) return 0;  // Past what off_t holds
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// ------------------------------------------
+// Map a whole file read-only
+// ------------------------------------------
+int Platform_MapFile(const char *filename, MappedFile *map) {
+    map->data = NULL;
+    map->size = 0;
+    map->handle = NULL;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return 0;
+    }
+    map->size = (size_t)size.QuadPart;
+    if (map->size == 0) {
+        // Empty files cannot be mapped, but are valid
+        CloseHandle(file);
+        return 1;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return 0;
+    map->data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!map->data) {
+        CloseHandle(mapping);
+        return 0;
+    }
+    map->handle = mapping;
+    return 1;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+    map->size = (size_t)st.st_size;
+    if (map->size == 0) {
+        close(fd);
+        return 1;
+    }
+
+    void *data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return 0;
+    madvise(data, map->size, MADV_SEQUENTIAL);
+    map->data = (const unsigned char*)data;
+    return 1;
+#endif
+}
+
+// ------------------------------------------
+// Release a mapping made by Platform_MapFile
+// ------------------------------------------
+void Platform_UnmapFile(MappedFile *map) {
+    if (map->data) {
+#ifdef _WIN32
+        UnmapViewOfFile(map->data);
+        CloseHandle((HANDLE)map->handle);
+#else
+        munmap((void*)map->data, map->size);
+#endif
+    }
+    map->data = NULL;
+    map->size = 0;
+    map->handle = NULL;
+}
+
+// ------------------------------------------
+// Secure random bytes from the operating system
+// ------------------------------------------
+int Platform_RandomBytes(void *buffer, size_t size) {
+#ifdef _WIN32
+    return BCryptGenRandom(NULL, (PUCHAR)buffer, (ULONG)size, BCRYPT_USE_SYSTEM_PREFERRED_RNG) >= 0;
+#else
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0) return 0;
+    unsigned char *p = (unsigned char*)buffer;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n <= 0) {
+            close(fd);
+            return 0;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    close(fd);
+    return 1;
+#endif
+}
+
+// ------------------------------------------
+// Monotonic milliseconds
+// ------------------------------------------
+double Platform_NowMs(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+#endif
+}
+
+// ------------------------------------------
+// Number of logical CPUs
+// ------------------------------------------
+int Platform_CpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// One worker thread of Platform_RunParallel
+typedef struct {
+    ParallelTask task;
+    void *context;
+    int worker;
+    int workerCount;
+    int started;
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+} ParallelWorker;
+
+#ifdef _WIN32
+static DWORD WINAPI Platform_WorkerMain(LPVOID arg) {
+    ParallelWorker *w = (ParallelWorker*)arg;
+    w->task(w->context, w->worker, w->workerCount);
+    return 0;
+}
+#else
+static void *Platform_WorkerMain(void *arg) {
+    ParallelWorker *w = (ParallelWorker*)arg;
+    w->task(w->context, w->worker, w->workerCount);
+    return NULL;
+}
+#endif
+
+// ------------------------------------------
+// Run 'task' on 'workerCount' threads and wait for them
+// A worker whose thread cannot be started runs on the calling thread.
+// ------------------------------------------
+void Platform_RunParallel(int workerCount, ParallelTask task, void *context) {
+    if (workerCount <= 1) {
+        task(context, 0, 1);
+        return;
+    }
+
+    ParallelWorker *workers = (ParallelWorker*)calloc((size_t)workerCount, sizeof(ParallelWorker));
+    if (!workers) {
+        for (int i = 0; i < workerCount; i++) task(context, i, workerCount);
+        return;
+    }
+
+    for (int i = 1; i < workerCount; i++) {
+        ParallelWorker *w = &workers[i];
+        w->task = task;
+        w->context = context;
+        w->worker = i;
+        w->workerCount = workerCount;
+#ifdef _WIN32
+        w->thread = CreateThread(NULL, 0, Platform_WorkerMain, w, 0, NULL);
+        w->started = (w->thread != NULL);
+#else
+        w->started = (pthread_create(&w->thread, NULL, Platform_WorkerMain, w) == 0);
+#endif
+        if (!w->started) task(context, i, workerCount);
+    }
+    task(context, 0, workerCount);
+
+    for (int i = 1; i < workerCount; i++) {
+        if (!workers[i].started) continue;
+#ifdef _WIN32
+        WaitForSingleObject(workers[i].thread, INFINITE);
+        CloseHandle(workers[i].thread);
+#else
+        pthread_join(workers[i].thread, NULL);
+#endif
+    }
+    free(workers);
+}
+
+// A background thread; 'finished' is guarded by 'lock' on POSIX, while
+// Windows asks the thread handle
+struct PlatformThread {
+    ThreadMain main;
+    void *context;
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+    pthread_mutex_t lock;
+    int finished;
+#endif
+};
+
+#ifdef _WIN32
+static DWORD WINAPI Platform_ThreadMain(LPVOID arg) {
+    PlatformThread *t = (PlatformThread*)arg;
+    t->main(t->context);
+    return 0;
+}
+#else
+static void *Platform_ThreadMain(void *arg) {
+    PlatformThread *t = (PlatformThread*)arg;
+    t->main(t->context);
+    pthread_mutex_lock(&t->lock);
+    t->finished = 1;
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+#endif
+
+// ------------------------------------------
+// Run 'main' on a new thread
+// ------------------------------------------
+PlatformThread *Platform_StartThread(ThreadMain main, void *context) {
+    PlatformThread *t = (PlatformThread*)calloc(1, sizeof(PlatformThread));
+    if (!t) return NULL;
+    t->main = main;
+    t->context = context;
+#ifdef _WIN32
+    t->thread = CreateThread(NULL, 0, Platform_ThreadMain, t, 0, NULL);
+    if (!t->thread) {
+        free(t);
+        return NULL;
+    }
+#else
+    if (pthread_mutex_init(&t->lock, NULL) != 0) {
+        free(t);
+        return NULL;
+    }
+    if (pthread_create(&t->thread, NULL, Platform_ThreadMain, t) != 0) {
+        pthread_mutex_destroy(&t->lock);
+        free(t);
+        return NULL;
+    }
+#endif
+    return t;
+}
+
+// ------------------------------------------
+// Has the thread's main function returned? Never blocks.
+// ------------------------------------------
+int Platform_ThreadFinished(PlatformThread *thread) {
+#ifdef _WIN32
+    return WaitForSingleObject(thread->thread, 0) == WAIT_OBJECT_0;
+#else
+    pthread_mutex_lock(&thread->lock);
+    int finished = thread->finished;
+    pthread_mutex_unlock(&thread->lock);
+    return finished;
+#endif
+}
+
+// ------------------------------------------
+// Wait for the thread and release it
+// ------------------------------------------
+void Platform_JoinThread(PlatformThread *thread) {
+    if (!thread) return;
+#ifdef _WIN32
+    WaitForSingleObject(thread->thread, INFINITE);
+    CloseHandle(thread->thread);
+#else
+    pthread_join(thread->thread, NULL);
+    pthread_mutex_destroy(&thread->lock);
+#endif
+    free(thread);
+}
+
+struct PlatformLock {
+#ifdef _WIN32
+    CRITICAL_SECTION section;
+#else
+    pthread_mutex_t mutex;
+#endif
+};
+
+// ------------------------------------------
+// Create an unlocked mutex
+// ------------------------------------------
+PlatformLock *Platform_CreateLock(void) {
+    PlatformLock *lock = (PlatformLock*)calloc(1, sizeof(PlatformLock));
+    if (!lock) return NULL;
+#ifdef _WIN32
+    InitializeCriticalSection(&lock->section);
+#else
+    if (pthread_mutex_init(&lock->mutex, NULL) != 0) {
+        free(lock);
+        return NULL;
+    }
+#endif
+    return lock;
+}
+
+// ------------------------------------------
+// Take the mutex, waiting for it if another thread holds it
+// ------------------------------------------
+void Platform_Lock(PlatformLock *lock) {
+#ifdef _WIN32
+    EnterCriticalSection(&lock->section);
+#else
+    pthread_mutex_lock(&lock->mutex);
+#endif
+}
+
+// ------------------------------------------
+// Release the mutex
+// ------------------------------------------
+void Platform_Unlock(PlatformLock *lock) {
+#ifdef _WIN32
+    LeaveCriticalSection(&lock->section);
+#else
+    pthread_mutex_unlock(&lock->mutex);
+#endif
+}
+
+// ------------------------------------------
+// Destroy an unlocked mutex
+// ------------------------------------------
+void Platform_FreeLock(PlatformLock *lock) {
+    if (!lock) return;
+#ifdef _WIN32
+    DeleteCriticalSection(&lock->section);
+#else
+    pthread_mutex_destroy(&lock->mutex);
+#endif
+    free(lock);
+}
+
+// ------------------------------------------
+// Atomic reference counting
+// ------------------------------------------
+long Platform_AtomicIncrement(volatile long *value) {
+#ifdef _WIN32
+    return InterlockedIncrement(value);
+#else
+    return __atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST);
+#endif
+}
+
+long Platform_AtomicDecrement(volatile long *value) {
+#ifdef _WIN32
+    return InterlockedDecrement(value);
+#else
+    return __atomic_sub_fetch(value, 1, __ATOMIC_SEQ_CST);
+#endif
+}
+
+long Platform_AtomicLoad(volatile long *value) {
+#ifdef _WIN32
+    return InterlockedCompareExchange(value, 0, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
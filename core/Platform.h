@@ -0,0 +1,75 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Small portability layer so the core builds on both Windows and POSIX.
+
+// Flush the OS buffers of 'f' to disk. Returns 1 on success.
+int Platform_SyncFile(FILE *f);
+
+// Atomically replace 'target' with 'source' (both on the same volume).
+// Returns 1 on success.
+int Platform_ReplaceFile(const char *source, const char *target);
+
+// Cut the file behind 'f' to 'size' bytes (flushes 'f' first).
+// Returns 1 on success.
+int Platform_TruncateFile(FILE *f, uint64_t size);
+
+// Move 'f' to byte 'offset' from the start, past 2 GB as well (plain
+// fseek takes a long, 32-bit on Windows). Returns 1 on success.
+int Platform_SeekFile(FILE *f, uint64_t offset);
+
+// Read-only memory mapping of a whole file
+typedef struct {
+    const unsigned char *data;  // NULL for an empty file
+    size_t size;
+    void  *handle;              // Platform specific
+} MappedFile;
+
+// Map 'filename' into memory. Returns 1 on success, 0 if the file cannot
+// be opened or mapped.
+int  Platform_MapFile(const char *filename, MappedFile *map);
+void Platform_UnmapFile(MappedFile *map);
+
+// Fill 'buffer' with cryptographically secure random bytes. Returns 1 on success.
+int Platform_RandomBytes(void *buffer, size_t size);
+
+// Monotonic clock in milliseconds, for timing and latency budgets
+double Platform_NowMs(void);
+
+// Number of logical CPUs available to the process (at least 1)
+int Platform_CpuCount(void);
+
+// Fork-join helper: runs task(context, worker, workerCount) for every
+// worker in [0, workerCount) on its own thread and waits for all of them.
+// Worker 0 runs on the calling thread.
+typedef void (*ParallelTask)(void *context, int worker, int workerCount);
+void Platform_RunParallel(int workerCount, ParallelTask task, void *context);
+
+// Background thread for a long job the caller keeps polling, so a UI
+// thread never blocks on it: start it, check Platform_ThreadFinished from
+// a timer, then Platform_JoinThread (which also frees it).
+typedef void (*ThreadMain)(void *context);
+typedef struct PlatformThread PlatformThread;
+PlatformThread *Platform_StartThread(ThreadMain main, void *context);  // NULL on failure
+int  Platform_ThreadFinished(PlatformThread *thread);
+void Platform_JoinThread(PlatformThread *thread);
+
+// Mutex for the little state a background thread shares with the UI
+// thread (progress, cancel requests, queues). Never held for long.
+typedef struct PlatformLock PlatformLock;
+PlatformLock *Platform_CreateLock(void);  // NULL on failure
+void Platform_Lock(PlatformLock *lock);
+void Platform_Unlock(PlatformLock *lock);
+void Platform_FreeLock(PlatformLock *lock);
+
+// Reference counts shared between threads. Each is a full barrier and
+// returns the new value.
+long Platform_AtomicIncrement(volatile long *value);
+long Platform_AtomicDecrement(volatile long *value);
+long Platform_AtomicLoad(volatile long *value);
+
+#endif // PLATFORM_H
@@ -0,0 +1,794 @@
+#include "Query.h"
+#include "DateKey.h"
+#include "PhoneKey.h"
+#include "Search.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Candidates are checked in blocks this size: small enough that a block's
+// positions stay in L1 while every predicate passes over it
+#define QUERY_BLOCK 1024
+
+static const char *const s_fieldNames[SORT_COLUMN_COUNT] = { "name", "phone", "email", "date" };
+
+static const char *const s_opNames[] = { "contains", "starts-with", "ends-with", "=", "<", "<=", ">", ">=" };
+
+static const char *const s_accessNames[] = { "scan", "sort order range", "phone hash index", "trigram index" };
+
+typedef struct {
+    const char *text;
+    QueryOp     op;
+    int         negate;
+} QueryOperator;
+
+static const QueryOperator s_operators[] = {
+    { "contains",    QUERY_CONTAINS,      0 },
+    { "starts-with", QUERY_STARTS_WITH,   0 },
+    { "ends-with",   QUERY_ENDS_WITH,     0 },
+    { "=",           QUERY_EQUAL,         0 },
+    { "==",          QUERY_EQUAL,         0 },
+    { "is",          QUERY_EQUAL,         0 },
+    { "!=",          QUERY_EQUAL,         1 },
+    { "<>",          QUERY_EQUAL,         1 },
+    { "<",           QUERY_LESS,          0 },
+    { "<=",          QUERY_LESS_EQUAL,    0 },
+    { ">",           QUERY_GREATER,       0 },
+    { ">=",          QUERY_GREATER_EQUAL, 0 },
+};
+
+// Binary search targets in a sort order (see Query_Past)
+typedef enum {
+    QUERY_BOUND_AT_LEAST,       // Field >= value
+    QUERY_BOUND_ABOVE,          // Field > value
+    QUERY_BOUND_PREFIX_AT_LEAST,
+    QUERY_BOUND_PREFIX_ABOVE,
+    QUERY_BOUND_NONEMPTY,
+    QUERY_BOUND_KEY_LOW,        // Phone key >= keyLow
+    QUERY_BOUND_KEY_HIGH        // Phone key >= keyHigh
+} QueryBound;
+
+// ------------------------------------------
+// ASCII case folding, as used by the search and the sort orders
+// ------------------------------------------
+static unsigned char Query_Fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+static int Query_IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// ------------------------------------------
+// Next word ("ends-with", "name", "and") or run of operator symbols
+// ("<=", "!="), folded to lower case. Returns its length, 0 at the end of
+// the text; words too long for 'token' come back empty.
+// ------------------------------------------
+static size_t Query_Token(const char **text, char *token, size_t size) {
+    const char *p = *text;
+    while (Query_IsSpace(*p)) p++;
+    size_t len = 0;
+    if (*p && strchr("<>=!", *p)) {
+        while (*p && strchr("<>=!", *p)) {
+            if (len + 1 < size) token[len] = *p;
+            len++;
+            p++;
+        }
+    } else {
+        while (*p && !Query_IsSpace(*p) && !strchr("<>=!\"", *p)) {
+            if (len + 1 < size) token[len] = (char)Query_Fold((unsigned char)*p);
+            len++;
+            p++;
+        }
+    }
+    if (len >= size) len = 0;
+    token[len] = '\0';
+    *text = p;
+    return len;
+}
+
+static int Query_FindField(const char *token) {
+    for (int f = 0; f < SORT_COLUMN_COUNT; f++) {
+        if (strcmp(token, s_fieldNames[f]) == 0) return f;
+    }
+    return -1;
+}
+
+static const QueryOperator *Query_FindOperator(const char *token) {
+    for (size_t i = 0; i < sizeof(s_operators) / sizeof(s_operators[0]); i++) {
+        if (strcmp(token, s_operators[i].text) == 0) return &s_operators[i];
+    }
+    return NULL;
+}
+
+// ------------------------------------------
+// Is 'p' at the keyword AND, as a word of its own?
+// ------------------------------------------
+static int Query_AtAnd(const char *p) {
+    return Query_Fold((unsigned char)p[0]) == 'a' && Query_Fold((unsigned char)p[1]) == 'n' &&
+           Query_Fold((unsigned char)p[2]) == 'd' && (p[3] == '\0' || Query_IsSpace(p[3]));
+}
+
+// ------------------------------------------
+// Field name, then operator, at the start of 'text'
+// ------------------------------------------
+int Query_IsStructured(const char *text) {
+    char token[16];
+    if (!text) return 0;
+    Query_Token(&text, token, sizeof(token));
+    if (strcmp(token, "not") == 0) Query_Token(&text, token, sizeof(token));
+    if (Query_FindField(token) < 0) return 0;
+    Query_Token(&text, token, sizeof(token));
+    return Query_FindOperator(token) != NULL;
+}
+
+// ------------------------------------------
+// Value of a predicate: a quoted string (possibly empty), or the text up
+// to the next AND with the surrounding blanks trimmed. Returns 0 with a
+// message in 'error'.
+// ------------------------------------------
+static int Query_ReadValue(const char **text, char *value, char *error, size_t errorSize) {
+    const char *p = *text;
+    while (Query_IsSpace(*p)) p++;
+    const char *start = p, *end;
+    int quoted = (*p == '"');
+    if (quoted) {
+        start = ++p;
+        while (*p && *p != '"') p++;
+        if (*p != '"') {
+            snprintf(error, errorSize, "Missing closing quote");
+            return 0;
+        }
+        end = p++;
+    } else {
+        while (*p && !(Query_IsSpace(p[-1]) && Query_AtAnd(p))) p++;
+        end = p;
+        while (end > start && Query_IsSpace(end[-1])) end--;
+    }
+    size_t len = (size_t)(end - start);
+    if (len == 0 && !quoted) {
+        snprintf(error, errorSize, "Missing value");
+        return 0;
+    }
+    if (len >= QUERY_MAX_VALUE) {
+        snprintf(error, errorSize, "Value longer than %d characters", QUERY_MAX_VALUE - 1);
+        return 0;
+    }
+    memcpy(value, start, len);
+    value[len] = '\0';
+    *text = p;
+    return 1;
+}
+
+// ------------------------------------------
+// Check a parsed predicate against its field and precompute what the
+// checks need. Returns 0 with a message in 'error'.
+// ------------------------------------------
+static int Query_Compile(QueryPredicate *p, char *error, size_t errorSize) {
+    int ordering = p->op >= QUERY_LESS;
+    p->length = strlen(p->value);
+    for (size_t i = 0; i <= p->length; i++) p->folded[i] = (char)Query_Fold((unsigned char)p->value[i]);
+
+    if (p->field == SORT_BY_PHONE) {
+        if (ordering) {
+            snprintf(error, errorSize, "Phone supports contains, starts-with, ends-with, = and !=");
+            return 0;
+        }
+        uint64_t key = PhoneKey_Parse(p->value);
+        if (key != PHONE_KEY_NONE && p->op == QUERY_EQUAL) {
+            p->byKey = 1;
+            p->keyLow = key;
+            p->keyHigh = key + 1;
+        } else if (key != PHONE_KEY_NONE && p->op == QUERY_STARTS_WITH) {
+            p->byKey = PhoneKey_PrefixRange(key, &p->keyLow, &p->keyHigh);
+            p->keyDigits = PhoneKey_Count(key);
+        }
+    }
+    // Any text goes for contains and the like; "" finds the contacts without a date
+    if (p->field == SORT_BY_DATE && (ordering || (p->op == QUERY_EQUAL && p->length > 0))) {
+        uint32_t day = DateKey_Parse(p->value);
+        if (day == DATE_KEY_NONE) {
+            snprintf(error, errorSize, "Not a date: \"%s\" (use YYYY-MM-DD)", p->value);
+            return 0;
+        }
+        // Compared as day ranges; contacts without a date have none
+        p->byKey = 1;
+        p->keyLow = 1;
+        p->keyHigh = DATE_KEY_END;
+        switch (p->op) {
+            case QUERY_LESS:          p->keyHigh = day; break;
+            case QUERY_LESS_EQUAL:    p->keyHigh = day + 1; break;
+            case QUERY_GREATER:       p->keyLow = day + 1; break;
+            case QUERY_GREATER_EQUAL: p->keyLow = day; break;
+            default:                  p->keyLow = day; p->keyHigh = day + 1; break;
+        }
+    } else if (p->field == SORT_BY_DATE && p->op == QUERY_STARTS_WITH) {
+        // A year or a month is a day range too
+        uint32_t low, high;
+        if (DateKey_PrefixRange(p->value, &low, &high)) {
+            p->byKey = 1;
+            p->keyLow = low;
+            p->keyHigh = high;
+        }
+    }
+
+    // Everything after the last '@' is the domain the store interned
+    if (p->field == SORT_BY_EMAIL && p->op == QUERY_ENDS_WITH && p->value[0] == '@' &&
+        p->length > 1 && !strchr(p->value + 1, '@')) {
+        p->byDomain = 1;
+    }
+
+    switch (p->op) {
+        case QUERY_CONTAINS:  p->cost = 4; break;
+        case QUERY_ENDS_WITH: p->cost = 3; break;
+        default:              p->cost = 2; break;
+    }
+    if (p->byKey || p->byDomain) p->cost = 1;
+    return 1;
+}
+
+// ------------------------------------------
+// Intersect the day ranges of the date conditions into the first one, so
+// "date >= 2024-07-01 AND date < 2024-10-01" is one range to look up and
+// the conditions it covers are never checked
+// ------------------------------------------
+static void Query_MergeDates(Query *query) {
+    QueryPredicate *range = NULL;
+    for (int i = 0; i < query->count; i++) {
+        QueryPredicate *p = &query->predicates[i];
+        if (p->field != SORT_BY_DATE || !p->byKey || p->negate) continue;
+        if (!range) {
+            range = p;
+            continue;
+        }
+        if (p->keyLow > range->keyLow) range->keyLow = p->keyLow;
+        if (p->keyHigh < range->keyHigh) range->keyHigh = p->keyHigh;
+        if (range->keyHigh < range->keyLow) range->keyHigh = range->keyLow;
+        p->merged = 1;
+    }
+}
+
+// ------------------------------------------
+// Parse "pred AND pred AND ..."
+// ------------------------------------------
+int Query_Parse(Query *query, const char *text) {
+    memset(query, 0, sizeof(*query));
+    query->driver = -1;
+    if (!text) text = "";
+
+    for (;;) {
+        char token[16];
+        QueryPredicate *p = &query->predicates[query->count];
+        if (query->count == QUERY_MAX_PREDICATES) {
+            snprintf(query->error, sizeof(query->error), "At most %d conditions", QUERY_MAX_PREDICATES);
+            return 0;
+        }
+
+        if (!Query_Token(&text, token, sizeof(token)) && query->count == 0) {
+            snprintf(query->error, sizeof(query->error), "Empty query");
+            return 0;
+        }
+        if (strcmp(token, "not") == 0) {
+            p->negate = 1;
+            Query_Token(&text, token, sizeof(token));
+        }
+        int field = Query_FindField(token);
+        if (field < 0) {
+            snprintf(query->error, sizeof(query->error),
+                     "Unknown field \"%s\" (use name, phone, email or date)", token);
+            return 0;
+        }
+        p->field = (SortColumn)field;
+
+        Query_Token(&text, token, sizeof(token));
+        const QueryOperator *op = Query_FindOperator(token);
+        if (!op) {
+            snprintf(query->error, sizeof(query->error), "Unknown operator \"%s\" after %s", token, s_fieldNames[field]);
+            return 0;
+        }
+        p->op = op->op;
+        p->negate ^= op->negate;
+
+        if (!Query_ReadValue(&text, p->value, query->error, sizeof(query->error))) return 0;
+        if (!Query_Compile(p, query->error, sizeof(query->error))) return 0;
+        query->count++;
+
+        while (Query_IsSpace(*text)) text++;
+        if (*text == '\0') {
+            Query_MergeDates(query);
+            return 1;
+        }
+        if (!Query_Token(&text, token, sizeof(token)) || strcmp(token, "and") != 0) {
+            snprintf(query->error, sizeof(query->error), "Expected AND after \"%s\"", p->value);
+            return 0;
+        }
+    }
+}
+
+// ------------------------------------------
+// Value of a field for the contact at 'row'
+// ------------------------------------------
+static const char *Query_Field(const ContactStore *store, int row, SortColumn field) {
+    switch (field) {
+        case SORT_BY_PHONE: return Store_GetPhone(store, row);
+        case SORT_BY_EMAIL: return Store_GetEmail(store, row);
+        case SORT_BY_DATE:  return Store_GetDate(store, row);
+        default:            return Store_GetName(store, row);
+    }
+}
+
+// ------------------------------------------
+// Case-insensitive comparison of a field with a folded value, in the
+// order of the sort index
+// ------------------------------------------
+static int Query_Compare(const char *field, const char *folded) {
+    const unsigned char *x = (const unsigned char *)field;
+    const unsigned char *y = (const unsigned char *)folded;
+    while (*x && Query_Fold(*x) == *y) {
+        x++;
+        y++;
+    }
+    return (int)Query_Fold(*x) - (int)*y;
+}
+
+// ------------------------------------------
+// The same, over the first 'length' bytes of the field only
+// ------------------------------------------
+static int Query_ComparePrefix(const char *field, const char *folded, size_t length) {
+    const unsigned char *x = (const unsigned char *)field;
+    for (size_t i = 0; i < length; i++) {
+        int c = x[i] ? Query_Fold(x[i]) : 0;
+        if (c != (unsigned char)folded[i]) return c - (unsigned char)folded[i];
+        if (c == 0) return 0;
+    }
+    return 0;
+}
+
+static int Query_EndsWith(const char *field, const char *folded, size_t length) {
+    size_t fieldLength = strlen(field);
+    if (fieldLength < length) return 0;
+    return Query_ComparePrefix(field + fieldLength - length, folded, length) == 0;
+}
+
+// ------------------------------------------
+// Does a field value satisfy a text predicate (before NOT)?
+// ------------------------------------------
+static int Query_MatchText(const QueryPredicate *p, const char *field) {
+    switch (p->op) {
+        case QUERY_CONTAINS:      return p->length == 0 || Search_FieldContains(field, p->folded, p->length);
+        case QUERY_STARTS_WITH:   return Query_ComparePrefix(field, p->folded, p->length) == 0;
+        case QUERY_ENDS_WITH:     return Query_EndsWith(field, p->folded, p->length);
+        case QUERY_EQUAL:         return Query_Compare(field, p->folded) == 0;
+        case QUERY_LESS:          return field[0] && Query_Compare(field, p->folded) < 0;
+        case QUERY_LESS_EQUAL:    return field[0] && Query_Compare(field, p->folded) <= 0;
+        case QUERY_GREATER:       return field[0] && Query_Compare(field, p->folded) > 0;
+        case QUERY_GREATER_EQUAL: return field[0] && Query_Compare(field, p->folded) >= 0;
+    }
+    return 0;
+}
+
+// ------------------------------------------
+// Keep the rows of a block that satisfy one predicate, in order.
+// Every row is written and the output only advances on a match, so the
+// loop does not branch on the outcome.
+// ------------------------------------------
+static int Query_FilterBlock(const QueryPredicate *p, const ContactStore *store, int *rows, int count) {
+    int out = 0;
+    if (p->byKey && p->field == SORT_BY_DATE) {
+        uint32_t low = (uint32_t)p->keyLow;
+        uint32_t width = (uint32_t)(p->keyHigh - p->keyLow);
+        for (int i = 0; i < count; i++) {
+            int row = rows[i];
+            rows[out] = row;
+            out += ((Store_GetDay(store, row) - low) < width) ^ p->negate;
+        }
+        return out;
+    }
+    if (p->byDomain) {
+        for (int i = 0; i < count; i++) {
+            int row = rows[i];
+            rows[out] = row;
+            out += (Store_GetDomain(store, row) == p->domain) ^ p->negate;
+        }
+        return out;
+    }
+    if (p->byKey) {
+        uint64_t width = p->keyHigh - p->keyLow;
+        for (int i = 0; i < count; i++) {
+            int row = rows[i];
+            uint64_t key = Store_GetPhoneKey(store, row);
+            int match = ((key - p->keyLow) < width) & (PhoneKey_Count(key) >= p->keyDigits);
+            rows[out] = row;
+            out += match ^ p->negate;
+        }
+        return out;
+    }
+    for (int i = 0; i < count; i++) {
+        int row = rows[i];
+        rows[out] = row;
+        out += Query_MatchText(p, Query_Field(store, row, p->field)) ^ p->negate;
+    }
+    return out;
+}
+
+// ------------------------------------------
+// Run the checks of the plan over a block of candidates; returns how many
+// are left at its start
+// ------------------------------------------
+static int Query_CheckBlock(const Query *query, const ContactStore *store, int *rows, int count) {
+    for (int f = 0; f < query->filterCount && count > 0; f++) {
+        count = Query_FilterBlock(&query->predicates[query->filter[f]], store, rows, count);
+    }
+    return count;
+}
+
+// ------------------------------------------
+// Check candidates a block at a time, compacting the survivors
+// ------------------------------------------
+static int Query_CheckRows(const Query *query, const ContactStore *store, int *rows, int count) {
+    int out = 0;
+    for (int start = 0; start < count; start += QUERY_BLOCK) {
+        int size = count - start < QUERY_BLOCK ? count - start : QUERY_BLOCK;
+        int kept = Query_CheckBlock(query, store, rows + start, size);
+        memmove(rows + out, rows + start, (size_t)kept * sizeof(int));
+        out += kept;
+    }
+    return out;
+}
+
+// ------------------------------------------
+// Every live contact, a block at a time
+// ------------------------------------------
+static int Query_Scan(const Query *query, const ContactStore *store, int *results) {
+    int out = 0;
+    for (int start = 0; start < store->count; start += QUERY_BLOCK) {
+        int end = store->count - start < QUERY_BLOCK ? store->count : start + QUERY_BLOCK;
+        int size = 0;
+        for (int row = start; row < end; row++) {
+            results[out + size] = row;
+            size += !Store_IsDeleted(store, row);
+        }
+        out += Query_CheckBlock(query, store, results + out, size);
+    }
+    return out;
+}
+
+// ------------------------------------------
+// Is the contact at 'row' at or past 'bound' in the order of the
+// predicate's field?
+// ------------------------------------------
+static int Query_Past(const QueryPredicate *p, const ContactStore *store, int row, QueryBound bound) {
+    switch (bound) {
+        case QUERY_BOUND_KEY_LOW:  return Store_GetPhoneKey(store, row) >= p->keyLow;
+        case QUERY_BOUND_KEY_HIGH: return Store_GetPhoneKey(store, row) >= p->keyHigh;
+        default: break;
+    }
+    const char *field = Query_Field(store, row, p->field);
+    switch (bound) {
+        case QUERY_BOUND_AT_LEAST:        return Query_Compare(field, p->folded) >= 0;
+        case QUERY_BOUND_ABOVE:           return Query_Compare(field, p->folded) > 0;
+        case QUERY_BOUND_PREFIX_AT_LEAST: return Query_ComparePrefix(field, p->folded, p->length) >= 0;
+        case QUERY_BOUND_PREFIX_ABOVE:    return Query_ComparePrefix(field, p->folded, p->length) > 0;
+        default:                          return field[0] != '\0';
+    }
+}
+
+// ------------------------------------------
+// First position of 'order' at or past 'bound'
+// ------------------------------------------
+static int Query_LowerBound(const QueryPredicate *p, const ContactStore *store, const int *order, int count,
+                            QueryBound bound) {
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (Query_Past(p, store, order[mid], bound)) high = mid;
+        else low = mid + 1;
+    }
+    return low;
+}
+
+// ------------------------------------------
+// Range of the field's sort order holding exactly the contacts that
+// satisfy 'p'. Returns 0 when the order cannot answer it.
+// ------------------------------------------
+static int Query_SortedRange(const QueryPredicate *p, const ContactStore *store, const SortIndex *sorted,
+                             int *first, int *end) {
+    const int *order = SortIndex_Order(sorted, p->field);
+    int count = sorted->count;
+    if (p->negate || !order) return 0;
+    if (p->field == SORT_BY_DATE) {
+        // Dates are ordered by day, then the ones without a day by text
+        if (p->byKey) return SortIndex_DayRange(sorted, store, (uint32_t)p->keyLow, (uint32_t)p->keyHigh, first, end);
+        if (p->op != QUERY_EQUAL || p->length > 0) return 0;
+    }
+    if (p->field == SORT_BY_PHONE) {
+        // Phones are ordered by key; only numbers can use it
+        if (!p->byKey) return 0;
+        *first = Query_LowerBound(p, store, order, count, QUERY_BOUND_KEY_LOW);
+        *end = Query_LowerBound(p, store, order, count, QUERY_BOUND_KEY_HIGH);
+        return 1;
+    }
+    switch (p->op) {
+        case QUERY_EQUAL:
+            *first = Query_LowerBound(p, store, order, count, QUERY_BOUND_AT_LEAST);
+            *end = Query_LowerBound(p, store, order, count, QUERY_BOUND_ABOVE);
+            return 1;
+        case QUERY_STARTS_WITH:
+            *first = Query_LowerBound(p, store, order, count, QUERY_BOUND_PREFIX_AT_LEAST);
+            *end = Query_LowerBound(p, store, order, count, QUERY_BOUND_PREFIX_ABOVE);
+            return 1;
+        case QUERY_LESS:
+        case QUERY_LESS_EQUAL:
+            // Empty fields sort first and never match an ordering compare
+            *first = Query_LowerBound(p, store, order, count, QUERY_BOUND_NONEMPTY);
+            *end = Query_LowerBound(p, store, order, count,
+                                    p->op == QUERY_LESS ? QUERY_BOUND_AT_LEAST : QUERY_BOUND_ABOVE);
+            return 1;
+        case QUERY_GREATER:
+        case QUERY_GREATER_EQUAL:
+            *first = Query_LowerBound(p, store, order, count,
+                                      p->op == QUERY_GREATER ? QUERY_BOUND_ABOVE : QUERY_BOUND_AT_LEAST);
+            *end = count;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// ------------------------------------------
+// Rough log2, for the cost of binary searches
+// ------------------------------------------
+static double Query_Log2(int count) {
+    double steps = 1.0;
+    while (count > 1) {
+        count >>= 1;
+        steps += 1.0;
+    }
+    return steps;
+}
+
+// ------------------------------------------
+// Keep an access path for a predicate if it beats the one it has.
+// Paths compare by the cost of listing their candidates plus checking
+// the predicate itself on them when they are not exact.
+// ------------------------------------------
+static void Query_Consider(QueryPredicate *p, QueryAccess path, int exact, long candidates, double pathCost) {
+    double cost = pathCost + (double)candidates * (exact ? 0 : p->cost);
+    double current = p->pathCost + (double)p->candidates * (p->exact ? 0 : p->cost);
+    if (p->path != QUERY_ACCESS_SCAN && cost >= current) return;
+    p->path = path;
+    p->exact = exact;
+    p->candidates = candidates;
+    p->pathCost = pathCost;
+}
+
+// ------------------------------------------
+// Best index for one predicate on its own
+// Costs count index steps and candidates listed, in the same units as
+// the predicate costs (roughly one field compare each).
+// ------------------------------------------
+static void Query_PlanPredicate(QueryPredicate *p, const ContactStore *store, const QueryIndexes *indexes,
+                                int live) {
+    double logCount = Query_Log2(live);
+    if (p->byDomain) {
+        p->domain = Store_FindDomain(store, p->value + 1);
+        if (p->domain == 0) p->domain = ARENA_INVALID;  // No contact has it
+    }
+    p->path = QUERY_ACCESS_SCAN;
+    p->exact = 0;
+    p->candidates = live;
+    p->pathCost = 0.0;
+    if (!indexes || p->negate) return;
+
+    // Two binary searches, then the range is copied and put back into
+    // store order. Number prefixes still check the digit count.
+    int first, end;
+    if (indexes->sorted && indexes->sorted->count == live &&
+        Query_SortedRange(p, store, indexes->sorted, &first, &end)) {
+        if (end < first) end = first;
+        Query_Consider(p, QUERY_ACCESS_SORTED, !(p->byKey && p->keyDigits > 0), end - first,
+                       4.0 * logCount * p->cost + 2.0 * (end - first));
+        p->rangeFirst = first;
+        p->rangeEnd = end;
+    }
+
+    // One probe, then a binary search per id to find its position
+    if (p->field == SORT_BY_PHONE && p->byKey && p->op == QUERY_EQUAL && indexes->phones) {
+        int found = PhoneIndex_Find(indexes->phones, p->keyLow, NULL, 0);
+        if (found >= 0) Query_Consider(p, QUERY_ACCESS_PHONE, 1, found, 1.0 + found * logCount);
+    }
+
+    // Intersecting the posting lists touches a few times the shortest;
+    // what is left contains the text in some field, not necessarily this one
+    if (!p->byKey && p->field != SORT_BY_DATE && p->op <= QUERY_EQUAL && indexes->trigrams) {
+        int found = TrigramIndex_Estimate(indexes->trigrams, store, p->value);
+        if (found >= 0) Query_Consider(p, QUERY_ACCESS_TRIGRAM, 0, found, 3.0 * found);
+    }
+}
+
+// ------------------------------------------
+// Pick the candidate source and the order of the checks
+// ------------------------------------------
+void Query_Plan(Query *query, const ContactStore *store, const QueryIndexes *indexes) {
+    int live = Store_LiveCount(store);
+    double allChecks = 0.0;
+    for (int i = 0; i < query->count; i++) {
+        QueryPredicate *p = &query->predicates[i];
+        if (p->merged) {
+            p->path = QUERY_ACCESS_SCAN;
+            p->candidates = 0;
+            continue;
+        }
+        Query_PlanPredicate(p, store, indexes, live);
+        allChecks += p->cost;
+    }
+
+    // A scan visits every record and checks each predicate; later ones
+    // usually see fewer rows, but the first one sees them all
+    query->scanCost = (double)store->count + (double)live * allChecks;
+    query->cost = query->scanCost;
+    query->driver = -1;
+    query->candidates = live;
+    for (int i = 0; i < query->count; i++) {
+        const QueryPredicate *p = &query->predicates[i];
+        if (p->path == QUERY_ACCESS_SCAN || p->merged) continue;
+        double checks = allChecks - (p->exact ? p->cost : 0);
+        double cost = p->pathCost + (double)p->candidates * checks;
+        if (cost < query->cost) {
+            query->cost = cost;
+            query->driver = i;
+            query->candidates = p->candidates;
+        }
+    }
+
+    // Checks left, cheapest first (insertion sort, stable)
+    query->filterCount = 0;
+    for (int i = 0; i < query->count; i++) {
+        if (query->predicates[i].merged || (i == query->driver && query->predicates[i].exact)) continue;
+        int at = query->filterCount++;
+        while (at > 0 && query->predicates[query->filter[at - 1]].cost > query->predicates[i].cost) {
+            query->filter[at] = query->filter[at - 1];
+            at--;
+        }
+        query->filter[at] = i;
+    }
+}
+
+static int Query_CompareInts(const void *a, const void *b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// ------------------------------------------
+// Put candidates from an index back into store order: a sweep over a
+// byte per contact when they are many, a sort when they are few
+// ------------------------------------------
+static void Query_SortRows(const ContactStore *store, int *rows, int count) {
+    if (count > store->count / 32) {
+        unsigned char *marks = (unsigned char*)calloc((size_t)store->count + 1, 1);
+        if (marks) {
+            for (int i = 0; i < count; i++) marks[rows[i]] = 1;
+            int out = 0;
+            for (int row = 0; row < store->count; row++) {
+                rows[out] = row;
+                out += marks[row];
+            }
+            free(marks);
+            return;
+        }
+    }
+    qsort(rows, (size_t)count, sizeof(int), Query_CompareInts);
+}
+
+// ------------------------------------------
+// Candidates from the driving predicate's index. Returns their number
+// (ascending positions in 'results'), -1 when the index no longer
+// matches the plan, or -2 when out of memory.
+// ------------------------------------------
+static int Query_Candidates(const Query *query, const ContactStore *store, const QueryIndexes *indexes,
+                            int *results) {
+    const QueryPredicate *p = &query->predicates[query->driver];
+    switch (p->path) {
+        case QUERY_ACCESS_SORTED: {
+            const int *order = indexes ? SortIndex_Order(indexes->sorted, p->field) : NULL;
+            if (!order || p->rangeEnd > indexes->sorted->count || indexes->sorted->count > store->count) return -1;
+            int count = p->rangeEnd - p->rangeFirst;
+            memcpy(results, order + p->rangeFirst, (size_t)count * sizeof(int));
+            Query_SortRows(store, results, count);
+            return count;
+        }
+        case QUERY_ACCESS_PHONE: {
+            int found = indexes ? PhoneIndex_Find(indexes->phones, p->keyLow, NULL, 0) : -1;
+            if (found <= 0) return found;
+            uint64_t *ids = (uint64_t*)malloc((size_t)found * sizeof(uint64_t));
+            if (!ids) return -2;
+            PhoneIndex_Find(indexes->phones, p->keyLow, ids, found);
+            int count = 0;
+            for (int i = 0; i < found; i++) {
+                int row = Store_FindId(store, ids[i]);
+                if (row >= 0) results[count++] = row;
+            }
+            free(ids);
+            Query_SortRows(store, results, count);
+            return count;
+        }
+        case QUERY_ACCESS_TRIGRAM: {
+            int exact;
+            if (!indexes) return -1;
+            return TrigramIndex_Candidates(indexes->trigrams, store, p->value, results, &exact);
+        }
+        default:
+            return -1;
+    }
+}
+
+// ------------------------------------------
+// Run a planned query
+// ------------------------------------------
+int Query_Run(const Query *query, const ContactStore *store, const QueryIndexes *indexes, int *results) {
+    if (query->driver >= 0) {
+        int count = Query_Candidates(query, store, indexes, results);
+        if (count == -2) return -1;
+        if (count >= 0) return Query_CheckRows(query, store, results, count);
+        // The index changed since planning: scan instead
+    }
+    return Query_Scan(query, store, results);
+}
+
+// ------------------------------------------
+// printf at the end of a bounded text
+// ------------------------------------------
+static void Query_Append(char *text, size_t size, size_t *used, const char *format, ...) {
+    if (*used >= size) return;
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(text + *used, size - *used, format, args);
+    va_end(args);
+    if (written > 0) *used += (size_t)written < size - *used ? (size_t)written : size - *used - 1;
+}
+
+static void Query_AppendPredicate(char *text, size_t size, size_t *used, const QueryPredicate *p) {
+    int notEqual = p->negate && p->op == QUERY_EQUAL;
+    Query_Append(text, size, used, "%s%s %s \"%s\"", p->negate && !notEqual ? "NOT " : "",
+                 s_fieldNames[p->field], notEqual ? "!=" : s_opNames[p->op], p->value);
+}
+
+// ------------------------------------------
+// Human-readable plan
+// ------------------------------------------
+void Query_Explain(const Query *query, char *text, size_t size) {
+    size_t used = 0;
+    if (size == 0) return;
+    text[0] = '\0';
+    for (int i = 0; i < query->count; i++) {
+        const QueryPredicate *p = &query->predicates[i];
+        Query_Append(text, size, &used, "%d. ", i + 1);
+        Query_AppendPredicate(text, size, &used, p);
+        if (p->merged) {
+            Query_Append(text, size, &used, ": within the date range of an earlier condition\n");
+        } else if (p->path == QUERY_ACCESS_SCAN) {
+            Query_Append(text, size, &used, ": no index, %scost %d per contact\n",
+                         p->byDomain ? "domain id compare, " : "", p->cost);
+        } else {
+            Query_Append(text, size, &used, ": %s, %s%ld candidates, cost %d per contact\n",
+                         s_accessNames[p->path], p->path == QUERY_ACCESS_TRIGRAM ? "at most " : "",
+                         p->candidates, p->cost);
+        }
+    }
+
+    if (query->driver < 0) {
+        Query_Append(text, size, &used, "Plan: scan %ld contacts", query->candidates);
+    } else {
+        Query_Append(text, size, &used, "Plan: %s of %d (%ld candidates)",
+                     s_accessNames[query->predicates[query->driver].path], query->driver + 1, query->candidates);
+    }
+    if (query->filterCount > 0) {
+        Query_Append(text, size, &used, ", then check");
+        for (int f = 0; f < query->filterCount; f++) {
+            Query_Append(text, size, &used, "%s %d", f ? "," : "", query->filter[f] + 1);
+        }
+    }
+    Query_Append(text, size, &used, "\nEstimated cost: %.0f (scan: %.0f)\n", query->cost, query->scanCost);
+}
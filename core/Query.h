@@ -0,0 +1,127 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ContactStore.h"
+#include "PhoneIndex.h"
+#include "SortIndex.h"
+#include "TrigramIndex.h"
+
+// Structured queries over every field, such as
+//   email ends-with @corp.com AND date >= 2024-01-01 AND phone starts-with +60
+//
+// A query is one or more predicates joined by AND. A predicate is a field
+// (name, phone, email, date), an operator and a value, optionally preceded
+// by NOT:
+//   contains, starts-with, ends-with, = (or is), != , <, <=, >, >=
+// Text compares ignore ASCII case. A value runs to the next AND, or is
+// quoted ("Smith AND Sons"). Phone =, != and starts-with compare numbers
+// in any spelling when the value is a number ("+60", "0060 12"). Dates
+// compare by their DateKey day number: =, <, <=, >, >= take a YYYY-MM-DD
+// date and starts-with may also take a year or a month ("2024-07"); they
+// never match a contact without a real date. Email ends-with "@domain"
+// compares each contact's interned domain id with that domain's. The day ranges of the date
+// conditions are intersected into the first one ("date >= 2024-07-01 AND
+// date < 2024-10-01" is one range).
+//
+// Query_Parse compiles the text into predicates. Query_Plan then picks the
+// access path that leaves the fewest candidates to check, from what the
+// given indexes can answer: a range of a sort order (prefixes, equality
+// and ranges of name and email, day ranges of date, numbers and number
+// prefixes of phone), the phone hash index (one number) or the trigram index (text of
+// three characters or more), else a scan. The candidates are then checked
+// a block at a time, one predicate over the whole block before the next,
+// cheapest first, compacting the block without branching on the outcome.
+
+#define QUERY_MAX_PREDICATES 8
+#define QUERY_MAX_VALUE      CONTACT_EMAIL_SIZE
+
+typedef enum {
+    QUERY_CONTAINS,
+    QUERY_STARTS_WITH,
+    QUERY_ENDS_WITH,
+    QUERY_EQUAL,
+    QUERY_LESS,
+    QUERY_LESS_EQUAL,
+    QUERY_GREATER,
+    QUERY_GREATER_EQUAL
+} QueryOp;
+
+typedef enum {
+    QUERY_ACCESS_SCAN,
+    QUERY_ACCESS_SORTED,    // Range of a SortIndex order
+    QUERY_ACCESS_PHONE,     // PhoneIndex lookup of one number
+    QUERY_ACCESS_TRIGRAM    // TrigramIndex candidates
+} QueryAccess;
+
+typedef struct {
+    SortColumn field;
+    QueryOp    op;
+    int        negate;                  // NOT, or != (EQUAL negated)
+    int        byKey;                   // Phone by PhoneKey, date by DateKey (see below)
+    char       value[QUERY_MAX_VALUE];  // As typed
+    char       folded[QUERY_MAX_VALUE]; // ASCII lower case
+    size_t     length;
+    uint64_t   keyLow, keyHigh;         // byKey: keys in [keyLow, keyHigh) ...
+    int        keyDigits;               // ... with at least this many digits
+    int        cost;                    // Relative cost of checking one contact
+    int        merged;                  // Date range folded into an earlier predicate's
+    int        byDomain;                // Email ends-with "@domain", by domain id
+
+    // Set by Query_Plan: the best index for this predicate alone
+    QueryAccess path;                   // QUERY_ACCESS_SCAN when none applies
+    int        exact;                   // Its candidates all match
+    long       candidates;              // Estimated (exact except for trigrams)
+    double     pathCost;                // Estimated index steps to list them
+    int        rangeFirst, rangeEnd;    // QUERY_ACCESS_SORTED: positions in the order
+    uint32_t   domain;                  // byDomain: its id in the store, ARENA_INVALID if unknown
+} QueryPredicate;
+
+// Indexes the planner may use; any of them may be NULL or stale
+typedef struct {
+    const TrigramIndex *trigrams;
+    const PhoneIndex   *phones;
+    const SortIndex    *sorted;
+} QueryIndexes;
+
+typedef struct {
+    QueryPredicate predicates[QUERY_MAX_PREDICATES];
+    int  count;
+
+    // Set by Query_Plan
+    int    driver;          // Predicate whose index lists the candidates, -1 to scan
+    long   candidates;      // Contacts to check
+    double cost;            // Estimated index steps and field tests
+    double scanCost;        // The same for a plain scan, for comparison
+    int    filter[QUERY_MAX_PREDICATES];  // Predicates to check, cheapest first
+    int    filterCount;
+
+    char error[128];        // Why Query_Parse failed
+} Query;
+
+// Does 'text' look like a structured query rather than plain search text?
+// True when it starts with a field name (or NOT and a field name) followed
+// by an operator, even if the rest is still being typed.
+int Query_IsStructured(const char *text);
+
+// Compile 'text'. Returns 0 with a message in query->error on a syntax
+// error.
+int Query_Parse(Query *query, const char *text);
+
+// Choose the access path and the order of the checks for the current
+// contents of 'store' (binary searches and hash lookups, no scanning).
+// 'indexes' may be NULL.
+void Query_Plan(Query *query, const ContactStore *store, const QueryIndexes *indexes);
+
+// Run a planned query against the same store and indexes. Writes the
+// matching positions (ascending) to 'results', which must have room for
+// store->count entries. Returns their number, or -1 when out of memory.
+int Query_Run(const Query *query, const ContactStore *store, const QueryIndexes *indexes, int *results);
+
+// Describe a planned query: the candidates each predicate's index would
+// leave, the path chosen, the order of the checks and the estimated costs.
+void Query_Explain(const Query *query, char *text, size_t size);
+
+#endif // QUERY_H
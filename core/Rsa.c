@@ -0,0 +1,88 @@
+#include "Rsa.h"
+
+// RSA keys (small and insecure, for demonstration only)
+static const int RSA_n = 3233;   // Example modulus (61*53)
+static const int RSA_e = 17;     // Public exponent
+static const int RSA_d = 2753;   // Private exponent
+
+#include <string.h>
+
+// Ciphertext of every byte value and plaintext of every ciphertext below
+// the modulus; a lookup replaces the modExp per character.
+static int s_encryptTable[256];
+static unsigned char s_decryptTable[3233];
+static int s_tablesReady = 0;
+
+// ------------------------------------------
+// RSA Encryption: Encrypt a single character using RSA
+// ------------------------------------------
+int RSA_EncryptChar(int m) {
+    return modExp(m, RSA_e, RSA_n);
+}
+
+// ------------------------------------------
+// RSA Decryption: Decrypt a single character using RSA
+// ------------------------------------------
+int RSA_DecryptChar(int c) {
+    return modExp(c, RSA_d, RSA_n);
+}
+
+// ------------------------------------------
+// Build the encryption/decryption lookup tables
+// Called lazily by the block functions; multi-threaded callers should
+// call it once before starting their threads.
+// ------------------------------------------
+void RSA_InitTables(void) {
+    if (s_tablesReady) return;
+    for (int i = 0; i < 256; i++) {
+        s_encryptTable[i] = RSA_EncryptChar(i);
+    }
+    for (int c = 0; c < RSA_n; c++) {
+        s_decryptTable[c] = (unsigned char)RSA_DecryptChar(c);
+    }
+    s_tablesReady = 1;
+}
+
+// ------------------------------------------
+// Encrypt 'len' bytes into 'out' (one int per byte)
+// Produces exactly the values of RSA_EncryptChar.
+// ------------------------------------------
+void RSA_EncryptBlock(const unsigned char *in, size_t len, int *out) {
+    RSA_InitTables();
+    for (size_t i = 0; i < len; i++) {
+        out[i] = s_encryptTable[in[i]];
+    }
+}
+
+// ------------------------------------------
+// Decrypt 'count' native-endian ints read from 'in' into bytes
+// Same result as (char)RSA_DecryptChar for every value; 'in' may be unaligned.
+// ------------------------------------------
+void RSA_DecryptBlock(const unsigned char *in, size_t count, char *out) {
+    RSA_InitTables();
+    for (size_t i = 0; i < count; i++) {
+        int c;
+        memcpy(&c, in + i * sizeof(int), sizeof(int));
+        if ((unsigned)c < (unsigned)RSA_n) {
+            out[i] = (char)s_decryptTable[c];
+        } else {
+            out[i] = (char)RSA_DecryptChar(c);
+        }
+    }
+}
+
+// ------------------------------------------
+// Modular exponentiation function used for RSA
+// (base^exp) % mod efficiently computed
+// ------------------------------------------
+int modExp(int base, int exp, int mod) {
+    long long result = 1;
+    long long b = base % mod;
+    long long e = exp;
+    while (e > 0) {
+        if (e & 1) result = (result * b) % mod;
+        b = (b * b) % mod;
+        e >>= 1;
+    }
+    return (int)result;
+}
@@ -0,0 +1,16 @@
+#ifndef RSA_H
+#define RSA_H
+
+#include <stddef.h>
+
+// RSA and modular exponentiation (toy keys, for demonstration only)
+int RSA_EncryptChar(int m);
+int RSA_DecryptChar(int c);
+int modExp(int base, int exp, int mod);
+
+// Table driven block versions of RSA_EncryptChar/RSA_DecryptChar
+void RSA_InitTables(void);
+void RSA_EncryptBlock(const unsigned char *in, size_t len, int *out);
+void RSA_DecryptBlock(const unsigned char *in, size_t count, char *out);
+
+#endif // RSA_H
@@ -0,0 +1,220 @@
+#include "Search.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SEARCH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Index of the lowest set bit of a non-zero mask (de Bruijn sequence)
+static uint32_t Search_LowestBit(uint64_t mask) {
+    static const unsigned char s_bits[64] = {
+         0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+        62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+        63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+        46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6
+    };
+    return s_bits[((mask & (0 - mask)) * UINT64_C(0x03F79D71B4CB0A89)) >> 58];
+}
+
+// ------------------------------------------
+// First position from 'p' where the first two bytes of the needle occur
+// together (just the first byte for a one-byte needle), 'size' if none
+// Sixteen positions per step with SSE2, eight with 64-bit words, then one
+// at a time for the last few bytes of the page.
+// ------------------------------------------
+static uint32_t Search_FindPair(const char *page, uint32_t p, uint32_t size, const char *needle, size_t len) {
+    unsigned char n0 = (unsigned char)needle[0];
+    unsigned char n1 = (unsigned char)needle[len > 1];
+#ifdef SEARCH_SSE2
+    const __m128i first = _mm_set1_epi8((char)n0);
+    const __m128i second = _mm_set1_epi8((char)n1);
+    for (; (size_t)p + 17 <= size; p += 16) {
+        __m128i hit = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(page + p)), first);
+        if (len > 1) hit = _mm_and_si128(hit, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(page + p + 1)), second));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask != 0) return p + Search_LowestBit((uint64_t)mask);
+    }
+#else
+    // Byte k of zero(x) is 0x80 where byte k of x is 0, else 0
+    const uint64_t ones = UINT64_C(0x0101010101010101);
+    const uint64_t low7 = ones * 0x7F;
+    for (; (size_t)p + 9 <= size; p += 8) {
+        uint64_t a, b;
+        memcpy(&a, page + p, sizeof(a));
+        memcpy(&b, page + p + 1, sizeof(b));
+        a ^= ones * n0;
+        b ^= ones * n1;
+        uint64_t hit = ~(((a & low7) + low7) | a | low7);
+        if (len > 1) hit &= ~(((b & low7) + low7) | b | low7);
+        // Little-endian, as on every Windows target: byte k is page[p + k]
+        if (hit != 0) return p + Search_LowestBit(hit) / 8;
+    }
+#endif
+    for (; p < size; p++) {
+        if ((unsigned char)page[p] == n0 && (len == 1 || (p + 1 < size && (unsigned char)page[p + 1] == n1))) return p;
+    }
+    return size;
+}
+
+// Index of the highest set bit of a non-zero 16-bit mask
+static uint32_t Search_HighestBit(uint32_t mask) {
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    return Search_LowestBit(mask - (mask >> 1));
+}
+
+// ------------------------------------------
+// Bounds of the page string holding position 'p': where it starts, and
+// where its '\0' is (at most 'size')
+// ------------------------------------------
+static uint32_t Search_StringStart(const char *page, uint32_t p) {
+#ifdef SEARCH_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; p >= 16; p -= 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(page + p - 16)), zero));
+        if (mask != 0) return p - 15 + Search_HighestBit((uint32_t)mask);
+    }
+#endif
+    while (p > 0 && page[p - 1] != '\0') p--;
+    return p;
+}
+
+static uint32_t Search_StringEnd(const char *page, uint32_t p, uint32_t size) {
+#ifdef SEARCH_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; (size_t)p + 16 <= size; p += 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(page + p)), zero));
+        if (mask != 0) return p + Search_LowestBit((uint64_t)mask);
+    }
+#endif
+    while (p < size && page[p] != '\0') p++;
+    return p;
+}
+
+// ------------------------------------------
+// Mark in 'hits' the names of one arena page that contain the needle
+// The page is '\0'-separated text, so it is searched as one block; each
+// candidate from Search_FindPair is confirmed against the rest of the
+// needle. A hit marks the offset of its string and the search resumes
+// after that string.
+// ------------------------------------------
+static void Search_ScanPage(const char *page, uint32_t size, uint32_t base,
+                            const char *needle, size_t len, uint64_t *hits) {
+    uint32_t p = 0;
+    while ((p = Search_FindPair(page, p, size, needle, len)) < size) {
+        if (len > 2 && ((size_t)p + len > size || memcmp(page + p + 2, needle + 2, len - 2) != 0)) {
+            p++;
+            continue;
+        }
+        uint32_t offset = base + Search_StringStart(page, p);
+        hits[offset >> 6] |= UINT64_C(1) << (offset & 63);
+        p = Search_StringEnd(page, p + (uint32_t)len, size);
+    }
+}
+
+// ------------------------------------------
+// Linear, case-sensitive substring filter over contact names
+// Scans the name column only: the name arena page by page, then the name
+// offsets to report the contacts whose name was hit, in store order.
+// ------------------------------------------
+int Search_FilterByName(const ContactStore *store, const char *filter, int *results) {
+    int matches = 0;
+    if (!filter || filter[0] == '\0') {
+        for (int i = 0; i < store->count; i++) {
+            if (!Store_IsDeleted(store, i)) results[matches++] = i;
+        }
+        return matches;
+    }
+
+    const StringArena *names = &store->fields[CONTACT_FIELD_NAME];
+    size_t len = strlen(filter);
+    if (len >= CONTACT_NAME_SIZE || names->pageCount == 0) return 0;
+    uint64_t *hits = (uint64_t*)calloc((size_t)names->pageCount << (ARENA_PAGE_SHIFT - 6), sizeof(uint64_t));
+    if (!hits) {
+        // Out of memory: fall back to testing each name
+        for (int i = 0; i < store->count; i++) {
+            if (strstr(Store_GetName(store, i), filter)) results[matches++] = i;
+        }
+        return matches;
+    }
+    for (uint32_t page = 0; page < names->pageCount; page++) {
+        uint32_t size;
+        const char *text = Arena_Page(names, page, &size);
+        Search_ScanPage(text, size, page << ARENA_PAGE_SHIFT, filter, len, hits);
+    }
+
+    // Tombstones have offset 0, the empty string, which is never hit
+    for (int i = 0; i < store->count;) {
+        int n;
+        const uint32_t *offsets = Store_Column(store, i, CONTACT_FIELD_NAME, &n);
+        for (int k = 0; k < n; k++) {
+            results[matches] = i + k;
+            matches += (int)((hits[offsets[k] >> 6] >> (offsets[k] & 63)) & 1);
+        }
+        i += n;
+    }
+    free(hits);
+    return matches;
+}
+
+static unsigned char Search_Fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+// ------------------------------------------
+// Case-insensitive substring test against a folded needle
+// ------------------------------------------
+int Search_FieldContains(const char *field, const char *folded, size_t len) {
+    const unsigned char *h = (const unsigned char*)field;
+    const unsigned char *n = (const unsigned char*)folded;
+    for (; *h; h++) {
+        if (Search_Fold(*h) != n[0]) continue;
+        size_t i = 1;
+        while (i < len && h[i] && Search_Fold(h[i]) == n[i]) i++;
+        if (i == len) return 1;
+        if (!h[i]) return 0;  // Rest of the field is shorter than the needle
+    }
+    return 0;
+}
+
+// ------------------------------------------
+// Does any searchable field of a contact contain the folded needle?
+// ------------------------------------------
+int Search_ContactContains(const ContactStore *store, int index, const char *folded, size_t len) {
+    return Search_FieldContains(Store_GetName(store, index), folded, len) ||
+           Search_FieldContains(Store_GetPhone(store, index), folded, len) ||
+           Search_FieldContains(Store_GetEmail(store, index), folded, len);
+}
+
+// ------------------------------------------
+// Search all fields, through the trigram index when it can answer
+// ------------------------------------------
+int Search_Contacts(const ContactStore *store, const TrigramIndex *index, const char *query, int *results) {
+    if (!query || query[0] == '\0') {
+        return Search_FilterByName(store, NULL, results);
+    }
+    if (index) {
+        int matches = TrigramIndex_Query(index, store, query, results);
+        if (matches >= 0) return matches;
+    }
+
+    // Short query or no usable index: fold once, then scan
+    char folded[256];
+    size_t len = strlen(query);
+    if (len >= sizeof(folded)) return 0;  // Longer than any field
+    for (size_t i = 0; i < len; i++) folded[i] = (char)Search_Fold((unsigned char)query[i]);
+
+    int matches = 0;
+    for (int i = 0; i < store->count; i++) {
+        if (Search_ContactContains(store, i, folded, len)) {
+            results[matches++] = i;
+        }
+    }
+    return matches;
+}
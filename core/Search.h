@@ -0,0 +1,29 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stddef.h>
+
+#include "ContactStore.h"
+#include "TrigramIndex.h"
+
+// Collect the indices of the contacts whose name contains 'filter'.
+// 'results' must have room for store->count entries. An empty or NULL
+// filter matches every contact. Deleted contacts never match.
+// Returns the number of matches.
+int Search_FilterByName(const ContactStore *store, const char *filter, int *results);
+
+// Case-insensitive substring search over name, phone and email.
+// Answered from 'index' when possible (it may be NULL), otherwise by a
+// linear scan. Same contract for 'results' and empty queries as above;
+// matches are returned in store order.
+int Search_Contacts(const ContactStore *store, const TrigramIndex *index, const char *query, int *results);
+
+// Does 'field' contain 'folded' ('len' bytes, already ASCII lower case),
+// ignoring case?
+int Search_FieldContains(const char *field, const char *folded, size_t len);
+
+// Does the name, phone or email of contact 'index' contain 'folded'
+// ('len' bytes, already ASCII lower case), ignoring case?
+int Search_ContactContains(const ContactStore *store, int index, const char *folded, size_t len);
+
+#endif // SEARCH_H
@@ -0,0 +1,340 @@
+#include "SortIndex.h"
+#include "ContactSort.h"
+#include "DateKey.h"
+#include "PhoneKey.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Store and column the qsort comparator resolves positions against
+static const ContactStore *s_sortStore = NULL;
+static SortColumn s_sortColumn = SORT_BY_NAME;
+
+// ------------------------------------------
+// ASCII case folding, as used by the search
+// ------------------------------------------
+static unsigned char SortIndex_Fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+// ------------------------------------------
+// Value of 'column' for the contact at 'row'
+// ------------------------------------------
+static const char *SortIndex_Field(const ContactStore *store, int row, SortColumn column) {
+    switch (column) {
+        case SORT_BY_PHONE: return Store_GetPhone(store, row);
+        case SORT_BY_EMAIL: return Store_GetEmail(store, row);
+        case SORT_BY_DATE:  return Store_GetDate(store, row);
+        default:            return Store_GetName(store, row);
+    }
+}
+
+// ------------------------------------------
+// Case-insensitive comparison, like strcasecmp in the C locale
+// ------------------------------------------
+static int SortIndex_CompareText(const char *a, const char *b) {
+    const unsigned char *x = (const unsigned char *)a;
+    const unsigned char *y = (const unsigned char *)b;
+    while (*x && SortIndex_Fold(*x) == SortIndex_Fold(*y)) {
+        x++;
+        y++;
+    }
+    return (int)SortIndex_Fold(*x) - (int)SortIndex_Fold(*y);
+}
+
+// ------------------------------------------
+// Phones compare by their keys; numbers without one come first, by text
+// (the order ContactSort gives them)
+// ------------------------------------------
+static int SortIndex_ComparePhone(const ContactStore *store, int a, int b) {
+    uint64_t x = Store_GetPhoneKey(store, a);
+    uint64_t y = Store_GetPhoneKey(store, b);
+    if (x != y) return x < y ? -1 : 1;
+    if (x != PHONE_KEY_NONE) return 0;
+    return SortIndex_CompareText(Store_GetPhone(store, a), Store_GetPhone(store, b));
+}
+
+// ------------------------------------------
+// Dates compare by their day numbers; those without one (empty, or text
+// that is not a real date) come first, by text
+// ------------------------------------------
+static int SortIndex_CompareDate(const ContactStore *store, int a, int b) {
+    uint32_t x = Store_GetDay(store, a);
+    uint32_t y = Store_GetDay(store, b);
+    if (x != y) return x < y ? -1 : 1;
+    if (x != DATE_KEY_NONE) return 0;
+    return SortIndex_CompareText(Store_GetDate(store, a), Store_GetDate(store, b));
+}
+
+// ------------------------------------------
+// Total order of a column: value, then store position
+// ------------------------------------------
+static int SortIndex_Compare(const ContactStore *store, SortColumn column, int a, int b) {
+    int cmp;
+    if (column == SORT_BY_PHONE) {
+        cmp = SortIndex_ComparePhone(store, a, b);
+    } else if (column == SORT_BY_DATE) {
+        cmp = SortIndex_CompareDate(store, a, b);
+    } else {
+        cmp = SortIndex_CompareText(SortIndex_Field(store, a, column), SortIndex_Field(store, b, column));
+    }
+    if (cmp != 0) return cmp;
+    return (a > b) - (a < b);
+}
+
+// ------------------------------------------
+// qsort comparator for store positions
+// ------------------------------------------
+static int SortIndex_CompareRows(const void *a, const void *b) {
+    return SortIndex_Compare(s_sortStore, s_sortColumn, *(const int*)a, *(const int*)b);
+}
+
+// ------------------------------------------
+// Initialize an index of an empty store
+// ------------------------------------------
+void SortIndex_Init(SortIndex *index) {
+    memset(index, 0, sizeof(*index));
+}
+
+// ------------------------------------------
+// Release the orders
+// ------------------------------------------
+void SortIndex_Free(SortIndex *index) {
+    for (int c = 0; c < SORT_COLUMN_COUNT; c++) {
+        free(index->order[c]);
+    }
+    SortIndex_Init(index);
+}
+
+// ------------------------------------------
+// Room for 'count' positions per column. Returns 0 when out of memory.
+// ------------------------------------------
+static int SortIndex_Reserve(SortIndex *index, int count) {
+    if (count <= index->capacity) return 1;
+    int newCapacity = index->capacity ? index->capacity : 256;
+    while (newCapacity < count) newCapacity *= 2;
+    for (int c = 0; c < SORT_COLUMN_COUNT; c++) {
+        int *order = (int*)realloc(index->order[c], (size_t)newCapacity * sizeof(int));
+        if (!order) return 0;
+        index->order[c] = order;
+    }
+    index->capacity = newCapacity;
+    return 1;
+}
+
+// ------------------------------------------
+// Sort every column of the store from scratch with the radix sort engine
+// ------------------------------------------
+int SortIndex_Build(SortIndex *index, const ContactStore *store) {
+    index->count = 0;
+    index->stale = 1;
+    if (!SortIndex_Reserve(index, store->count)) return 0;
+
+    // Stable sorts of the identity order break ties by store position
+    int live = 0;
+    for (int c = 0; c < SORT_COLUMN_COUNT; c++) {
+        SortSpec spec;
+        spec.count = 1;
+        spec.keys[0].column = (SortColumn)c;
+        spec.keys[0].descending = 0;
+        live = 0;
+        for (int i = 0; i < store->count; i++) {
+            if (!Store_IsDeleted(store, i)) index->order[c][live++] = i;
+        }
+        if (!ContactSort_Rows(store, &spec, index->order[c], live)) return 0;
+    }
+
+    index->count = live;
+    index->stale = 0;
+    return 1;
+}
+
+// ------------------------------------------
+// Where 'row' is (or belongs) in the order of 'column', by binary search
+// ------------------------------------------
+static int SortIndex_Position(const SortIndex *index, const ContactStore *store, SortColumn column, int row) {
+    const int *order = index->order[column];
+    int lo = 0, hi = index->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (SortIndex_Compare(store, column, order[mid], row) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// ------------------------------------------
+// Insert 'row' into every order; capacity must already be there
+// ------------------------------------------
+static void SortIndex_Place(SortIndex *index, const ContactStore *store, int row) {
+    for (int c = 0; c < SORT_COLUMN_COUNT; c++) {
+        int *order = index->order[c];
+        int pos = SortIndex_Position(index, store, (SortColumn)c, row);
+        memmove(&order[pos + 1], &order[pos], (size_t)(index->count - pos) * sizeof(int));
+        order[pos] = row;
+    }
+    index->count++;
+}
+
+// ------------------------------------------
+// Take 'row' out of every order; its values must be the indexed ones
+// ------------------------------------------
+static void SortIndex_Take(SortIndex *index, const ContactStore *store, int row) {
+    for (int c = 0; c < SORT_COLUMN_COUNT; c++) {
+        int *order = index->order[c];
+        int pos = SortIndex_Position(index, store, (SortColumn)c, row);
+        if (pos < index->count && order[pos] == row) {
+            memmove(&order[pos], &order[pos + 1], (size_t)(index->count - pos - 1) * sizeof(int));
+        } else {
+            index->stale = 1;
+        }
+    }
+    index->count--;
+}
+
+// ------------------------------------------
+// Index the contact just appended at 'row'
+// Returns 0 (and leaves the index stale) when out of memory.
+// ------------------------------------------
+int SortIndex_Insert(SortIndex *index, const ContactStore *store, int row) {
+    if (index->stale) return 0;
+    if (row != store->count - 1 || !SortIndex_Reserve(index, index->count + 1)) {
+        index->stale = 1;
+        return 0;
+    }
+    SortIndex_Place(index, store, row);
+    return 1;
+}
+
+// ------------------------------------------
+// Unindex 'row' while its old values are still in the store
+// ------------------------------------------
+void SortIndex_BeginUpdate(SortIndex *index, const ContactStore *store, int row) {
+    if (index->stale || row < 0 || row >= store->count || index->count == 0) return;
+    if (Store_IsDeleted(store, row)) return;
+    SortIndex_Take(index, store, row);
+}
+
+// ------------------------------------------
+// Index 'row' again with its new values
+// ------------------------------------------
+void SortIndex_EndUpdate(SortIndex *index, const ContactStore *store, int row) {
+    if (index->stale || index->count >= index->capacity || Store_IsDeleted(store, row)) return;
+    SortIndex_Place(index, store, row);
+}
+
+// ------------------------------------------
+// Unindex 'row' before Store_Delete clears its values
+// ------------------------------------------
+void SortIndex_Remove(SortIndex *index, const ContactStore *store, int row) {
+    if (index->stale || row < 0 || row >= store->count || index->count == 0) return;
+    if (Store_IsDeleted(store, row)) return;
+    SortIndex_Take(index, store, row);
+}
+
+// ------------------------------------------
+// Drop every tombstone from the orders in one pass per column
+// ------------------------------------------
+void SortIndex_RemoveDeleted(SortIndex *index, const ContactStore *store) {
+    if (index->stale) return;
+    int kept = 0;
+    for (int c = 0; c < SORT_COLUMN_COUNT; c++) {
+        int *order = index->order[c];
+        kept = 0;
+        for (int i = 0; i < index->count; i++) {
+            if (!Store_IsDeleted(store, order[i])) order[kept++] = order[i];
+        }
+    }
+    index->count = kept;
+}
+
+// ------------------------------------------
+// Follow a Store_Purge; the relative order of the survivors is unchanged
+// ------------------------------------------
+void SortIndex_Purge(SortIndex *index, const int *remap) {
+    if (index->stale) return;
+    int kept = 0;
+    for (int c = 0; c < SORT_COLUMN_COUNT; c++) {
+        int *order = index->order[c];
+        kept = 0;
+        for (int i = 0; i < index->count; i++) {
+            if (remap[order[i]] >= 0) order[kept++] = remap[order[i]];
+        }
+    }
+    index->count = kept;
+}
+
+// ------------------------------------------
+// Current order of a column
+// ------------------------------------------
+const int *SortIndex_Order(const SortIndex *index, SortColumn column) {
+    if (index->stale || column < 0 || column >= SORT_COLUMN_COUNT) return NULL;
+    return index->order[column];
+}
+
+// ------------------------------------------
+// First position of the date order whose day is 'day' or later
+// ------------------------------------------
+static int SortIndex_DayBound(const SortIndex *index, const ContactStore *store, uint32_t day) {
+    const int *order = index->order[SORT_BY_DATE];
+    int lo = 0, hi = index->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (Store_GetDay(store, order[mid]) < day) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// ------------------------------------------
+// Contacts dated in a range of days: two binary searches
+// ------------------------------------------
+int SortIndex_DayRange(const SortIndex *index, const ContactStore *store, uint32_t low, uint32_t high,
+                       int *first, int *end) {
+    *first = *end = 0;
+    if (index->stale) return 0;
+    if (low == DATE_KEY_NONE) low = 1;
+    if (low >= high) return 1;
+    *first = SortIndex_DayBound(index, store, low);
+    *end = SortIndex_DayBound(index, store, high);
+    return 1;
+}
+
+// ------------------------------------------
+// Put a subset of the store into column order
+// Large subsets are picked out of the maintained order in one O(n) pass;
+// small ones are sorted directly in O(m log m).
+// ------------------------------------------
+void SortIndex_Arrange(const SortIndex *index, const ContactStore *store, SortColumn column,
+                       int *rows, int count) {
+    const int *order = SortIndex_Order(index, column);
+    if (!order || count < 2) return;
+
+    if (count > index->count / 8) {
+        unsigned char *marks = (unsigned char*)calloc((size_t)store->count + 1, 1);
+        int inRange = marks != NULL;
+        for (int i = 0; inRange && i < count; i++) {
+            if (rows[i] < 0 || rows[i] >= store->count) inRange = 0;
+            else marks[rows[i]] = 1;
+        }
+        if (inRange) {
+            int out = 0;
+            for (int i = 0; i < index->count; i++) {
+                if (marks[order[i]]) rows[out++] = order[i];
+            }
+            free(marks);
+            return;
+        }
+        free(marks);
+    }
+
+    s_sortStore = store;
+    s_sortColumn = column;
+    qsort(rows, count, sizeof(int), SortIndex_CompareRows);
+}
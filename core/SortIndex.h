@@ -0,0 +1,70 @@
+#ifndef SORT_INDEX_H
+#define SORT_INDEX_H
+
+#include "ContactStore.h"
+
+// Per-column sort orders kept as permutations of store positions.
+// The store itself is never reordered, so switching the displayed order
+// is O(1) and positions held by the UI and the other indexes stay valid.
+// Ordering is case-insensitive (ASCII); equal values keep store order.
+// Phones order by their PhoneKey: spellings of one number are equal, and
+// numbers sort digit by digit, national before international, after the
+// ones that have no key. Dates order by their DateKey day number, after
+// the empty ones and those that are not real dates.
+//
+// Every order is kept sorted as the store changes (O(log n) compares plus
+// an O(n) move of 4-byte entries). Tombstones are never indexed.
+//   Store_Add          -> SortIndex_Insert(index, store, store->count - 1)
+//   Store_Update(row)  -> SortIndex_BeginUpdate before, SortIndex_EndUpdate after
+//   Store_Delete(row)  -> SortIndex_Remove before, or for a batch of
+//                         deletes one SortIndex_RemoveDeleted after them all,
+//                         before any other change
+//   Store_Purge(remap) -> SortIndex_Purge after
+
+typedef enum {
+    SORT_NONE = -1,     // Store order
+    SORT_BY_NAME,
+    SORT_BY_PHONE,
+    SORT_BY_EMAIL,
+    SORT_BY_DATE,
+    SORT_COLUMN_COUNT
+} SortColumn;
+
+typedef struct {
+    int *order[SORT_COLUMN_COUNT];  // Store positions, in column order
+    int  count;
+    int  capacity;
+    int  stale;                     // Out of memory during an update; needs a Build
+} SortIndex;
+
+void SortIndex_Init(SortIndex *index);
+void SortIndex_Free(SortIndex *index);
+
+// (Re)sort every column from scratch on precomputed case-folded keys.
+// Returns 0 when out of memory (the index is left stale).
+int SortIndex_Build(SortIndex *index, const ContactStore *store);
+
+int  SortIndex_Insert(SortIndex *index, const ContactStore *store, int row);
+void SortIndex_BeginUpdate(SortIndex *index, const ContactStore *store, int row);
+void SortIndex_EndUpdate(SortIndex *index, const ContactStore *store, int row);
+void SortIndex_Remove(SortIndex *index, const ContactStore *store, int row);
+void SortIndex_RemoveDeleted(SortIndex *index, const ContactStore *store);
+void SortIndex_Purge(SortIndex *index, const int *remap);
+
+// Live store positions in 'column' order (index->count of them), or NULL for
+// SORT_NONE and while the index is stale
+const int *SortIndex_Order(const SortIndex *index, SortColumn column);
+
+// Positions [*first, *end) of the SORT_BY_DATE order holding the contacts
+// whose DateKey is in [low, high), in date order: O(log n), so listing
+// them is O(log n + k). Contacts without a date never fall in a range.
+// Returns 0 (and an empty range) while the index is stale.
+int SortIndex_DayRange(const SortIndex *index, const ContactStore *store, uint32_t low, uint32_t high,
+                       int *first, int *end);
+
+// Reorder a set of distinct store positions (such as search results) into
+// 'column' order. Leaves them untouched for SORT_NONE or a stale index.
+void SortIndex_Arrange(const SortIndex *index, const ContactStore *store, SortColumn column,
+                       int *rows, int count);
+
+#endif // SORT_INDEX_H
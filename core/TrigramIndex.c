@@ -0,0 +1,493 @@
+#include "TrigramIndex.h"
+#include "Search.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Upper bound of trigrams in one contact (name + phone + email)
+#define TRIGRAM_MAX_PER_CONTACT (CONTACT_NAME_SIZE + CONTACT_PHONE_SIZE + CONTACT_EMAIL_SIZE)
+#define TRIGRAM_INITIAL_SLOTS   (64 * 1024)
+
+// ------------------------------------------
+// ASCII case folding, other bytes are kept as they are
+// ------------------------------------------
+static uint32_t Trigram_Fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (uint32_t)(c + ('a' - 'A')) : c;
+}
+
+// ------------------------------------------
+// Append the trigram keys of one field, returns the new key count
+// Keys never contain a '\0' byte, so 0 can mark a free slot.
+// ------------------------------------------
+static int Trigram_ExtractField(const char *field, uint32_t *keys, int count) {
+    const unsigned char *p = (const unsigned char*)field;
+    if (!p[0] || !p[1]) return count;
+    uint32_t key = (Trigram_Fold(p[0]) << 8) | Trigram_Fold(p[1]);
+    for (p += 2; *p; p++) {
+        key = ((key << 8) | Trigram_Fold(*p)) & 0xFFFFFF;
+        keys[count++] = key;
+    }
+    return count;
+}
+
+// ------------------------------------------
+// All trigram keys of a contact (may repeat)
+// ------------------------------------------
+static int Trigram_ExtractContact(const ContactStore *store, int row, uint32_t *keys) {
+    int count = Trigram_ExtractField(Store_GetName(store, row), keys, 0);
+    count = Trigram_ExtractField(Store_GetPhone(store, row), keys, count);
+    return Trigram_ExtractField(Store_GetEmail(store, row), keys, count);
+}
+
+static uint32_t Trigram_Hash(uint32_t key) {
+    uint32_t h = key * 0x9E3779B1u;
+    return h ^ (h >> 15);
+}
+
+// ------------------------------------------
+// Posting list of 'key', or NULL
+// ------------------------------------------
+static TrigramPosting *Trigram_Find(const TrigramIndex *index, uint32_t key) {
+    if (!index->slots) return NULL;
+    for (uint32_t i = Trigram_Hash(key) & index->slotMask; ; i = (i + 1) & index->slotMask) {
+        TrigramPosting *slot = &index->slots[i];
+        if (slot->key == key) return slot;
+        if (slot->key == 0) return NULL;
+    }
+}
+
+// ------------------------------------------
+// Double the slot table. Returns 0 when out of memory.
+// ------------------------------------------
+static int Trigram_Grow(TrigramIndex *index) {
+    uint32_t oldCount = index->slots ? index->slotMask + 1 : 0;
+    uint32_t newCount = oldCount ? oldCount * 2 : TRIGRAM_INITIAL_SLOTS;
+    TrigramPosting *slots = (TrigramPosting*)calloc(newCount, sizeof(TrigramPosting));
+    if (!slots) return 0;
+
+    for (uint32_t s = 0; s < oldCount; s++) {
+        const TrigramPosting *old = &index->slots[s];
+        if (old->key == 0) continue;
+        uint32_t i = Trigram_Hash(old->key) & (newCount - 1);
+        while (slots[i].key != 0) i = (i + 1) & (newCount - 1);
+        slots[i] = *old;
+    }
+    free(index->slots);
+    index->slots = slots;
+    index->slotMask = newCount - 1;
+    return 1;
+}
+
+// ------------------------------------------
+// Posting list of 'key', created if needed. NULL when out of memory.
+// ------------------------------------------
+static TrigramPosting *Trigram_Slot(TrigramIndex *index, uint32_t key) {
+    TrigramPosting *slot = Trigram_Find(index, key);
+    if (slot) return slot;
+
+    // Keep the load factor under 70%
+    if (!index->slots || (uint64_t)(index->used + 1) * 10 > (uint64_t)(index->slotMask + 1) * 7) {
+        if (!Trigram_Grow(index)) return NULL;
+    }
+    uint32_t i = Trigram_Hash(key) & index->slotMask;
+    while (index->slots[i].key != 0) i = (i + 1) & index->slotMask;
+    index->slots[i].key = key;
+    index->used++;
+    return &index->slots[i];
+}
+
+// ------------------------------------------
+// First position in the list whose id is >= 'id'
+// ------------------------------------------
+static uint32_t Posting_LowerBound(const uint32_t *ids, uint32_t count, uint32_t id) {
+    uint32_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (ids[mid] < id) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// ------------------------------------------
+// Add 'id' to a posting list, keeping it sorted and free of duplicates
+// Appending the newest id (the common case) is amortized O(1).
+// ------------------------------------------
+static int Posting_Add(TrigramPosting *p, uint32_t id) {
+    uint32_t at = p->count;
+    if (p->count && p->ids[p->count - 1] >= id) {
+        at = Posting_LowerBound(p->ids, p->count, id);
+        if (at < p->count && p->ids[at] == id) return 1;
+    }
+    if (p->count == p->capacity) {
+        uint32_t capacity = p->capacity ? p->capacity + p->capacity / 2 + 1 : 4;
+        uint32_t *ids = (uint32_t*)realloc(p->ids, (size_t)capacity * sizeof(uint32_t));
+        if (!ids) return 0;
+        p->ids = ids;
+        p->capacity = capacity;
+    }
+    memmove(&p->ids[at + 1], &p->ids[at], (size_t)(p->count - at) * sizeof(uint32_t));
+    p->ids[at] = id;
+    p->count++;
+    return 1;
+}
+
+static void Posting_Remove(TrigramPosting *p, uint32_t id) {
+    uint32_t at = Posting_LowerBound(p->ids, p->count, id);
+    if (at == p->count || p->ids[at] != id) return;
+    memmove(&p->ids[at], &p->ids[at + 1], (size_t)(p->count - at - 1) * sizeof(uint32_t));
+    p->count--;
+}
+
+// ------------------------------------------
+// Make room for 'rows' positions and 'ids' ids
+// ------------------------------------------
+static int Trigram_ReserveRows(TrigramIndex *index, int rows, uint32_t ids) {
+    if (rows > index->rowCapacity) {
+        int capacity = index->rowCapacity ? index->rowCapacity * 2 : 1024;
+        if (capacity < rows) capacity = rows;
+        uint32_t *idOfRow = (uint32_t*)realloc(index->idOfRow, (size_t)capacity * sizeof(uint32_t));
+        if (!idOfRow) return 0;
+        index->idOfRow = idOfRow;
+        index->rowCapacity = capacity;
+    }
+    if (ids > index->idCapacity) {
+        uint32_t capacity = index->idCapacity ? index->idCapacity * 2 : 1024;
+        if (capacity < ids) capacity = ids;
+        uint32_t *rowOfId = (uint32_t*)realloc(index->rowOfId, (size_t)capacity * sizeof(uint32_t));
+        if (!rowOfId) return 0;
+        index->rowOfId = rowOfId;
+        index->idCapacity = capacity;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Initialize an empty index
+// ------------------------------------------
+void TrigramIndex_Init(TrigramIndex *index) {
+    memset(index, 0, sizeof(*index));
+}
+
+// ------------------------------------------
+// Release all memory held by the index
+// ------------------------------------------
+void TrigramIndex_Free(TrigramIndex *index) {
+    for (uint32_t s = 0; index->slots && s <= index->slotMask; s++) {
+        free(index->slots[s].ids);
+    }
+    free(index->slots);
+    free(index->idOfRow);
+    free(index->rowOfId);
+    TrigramIndex_Init(index);
+}
+
+// ------------------------------------------
+// Index the whole store
+// Two passes: count the contacts per trigram, then fill lists of exactly
+// that size, so a build does one allocation per distinct trigram.
+// ------------------------------------------
+int TrigramIndex_Build(TrigramIndex *index, const ContactStore *store) {
+    uint32_t keys[TRIGRAM_MAX_PER_CONTACT];
+    TrigramIndex_Free(index);
+
+    int ok = Trigram_ReserveRows(index, store->count, (uint32_t)store->count) && Trigram_Grow(index);
+    for (int row = 0; ok && row < store->count; row++) {
+        int count = Trigram_ExtractContact(store, row, keys);
+        for (int k = 0; k < count; k++) {
+            TrigramPosting *slot = Trigram_Slot(index, keys[k]);
+            if (!slot) { ok = 0; break; }
+            if (slot->mark != (uint32_t)row + 1) {
+                slot->mark = (uint32_t)row + 1;
+                slot->capacity++;
+            }
+        }
+    }
+    for (uint32_t s = 0; ok && s <= index->slotMask; s++) {
+        TrigramPosting *slot = &index->slots[s];
+        if (slot->key == 0) continue;
+        slot->ids = (uint32_t*)malloc((size_t)slot->capacity * sizeof(uint32_t));
+        if (!slot->ids) ok = 0;
+    }
+    for (int row = 0; ok && row < store->count; row++) {
+        int count = Trigram_ExtractContact(store, row, keys);
+        for (int k = 0; k < count; k++) {
+            TrigramPosting *slot = Trigram_Find(index, keys[k]);
+            if (slot->count == 0 || slot->ids[slot->count - 1] != (uint32_t)row) {
+                slot->ids[slot->count++] = (uint32_t)row;
+            }
+        }
+        index->idOfRow[row] = (uint32_t)row;
+        index->rowOfId[row] = (uint32_t)row;
+    }
+
+    if (!ok) {
+        TrigramIndex_Free(index);
+        index->stale = 1;
+        return 0;
+    }
+    index->rows = store->count;
+    index->nextId = (uint32_t)store->count;
+    return 1;
+}
+
+// ------------------------------------------
+// Add or remove the trigrams of store position 'row' under 'id'
+// ------------------------------------------
+static int Trigram_Link(TrigramIndex *index, const ContactStore *store, int row, uint32_t id) {
+    uint32_t keys[TRIGRAM_MAX_PER_CONTACT];
+    int count = Trigram_ExtractContact(store, row, keys);
+    for (int k = 0; k < count; k++) {
+        TrigramPosting *slot = Trigram_Slot(index, keys[k]);
+        if (!slot || !Posting_Add(slot, id)) return 0;
+    }
+    return 1;
+}
+
+static void Trigram_Unlink(TrigramIndex *index, const ContactStore *store, int row, uint32_t id) {
+    uint32_t keys[TRIGRAM_MAX_PER_CONTACT];
+    int count = Trigram_ExtractContact(store, row, keys);
+    for (int k = 0; k < count; k++) {
+        TrigramPosting *slot = Trigram_Find(index, keys[k]);
+        if (slot) Posting_Remove(slot, id);
+    }
+}
+
+// ------------------------------------------
+// Index a contact that was just inserted at store position 'row'
+// ------------------------------------------
+int TrigramIndex_Insert(TrigramIndex *index, const ContactStore *store, int row) {
+    if (index->stale) return 0;
+    if (index->nextId == TRIGRAM_NO_ROW || !Trigram_ReserveRows(index, index->rows + 1, index->nextId + 1)) {
+        index->stale = 1;
+        return 0;
+    }
+
+    uint32_t id = index->nextId++;
+    memmove(&index->idOfRow[row + 1], &index->idOfRow[row], (size_t)(index->rows - row) * sizeof(uint32_t));
+    index->idOfRow[row] = id;
+    index->rows++;
+    for (int r = row; r < index->rows; r++) {
+        index->rowOfId[index->idOfRow[r]] = (uint32_t)r;
+    }
+
+    if (!Trigram_Link(index, store, row, id)) {
+        index->stale = 1;
+        return 0;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Drop the trigrams of a contact that is about to change
+// ------------------------------------------
+void TrigramIndex_BeginUpdate(TrigramIndex *index, const ContactStore *store, int row) {
+    if (index->stale) return;
+    Trigram_Unlink(index, store, row, index->idOfRow[row]);
+}
+
+// ------------------------------------------
+// Index the new contents of a contact changed by Store_Update
+// ------------------------------------------
+int TrigramIndex_EndUpdate(TrigramIndex *index, const ContactStore *store, int row) {
+    if (index->stale) return 0;
+    if (!Trigram_Link(index, store, row, index->idOfRow[row])) {
+        index->stale = 1;
+        return 0;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Forget a contact that is about to be deleted from store position 'row'
+// The store leaves a tombstone behind, so no position moves.
+// ------------------------------------------
+void TrigramIndex_Remove(TrigramIndex *index, const ContactStore *store, int row) {
+    if (index->stale) return;
+    uint32_t id = index->idOfRow[row];
+    Trigram_Unlink(index, store, row, id);
+    index->rowOfId[id] = TRIGRAM_NO_ROW;
+}
+
+// ------------------------------------------
+// Follow a Store_Purge: only the position maps change, in O(n)
+// Ids stay ascending in store order since purging keeps the order.
+// ------------------------------------------
+void TrigramIndex_Purge(TrigramIndex *index, const int *remap, int count) {
+    if (index->stale) return;
+    for (int row = 0; row < index->rows; row++) {
+        if (remap[row] < 0) continue;
+        uint32_t id = index->idOfRow[row];
+        index->idOfRow[remap[row]] = id;
+        index->rowOfId[id] = (uint32_t)remap[row];
+    }
+    index->rows = count;
+}
+
+// ------------------------------------------
+// Keep only the candidates that are also in 'list' (both ascending)
+// Galloping search, so a short candidate set against a long list costs
+// O(candidates * log(list / candidates)).
+// ------------------------------------------
+static int Trigram_Intersect(int *candidates, int count, const TrigramPosting *list) {
+    int kept = 0;
+    uint32_t pos = 0;
+    for (int c = 0; c < count && pos < list->count; c++) {
+        uint32_t id = (uint32_t)candidates[c];
+        uint32_t lo = pos, hi = pos, step = 1;
+        while (hi < list->count && list->ids[hi] < id) {
+            lo = hi + 1;
+            hi += step;
+            step *= 2;
+        }
+        if (hi > list->count) hi = list->count;
+        pos = lo + Posting_LowerBound(list->ids + lo, hi - lo, id);
+        if (pos < list->count && list->ids[pos] == id) {
+            candidates[kept++] = (int)id;
+            pos++;
+        }
+    }
+    return kept;
+}
+
+// ------------------------------------------
+// Candidates through the posting lists
+// ------------------------------------------
+int TrigramIndex_Candidates(const TrigramIndex *index, const ContactStore *store, const char *query,
+                            int *results, int *exact) {
+    if (index->stale || index->rows != store->count || !query) return -1;
+    size_t len = strlen(query);
+    if (len < 3) return -1;
+
+    // A three-character query is one trigram, and trigrams never span
+    // fields, so only longer queries need checking
+    *exact = (len == 3);
+    char folded[TRIGRAM_MAX_QUERY];
+    if (len >= sizeof(folded)) return 0;  // Longer than any field
+    for (size_t i = 0; i < len; i++) folded[i] = (char)Trigram_Fold((unsigned char)query[i]);
+    folded[len] = '\0';
+
+    // Posting lists of the distinct query trigrams, shortest first
+    uint32_t keys[TRIGRAM_MAX_QUERY];
+    const TrigramPosting *lists[TRIGRAM_MAX_QUERY];
+    int keyCount = Trigram_ExtractField(folded, keys, 0);
+    int listCount = 0;
+    for (int k = 0; k < keyCount; k++) {
+        const TrigramPosting *list = Trigram_Find(index, keys[k]);
+        if (!list || list->count == 0) return 0;
+        int at = listCount;
+        int duplicate = 0;
+        for (int l = 0; l < listCount; l++) duplicate |= (lists[l] == list);
+        if (duplicate) continue;
+        while (at > 0 && lists[at - 1]->count > list->count) {
+            lists[at] = lists[at - 1];
+            at--;
+        }
+        lists[at] = list;
+        listCount++;
+    }
+
+    int count = (int)lists[0]->count;
+    for (int c = 0; c < count; c++) results[c] = (int)lists[0]->ids[c];
+    for (int l = 1; l < listCount && count > 0; l++) {
+        count = Trigram_Intersect(results, count, lists[l]);
+    }
+
+    // Ids -> store positions
+    for (int c = 0; c < count; c++) {
+        results[c] = (int)index->rowOfId[results[c]];
+    }
+    return count;
+}
+
+// ------------------------------------------
+// Shortest posting list of the query's trigrams
+// ------------------------------------------
+int TrigramIndex_Estimate(const TrigramIndex *index, const ContactStore *store, const char *query) {
+    if (index->stale || index->rows != store->count || !query) return -1;
+    size_t len = strlen(query);
+    if (len < 3) return -1;
+    char folded[TRIGRAM_MAX_QUERY];
+    if (len >= sizeof(folded)) return 0;
+    for (size_t i = 0; i < len; i++) folded[i] = (char)Trigram_Fold((unsigned char)query[i]);
+    folded[len] = '\0';
+
+    uint32_t keys[TRIGRAM_MAX_QUERY];
+    int keyCount = Trigram_ExtractField(folded, keys, 0);
+    uint32_t shortest = UINT32_MAX;
+    for (int k = 0; k < keyCount; k++) {
+        const TrigramPosting *list = Trigram_Find(index, keys[k]);
+        if (!list) return 0;
+        if (list->count < shortest) shortest = list->count;
+    }
+    return (int)shortest;
+}
+
+// ------------------------------------------
+// Approximate candidates by counting shared trigrams
+// Every posting list of a query trigram bumps a counter per contact, so
+// the cost is the total length of those lists plus one pass over the ids.
+// ------------------------------------------
+int TrigramIndex_FuzzyCandidates(const TrigramIndex *index, const ContactStore *store, const char *query,
+                                 int edits, int *results) {
+    if (index->stale || index->rows != store->count || !query) return -1;
+    size_t len = strlen(query);
+    if (len < 3 || len >= TRIGRAM_MAX_QUERY) return -1;
+
+    char folded[TRIGRAM_MAX_QUERY];
+    for (size_t i = 0; i < len; i++) folded[i] = (char)Trigram_Fold((unsigned char)query[i]);
+    folded[len] = '\0';
+
+    uint32_t keys[TRIGRAM_MAX_QUERY];
+    const TrigramPosting *lists[TRIGRAM_MAX_QUERY];
+    int keyCount = Trigram_ExtractField(folded, keys, 0);
+    int distinct = 0;
+    int listCount = 0;
+    for (int k = 0; k < keyCount; k++) {
+        int duplicate = 0;
+        for (int j = 0; j < k; j++) duplicate |= (keys[j] == keys[k]);
+        if (duplicate) continue;
+        distinct++;
+        const TrigramPosting *list = Trigram_Find(index, keys[k]);
+        if (list && list->count > 0) lists[listCount++] = list;
+    }
+    int needed = distinct - 3 * edits;
+    if (needed < 1) return -1;
+    if (listCount < needed) return 0;
+
+    // At most TRIGRAM_MAX_QUERY distinct trigrams, so a byte per id will do
+    unsigned char *shared = (unsigned char*)calloc(index->nextId > 0 ? index->nextId : 1, 1);
+    if (!shared) return -1;
+    for (int l = 0; l < listCount; l++) {
+        const TrigramPosting *list = lists[l];
+        for (uint32_t i = 0; i < list->count; i++) shared[list->ids[i]]++;
+    }
+    int count = 0;
+    for (uint32_t id = 0; id < index->nextId; id++) {
+        if (shared[id] >= needed && index->rowOfId[id] != TRIGRAM_NO_ROW) {
+            results[count++] = (int)index->rowOfId[id];
+        }
+    }
+    free(shared);
+    return count;
+}
+
+// ------------------------------------------
+// Substring query: candidates, then the substring check
+// ------------------------------------------
+int TrigramIndex_Query(const TrigramIndex *index, const ContactStore *store, const char *query, int *results) {
+    int exact;
+    int count = TrigramIndex_Candidates(index, store, query, results, &exact);
+    if (count <= 0 || exact) return count;
+
+    char folded[TRIGRAM_MAX_QUERY];
+    size_t len = strlen(query);
+    for (size_t i = 0; i < len; i++) folded[i] = (char)Trigram_Fold((unsigned char)query[i]);
+
+    int matches = 0;
+    for (int c = 0; c < count; c++) {
+        if (Search_ContactContains(store, results[c], folded, len)) {
+            results[matches++] = results[c];
+        }
+    }
+    return matches;
+}
@@ -0,0 +1,90 @@
+#ifndef TRIGRAM_INDEX_H
+#define TRIGRAM_INDEX_H
+
+#include <stdint.h>
+
+#include "ContactStore.h"
+
+// In-memory trigram inverted index over name, phone and email.
+// Every run of three case-folded characters inside a field maps to the
+// sorted list of contacts containing it. A substring query intersects the
+// lists of its trigrams, then checks only the surviving candidates.
+//
+// Posting lists hold internal ids rather than store positions, so a purge
+// of the store's tombstones only remaps positions (O(n) integers) instead
+// of rewriting every list. Ids grow in store order, which keeps results in
+// store order. Reordering the store (Store_Permute) requires a Build.
+
+#define TRIGRAM_NO_ROW UINT32_MAX
+// Longer queries cannot match any field
+#define TRIGRAM_MAX_QUERY (CONTACT_NAME_SIZE > CONTACT_EMAIL_SIZE ? CONTACT_NAME_SIZE : CONTACT_EMAIL_SIZE)
+
+typedef struct {
+    uint32_t  key;       // Three folded bytes; 0 marks a free slot
+    uint32_t  count;
+    uint32_t  capacity;
+    uint32_t  mark;      // Last id counted while building
+    uint32_t *ids;       // Ascending
+} TrigramPosting;
+
+typedef struct {
+    TrigramPosting *slots;     // Open addressing, linear probing
+    uint32_t  slotMask;        // Slot count - 1 (a power of two)
+    uint32_t  used;            // Occupied slots
+    uint32_t *idOfRow;         // Store position -> id
+    uint32_t *rowOfId;         // Id -> store position, TRIGRAM_NO_ROW once deleted
+    int       rows;
+    int       rowCapacity;
+    uint32_t  nextId;
+    uint32_t  idCapacity;
+    int       stale;           // Out of memory during an update; needs a Build
+} TrigramIndex;
+
+void TrigramIndex_Init(TrigramIndex *index);
+void TrigramIndex_Free(TrigramIndex *index);
+
+// (Re)index the whole store. Returns 0 when out of memory (the index is
+// left stale and queries fall back to scanning).
+int TrigramIndex_Build(TrigramIndex *index, const ContactStore *store);
+
+// Incremental maintenance, in step with the store:
+//   Store_Add          -> TrigramIndex_Insert(index, store, store->count - 1)
+//   Store_Update(row)  -> TrigramIndex_BeginUpdate before, TrigramIndex_EndUpdate after
+//   Store_Delete(row)  -> TrigramIndex_Remove before
+//   Store_Purge(remap) -> TrigramIndex_Purge after, with the new count
+int  TrigramIndex_Insert(TrigramIndex *index, const ContactStore *store, int row);
+void TrigramIndex_BeginUpdate(TrigramIndex *index, const ContactStore *store, int row);
+int  TrigramIndex_EndUpdate(TrigramIndex *index, const ContactStore *store, int row);
+void TrigramIndex_Remove(TrigramIndex *index, const ContactStore *store, int row);
+void TrigramIndex_Purge(TrigramIndex *index, const int *remap, int count);
+
+// Case-insensitive substring query over name, phone and email.
+// Writes matching store positions (ascending) to 'results', which must
+// have room for store->count entries, and returns their number.
+// Returns -1 if the index cannot answer (query shorter than three
+// characters or stale index); the caller should scan instead.
+int TrigramIndex_Query(const TrigramIndex *index, const ContactStore *store, const char *query, int *results);
+
+// First half of TrigramIndex_Query: the positions (ascending) of contacts
+// holding every trigram of 'query', a superset of the matches. Sets
+// '*exact' when every candidate is known to match. Returns -1 like
+// TrigramIndex_Query.
+int TrigramIndex_Candidates(const TrigramIndex *index, const ContactStore *store, const char *query,
+                            int *results, int *exact);
+
+// Upper bound on the number of TrigramIndex_Candidates for 'query', for
+// planning: the length of its shortest posting list, 0 when a trigram
+// occurs nowhere. O(trigrams of the query). Returns -1 like
+// TrigramIndex_Query.
+int TrigramIndex_Estimate(const TrigramIndex *index, const ContactStore *store, const char *query);
+
+// Candidates for an approximate match: the positions (ascending) of the
+// contacts that may hold a substring within 'edits' edits of 'query'.
+// An edit destroys at most three of the query's trigrams, so such a
+// contact holds at least D - 3 * edits of the D distinct query trigrams.
+// Returns -1 if the index cannot rule anything out that way (stale index
+// or D - 3 * edits < 1); the caller should scan instead.
+int TrigramIndex_FuzzyCandidates(const TrigramIndex *index, const ContactStore *store, const char *query,
+                                 int edits, int *results);
+
+#endif // TRIGRAM_INDEX_H
@@ -0,0 +1,58 @@
+#include "Validation.h"
+#include "DateKey.h"
+
+#include <ctype.h>
+#include <string.h>
+
+// ------------------------------------------
+// Validate the contact's name: must not be empty
+// ------------------------------------------
+int ValidateName(const char *name) {
+    return (strlen(name) > 0);
+}
+
+// ------------------------------------------
+// Validate the phone number
+// Conditions:
+// - Allowed chars: digits, '+', '-'
+// - If starts with '+', must start with '+44' (UK) or '+60' (Malaysia)
+// This is a basic check and can be enhanced as needed.
+// ------------------------------------------
+int ValidatePhone(const char *phone) {
+    for (int i = 0; i < (int)strlen(phone); i++) {
+        if (!isdigit((unsigned char)phone[i]) && phone[i] != '+' && phone[i] != '-') {
+            return 0;
+        }
+    }
+
+    // If starts with '+', check the country code
+    if (phone[0] == '+') {
+        if (strncmp(phone, "+44", 3) != 0 && strncmp(phone, "+60", 3) != 0) {
+            // Must be either +44 or +60 if starting with '+'
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Validate the email
+// Conditions:
+// - Allow empty email
+// - If not empty, must contain '@'
+// ------------------------------------------
+int ValidateEmail(const char *email) {
+    if (email[0] == '\0') return 1;
+    return (strchr(email, '@') != NULL);
+}
+
+// ------------------------------------------
+// Validate the date
+// Conditions:
+// - Allow empty date
+// - If not empty, must be a real day written YYYY-MM-DD
+// ------------------------------------------
+int ValidateDate(const char *date) {
+    if (date[0] == '\0') return 1;
+    return DateKey_Parse(date) != DATE_KEY_NONE;
+}
@@ -0,0 +1,11 @@
+#ifndef VALIDATION_H
+#define VALIDATION_H
+
+// Field validation shared by the UI and batch tools.
+// Each function returns 1 if the value is acceptable, 0 otherwise.
+int ValidateName(const char *name);
+int ValidatePhone(const char *phone);
+int ValidateEmail(const char *email);
+int ValidateDate(const char *date);
+
+#endif // VALIDATION_H
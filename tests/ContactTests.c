@@ -0,0 +1,1883 @@
+// ------------------------------------------
+// ContactTests: unit tests of the headless contact core, run by CTest
+//
+// Usage: ContactTests <suite>
+//   jobs        job queue cancel and poll, load and save jobs
+//   view        view rows after deletes and purges
+//   livesearch  search-as-you-type refinement against a full scan
+//   v2          v2 file round trip, plain and compressed
+//   crypto      RFC 8439 and PBKDF2 vectors, encrypted v2 round trip,
+//               wrong passphrase, damage
+//   journal     journal replay, checkpoint and a damaged header
+//   import      CSV headers of Google and Outlook exports
+//   dedup       duplicate search and merge jobs, values a merge drops
+//   datekey     every date parsed and formatted, bad dates, prefix ranges
+//   phone       phone key spellings, digit limit, prefix ranges, phone index
+//   query       structured query results, index paths against scans, errors
+//   sort        maintained orders and the radix engine against a reference
+//   export      CSV quoting, JSON escapes, vCard escapes and line folding
+//   fuzzy       typo-tolerant name search against the edit distance
+//   autocomplete  top-k name and domain completions through edits
+// Scratch files are written to the working directory and removed.
+// ------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Autocomplete.h"
+#include "ContactFile.h"
+#include "ContactJobs.h"
+#include "ContactSort.h"
+#include "ContactStore.h"
+#include "ContactView.h"
+#include "Crypto.h"
+#include "DateKey.h"
+#include "Export.h"
+#include "FuzzySearch.h"
+#include "Import.h"
+#include "JobQueue.h"
+#include "Journal.h"
+#include "LiveSearch.h"
+#include "PhoneIndex.h"
+#include "PhoneKey.h"
+#include "Platform.h"
+#include "Query.h"
+#include "Search.h"
+#include "SortIndex.h"
+#include "SynthContacts.h"
+#include "TrigramIndex.h"
+
+static int s_failures = 0;
+
+#define CHECK(cond) Test_Check((cond), #cond, __FILE__, __LINE__)
+
+// ------------------------------------------
+// Report a failed check and keep going
+// ------------------------------------------
+static int Test_Check(int ok, const char *text, const char *file, int line) {
+    if (!ok) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+        s_failures++;
+    }
+    return ok;
+}
+
+// ------------------------------------------
+// Do two stores hold the same live contacts, ids included, in order?
+// ------------------------------------------
+static int Test_SameContacts(const ContactStore *a, const ContactStore *b) {
+    int i = 0, j = 0;
+    for (;;) {
+        while (i < a->count && Store_IsDeleted(a, i)) i++;
+        while (j < b->count && Store_IsDeleted(b, j)) j++;
+        if (i == a->count || j == b->count) return i == a->count && j == b->count;
+        if (Store_GetId(a, i) != Store_GetId(b, j) ||
+            strcmp(Store_GetName(a, i), Store_GetName(b, j)) != 0 ||
+            strcmp(Store_GetPhone(a, i), Store_GetPhone(b, j)) != 0 ||
+            strcmp(Store_GetEmail(a, i), Store_GetEmail(b, j)) != 0 ||
+            strcmp(Store_GetDate(a, i), Store_GetDate(b, j)) != 0) {
+            return 0;
+        }
+        i++;
+        j++;
+    }
+}
+
+// ------------------------------------------
+// Synthetic contacts plus the edge cases: empty fields, longest fields
+// ------------------------------------------
+static void Test_FillStore(ContactStore *store, int count, uint64_t seed) {
+    char name[CONTACT_NAME_SIZE], email[CONTACT_EMAIL_SIZE];
+    Store_Init(store);
+    CHECK(Synth_FillStore(store, count, seed));
+    memset(name, 'n', sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    memset(email, 'e', sizeof(email) - 1);
+    email[sizeof(email) - 1] = '\0';
+    email[40] = '@';
+    CHECK(Store_Add(store, "Only A Name", "", "", ""));
+    CHECK(Store_Add(store, name, "+44-12345678901234567890123456", email, "2024-02-29"));
+}
+
+// ------------------------------------------
+// Change one byte of a file, or cut its last bytes
+// ------------------------------------------
+static int Test_FlipByte(const char *filename, long long offset) {
+    FILE *f = fopen(filename, "r+b");
+    if (!f) return 0;
+    int ok = Platform_SeekFile(f, (uint64_t)offset);
+    int c = ok ? fgetc(f) : EOF;
+    ok = c != EOF && Platform_SeekFile(f, (uint64_t)offset) && fputc(c ^ 0x20, f) != EOF;
+    return (fclose(f) == 0) && ok;
+}
+
+static long long Test_FileSize(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return -1;
+    long long size = 0;
+    while (fgetc(f) != EOF) size++;
+    fclose(f);
+    return size;
+}
+
+static int Test_Truncate(const char *filename, uint64_t size) {
+    FILE *f = fopen(filename, "r+b");
+    if (!f) return 0;
+    int ok = Platform_TruncateFile(f, size);
+    return (fclose(f) == 0) && ok;
+}
+
+// ------------------------------------------
+// Remove a snapshot and the journal files next to it
+// ------------------------------------------
+static void Test_RemoveFiles(const char *path) {
+    static const char *s_suffixes[] = { "", ".journal", ".checkpoint", ".journal.next" };
+    char name[256];
+    for (size_t i = 0; i < sizeof(s_suffixes) / sizeof(s_suffixes[0]); i++) {
+        snprintf(name, sizeof(name), "%s%s", path, s_suffixes[i]);
+        remove(name);
+    }
+}
+
+// ------------------------------------------
+//                 Job queue
+// ------------------------------------------
+
+typedef struct {
+    Job           job;
+    volatile long started;
+    volatile long release;  // Finish instead of waiting to be cancelled
+    int           ran;
+} TestJob;
+
+// ------------------------------------------
+// Runs until released or cancelled
+// ------------------------------------------
+static int Test_BlockingRun(Job *job) {
+    TestJob *test = (TestJob*)job;
+    test->ran = 1;
+    Platform_AtomicIncrement(&test->started);
+    while (!Platform_AtomicLoad(&test->release)) {
+        if (Job_Cancelled(job)) return 0;
+    }
+    Job_Progress(job, 1, 1);
+    return 1;
+}
+
+// ------------------------------------------
+// Wait for the queue to drain and return the last state of 'job'
+// ------------------------------------------
+static JobState Test_RunToEnd(JobQueue *queue, Job *job) {
+    JobQueue_Wait(queue);
+    JobState state = JOB_QUEUED;
+    JobEvent event;
+    while (JobQueue_Poll(queue, &event)) {
+        if (event.job == job) state = event.state;
+    }
+    return state;
+}
+
+static void Test_Jobs(void) {
+    JobQueue queue;
+    CHECK(JobQueue_Init(&queue, 1, NULL, NULL));
+
+    // One worker: 'running' holds it, so 'queued' has not started when cancelled
+    TestJob running, queued, after;
+    memset(&running, 0, sizeof(running));
+    memset(&queued, 0, sizeof(queued));
+    memset(&after, 0, sizeof(after));
+    running.job.run = queued.job.run = after.job.run = Test_BlockingRun;
+    after.release = 1;
+    CHECK(JobQueue_Submit(&queue, &running.job));
+    CHECK(JobQueue_Submit(&queue, &queued.job));
+    CHECK(JobQueue_Submit(&queue, &after.job));
+    CHECK(running.job.id == 1 && queued.job.id == 2 && after.job.id == 3);
+    while (!Platform_AtomicLoad(&running.started)) {
+    }
+    CHECK(JobQueue_Pending(&queue) == 3);
+    JobQueue_Cancel(&queue, &queued.job);
+    JobQueue_Cancel(&queue, &running.job);
+
+    JobQueue_Wait(&queue);
+    JobState states[3] = { JOB_QUEUED, JOB_QUEUED, JOB_QUEUED };
+    JobEvent event;
+    while (JobQueue_Poll(&queue, &event)) {
+        states[event.job->id - 1] = event.state;
+    }
+    CHECK(states[0] == JOB_CANCELLED && running.ran);
+    CHECK(states[1] == JOB_CANCELLED && !queued.ran);
+    CHECK(states[2] == JOB_FINISHED && after.ran);
+    CHECK(after.job.done == 1 && after.job.total == 1);
+    CHECK(JobQueue_Pending(&queue) == 0);
+    CHECK(!JobQueue_Poll(&queue, &event));
+
+    // Save a snapshot, then load it back with its indexes
+    const char *path = "ContactTests_jobs.db";
+    ContactStore store;
+    Test_FillStore(&store, 3000, 11);
+    ContactJob *save = ContactJob_Save(&store, path, CONTACT_V2_COMPRESSED, NULL);
+    CHECK(save && JobQueue_Submit(&queue, &save->job));
+    CHECK(Test_RunToEnd(&queue, &save->job) == JOB_FINISHED && save->status == CONTACT_FILE_OK);
+    ContactJob_Free(save);
+
+    ContactJob *load = ContactJob_Load(path, NULL);
+    CHECK(load && JobQueue_Submit(&queue, &load->job));
+    CHECK(Test_RunToEnd(&queue, &load->job) == JOB_FINISHED && load->status == CONTACT_FILE_OK);
+    CHECK(load->indexed && load->sortIndex.count == Store_LiveCount(&store));
+    CHECK(Test_SameContacts(&load->store, &store));
+    ContactJob_Free(load);
+
+    // A load cancelled while it waits for the worker never runs
+    memset(&running, 0, sizeof(running));
+    running.job.run = Test_BlockingRun;
+    load = ContactJob_Load(path, NULL);
+    CHECK(JobQueue_Submit(&queue, &running.job));
+    CHECK(load && JobQueue_Submit(&queue, &load->job));
+    JobQueue_Cancel(&queue, &load->job);
+    Platform_AtomicIncrement(&running.release);
+    CHECK(Test_RunToEnd(&queue, &load->job) == JOB_CANCELLED && load->store.count == 0);
+    ContactJob_Free(load);
+
+    JobQueue_Free(&queue);
+    Store_Free(&store);
+    Test_RemoveFiles(path);
+}
+
+// ------------------------------------------
+//                Contact view
+// ------------------------------------------
+
+// ------------------------------------------
+// Does every row show the contact with the id expected for it?
+// ------------------------------------------
+static int Test_ViewIds(const ContactView *view, const ContactStore *store, const uint64_t *ids, int count) {
+    if (view->count != count) return 0;
+    for (int row = 0; row < count; row++) {
+        int index = ContactView_IndexOfRow(view, store, row);
+        if (index < 0 || Store_IsDeleted(store, index) || Store_GetId(store, index) != ids[row]) return 0;
+        if (strcmp(ContactView_Text(view, store, row, VIEW_COLUMN_NAME), Store_GetName(store, index)) != 0) {
+            return 0;
+        }
+    }
+    return ContactView_IndexOfRow(view, store, count) == -1;
+}
+
+// ------------------------------------------
+// Delete every 'step'-th row shown and drop them from the view; 'ids'
+// becomes the ids of the rows left
+// ------------------------------------------
+static int Test_DeleteRows(ContactView *view, ContactStore *store, SortIndex *sort, uint64_t *ids, int step) {
+    int count = view->count, kept = 0;
+    for (int row = 0; row < count; row++) {
+        int index = ContactView_IndexOfRow(view, store, row);
+        if (row % step == 0) {
+            CHECK(Store_Delete(store, index));
+        } else {
+            ids[kept++] = Store_GetId(store, index);
+        }
+    }
+    SortIndex_RemoveDeleted(sort, store);
+    CHECK(ContactView_RemoveDeleted(view, store));
+    return kept;
+}
+
+// ------------------------------------------
+// Purge the store and move the sort index and the view along
+// ------------------------------------------
+static void Test_Purge(ContactView *view, ContactStore *store, SortIndex *sort) {
+    int *remap = (int*)malloc((size_t)store->count * sizeof(int));
+    CHECK(remap && Store_Purge(store, remap));
+    SortIndex_Purge(sort, remap);
+    ContactView_Purge(view, remap);
+    free(remap);
+}
+
+static void Test_View(void) {
+    ContactStore store;
+    SortIndex sort;
+    ContactView view;
+    Test_FillStore(&store, 2000, 21);
+    SortIndex_Init(&sort);
+    ContactView_Init(&view);
+    CHECK(SortIndex_Build(&sort, &store));
+    uint64_t *ids = (uint64_t*)malloc((size_t)store.count * sizeof(uint64_t));
+
+    // Whole store by name: rows follow the sort order
+    ContactView_SetSort(&view, &store, &sort, SORT_BY_NAME);
+    CHECK(ContactView_ShowAll(&view, &store));
+    for (int row = 0; row < view.count; row++) ids[row] = Store_GetId(&store, SortIndex_Order(&sort, SORT_BY_NAME)[row]);
+    CHECK(Test_ViewIds(&view, &store, ids, store.count));
+
+    int kept = Test_DeleteRows(&view, &store, &sort, ids, 3);
+    CHECK(kept == Store_LiveCount(&store));
+    CHECK(Test_ViewIds(&view, &store, ids, kept));
+    Test_Purge(&view, &store, &sort);
+    CHECK(store.deleted == 0 && Test_ViewIds(&view, &store, ids, kept));
+
+    // Store order with tombstones, then after the purge
+    ContactView_SetSort(&view, &store, &sort, SORT_NONE);
+    CHECK(ContactView_ShowAll(&view, &store));
+    kept = Test_DeleteRows(&view, &store, &sort, ids, 4);
+    CHECK(ContactView_ShowAll(&view, &store));
+    CHECK(Test_ViewIds(&view, &store, ids, kept));
+    Test_Purge(&view, &store, &sort);
+    CHECK(Test_ViewIds(&view, &store, ids, kept));
+    CHECK(ContactView_IndexOfRow(&view, &store, 5) == 5);
+
+    // A filtered view keeps its rows through deletes and a purge
+    CHECK(ContactView_Filter(&view, &store, NULL, "an"));
+    CHECK(view.count > 10 && view.count < store.count);
+    kept = Test_DeleteRows(&view, &store, &sort, ids, 2);
+    CHECK(Test_ViewIds(&view, &store, ids, kept));
+    Test_Purge(&view, &store, &sort);
+    CHECK(Test_ViewIds(&view, &store, ids, kept));
+
+    free(ids);
+    ContactView_Free(&view);
+    SortIndex_Free(&sort);
+    Store_Free(&store);
+}
+
+// ------------------------------------------
+//                Live search
+// ------------------------------------------
+
+static void Test_LiveSearch(void) {
+    static const char *s_typed[] = {
+        "m", "ma", "mar", "mart", "marti", "martin", "mar", "", "@", "@e", "@ex", "07", "+44", "zzq", "zzqx"
+    };
+    ContactStore store;
+    TrigramIndex index;
+    LiveSearch search;
+    Test_FillStore(&store, 5000, 31);
+    for (int i = 0; i < store.count; i += 7) CHECK(Store_Delete(&store, i));
+    TrigramIndex_Init(&index);
+    CHECK(TrigramIndex_Build(&index, &store));
+    int *expected = (int*)malloc((size_t)store.count * sizeof(int));
+
+    // Once through the trigram index, once scanning
+    for (int pass = 0; pass < 2; pass++) {
+        LiveSearch_Init(&search);
+        for (size_t q = 0; q < sizeof(s_typed) / sizeof(s_typed[0]); q++) {
+            CHECK(LiveSearch_Start(&search, &store, pass == 0 ? &index : NULL, s_typed[q]));
+            int steps = 0;
+            while (!LiveSearch_Step(&search, &store, 0.01)) steps++;
+            int count = Search_Contacts(&store, NULL, s_typed[q], expected);
+            if (!CHECK(search.count == count && memcmp(search.results, expected, (size_t)count * sizeof(int)) == 0)) {
+                fprintf(stderr, "  query \"%s\": %d results, expected %d\n", s_typed[q], search.count, count);
+            }
+        }
+        LiveSearch_Free(&search);
+    }
+
+    free(expected);
+    TrigramIndex_Free(&index);
+    Store_Free(&store);
+}
+
+// ------------------------------------------
+//                 v2 files
+// ------------------------------------------
+
+static void Test_V2(void) {
+    static const int s_flags[] = { 0, CONTACT_V2_COMPRESSED };
+    const char *path = "ContactTests_v2.db";
+    ContactStore store, loaded;
+    Test_FillStore(&store, 20000, 41);
+    for (int i = 0; i < store.count; i += 5) CHECK(Store_Delete(&store, i));
+
+    for (size_t f = 0; f < sizeof(s_flags) / sizeof(s_flags[0]); f++) {
+        CHECK(ContactFile_SaveV2(&store, path, s_flags[f], NULL) == CONTACT_FILE_OK);
+        CHECK(ContactFile_IsV2(path) && !ContactFile_IsEncrypted(path));
+        CHECK(ContactFile_LoadV2(&loaded, path, NULL) == CONTACT_FILE_OK);
+        CHECK(loaded.count == Store_LiveCount(&store) && Test_SameContacts(&loaded, &store));
+        Store_Free(&loaded);
+        CHECK(ContactFile_Load(&loaded, path, NULL) == CONTACT_FILE_OK);
+        CHECK(Test_SameContacts(&loaded, &store));
+        Store_Free(&loaded);
+    }
+
+    // A cut file is refused, not read in part
+    CHECK(Test_Truncate(path, (uint64_t)Test_FileSize(path) - 1));
+    CHECK(ContactFile_LoadV2(&loaded, path, NULL) == CONTACT_FILE_CORRUPT && loaded.count == 0);
+    Store_Free(&loaded);
+
+    Store_Free(&store);
+    Test_RemoveFiles(path);
+}
+
+// ------------------------------------------
+//              Encrypted v2 files
+// ------------------------------------------
+
+// ------------------------------------------
+// Does 'bytes' equal the hex string 'hex' (spaces ignored)?
+// ------------------------------------------
+static int Test_SameHex(const uint8_t *bytes, const char *hex) {
+    size_t n = 0;
+    for (; *hex; hex++) {
+        if (*hex == ' ') continue;
+        unsigned value;
+        if (sscanf(hex, "%2x", &value) != 1 || bytes[n++] != value) return 0;
+        hex++;
+    }
+    return 1;
+}
+
+// ------------------------------------------
+// Known-answer vectors of RFC 8439 (ChaCha20, Poly1305, AEAD), FIPS 180-2
+// (SHA-256) and PBKDF2-HMAC-SHA256 (RFC 7914 section 11, and the RFC 6070
+// inputs with SHA-256)
+// Files written by one build must open in every other, so the primitives
+// are pinned to the published values, not only to their own round trip.
+// ------------------------------------------
+static void Test_CryptoVectors(void) {
+    uint8_t key[CRYPTO_KEY_SIZE], tag[CRYPTO_TAG_SIZE], out[128];
+    for (int i = 0; i < CRYPTO_KEY_SIZE; i++) key[i] = (uint8_t)i;
+
+    // 2.3.2: the block function at counter 1
+    static const uint8_t s_blockNonce[CRYPTO_NONCE_SIZE] = { 0, 0, 0, 9, 0, 0, 0, 0x4a, 0, 0, 0, 0 };
+    memset(out, 0, 64);
+    ChaCha20_Xor(key, 1, s_blockNonce, out, out, 64);
+    CHECK(Test_SameHex(out, "10f1e7e4d13b5915500fdd1fa32071c4c7d1f4c733c068030422aa9ac3d46c4e"
+                            "d2826446079faa0914c2d705d98b02a2b5129cd1de164eb9cbd083e8a2503c4e"));
+
+    // 2.5.2: Poly1305
+    static const uint8_t s_macKey[32] = {
+        0x85, 0xd6, 0xbe, 0x78, 0x57, 0x55, 0x6d, 0x33, 0x7f, 0x44, 0x52, 0xfe, 0x42, 0xd5, 0x06, 0xa8,
+        0x01, 0x03, 0x80, 0x8a, 0xfb, 0x0d, 0xb2, 0xfd, 0x4a, 0xbf, 0xf6, 0xaf, 0x41, 0x49, 0xf5, 0x1b
+    };
+    const char *message = "Cryptographic Forum Research Group";
+    Poly1305_Mac(s_macKey, (const uint8_t*)message, strlen(message), tag);
+    CHECK(Test_SameHex(tag, "a8061dc1305136c6c22b8baf0c0127a9"));
+
+    // 2.8.2: AEAD_CHACHA20_POLY1305
+    static const uint8_t s_nonce[CRYPTO_NONCE_SIZE] = { 7, 0, 0, 0, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47 };
+    static const uint8_t s_aad[12] = { 0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7 };
+    const char *plain = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for "
+                        "the future, sunscreen would be it.";
+    size_t len = strlen(plain);
+    for (int i = 0; i < CRYPTO_KEY_SIZE; i++) key[i] = (uint8_t)(0x80 + i);
+    memcpy(out, plain, len);
+    Aead_Seal(key, s_nonce, s_aad, sizeof(s_aad), out, len, tag);
+    CHECK(Test_SameHex(out, "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d6"
+                            "3dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b36"
+                            "92ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+                            "3ff4def08e4b7a9de576d26586cec64b6116"));
+    CHECK(Test_SameHex(tag, "1ae10b594f09e26a7e902ecbd0600691"));
+    CHECK(Aead_Open(key, s_nonce, s_aad, sizeof(s_aad), out, len, tag) && memcmp(out, plain, len) == 0);
+
+    Sha256((const uint8_t*)"abc", 3, out);
+    CHECK(Test_SameHex(out, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+
+    // PBKDF2-HMAC-SHA256, also with output longer than one block
+    Pbkdf2_Sha256((const uint8_t*)"passwd", 6, (const uint8_t*)"salt", 4, 1, out, 64);
+    CHECK(Test_SameHex(out, "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc"
+                            "49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783"));
+    Pbkdf2_Sha256((const uint8_t*)"password", 8, (const uint8_t*)"salt", 4, 4096, out, 32);
+    CHECK(Test_SameHex(out, "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a"));
+    Pbkdf2_Sha256((const uint8_t*)"passwordPASSWORDpassword", 24,
+                  (const uint8_t*)"saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 4096, out, 40);
+    CHECK(Test_SameHex(out, "348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1c635518c7dac47e9"));
+}
+
+static void Test_Crypto(void) {
+    Test_CryptoVectors();
+
+    const char *path = "ContactTests_crypto.db";
+    ContactStore store, loaded;
+    Test_FillStore(&store, 5000, 51);
+
+    CHECK(ContactFile_SaveV2(&store, path, CONTACT_V2_COMPRESSED | CONTACT_V2_ENCRYPTED, "correct horse") ==
+          CONTACT_FILE_OK);
+    CHECK(ContactFile_IsEncrypted(path));
+    CHECK(ContactFile_LoadV2(&loaded, path, "correct horse") == CONTACT_FILE_OK);
+    CHECK(Test_SameContacts(&loaded, &store));
+    Store_Free(&loaded);
+
+    CHECK(ContactFile_LoadV2(&loaded, path, "correct horsE") == CONTACT_FILE_BAD_PASSPHRASE && loaded.count == 0);
+    Store_Free(&loaded);
+    CHECK(ContactFile_LoadV2(&loaded, path, NULL) == CONTACT_FILE_BAD_PASSPHRASE);
+    Store_Free(&loaded);
+
+    // Any changed byte of a block fails its tag
+    long long size = Test_FileSize(path);
+    CHECK(Test_FlipByte(path, size - 100));
+    CHECK(ContactFile_LoadV2(&loaded, path, "correct horse") == CONTACT_FILE_CORRUPT && loaded.count == 0);
+    Store_Free(&loaded);
+
+    Store_Free(&store);
+    Test_RemoveFiles(path);
+}
+
+// ------------------------------------------
+//                  Journal
+// ------------------------------------------
+
+// ------------------------------------------
+// Add, update and delete contacts, journaling each change
+// ------------------------------------------
+static void Test_Edit(ContactStore *store, Journal *journal, SynthRng *rng, int changes) {
+    char name[CONTACT_NAME_SIZE], phone[CONTACT_PHONE_SIZE], email[CONTACT_EMAIL_SIZE], date[CONTACT_DATE_SIZE];
+    for (int c = 0; c < changes; c++) {
+        Synth_Contact(rng, name, phone, email, date);
+        int row = (int)Synth_Below(rng, (uint32_t)store->count);
+        switch (c % 3) {
+        case 0:
+            CHECK(Store_Add(store, name, phone, email, date));
+            CHECK(Journal_Append(journal, JOURNAL_ADD, store, store->count - 1));
+            break;
+        case 1:
+            if (Store_IsDeleted(store, row)) break;
+            CHECK(Store_Update(store, row, name, phone, email, date));
+            CHECK(Journal_Append(journal, JOURNAL_UPDATE, store, row));
+            break;
+        default:
+            if (Store_IsDeleted(store, row)) break;
+            CHECK(Store_Delete(store, row));
+            CHECK(Journal_Append(journal, JOURNAL_DELETE, store, row));
+            break;
+        }
+    }
+}
+
+// ------------------------------------------
+// Load the snapshot and replay its journal
+// ------------------------------------------
+static ContactFileStatus Test_Reopen(ContactStore *loaded, Journal *journal, const char *path,
+                                     const char *passphrase) {
+    ContactFileStatus status = ContactFile_LoadV2(loaded, path, passphrase);
+    if (status == CONTACT_FILE_OK) status = Journal_Open(journal, path, passphrase, loaded);
+    return status;
+}
+
+static void Test_Journal(void) {
+    const char *path = "ContactTests_journal.db";
+    const char *passphrase = "journal test";
+    char journalPath[256];
+    snprintf(journalPath, sizeof(journalPath), "%s.journal", path);
+    ContactStore store, loaded;
+    Journal journal;
+    SynthRng rng;
+    Synth_Seed(&rng, 61);
+    Journal_Init(&journal);
+    Test_RemoveFiles(path);
+    Test_FillStore(&store, 3000, 61);
+
+    CHECK(ContactFile_SaveV2(&store, path, CONTACT_V2_COMPRESSED | CONTACT_V2_ENCRYPTED, passphrase) ==
+          CONTACT_FILE_OK);
+    CHECK(Journal_Create(&journal, path, passphrase) == CONTACT_FILE_OK);
+    Test_Edit(&store, &journal, &rng, 300);
+    Journal_Close(&journal);
+
+    // Snapshot + journal give back the edited store
+    CHECK(Test_Reopen(&loaded, &journal, path, passphrase) == CONTACT_FILE_OK);
+    CHECK(Test_SameContacts(&loaded, &store));
+
+    // Checkpoint while edits keep coming
+    JournalCheckpoint checkpoint;
+    CHECK(Journal_StartCheckpoint(&checkpoint, &journal, &loaded, passphrase));
+    Test_Edit(&loaded, &journal, &rng, 90);
+    CHECK(Journal_FinishCheckpoint(&checkpoint, &journal) == CONTACT_FILE_OK);
+    Test_Edit(&loaded, &journal, &rng, 30);
+    Journal_Close(&journal);
+    Store_Free(&store);
+    CHECK(Test_Reopen(&store, &journal, path, passphrase) == CONTACT_FILE_OK);
+    CHECK(Test_SameContacts(&store, &loaded));
+    Journal_Close(&journal);
+    Store_Free(&store);
+
+    // A damaged journal header is corrupt, not a wrong passphrase
+    CHECK(Test_FlipByte(journalPath, 52));
+    CHECK(Test_Reopen(&store, &journal, path, passphrase) == CONTACT_FILE_CORRUPT);
+    Journal_Close(&journal);
+    Store_Free(&store);
+    CHECK(Test_Reopen(&store, &journal, path, "journal tesT") == CONTACT_FILE_BAD_PASSPHRASE);
+    Journal_Close(&journal);
+    Store_Free(&store);
+    Store_Free(&loaded);
+
+    // Deleting every contact checkpoints an empty snapshot; contacts added
+    // after it live only in the journal and must still load
+    Test_RemoveFiles(path);
+    Test_FillStore(&store, 1100, 62);
+    CHECK(ContactFile_SaveV2(&store, path, CONTACT_V2_COMPRESSED | CONTACT_V2_ENCRYPTED, passphrase) ==
+          CONTACT_FILE_OK);
+    CHECK(Journal_Create(&journal, path, passphrase) == CONTACT_FILE_OK);
+    for (int row = 0; row < store.count; row++) {
+        CHECK(Store_Delete(&store, row));
+        CHECK(Journal_Append(&journal, JOURNAL_DELETE, &store, row));
+    }
+    CHECK(Journal_StartCheckpoint(&checkpoint, &journal, &store, passphrase));
+    CHECK(Journal_FinishCheckpoint(&checkpoint, &journal) == CONTACT_FILE_OK);
+    CHECK(ContactFile_Load(&loaded, path, passphrase) == CONTACT_FILE_OK && loaded.count == 0);
+    Store_Free(&loaded);
+    CHECK(Store_Add(&store, "Ada Lovelace", "+44 20 7946 0958", "ada@example.com", "1815-12-10"));
+    CHECK(Journal_Append(&journal, JOURNAL_ADD, &store, store.count - 1));
+    Journal_Close(&journal);
+    CHECK(ContactFile_Load(&loaded, path, passphrase) == CONTACT_FILE_OK);
+    CHECK(Journal_Open(&journal, path, passphrase, &loaded) == CONTACT_FILE_OK);
+    CHECK(Store_LiveCount(&loaded) == 1 && Test_SameContacts(&loaded, &store));
+    Journal_Close(&journal);
+    Store_Free(&loaded);
+    Store_Free(&store);
+    Test_RemoveFiles(path);
+}
+
+// ------------------------------------------
+//                  Import
+// ------------------------------------------
+
+// ------------------------------------------
+// Import 'csv' into an empty store
+// ------------------------------------------
+static ContactFileStatus Test_ImportCsv(ContactStore *store, ImportResult *result, const char *csv) {
+    const char *path = "ContactTests_import.csv";
+    FILE *f = fopen(path, "wb");
+    if (!f) return CONTACT_FILE_OPEN_FAILED;
+    fputs(csv, f);
+    fclose(f);
+    Store_Init(store);
+    ContactFileStatus status = Import_File(store, path, IMPORT_CSV, result);
+    remove(path);
+    return status;
+}
+
+static void Test_Import(void) {
+    // Google Contacts: label columns come before their values
+    static const char *s_google =
+        "First Name,Middle Name,Last Name,Phonetic First Name,Phonetic Middle Name,Phonetic Last Name,"
+        "Name Prefix,Name Suffix,Nickname,File As,Organization Name,Organization Title,Birthday,Notes,"
+        "Photo,Labels,E-mail 1 - Label,E-mail 1 - Value,E-mail 2 - Label,E-mail 2 - Value,"
+        "Phone 1 - Label,Phone 1 - Value\r\n"
+        "Ada,,Lovelace,,,,,,,,Engines Ltd,,1815-12-10,,,* myContacts,* Home,ada@example.com,Work,"
+        "ada@engines.example,Mobile,+44 20 7946 0958\r\n"
+        "Charles,,Babbage,,,,,,,,,,,,,* myContacts,* Work,charles@example.com,,,Work,020 7946 0000\r\n";
+    // The older Google layout: full name, then "- Type" columns
+    static const char *s_googleOld =
+        "Name,Given Name,Additional Name,Family Name,Yomi Name,Birthday,Gender,Group Membership,"
+        "E-mail 1 - Type,E-mail 1 - Value,Phone 1 - Type,Phone 1 - Value\n"
+        "Ada Lovelace,Ada,,Lovelace,,1815-12-10,female,* My Contacts,* Home,ada@example.com,"
+        "Mobile,+44 20 7946 0958\n";
+    // Outlook: "0/0/00" for no birthday, e-mail type and display name after the address
+    static const char *s_outlook =
+        "Title,First Name,Middle Name,Last Name,Suffix,Company,Job Title,Business Phone,Home Phone,"
+        "Mobile Phone,Birthday,E-mail Address,E-mail Type,E-mail Display Name\r\n"
+        "\"\",\"Ada\",\"\",\"Lovelace\",\"\",\"Engines Ltd\",\"\",\"+44 20 7946 0958\",\"\",\"\","
+        "\"0/0/00\",\"ada@example.com\",\"SMTP\",\"Ada Lovelace (ada@example.com)\"\r\n";
+
+    ContactStore store;
+    ImportResult result;
+    CHECK(Test_ImportCsv(&store, &result, s_google) == CONTACT_FILE_OK);
+    CHECK(result.rows == 2 && result.imported == 2 && result.rejectedCount == 0);
+    if (CHECK(store.count == 2)) {
+        CHECK(strcmp(Store_GetName(&store, 0), "Ada Lovelace") == 0);
+        CHECK(strcmp(Store_GetPhone(&store, 0), "+442079460958") == 0);
+        CHECK(strcmp(Store_GetEmail(&store, 0), "ada@example.com") == 0);
+        CHECK(strcmp(Store_GetDate(&store, 0), "1815-12-10") == 0);
+        CHECK(strcmp(Store_GetName(&store, 1), "Charles Babbage") == 0);
+        CHECK(strcmp(Store_GetPhone(&store, 1), "02079460000") == 0);
+        CHECK(strcmp(Store_GetDate(&store, 1), "") == 0);
+    }
+    Import_FreeResult(&result);
+    Store_Free(&store);
+
+    CHECK(Test_ImportCsv(&store, &result, s_googleOld) == CONTACT_FILE_OK);
+    CHECK(result.imported == 1 && result.rejectedCount == 0);
+    if (CHECK(store.count == 1)) {
+        CHECK(strcmp(Store_GetName(&store, 0), "Ada Lovelace") == 0);
+        CHECK(strcmp(Store_GetEmail(&store, 0), "ada@example.com") == 0);
+        CHECK(strcmp(Store_GetPhone(&store, 0), "+442079460958") == 0);
+    }
+    Import_FreeResult(&result);
+    Store_Free(&store);
+
+    CHECK(Test_ImportCsv(&store, &result, s_outlook) == CONTACT_FILE_OK);
+    CHECK(result.imported == 1 && result.rejectedCount == 0);
+    if (CHECK(store.count == 1)) {
+        CHECK(strcmp(Store_GetName(&store, 0), "Ada Lovelace") == 0);
+        CHECK(strcmp(Store_GetPhone(&store, 0), "+442079460958") == 0);
+        CHECK(strcmp(Store_GetEmail(&store, 0), "ada@example.com") == 0);
+        CHECK(strcmp(Store_GetDate(&store, 0), "") == 0);
+    }
+    Import_FreeResult(&result);
+    Store_Free(&store);
+}
+
+// ------------------------------------------
+//                Duplicates
+// ------------------------------------------
+
+// ------------------------------------------
+// Group of a dedup result holding store position 'row', or -1
+// ------------------------------------------
+static int Test_GroupOf(const DedupResult *result, int row) {
+    for (int g = 0; g < result->groupCount; g++) {
+        for (int m = result->groupStart[g]; m < result->groupStart[g + 1]; m++) {
+            if (result->members[m] == row) return g;
+        }
+    }
+    return -1;
+}
+
+static void Test_Dedup(void) {
+    ContactStore store;
+    Store_Init(&store);
+    // Same number; the second has a date and another email, and is kept
+    CHECK(Store_Add(&store, "John Smith", "07700900001", "john@example.com", ""));
+    CHECK(Store_Add(&store, "Jon Smith", "07700900001", "jon.smith@work.example", "1980-01-02"));
+    // Same email in another case: nothing differs
+    CHECK(Store_Add(&store, "Mary Jones", "07700900002", "mary@example.com", "1990-05-06"));
+    CHECK(Store_Add(&store, "Mary Jones", "07700900002", "MARY@example.com", "1990-05-06"));
+    CHECK(Synth_FillStore(&store, 500, 71));
+
+    JobQueue queue;
+    CHECK(JobQueue_Init(&queue, 1, NULL, NULL));
+    ContactJob *find = ContactJob_Dedup(&store, DEDUP_DEFAULT_THRESHOLD);
+    CHECK(find && JobQueue_Submit(&queue, &find->job));
+    CHECK(Test_RunToEnd(&queue, &find->job) == JOB_FINISHED && find->status == CONTACT_FILE_OK);
+    int smith = Test_GroupOf(&find->dedup, 0);
+    int jones = Test_GroupOf(&find->dedup, 2);
+    if (!CHECK(smith >= 0 && jones >= 0 && Test_GroupOf(&find->dedup, 1) == smith)) {
+        ContactJob_Free(find);
+        JobQueue_Free(&queue);
+        Store_Free(&store);
+        return;
+    }
+    CHECK(find->dedup.members[find->dedup.groupStart[smith]] == 1);
+
+    DedupDropped dropped[4];
+    CHECK(Dedup_Dropped(&store, &find->dedup, &jones, 1, dropped, 4) == 0);
+    CHECK(Dedup_Dropped(&store, &find->dedup, &smith, 1, dropped, 4) == 1);
+    CHECK(dropped[0].row == 0 && dropped[0].field == CONTACT_FIELD_EMAIL &&
+          strcmp(dropped[0].value, "john@example.com") == 0);
+
+    // Merge only the Smiths; the job takes over the groups
+    ContactJob *merge = ContactJob_Merge(&store, &find->dedup, &smith, 1);
+    CHECK(find->dedup.groupCount == 0);
+    ContactJob_Free(find);
+    CHECK(merge && JobQueue_Submit(&queue, &merge->job));
+    CHECK(Test_RunToEnd(&queue, &merge->job) == JOB_FINISHED && merge->status == CONTACT_FILE_OK);
+    CHECK(merge->merged == 1 && merge->droppedCount == 1 && merge->dropped[0].row == 0);
+    CHECK(merge->indexed && merge->sortIndex.count == Store_LiveCount(&merge->store));
+    CHECK(Store_IsDeleted(&merge->store, 0) && !Store_IsDeleted(&merge->store, 1));
+    CHECK(strcmp(Store_GetEmail(&merge->store, 1), "jon.smith@work.example") == 0);
+    CHECK(!Store_IsDeleted(&merge->store, 2) && !Store_IsDeleted(&merge->store, 3));
+    CHECK(!Store_IsDeleted(&store, 0));  // The caller's store is untouched
+    ContactJob_Free(merge);
+
+    JobQueue_Free(&queue);
+    Store_Free(&store);
+}
+
+// ------------------------------------------
+//                  Date keys
+// ------------------------------------------
+
+static void Test_DateKey(void) {
+    // Every day of the calendar: keys count up from 1 and format back
+    char text[32], back[DATE_KEY_TEXT];
+    uint32_t expected = 1;
+    int mismatches = 0;
+    static const int s_days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    for (int year = 0; year <= 9999; year++) {
+        int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        for (int month = 1; month <= 12; month++) {
+            int days = s_days[month - 1] + (month == 2 && leap);
+            for (int day = 1; day <= days; day++, expected++) {
+                snprintf(text, sizeof(text), "%04d-%02d-%02d", year, month, day);
+                uint32_t key = DateKey_Parse(text);
+                DateKey_Format(key, back);
+                if (key != expected || DateKey_FromCivil(year, month, day) != key || strcmp(back, text) != 0) {
+                    mismatches++;
+                }
+            }
+        }
+    }
+    CHECK(mismatches == 0 && expected == DATE_KEY_END);
+    DateKey_Format(DATE_KEY_NONE, back);
+    CHECK(back[0] == '\0');
+    DateKey_Format(DATE_KEY_END, back);
+    CHECK(back[0] == '\0');
+
+    // Days that do not exist and other formats have no key
+    static const char *s_bad[] = {
+        "2024-02-30", "2023-02-29", "1900-02-29", "2024-1-01", "2024-01-1", "24-01-01", "2024-13-01",
+        "2024-00-10", "2024-01-00", "2024-04-31", "2024/01/01", "2024-01-011", "", " 2024-01-01"
+    };
+    for (size_t i = 0; i < sizeof(s_bad) / sizeof(s_bad[0]); i++) {
+        if (!CHECK(DateKey_Parse(s_bad[i]) == DATE_KEY_NONE)) fprintf(stderr, "  parsed \"%s\"\n", s_bad[i]);
+    }
+    CHECK(DateKey_Parse(NULL) == DATE_KEY_NONE);
+    CHECK(DateKey_Parse("2024-02-29") != DATE_KEY_NONE && DateKey_Parse("2000-02-29") != DATE_KEY_NONE);
+
+    // Any other byte in place of a digit or a separator
+    int accepted = 0;
+    for (int pos = 0; pos < 10; pos++) {
+        for (int c = 1; c < 256; c++) {
+            char date[] = "2024-07-15";
+            int separator = pos == 4 || pos == 7;
+            if (separator ? c == '-' : (c >= '0' && c <= '9')) continue;
+            date[pos] = (char)c;
+            if (DateKey_Parse(date) != DATE_KEY_NONE) {
+                fprintf(stderr, "  byte 0x%02x accepted at %d\n", c, pos);
+                accepted++;
+            }
+        }
+    }
+    CHECK(accepted == 0);
+
+    // Prefix ranges: a year, a month, a day
+    uint32_t low, high;
+    CHECK(DateKey_PrefixRange("2024", &low, &high));
+    CHECK(low == DateKey_Parse("2024-01-01") && high == DateKey_Parse("2025-01-01") && high - low == 366);
+    CHECK(DateKey_PrefixRange("2023", &low, &high) && high - low == 365);
+    CHECK(DateKey_PrefixRange("2024-02", &low, &high));
+    CHECK(low == DateKey_Parse("2024-02-01") && high == DateKey_Parse("2024-03-01") && high - low == 29);
+    CHECK(DateKey_PrefixRange("2023-02", &low, &high) && high - low == 28);
+    CHECK(DateKey_PrefixRange("2024-12", &low, &high) && high == DateKey_Parse("2025-01-01"));
+    CHECK(DateKey_PrefixRange("9999", &low, &high) && high == DATE_KEY_END);
+    CHECK(DateKey_PrefixRange("2024-07-15", &low, &high) && low == DateKey_Parse("2024-07-15") &&
+          high == low + 1);
+    static const char *s_badPrefix[] = { "", "202", "20a4", "2024-", "2024-2", "2024-13", "2024-00", "2024-02-30" };
+    for (size_t i = 0; i < sizeof(s_badPrefix) / sizeof(s_badPrefix[0]); i++) {
+        CHECK(!DateKey_PrefixRange(s_badPrefix[i], &low, &high));
+    }
+}
+
+// ------------------------------------------
+//                 Phone keys
+// ------------------------------------------
+
+// ------------------------------------------
+// Does the index give the same owners of 'phone' as a scan of the store?
+// ------------------------------------------
+static int Test_SameOwners(const PhoneIndex *index, const ContactStore *store, const char *phone) {
+    int rows[1024];
+    int found = PhoneIndex_Owners(index, store, phone, rows, 1024);
+    uint64_t key = PhoneKey_Parse(phone);
+    int expected = 0;
+    for (int row = 0; row < store->count; row++) {
+        if (key == PHONE_KEY_NONE || Store_IsDeleted(store, row) || PhoneKey_Parse(Store_GetPhone(store, row)) != key) {
+            continue;
+        }
+        int listed = 0;
+        for (int i = 0; i < found; i++) listed |= rows[i] == row;
+        if (!listed) return 0;
+        expected++;
+    }
+    return found == expected;
+}
+
+static void Test_Phone(void) {
+    // Spellings of one number share a key; national numbers stay apart
+    uint64_t key = PhoneKey_Parse("+44-20-1234");
+    CHECK(key != PHONE_KEY_NONE && (key & PHONE_KEY_INTERNATIONAL));
+    CHECK(PhoneKey_Parse("+44 2012 34") == key && PhoneKey_Parse("0044 20 1234") == key);
+    CHECK(PhoneKey_Parse("0044 (20) 1234") == key && PhoneKey_Parse("  +44.20/1234") == key);
+    CHECK(PhoneKey_Parse("020 1234") != key && PhoneKey_Parse("44 20 1234") != key);
+    char text[PHONE_KEY_MAX_DIGITS + 2];
+    PhoneKey_Format(key, text);
+    CHECK(strcmp(text, "+44201234") == 0 && PhoneKey_Count(key) == 8);
+    PhoneKey_Format(PhoneKey_Parse("(020) 7946-0958"), text);
+    CHECK(strcmp(text, "02079460958") == 0);
+
+    // Sixteen digits at most; no number without digits or with other characters
+    CHECK(PhoneKey_Parse("1234567890123456") != PHONE_KEY_NONE);
+    CHECK(PhoneKey_Parse("+9999 9999 9999 9999") != PHONE_KEY_NONE);
+    CHECK(PhoneKey_Parse("12345678901234567") == PHONE_KEY_NONE);
+    CHECK(PhoneKey_Parse("0012345678901234567") == PHONE_KEY_NONE);
+    static const char *s_none[] = { "", "   ", "+", "00", "--", "555-CALL", "12#34", "+44 20 1234 ext 5" };
+    for (size_t i = 0; i < sizeof(s_none) / sizeof(s_none[0]); i++) {
+        CHECK(PhoneKey_Parse(s_none[i]) == PHONE_KEY_NONE);
+    }
+    PhoneKey_Format(PHONE_KEY_NONE, text);
+    CHECK(text[0] == '\0');
+
+    // Key order is digit order, national before international
+    CHECK(PhoneKey_Parse("0123") < PhoneKey_Parse("0124") && PhoneKey_Parse("012") < PhoneKey_Parse("0120"));
+    CHECK(PhoneKey_Parse("9999999999999999") < PhoneKey_Parse("+1"));
+
+    // Prefix ranges hold the longer numbers with those first digits, and
+    // the shorter ones padded to the same value, which the count excludes
+    uint64_t low, high, prefix = PhoneKey_Parse("020");
+    CHECK(!PhoneKey_PrefixRange(PHONE_KEY_NONE, &low, &high));
+    CHECK(PhoneKey_PrefixRange(prefix, &low, &high));
+    static const struct { const char *phone; int starts; } s_prefix[] = {
+        { "020", 1 }, { "020 7946 0958", 1 }, { "0209999999999999", 1 }, { "02", 0 }, { "0", 0 },
+        { "021", 0 }, { "0199", 0 }, { "+44 20", 0 }, { "0020", 0 }
+    };
+    for (size_t i = 0; i < sizeof(s_prefix) / sizeof(s_prefix[0]); i++) {
+        uint64_t k = PhoneKey_Parse(s_prefix[i].phone);
+        int starts = k >= low && k < high && PhoneKey_Count(k) >= PhoneKey_Count(prefix);
+        if (!CHECK(starts == s_prefix[i].starts)) fprintf(stderr, "  prefix 020 of \"%s\"\n", s_prefix[i].phone);
+    }
+    CHECK(PhoneKey_Parse("02") >= low && PhoneKey_Parse("02") < high);
+    CHECK(PhoneKey_PrefixRange(PhoneKey_Parse("9999999999999999"), &low, &high) &&
+          high <= PhoneKey_Parse("+0") && low == (PhoneKey_Parse("9999999999999999") & ~UINT64_C(31)));
+
+    // The index follows adds, updates and deletes
+    static const char *s_pool[] = {
+        "+44-20-1234", "+44 2012 34", "0044 20 1234", "020 1234", "(020) 1234", "+1 555 0100",
+        "001 555 0100", "07700 900123", "", "n/a"
+    };
+    const int poolSize = (int)(sizeof(s_pool) / sizeof(s_pool[0]));
+    ContactStore store;
+    PhoneIndex index;
+    SynthRng rng;
+    Synth_Seed(&rng, 81);
+    Test_FillStore(&store, 1500, 81);
+    PhoneIndex_Init(&index);
+    CHECK(PhoneIndex_Build(&index, &store));
+    int failures = 0;
+    for (int step = 0; step < 4000; step++) {
+        const char *phone = s_pool[Synth_Below(&rng, (uint32_t)poolSize)];
+        int row = (int)Synth_Below(&rng, (uint32_t)store.count);
+        switch (Synth_Below(&rng, 3)) {
+        case 0:
+            CHECK(Store_Add(&store, "Pat Doe", phone, "pat@example.com", ""));
+            CHECK(PhoneIndex_Insert(&index, &store, store.count - 1));
+            break;
+        case 1:
+            if (Store_IsDeleted(&store, row)) break;
+            PhoneIndex_BeginUpdate(&index, &store, row);
+            CHECK(Store_Update(&store, row, Store_GetName(&store, row), phone, Store_GetEmail(&store, row),
+                               Store_GetDate(&store, row)));
+            CHECK(PhoneIndex_EndUpdate(&index, &store, row));
+            break;
+        default:
+            if (Store_IsDeleted(&store, row)) break;
+            PhoneIndex_Remove(&index, &store, row);
+            CHECK(Store_Delete(&store, row));
+            break;
+        }
+        if (step % 500 == 499) {
+            for (int i = 0; i < poolSize; i++) failures += !Test_SameOwners(&index, &store, s_pool[i]);
+        }
+    }
+    CHECK(failures == 0 && !index.stale);
+    for (int row = 0; row < store.count; row++) {
+        if (!Store_IsDeleted(&store, row) && !Test_SameOwners(&index, &store, Store_GetPhone(&store, row))) failures++;
+    }
+    CHECK(failures == 0);
+
+    // Every spelling finds the same owners; ids survive a purge
+    static uint64_t ids[1024];
+    static int rows[1024];
+    int owners = PhoneIndex_Find(&index, key, ids, 1024);
+    CHECK(owners > 0 && owners <= 1024 && PhoneIndex_Find(&index, PHONE_KEY_NONE, ids, 1024) == 0);
+    CHECK(PhoneIndex_Owners(&index, &store, "0044 (20) 1234", rows, 1024) == owners);
+    int *remap = (int*)malloc((size_t)store.count * sizeof(int));
+    CHECK(remap && Store_Purge(&store, remap));
+    free(remap);
+    CHECK(Test_SameOwners(&index, &store, "+44 20 1234") && Test_SameOwners(&index, &store, "020 1234"));
+
+    PhoneIndex_Free(&index);
+    Store_Free(&store);
+}
+
+// ------------------------------------------
+//              Structured queries
+// ------------------------------------------
+
+typedef struct {
+    TrigramIndex trigrams;
+    PhoneIndex   phones;
+    SortIndex    sorted;
+    QueryIndexes indexes;
+} TestIndexes;
+
+static void Test_BuildIndexes(TestIndexes *t, const ContactStore *store) {
+    TrigramIndex_Init(&t->trigrams);
+    PhoneIndex_Init(&t->phones);
+    SortIndex_Init(&t->sorted);
+    CHECK(TrigramIndex_Build(&t->trigrams, store) && PhoneIndex_Build(&t->phones, store) &&
+          SortIndex_Build(&t->sorted, store));
+    t->indexes.trigrams = &t->trigrams;
+    t->indexes.phones = &t->phones;
+    t->indexes.sorted = &t->sorted;
+}
+
+static void Test_FreeIndexes(TestIndexes *t) {
+    TrigramIndex_Free(&t->trigrams);
+    PhoneIndex_Free(&t->phones);
+    SortIndex_Free(&t->sorted);
+}
+
+// ------------------------------------------
+// Run 'text' with the indexes and as a scan. Returns the number of
+// matches (positions in 'rows') if both agree, else -1.
+// ------------------------------------------
+static int Test_RunQuery(const ContactStore *store, const QueryIndexes *indexes, const char *text, int *rows) {
+    Query query;
+    if (!CHECK(Query_Parse(&query, text))) {
+        fprintf(stderr, "  %s: %s\n", text, query.error);
+        return -1;
+    }
+    int *scanned = (int*)malloc((size_t)(store->count + 1) * sizeof(int));
+    if (!scanned) return -1;
+    Query_Plan(&query, store, indexes);
+    int count = Query_Run(&query, store, indexes, rows);
+    Query_Plan(&query, store, NULL);
+    int scanCount = Query_Run(&query, store, NULL, scanned);
+    int same = count >= 0 && count == scanCount && memcmp(rows, scanned, (size_t)count * sizeof(int)) == 0;
+    free(scanned);
+    if (!same) fprintf(stderr, "  %s: %d indexed, %d scanned\n", text, count, scanCount);
+    return same ? count : -1;
+}
+
+// ------------------------------------------
+// Does 'text' match exactly the positions in the -1 terminated 'expected'?
+// ------------------------------------------
+static int Test_QueryRows(const ContactStore *store, const QueryIndexes *indexes, const char *text,
+                          const int *expected) {
+    int rows[64];
+    int count = Test_RunQuery(store, indexes, text, rows);
+    int n = 0;
+    while (expected[n] >= 0) n++;
+    int same = count == n && memcmp(rows, expected, (size_t)n * sizeof(int)) == 0;
+    if (!same) fprintf(stderr, "  %s: %d rows, expected %d\n", text, count, n);
+    return same;
+}
+
+// ------------------------------------------
+// Does parsing 'text' fail with 'message'?
+// ------------------------------------------
+static int Test_QueryError(const char *text, const char *message) {
+    Query query;
+    if (Query_Parse(&query, text)) return 0;
+    if (strcmp(query.error, message) == 0) return 1;
+    fprintf(stderr, "  %s: \"%s\"\n", text, query.error);
+    return 0;
+}
+
+// ------------------------------------------
+// Positions matching 'prefix' by phone key or date range, found the slow way
+// ------------------------------------------
+static int Test_PhonePrefixCount(const ContactStore *store, const char *prefix) {
+    char want[PHONE_KEY_MAX_DIGITS + 2], have[PHONE_KEY_MAX_DIGITS + 2];
+    PhoneKey_Format(PhoneKey_Parse(prefix), want);
+    int count = 0;
+    for (int row = 0; row < store->count; row++) {
+        PhoneKey_Format(PhoneKey_Parse(Store_GetPhone(store, row)), have);
+        count += !Store_IsDeleted(store, row) && strncmp(have, want, strlen(want)) == 0;
+    }
+    return count;
+}
+
+static int Test_DateRangeCount(const ContactStore *store, const char *first, const char *last) {
+    int count = 0;
+    for (int row = 0; row < store->count; row++) {
+        const char *date = Store_GetDate(store, row);
+        count += !Store_IsDeleted(store, row) && date[0] && strcmp(date, first) >= 0 && strcmp(date, last) <= 0;
+    }
+    return count;
+}
+
+static void Test_Query(void) {
+    ContactStore store;
+    Store_Init(&store);
+    static const char *s_contacts[][4] = {
+        { "Ada Lovelace",      "+44 20 7946 0958",  "ada@engines.example",     "1815-12-10" },
+        { "Charles Babbage",   "020 7946 0000",     "charles@engines.example", "1791-12-26" },
+        { "Grace Hopper",      "+1 555 0100",       "grace@navy.example",      "1906-12-09" },
+        { "Smith AND Sons",    "0044 20 7946 0001", "info@smith.example",      "2024-02-29" },
+        { "Alan Turing",       "+44-20-7946-0002",  "alan@bletchley.example",  "2024-07-15" },
+        { "Katherine Johnson", "",                  "kj@nasa.example",         ""           },
+        { "Mary Jackson",      "555-0100",          "mary@nasa.example",       "2024-07-01" },
+        { "Dorothy Vaughan",   "001 555 0199",      "dorothy@nasa.example",    "2023-12-31" },
+    };
+    for (size_t i = 0; i < sizeof(s_contacts) / sizeof(s_contacts[0]); i++) {
+        CHECK(Store_Add(&store, s_contacts[i][0], s_contacts[i][1], s_contacts[i][2], s_contacts[i][3]));
+    }
+    TestIndexes t;
+    Test_BuildIndexes(&t, &store);
+    const QueryIndexes *ix = &t.indexes;
+
+    // AND chains, quoting, NOT and !=
+    CHECK(Test_QueryRows(&store, ix, "name contains a AND email ends-with @nasa.example", (int[]){ 5, 6, 7, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "NAME Contains LOVE", (int[]){ 0, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "name = \"Smith AND Sons\"", (int[]){ 3, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "name is \"smith and sons\" AND email starts-with info", (int[]){ 3, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "NOT name contains o", (int[]){ 1, 4, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "name starts-with g AND email != grace@navy.example", (int[]){ -1 }));
+    CHECK(Test_QueryRows(&store, ix, "email != GRACE@NAVY.EXAMPLE AND NOT email ends-with @nasa.example",
+                         (int[]){ 0, 1, 3, 4, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "name ends-with son AND name contains  \"a\"", (int[]){ 5, 6, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "name >= k AND name < n", (int[]){ 5, 6, -1 }));
+
+    // Phone numbers in any spelling
+    CHECK(Test_QueryRows(&store, ix, "phone = 0044 (20) 7946-0958", (int[]){ 0, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "phone starts-with +44 20 7946", (int[]){ 0, 3, 4, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "phone starts-with 020", (int[]){ 1, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "phone starts-with +1 555", (int[]){ 2, 7, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "phone = 555 0100", (int[]){ 6, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "phone != +1-555-0100", (int[]){ 0, 1, 3, 4, 5, 6, 7, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "phone contains 7946 AND phone ends-with 0", (int[]){ 1, -1 }));
+
+    // Dates: ranges, merged ranges, years and months
+    CHECK(Test_QueryRows(&store, ix, "date >= 2024-01-01 AND date < 2024-07-15", (int[]){ 3, 6, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "date starts-with 2024", (int[]){ 3, 4, 6, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "date starts-with 2024-07", (int[]){ 4, 6, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "date starts-with 2024-02 AND date > 2024-02-28", (int[]){ 3, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "date > 2023-12-30 AND date <= 2024-07-01 AND date != 2024-02-29",
+                         (int[]){ 6, 7, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "date >= 2024-07-01 AND date <= 2023-01-01", (int[]){ -1 }));
+    CHECK(Test_QueryRows(&store, ix, "date < 1800-01-01", (int[]){ 1, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "date = \"\"", (int[]){ 5, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "NOT date starts-with 2024", (int[]){ 0, 1, 2, 5, 7, -1 }));
+    CHECK(Test_QueryRows(&store, ix, "date contains -12-", (int[]){ 0, 1, 2, 7, -1 }));
+
+    Query query;
+    CHECK(Query_Parse(&query, "date >= 2024-01-01 AND name contains a AND date < 2024-07-15") && query.count == 3);
+    CHECK(!query.predicates[0].merged && query.predicates[2].merged && !query.predicates[1].byKey);
+    CHECK(query.predicates[0].keyLow == DateKey_Parse("2024-01-01") &&
+          query.predicates[0].keyHigh == DateKey_Parse("2024-07-15"));
+    CHECK(Query_Parse(&query, "date != 2024-01-01 AND date >= 2024-01-01") && !query.predicates[1].merged);
+    CHECK(Query_Parse(&query, "name != x") && query.predicates[0].negate && query.predicates[0].op == QUERY_EQUAL);
+    CHECK(Query_Parse(&query, "NOT name != x") && !query.predicates[0].negate);
+    CHECK(Query_Parse(&query, "name = Smith and Sons and co") == 0);
+    CHECK(Query_IsStructured("not date >") && Query_IsStructured("email ends-with") &&
+          !Query_IsStructured("Ada Lovelace") && !Query_IsStructured("name"));
+
+    // Errors
+    CHECK(Test_QueryError("", "Empty query"));
+    CHECK(Test_QueryError("age > 30", "Unknown field \"age\" (use name, phone, email or date)"));
+    CHECK(Test_QueryError("name like ada", "Unknown operator \"like\" after name"));
+    CHECK(Test_QueryError("name = Smith AND Sons", "Unknown field \"sons\" (use name, phone, email or date)"));
+    CHECK(Test_QueryError("date > 2024-02-30", "Not a date: \"2024-02-30\" (use YYYY-MM-DD)"));
+    CHECK(Test_QueryError("date = 2024-1-01", "Not a date: \"2024-1-01\" (use YYYY-MM-DD)"));
+    CHECK(Test_QueryError("date <= July", "Not a date: \"July\" (use YYYY-MM-DD)"));
+    CHECK(Test_QueryError("phone < 5", "Phone supports contains, starts-with, ends-with, = and !="));
+    CHECK(Test_QueryError("name = \"Ada", "Missing closing quote"));
+    CHECK(Test_QueryError("email =  ", "Missing value"));
+    CHECK(Test_QueryError("name = \"Ada\" email = x", "Expected AND after \"Ada\""));
+    CHECK(Test_QueryError("name = a AND name = b AND name = c AND name = d AND name = e AND name = f AND "
+                          "name = g AND name = h AND name = i", "At most 8 conditions"));
+    Test_FreeIndexes(&t);
+
+    // A larger store: every index path agrees with the scan and with keys
+    // compared one contact at a time
+    CHECK(Synth_FillStore(&store, 20000, 91));
+    for (int row = 0; row < store.count; row += 7) CHECK(Store_Delete(&store, row));
+    Test_BuildIndexes(&t, &store);
+    int *rows = (int*)malloc((size_t)store.count * sizeof(int));
+    static const char *s_prefixes[] = { "+44", "+44 7", "+60-12", "07", "0712", "03", "+1 555", "0", "9" };
+    for (size_t i = 0; rows && i < sizeof(s_prefixes) / sizeof(s_prefixes[0]); i++) {
+        char text[64];
+        snprintf(text, sizeof(text), "phone starts-with %s", s_prefixes[i]);
+        int count = Test_RunQuery(&store, ix, text, rows);
+        if (!CHECK(count == Test_PhonePrefixCount(&store, s_prefixes[i]))) fprintf(stderr, "  %s\n", text);
+    }
+    for (int row = 1; rows && row < store.count; row += 997) {
+        char text[64];
+        snprintf(text, sizeof(text), "phone = \"%s\"", Store_GetPhone(&store, row));
+        int count = Test_RunQuery(&store, ix, text, rows);
+        CHECK(count >= 1);
+    }
+    static const char *s_ranges[][3] = {
+        { "date starts-with 2010",                           "2010-01-01", "2010-12-31" },
+        { "date starts-with 2012-02",                        "2012-02-01", "2012-02-29" },
+        { "date >= 2005-06-15 AND date <= 2007-01-01",       "2005-06-15", "2007-01-01" },
+        { "date > 2020-02-28 AND date starts-with 2020-02",  "2020-02-29", "2020-02-29" },
+        { "date < 2000-01-02",                               "0000-01-01", "2000-01-01" },
+    };
+    for (size_t i = 0; rows && i < sizeof(s_ranges) / sizeof(s_ranges[0]); i++) {
+        int count = Test_RunQuery(&store, ix, s_ranges[i][0], rows);
+        if (!CHECK(count == Test_DateRangeCount(&store, s_ranges[i][1], s_ranges[i][2]))) {
+            fprintf(stderr, "  %s\n", s_ranges[i][0]);
+        }
+    }
+    static const char *s_mixed[] = {
+        "name contains son AND email ends-with @gmail.com",
+        "email ends-with @corp.com AND date >= 2024-01-01 AND phone starts-with +60",
+        "name starts-with mar AND NOT phone starts-with +44",
+        "email contains .com AND name = \"Oliver Smith\"",
+        "NOT email ends-with .com AND date starts-with 2015",
+        "name > \"Zz\"",
+        "email = \"\" AND name contains liv",
+    };
+    for (size_t i = 0; rows && i < sizeof(s_mixed) / sizeof(s_mixed[0]); i++) {
+        CHECK(Test_RunQuery(&store, ix, s_mixed[i], rows) >= 0);
+    }
+
+    // The comparisons above went through the indexes, not only scans
+    static const struct { const char *text; QueryAccess path; } s_paths[] = {
+        { "phone starts-with +44 7",                  QUERY_ACCESS_SORTED },
+        { "phone = +44-7123-456789",                  QUERY_ACCESS_PHONE },
+        { "date >= 2005-06-15 AND date <= 2005-07-01", QUERY_ACCESS_SORTED },
+        { "name contains livia",                      QUERY_ACCESS_TRIGRAM },
+    };
+    for (size_t i = 0; i < sizeof(s_paths) / sizeof(s_paths[0]); i++) {
+        CHECK(Query_Parse(&query, s_paths[i].text));
+        Query_Plan(&query, &store, ix);
+        if (!CHECK(query.driver >= 0 && query.predicates[query.driver].path == s_paths[i].path)) {
+            fprintf(stderr, "  %s\n", s_paths[i].text);
+        }
+    }
+
+    free(rows);
+    Test_FreeIndexes(&t);
+    Store_Free(&store);
+}
+
+// ------------------------------------------
+//                    Sorting
+// ------------------------------------------
+
+// ------------------------------------------
+// Reference collation, written from the documented rules: text ignores
+// ASCII case; phones go by PhoneKey and dates by DateKey, those without a
+// key first, by text
+// ------------------------------------------
+static int Test_CompareText(const char *a, const char *b) {
+    const unsigned char *x = (const unsigned char *)a, *y = (const unsigned char *)b;
+    for (;; x++, y++) {
+        int cx = (*x >= 'A' && *x <= 'Z') ? *x + 32 : *x;
+        int cy = (*y >= 'A' && *y <= 'Z') ? *y + 32 : *y;
+        if (cx != cy || cx == 0) return cx - cy;
+    }
+}
+
+static int Test_CompareColumn(const ContactStore *store, SortColumn column, int a, int b) {
+    if (column == SORT_BY_PHONE) {
+        uint64_t x = PhoneKey_Parse(Store_GetPhone(store, a)), y = PhoneKey_Parse(Store_GetPhone(store, b));
+        if (x != y) return x < y ? -1 : 1;
+        return x != PHONE_KEY_NONE ? 0 : Test_CompareText(Store_GetPhone(store, a), Store_GetPhone(store, b));
+    }
+    if (column == SORT_BY_DATE) {
+        uint32_t x = DateKey_Parse(Store_GetDate(store, a)), y = DateKey_Parse(Store_GetDate(store, b));
+        if (x != y) return x < y ? -1 : 1;
+        return x != DATE_KEY_NONE ? 0 : Test_CompareText(Store_GetDate(store, a), Store_GetDate(store, b));
+    }
+    return Test_CompareText(column == SORT_BY_NAME ? Store_GetName(store, a) : Store_GetEmail(store, a),
+                            column == SORT_BY_NAME ? Store_GetName(store, b) : Store_GetEmail(store, b));
+}
+
+// A row and its place in the input, the tie-breaker
+typedef struct {
+    int row;
+    int place;
+} TestSortItem;
+
+static const ContactStore *s_testSortStore;
+static const SortSpec *s_testSortSpec;
+
+static int Test_CompareItems(const void *a, const void *b) {
+    const TestSortItem *x = (const TestSortItem*)a, *y = (const TestSortItem*)b;
+    for (int k = 0; k < s_testSortSpec->count; k++) {
+        int cmp = Test_CompareColumn(s_testSortStore, s_testSortSpec->keys[k].column, x->row, y->row);
+        if (cmp != 0) return s_testSortSpec->keys[k].descending ? -cmp : cmp;
+    }
+    return x->place - y->place;
+}
+
+// ------------------------------------------
+// Sort 'rows' by 'spec' the slow way, stable
+// ------------------------------------------
+static void Test_ReferenceSort(const ContactStore *store, const SortSpec *spec, int *rows, int count) {
+    TestSortItem *items = (TestSortItem*)malloc((size_t)(count + 1) * sizeof(TestSortItem));
+    if (!CHECK(items != NULL)) return;
+    for (int i = 0; i < count; i++) {
+        items[i].row = rows[i];
+        items[i].place = i;
+    }
+    s_testSortStore = store;
+    s_testSortSpec = spec;
+    qsort(items, (size_t)count, sizeof(TestSortItem), Test_CompareItems);
+    for (int i = 0; i < count; i++) rows[i] = items[i].row;
+    free(items);
+}
+
+// ------------------------------------------
+// Does every order of 'index' match the reference order of the live rows?
+// ------------------------------------------
+static int Test_SameOrders(const SortIndex *index, const ContactStore *store) {
+    int *rows = (int*)malloc((size_t)(store->count + 1) * sizeof(int));
+    if (!rows) return 0;
+    int live = 0;
+    for (int row = 0; row < store->count; row++) {
+        if (!Store_IsDeleted(store, row)) rows[live++] = row;
+    }
+    int same = index->count == live;
+    for (int c = 0; same && c < SORT_COLUMN_COUNT; c++) {
+        SortSpec spec = { { { (SortColumn)c, 0 } }, 1 };
+        const int *order = SortIndex_Order(index, (SortColumn)c);
+        int *expected = (int*)malloc((size_t)(live + 1) * sizeof(int));
+        if (!order || !expected) {
+            free(expected);
+            same = 0;
+            break;
+        }
+        memcpy(expected, rows, (size_t)live * sizeof(int));
+        Test_ReferenceSort(store, &spec, expected, live);
+        same = memcmp(order, expected, (size_t)live * sizeof(int)) == 0;
+        if (!same) fprintf(stderr, "  column %d out of order\n", c);
+        free(expected);
+    }
+    free(rows);
+    return same;
+}
+
+// ------------------------------------------
+// A contact from small pools of values, so that many compare equal: case
+// variants, spellings of one number, dates that are not real
+// ------------------------------------------
+static void Test_SortContact(SynthRng *rng, char *name, char *phone, char *email, char *date) {
+    static const char *s_names[] = { "Ann Lee", "ann lee", "ANN LEE", "Ann", "Bob", "bob", "Zo\xC3\xAB", "\xC3\x89mile",
+                                     "", "a", "A b", "Ann Lee " };
+    static const char *s_phones[] = { "+44 20 1234", "0044-20-1234", "020 1234", "0201234", "12", "120", "n/a",
+                                      "N/A", "", "+1 2", "+12", "0012" };
+    static const char *s_emails[] = { "a@x.com", "A@X.COM", "b@y.org", "", "a@x.co", "a@x.com.my" };
+    static const char *s_dates[] = { "2024-02-29", "2023-02-29", "", "1999-12-31", "July 4", "july 4",
+                                     "0000-01-01", "9999-12-31", "2024-02-28" };
+    Synth_Contact(rng, name, phone, email, date);
+    if (Synth_Below(rng, 2)) strcpy(name, s_names[Synth_Below(rng, sizeof(s_names) / sizeof(s_names[0]))]);
+    if (Synth_Below(rng, 2)) strcpy(phone, s_phones[Synth_Below(rng, sizeof(s_phones) / sizeof(s_phones[0]))]);
+    if (Synth_Below(rng, 2)) strcpy(email, s_emails[Synth_Below(rng, sizeof(s_emails) / sizeof(s_emails[0]))]);
+    if (Synth_Below(rng, 2)) strcpy(date, s_dates[Synth_Below(rng, sizeof(s_dates) / sizeof(s_dates[0]))]);
+}
+
+static void Test_Sort(void) {
+    char name[CONTACT_NAME_SIZE], phone[CONTACT_PHONE_SIZE], email[CONTACT_EMAIL_SIZE], date[CONTACT_DATE_SIZE];
+    SynthRng rng;
+    Synth_Seed(&rng, 101);
+    ContactStore store;
+    Store_Init(&store);
+    for (int i = 0; i < 3000; i++) {
+        Test_SortContact(&rng, name, phone, email, date);
+        CHECK(Store_Add(&store, name, phone, email, date));
+    }
+
+    // Maintained orders follow random adds, updates, deletes and purges
+    SortIndex index;
+    SortIndex_Init(&index);
+    CHECK(SortIndex_Build(&index, &store) && Test_SameOrders(&index, &store));
+    for (int step = 0; step < 6000; step++) {
+        int row = (int)Synth_Below(&rng, (uint32_t)store.count);
+        Test_SortContact(&rng, name, phone, email, date);
+        switch (Synth_Below(&rng, 4)) {
+        case 0:
+            CHECK(Store_Add(&store, name, phone, email, date));
+            CHECK(SortIndex_Insert(&index, &store, store.count - 1));
+            break;
+        case 1:
+            if (Store_IsDeleted(&store, row)) break;
+            SortIndex_BeginUpdate(&index, &store, row);
+            CHECK(Store_Update(&store, row, name, phone, email, date));
+            SortIndex_EndUpdate(&index, &store, row);
+            break;
+        case 2:
+            if (Store_IsDeleted(&store, row)) break;
+            SortIndex_Remove(&index, &store, row);
+            CHECK(Store_Delete(&store, row));
+            break;
+        default:
+            // A batch of deletes, removed from the orders at once
+            for (int i = 0; i < 5; i++) {
+                row = (int)Synth_Below(&rng, (uint32_t)store.count);
+                if (!Store_IsDeleted(&store, row)) CHECK(Store_Delete(&store, row));
+            }
+            SortIndex_RemoveDeleted(&index, &store);
+            break;
+        }
+        if (step % 1500 == 1499) {
+            CHECK(Test_SameOrders(&index, &store));
+            int *remap = (int*)malloc((size_t)store.count * sizeof(int));
+            if (CHECK(remap && Store_Purge(&store, remap))) SortIndex_Purge(&index, remap);
+            free(remap);
+            CHECK(Test_SameOrders(&index, &store));
+        }
+    }
+    CHECK(!index.stale && Test_SameOrders(&index, &store));
+    SortIndex rebuilt;
+    SortIndex_Init(&rebuilt);
+    CHECK(SortIndex_Build(&rebuilt, &store) && rebuilt.count == index.count);
+    for (int c = 0; c < SORT_COLUMN_COUNT; c++) {
+        CHECK(memcmp(SortIndex_Order(&rebuilt, (SortColumn)c), SortIndex_Order(&index, (SortColumn)c),
+                     (size_t)index.count * sizeof(int)) == 0);
+    }
+    SortIndex_Free(&rebuilt);
+
+    // Arranging a subset puts it in the same order
+    int subset[500], expected[500], count = 0;
+    for (int row = 0; row < store.count && count < 500; row += 3) {
+        if (!Store_IsDeleted(&store, row)) subset[count++] = row;
+    }
+    for (int c = 0; c < SORT_COLUMN_COUNT; c++) {
+        SortSpec spec = { { { (SortColumn)c, 0 } }, 1 };
+        memcpy(expected, subset, (size_t)count * sizeof(int));
+        Test_ReferenceSort(&store, &spec, expected, count);
+        int arranged[500];
+        memcpy(arranged, subset, (size_t)count * sizeof(int));
+        SortIndex_Arrange(&index, &store, (SortColumn)c, arranged, count);
+        CHECK(memcmp(arranged, expected, (size_t)count * sizeof(int)) == 0);
+    }
+    SortIndex_Free(&index);
+    Store_Free(&store);
+
+    // The radix engine, on inputs large enough to be split across workers
+    Store_Init(&store);
+    for (int i = 0; i < 70000; i++) {
+        Test_SortContact(&rng, name, phone, email, date);
+        CHECK(Store_Add(&store, name, phone, email, date));
+    }
+    int *rows = (int*)malloc((size_t)store.count * sizeof(int));
+    int *reference = (int*)malloc((size_t)store.count * sizeof(int));
+    static const char *s_specs[] = {
+        "name", "name-", "phone", "phone-", "email", "date", "date-,name", "email,date-,phone",
+        "name-,phone,email-,date", "date+,phone-"
+    };
+    for (size_t s = 0; rows && reference && s < sizeof(s_specs) / sizeof(s_specs[0]); s++) {
+        SortSpec spec;
+        CHECK(ContactSort_ParseSpec(&spec, s_specs[s]));
+        // A shuffled input: ties must keep this order, not the store's
+        for (int i = 0; i < store.count; i++) rows[i] = i;
+        for (int i = store.count - 1; i > 0; i--) {
+            int j = (int)Synth_Below(&rng, (uint32_t)i + 1);
+            int swap = rows[i];
+            rows[i] = rows[j];
+            rows[j] = swap;
+        }
+        int n = s % 2 ? store.count : 1000;  // Small inputs take the single-threaded path
+        memcpy(reference, rows, (size_t)n * sizeof(int));
+        Test_ReferenceSort(&store, &spec, reference, n);
+        CHECK(ContactSort_Rows(&store, &spec, rows, n));
+        if (!CHECK(memcmp(rows, reference, (size_t)n * sizeof(int)) == 0)) fprintf(stderr, "  %s\n", s_specs[s]);
+    }
+    free(rows);
+    free(reference);
+
+    SortSpec spec;
+    CHECK(!ContactSort_ParseSpec(&spec, "") && !ContactSort_ParseSpec(&spec, "age") &&
+          !ContactSort_ParseSpec(&spec, "name,,phone") &&
+          !ContactSort_ParseSpec(&spec, "name,name,name,name,name,name,name,name,name"));
+    CHECK(ContactSort_ParseSpec(&spec, "date-,name+") && spec.count == 2 && spec.keys[0].column == SORT_BY_DATE &&
+          spec.keys[0].descending && spec.keys[1].column == SORT_BY_NAME && !spec.keys[1].descending);
+    Store_Free(&store);
+}
+
+// ------------------------------------------
+//                    Export
+// ------------------------------------------
+
+// ------------------------------------------
+// Export 'rows' of 'store' and read the file back into 'text'
+// ------------------------------------------
+static int Test_ExportText(const ContactStore *store, const int *rows, int count, ExportFormat format,
+                           char *text, size_t size) {
+    const char *path = "ContactTests_export.out";
+    int exported = -1;
+    text[0] = '\0';
+    if (!CHECK(Export_File(store, rows, count, path, format, &exported) == CONTACT_FILE_OK)) return -1;
+    FILE *f = fopen(path, "rb");
+    size_t len = f ? fread(text, 1, size - 1, f) : 0;
+    text[len] = '\0';
+    if (f) fclose(f);
+    remove(path);
+    return exported;
+}
+
+// ------------------------------------------
+// Is 'actual' equal to 'expected'? Shows where they differ if not.
+// ------------------------------------------
+static int Test_SameText(const char *actual, const char *expected) {
+    size_t i = 0;
+    while (actual[i] && actual[i] == expected[i]) i++;
+    if (actual[i] == expected[i]) return 1;
+    fprintf(stderr, "  differs at byte %zu: \"%.40s\"\n  expected \"%.40s\"\n", i, actual + i, expected + i);
+    return 0;
+}
+
+static void Test_Export(void) {
+    // 40 two-byte characters after "FN:x": octet 75 is inside one of them
+    char longName[CONTACT_NAME_SIZE] = "x";
+    for (int i = 0; i < 40; i++) strcat(longName, "\xC3\xA9");
+    ContactStore store;
+    Store_Init(&store);
+    CHECK(Store_Add(&store, "Ada Lovelace", "+44 20 7946 0958", "ada@example.com", "1815-12-10"));
+    CHECK(Store_Add(&store, "Smith, \"Jr\"", "", "a;b@example.com", ""));
+    CHECK(Store_Add(&store, "Multi\r\nLine", "1\\2", "x@y", ""));
+    // Escapes past the first 16 bytes, where the vector scan hands over
+    CHECK(Store_Add(&store, "A very long name with a comma, here\x01 and \"quote\" after sixteen\tbytes\x1f",
+                    "", "", ""));
+    CHECK(Store_Add(&store, longName, "", "", ""));
+    CHECK(Store_Add(&store, "Deleted", "", "", ""));
+    CHECK(Store_Delete(&store, 5));
+
+    static char text[8192], expected[8192];
+    CHECK(Test_ExportText(&store, NULL, 0, EXPORT_CSV, text, sizeof(text)) == 5);
+    snprintf(expected, sizeof(expected),
+             "Name,Phone,Email,Date\r\n"
+             "Ada Lovelace,+44 20 7946 0958,ada@example.com,1815-12-10\r\n"
+             "\"Smith, \"\"Jr\"\"\",,a;b@example.com,\r\n"
+             "\"Multi\r\nLine\",1\\2,x@y,\r\n"
+             "\"A very long name with a comma, here\x01 and \"\"quote\"\" after sixteen\tbytes\x1f\",,,\r\n"
+             "%s,,,\r\n", longName);
+    CHECK(Test_SameText(text, expected));
+
+    CHECK(Test_ExportText(&store, (int[]){ 3, 1, 2, 5 }, 4, EXPORT_JSONL, text, sizeof(text)) == 3);
+    snprintf(expected, sizeof(expected),
+             "{\"id\":%llu,\"name\":\"A very long name with a comma, here\\u0001 and \\\"quote\\\" after "
+             "sixteen\\tbytes\\u001f\",\"phone\":\"\",\"email\":\"\",\"date\":\"\"}\n"
+             "{\"id\":%llu,\"name\":\"Smith, \\\"Jr\\\"\",\"phone\":\"\",\"email\":\"a;b@example.com\",\"date\":\"\"}\n"
+             "{\"id\":%llu,\"name\":\"Multi\\r\\nLine\",\"phone\":\"1\\\\2\",\"email\":\"x@y\",\"date\":\"\"}\n",
+             (unsigned long long)Store_GetId(&store, 3), (unsigned long long)Store_GetId(&store, 1),
+             (unsigned long long)Store_GetId(&store, 2));
+    CHECK(Test_SameText(text, expected));
+
+    CHECK(Test_ExportText(&store, (int[]){ 0, 1, 2 }, 3, EXPORT_VCARD, text, sizeof(text)) == 3);
+    CHECK(Test_SameText(text,
+        "BEGIN:VCARD\r\nVERSION:3.0\r\nFN:Ada Lovelace\r\nN:Lovelace;Ada;;;\r\nTEL:+44 20 7946 0958\r\n"
+        "EMAIL:ada@example.com\r\nBDAY:1815-12-10\r\nEND:VCARD\r\n"
+        "BEGIN:VCARD\r\nVERSION:3.0\r\nFN:Smith\\, \"Jr\"\r\nN:\"Jr\";Smith\\,;;;\r\nEMAIL:a\\;b@example.com\r\n"
+        "END:VCARD\r\n"
+        "BEGIN:VCARD\r\nVERSION:3.0\r\nFN:Multi\\nLine\r\nN:Multi\\nLine;;;;\r\nTEL:1\\\\2\r\nEMAIL:x@y\r\n"
+        "END:VCARD\r\n"));
+
+    // Folded lines: at most 75 octets, cut between characters, and the
+    // same text once unfolded
+    CHECK(Test_ExportText(&store, (int[]){ 4 }, 1, EXPORT_VCARD, text, sizeof(text)) == 1);
+    char unfolded[8192];
+    size_t u = 0;
+    int lines = 0, folds = 0;
+    for (const char *line = text; *line; lines++) {
+        const char *end = strstr(line, "\r\n");
+        if (!CHECK(end != NULL)) break;
+        CHECK(end - line <= 75);
+        if (line[0] == ' ') {
+            folds++;
+            CHECK(((unsigned char)line[1] & 0xC0) != 0x80);
+            memcpy(unfolded + u, line + 1, (size_t)(end - line - 1));
+            u += (size_t)(end - line - 1);
+        } else {
+            if (u > 0) unfolded[u++] = '\n';
+            memcpy(unfolded + u, line, (size_t)(end - line));
+            u += (size_t)(end - line);
+        }
+        line = end + 2;
+    }
+    unfolded[u] = '\0';
+    CHECK(folds == 2);
+    // The first cut moves back from octet 75 to the start of its character
+    const char *fn = strstr(text, "\r\nFN:x");
+    CHECK(fn && fn[2 + 74] == '\r');
+    snprintf(expected, sizeof(expected), "BEGIN:VCARD\nVERSION:3.0\nFN:%s\nN:%s;;;;\nEND:VCARD", longName, longName);
+    CHECK(Test_SameText(unfolded, expected));
+
+    CHECK(Export_FormatFor("a.VCF", EXPORT_AUTO) == EXPORT_VCARD && Export_FormatFor("a.ndjson", EXPORT_AUTO) ==
+          EXPORT_JSONL && Export_FormatFor("a.txt", EXPORT_AUTO) == EXPORT_CSV &&
+          Export_FormatFor("a.vcf", EXPORT_CSV) == EXPORT_CSV);
+    Store_Free(&store);
+}
+
+// ------------------------------------------
+//                 Fuzzy search
+// ------------------------------------------
+
+// ------------------------------------------
+// Fewest edits between 'query' and a substring of 'text', ignoring ASCII
+// case: the textbook dynamic program the bit-parallel matchers must equal
+// ------------------------------------------
+static int Test_FuzzyDistance(const char *query, const char *text) {
+    int m = (int)strlen(query);
+    int column[FUZZY_MAX_QUERY + 1];
+    for (int i = 0; i <= m; i++) column[i] = i;
+    int best = m;
+    for (const unsigned char *t = (const unsigned char *)text; *t; t++) {
+        int diagonal = 0;  // A match may start at any character
+        column[0] = 0;
+        for (int i = 1; i <= m; i++) {
+            int q = (unsigned char)query[i - 1];
+            int same = q == *t || (q >= 'A' && q <= 'Z' && q + 32 == *t) || (q >= 'a' && q <= 'z' && q - 32 == *t);
+            int value = diagonal + !same;
+            if (column[i] + 1 < value) value = column[i] + 1;
+            if (column[i - 1] + 1 < value) value = column[i - 1] + 1;
+            diagonal = column[i];
+            column[i] = value;
+        }
+        if (column[m] < best) best = column[m];
+    }
+    return best;
+}
+
+// ------------------------------------------
+// Do the results of 'query' (with or without the trigram index) list
+// exactly the names within 'k' edits, best first, in store order within
+// a distance?
+// ------------------------------------------
+static int Test_FuzzyAgrees(const ContactStore *store, const TrigramIndex *index, const char *query, int k,
+                            int workers, int *results, int *distances) {
+    int count = FuzzySearch_Names(store, index, query, k, workers, results, distances);
+    if (k > (int)strlen(query) - 1) k = (int)strlen(query) - 1;
+    unsigned char *reference = (unsigned char*)malloc((size_t)store->count);
+    if (!reference) return 0;
+    for (int row = 0; row < store->count; row++) {
+        reference[row] = Store_IsDeleted(store, row)
+                       ? 0xFF : (unsigned char)Test_FuzzyDistance(query, Store_GetName(store, row));
+    }
+    int expected = 0, at = 0;
+    for (int d = 0; d <= k; d++) {
+        for (int row = 0; row < store->count; row++) {
+            if (reference[row] != d) continue;
+            expected++;
+            if (at < count && results[at] == row && distances[at] == d) at++;
+        }
+    }
+    free(reference);
+    if (count == expected && at == count) return 1;
+    fprintf(stderr, "  \"%s\" k=%d: %d matches, expected %d, %d in place\n", query, k, count, expected, at);
+    return 0;
+}
+
+static void Test_Fuzzy(void) {
+    ContactStore store;
+    Store_Init(&store);
+    static const char *s_names[] = {
+        "John Smith", "JOHN SMITH", "Jon Smith", "Johnny Smithers", "Joan Smyth", "Christopher Robinson",
+        "Christoph Robinsen", "Elizabeth Thompson", "Ahmad Abdullah", "Zo\xC3\xAB Evans", ""
+    };
+    for (int r = 0; r < 20; r++) {
+        for (size_t i = 0; i < sizeof(s_names) / sizeof(s_names[0]); i++) {
+            CHECK(Store_Add(&store, s_names[i], "", "", ""));
+        }
+    }
+    CHECK(Synth_FillStore(&store, 40000, 111));  // Enough names for two workers
+    for (int row = 3; row < store.count; row += 11) CHECK(Store_Delete(&store, row));
+    TrigramIndex index;
+    TrigramIndex_Init(&index);
+    CHECK(TrigramIndex_Build(&index, &store));
+    int *results = (int*)malloc((size_t)store.count * sizeof(int));
+    int *distances = (int*)malloc((size_t)store.count * sizeof(int));
+    if (!CHECK(results && distances)) {
+        free(results);
+        free(distances);
+        TrigramIndex_Free(&index);
+        Store_Free(&store);
+        return;
+    }
+
+    // "Jonh" finds "John" with one edit
+    int count = FuzzySearch_Names(&store, &index, "Jonh", FuzzySearch_DefaultDistance(4), 1, results, distances);
+    CHECK(count > 0 && distances[0] <= 1);
+    int john = 0;
+    for (int i = 0; i < count; i++) john |= strcmp(Store_GetName(&store, results[i]), "John Smith") == 0;
+    CHECK(john);
+
+    // Queries of up to 16 characters take the four-names-at-once matcher,
+    // longer ones the one-name matcher: both must give the exact distance
+    static const struct { const char *query; int k; } s_queries[] = {
+        { "Jonh", 1 }, { "smiht", 2 }, { "jon", 8 }, { "Wiliams", 1 }, { "Oliver Tan", 2 },
+        { "Ahmad Abdulah", 3 }, { "Zo\xC3\xAB", 1 }, { "Elizabeth Thomson", 2 }, { "Christopher Robinsen", 2 },
+        { "Elizabeth Thompson-Hughes Jr", 8 }, { "qqqqqqqqqqqqqqqq", 8 }, { "qqqqqqqqqqqqqqqqq", 8 }
+    };
+    for (size_t i = 0; i < sizeof(s_queries) / sizeof(s_queries[0]); i++) {
+        CHECK(Test_FuzzyAgrees(&store, NULL, s_queries[i].query, s_queries[i].k, 1, results, distances));
+        CHECK(Test_FuzzyAgrees(&store, NULL, s_queries[i].query, s_queries[i].k, 4, results, distances));
+        CHECK(Test_FuzzyAgrees(&store, &index, s_queries[i].query, s_queries[i].k, 1, results, distances));
+    }
+
+    CHECK(FuzzySearch_Names(&store, NULL, "", 1, 1, results, NULL) == -1);
+    char tooLong[FUZZY_MAX_QUERY + 2];
+    memset(tooLong, 'a', sizeof(tooLong) - 1);
+    tooLong[sizeof(tooLong) - 1] = '\0';
+    CHECK(FuzzySearch_Names(&store, NULL, tooLong, 1, 1, results, NULL) == -1);
+    CHECK(FuzzySearch_DefaultDistance(3) == 0 && FuzzySearch_DefaultDistance(4) == 1 &&
+          FuzzySearch_DefaultDistance(8) == 2);
+
+    free(results);
+    free(distances);
+    TrigramIndex_Free(&index);
+    Store_Free(&store);
+}
+
+// ------------------------------------------
+//                 Autocomplete
+// ------------------------------------------
+
+// ------------------------------------------
+// Key of 'row' for 'kind', as documented: the name as stored, or the
+// email domain folded to lower case; "" when there is none
+// ------------------------------------------
+static void Test_CompleteKey(const ContactStore *store, int row, CompleteKind kind, char *key) {
+    key[0] = '\0';
+    if (kind == COMPLETE_NAME) {
+        strcpy(key, Store_GetName(store, row));
+        return;
+    }
+    const char *domain = Autocomplete_Domain(Store_GetEmail(store, row));
+    if (!domain) return;
+    size_t i = 0;
+    for (; domain[i]; i++) key[i] = (char)((domain[i] >= 'A' && domain[i] <= 'Z') ? domain[i] + 32 : domain[i]);
+    key[i] = '\0';
+}
+
+static int Test_StartsWithFolded(const char *text, const char *prefix) {
+    for (; *prefix; text++, prefix++) {
+        int a = (*text >= 'A' && *text <= 'Z') ? *text + 32 : *text;
+        int b = (*prefix >= 'A' && *prefix <= 'Z') ? *prefix + 32 : *prefix;
+        if (a != b) return 0;
+    }
+    return 1;
+}
+
+static int Test_CompareCounts(const void *a, const void *b) {
+    return *(const int*)b - *(const int*)a;
+}
+
+// ------------------------------------------
+// Are the completions of 'prefix' the 'max' most frequent matching keys,
+// each with the number of live contacts that have it?
+// ------------------------------------------
+static int Test_TopKeys(const Autocomplete *ac, const ContactStore *store, CompleteKind kind, const char *prefix,
+                        int max) {
+    Completion results[COMPLETE_MAX_RESULTS];
+    int found = Autocomplete_Lookup(ac, kind, prefix, results, max);
+    if (found < 0) return 0;
+
+    // Distinct matching keys and their counts, the slow way
+    static char keys[4096][CONTACT_NAME_SIZE];
+    static int counts[4096];
+    int keyCount = 0;
+    char key[CONTACT_EMAIL_SIZE];
+    for (int row = 0; row < store->count; row++) {
+        if (Store_IsDeleted(store, row)) continue;
+        Test_CompleteKey(store, row, kind, key);
+        if (!key[0] || !Test_StartsWithFolded(key, prefix)) continue;
+        int k = 0;
+        while (k < keyCount && strcmp(keys[k], key) != 0) k++;
+        if (k == keyCount) {
+            if (keyCount == 4096) return 0;
+            strcpy(keys[keyCount], key);
+            counts[keyCount++] = 0;
+        }
+        counts[k]++;
+    }
+
+    int ok = found == (keyCount < max ? keyCount : max);
+    for (int i = 0; ok && i < found; i++) {
+        int k = 0;
+        while (k < keyCount && strcmp(keys[k], results[i].text) != 0) k++;
+        ok = k < keyCount && counts[k] == results[i].count;
+        for (int j = 0; ok && j < i; j++) ok = strcmp(results[j].text, results[i].text) != 0;
+    }
+    qsort(counts, (size_t)keyCount, sizeof(int), Test_CompareCounts);
+    for (int i = 0; ok && i < found; i++) ok = results[i].count == counts[i];
+    if (!ok) fprintf(stderr, "  kind %d, prefix \"%s\": %d completions of %d keys\n", (int)kind, prefix, found, keyCount);
+    return ok;
+}
+
+static void Test_Autocomplete(void) {
+    static const char *s_names[] = { "Ann Lee", "ann lee", "ANN LEE", "Ann", "Annabel", "Bob", "bob", "Zo\xC3\xAB",
+                                     "\xC3\x89mile", "", "a", "Anna Lee" };
+    static const char *s_emails[] = { "a@gmail.com", "b@GMAIL.com", "c@gmail.co", "d@gmx.net", "", "e@x",
+                                      "f@mail.example.org", "g@Mail.Example.org", "no-at-sign" };
+    static const char *s_prefixes[] = { "", "a", "AN", "ann l", "b", "zz", "Zo\xC3\xAB", "\xC3\x89", "g", "GMAIL",
+                                        "mail.", "x" };
+    SynthRng rng;
+    Synth_Seed(&rng, 121);
+    ContactStore store;
+    Store_Init(&store);
+    char name[CONTACT_NAME_SIZE], phone[CONTACT_PHONE_SIZE], email[CONTACT_EMAIL_SIZE], date[CONTACT_DATE_SIZE];
+    for (int i = 0; i < 2000; i++) {
+        Synth_Contact(&rng, name, phone, email, date);
+        if (Synth_Below(&rng, 2)) strcpy(name, s_names[Synth_Below(&rng, sizeof(s_names) / sizeof(s_names[0]))]);
+        if (Synth_Below(&rng, 2)) strcpy(email, s_emails[Synth_Below(&rng, sizeof(s_emails) / sizeof(s_emails[0]))]);
+        CHECK(Store_Add(&store, name, phone, email, date));
+    }
+    Autocomplete ac;
+    Autocomplete_Init(&ac);
+    CHECK(Autocomplete_Build(&ac, &store));
+
+    // Counts follow adds, updates and deletes
+    int failures = 0;
+    for (int step = 0; step < 6000; step++) {
+        int row = (int)Synth_Below(&rng, (uint32_t)store.count);
+        Synth_Contact(&rng, name, phone, email, date);
+        if (Synth_Below(&rng, 4)) strcpy(name, s_names[Synth_Below(&rng, sizeof(s_names) / sizeof(s_names[0]))]);
+        if (Synth_Below(&rng, 2)) strcpy(email, s_emails[Synth_Below(&rng, sizeof(s_emails) / sizeof(s_emails[0]))]);
+        switch (Synth_Below(&rng, 3)) {
+        case 0:
+            CHECK(Store_Add(&store, name, phone, email, date));
+            CHECK(Autocomplete_Insert(&ac, &store, store.count - 1));
+            break;
+        case 1:
+            if (Store_IsDeleted(&store, row)) break;
+            Autocomplete_BeginUpdate(&ac, &store, row);
+            CHECK(Store_Update(&store, row, name, phone, email, date));
+            CHECK(Autocomplete_EndUpdate(&ac, &store, row));
+            break;
+        default:
+            if (Store_IsDeleted(&store, row)) break;
+            Autocomplete_Remove(&ac, &store, row);
+            CHECK(Store_Delete(&store, row));
+            break;
+        }
+        if (step % 1000 == 999) {
+            for (size_t p = 0; p < sizeof(s_prefixes) / sizeof(s_prefixes[0]); p++) {
+                failures += !Test_TopKeys(&ac, &store, COMPLETE_NAME, s_prefixes[p], 5);
+                failures += !Test_TopKeys(&ac, &store, COMPLETE_DOMAIN, s_prefixes[p], COMPLETE_MAX_RESULTS);
+            }
+        }
+    }
+    CHECK(failures == 0 && !ac.stale);
+
+    // Deleting every contact of a key drops it
+    for (int row = 0; row < store.count; row++) {
+        if (Store_IsDeleted(&store, row) || Test_StartsWithFolded(Store_GetName(&store, row), "ann") == 0) continue;
+        Autocomplete_Remove(&ac, &store, row);
+        CHECK(Store_Delete(&store, row));
+    }
+    Completion results[COMPLETE_MAX_RESULTS];
+    CHECK(Autocomplete_Lookup(&ac, COMPLETE_NAME, "ann", results, COMPLETE_MAX_RESULTS) == 0);
+    CHECK(Test_TopKeys(&ac, &store, COMPLETE_NAME, "", COMPLETE_MAX_RESULTS));
+    CHECK(Test_TopKeys(&ac, &store, COMPLETE_DOMAIN, "", COMPLETE_MAX_RESULTS));
+
+    Autocomplete_Invalidate(&ac);
+    CHECK(Autocomplete_Lookup(&ac, COMPLETE_NAME, "a", results, 5) == -1);
+    CHECK(Autocomplete_Build(&ac, &store) && Test_TopKeys(&ac, &store, COMPLETE_NAME, "", 8));
+    CHECK(Autocomplete_Domain("a@b@Corp.com") && strcmp(Autocomplete_Domain("a@b@Corp.com"), "Corp.com") == 0 &&
+          Autocomplete_Domain("no-at-sign") == NULL);
+    Autocomplete_Free(&ac);
+    Store_Free(&store);
+}
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} s_suites[] = {
+    { "jobs",       Test_Jobs },
+    { "view",       Test_View },
+    { "livesearch", Test_LiveSearch },
+    { "v2",         Test_V2 },
+    { "crypto",     Test_Crypto },
+    { "journal",    Test_Journal },
+    { "import",     Test_Import },
+    { "dedup",      Test_Dedup },
+    { "datekey",    Test_DateKey },
+    { "phone",      Test_Phone },
+    { "query",      Test_Query },
+    { "sort",       Test_Sort },
+    { "export",     Test_Export },
+    { "fuzzy",      Test_Fuzzy },
+    { "autocomplete", Test_Autocomplete },
+};
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: ContactTests <suite>\n");
+        return 2;
+    }
+    for (size_t i = 0; i < sizeof(s_suites) / sizeof(s_suites[0]); i++) {
+        if (strcmp(argv[1], s_suites[i].name) != 0) continue;
+        s_suites[i].run();
+        if (s_failures > 0) {
+            fprintf(stderr, "%s: %d checks failed\n", argv[1], s_failures);
+            return 1;
+        }
+        printf("%s: ok\n", argv[1]);
+        return 0;
+    }
+    fprintf(stderr, "Unknown suite: %s\n", argv[1]);
+    return 2;
+}
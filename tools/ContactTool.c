@@ -0,0 +1,698 @@
+// ------------------------------------------
+// ContactTool: command line access to the contact core
+//
+// Usage: ContactTool <command> [arguments]
+//   migrate <input> <output> [--no-compress] [--passphrase <text>] [--encrypt <text>]
+//           [--sort <columns>]
+//       Convert a contacts file (legacy RSA or v2) to the v2 binary format.
+//       --passphrase opens an encrypted input, --encrypt seals the output.
+//       --sort writes the contacts in the given order, e.g. "date-,name".
+//   import <input> <contacts> [--format csv|vcard] [--passphrase <text>] [--report <file>]
+//          [--no-compress]
+//       Append the contacts of a CSV or vCard export to a contacts file
+//       (created if missing), and report the rows rejected and rows/s.
+//       --passphrase opens and saves an encrypted contacts file.
+//   export <contacts> <output> [--format csv|vcard|jsonl] [--passphrase <text>]
+//          [--search <text>] [--fuzzy <text>] [--sort <columns>]
+//       Write the contacts (or those matching --search) as CSV, vCard or
+//       JSON Lines, in store order or --sort order. The format defaults to
+//       the output's extension. --search also takes a structured query
+//       ("email ends-with @corp.com AND date >= 2024-01-01"). --fuzzy keeps
+//       the contacts whose name matches the text despite a typo or two,
+//       closest first.
+//   phone <contacts> <number> [--passphrase <text>]
+//       List the contacts with that phone number, in any spelling.
+//   dedup <contacts> [--threshold <0..1>] [--apply] [--passphrase <text>] [--no-compress]
+//       List the groups of likely duplicates, best first. --apply merges
+//       each group into its most complete contact and saves the file,
+//       listing the phones, emails and dates that could not be kept.
+//   query <contacts> <query> [--explain] [--scan] [--limit <n>] [--passphrase <text>]
+//       List the contacts matching a structured query, through the most
+//       selective index (--scan: without indexes). --explain prints the plan.
+//   complete <contacts> <prefix> [--domain] [--passphrase <text>]
+//       List the most frequent names (or email domains) starting with the
+//       prefix, with their number of contacts.
+// ------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Autocomplete.h"
+#include "ContactStore.h"
+#include "ContactFile.h"
+#include "ContactSort.h"
+#include "Dedup.h"
+#include "Export.h"
+#include "FuzzySearch.h"
+#include "Import.h"
+#include "Journal.h"
+#include "PhoneIndex.h"
+#include "Platform.h"
+#include "Query.h"
+#include "Search.h"
+#include "TrigramIndex.h"
+
+// ------------------------------------------
+// Size of a file in bytes, or -1
+// ------------------------------------------
+static long long Tool_FileSize(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return -1;
+    long long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+// ------------------------------------------
+// Load a contacts file with the changes journaled since it was written
+// ------------------------------------------
+static ContactFileStatus Tool_Load(ContactStore *store, const char *filename, const char *passphrase) {
+    ContactFileStatus status = ContactFile_Load(store, filename, passphrase);
+    if (status != CONTACT_FILE_OK || !ContactFile_IsEncrypted(filename)) return status;
+
+    Journal journal;
+    Journal_Init(&journal);
+    status = Journal_Open(&journal, filename, passphrase, store);
+    Journal_Close(&journal);
+    if (status == CONTACT_FILE_NOT_FOUND) return CONTACT_FILE_OK;
+    if (status != CONTACT_FILE_OK) Store_Free(store);
+    return status;
+}
+
+// ------------------------------------------
+// Reorder the whole store by a column list. Returns 1 on success.
+// ------------------------------------------
+static int Tool_SortStore(ContactStore *store, const SortSpec *sort) {
+    int *rows = (int*)malloc((size_t)(store->count > 0 ? store->count : 1) * sizeof(int));
+    if (!rows) return 0;
+    for (int i = 0; i < store->count; i++) {
+        rows[i] = i;
+    }
+    int ok = ContactSort_Rows(store, sort, rows, store->count) && Store_Permute(store, rows);
+    free(rows);
+    return ok;
+}
+
+// ------------------------------------------
+// migrate: legacy (or v2) file -> v2 file
+// ------------------------------------------
+static int Tool_Migrate(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: ContactTool migrate <input> <output> [--no-compress]"
+                        " [--passphrase <text>] [--encrypt <text>] [--sort <columns>]\n");
+        return 2;
+    }
+    const char *input = argv[0];
+    const char *output = argv[1];
+    const char *passphrase = NULL;
+    const char *encryptWith = NULL;
+    int flags = CONTACT_V2_COMPRESSED;
+    SortSpec sort;
+    sort.count = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--no-compress") == 0) {
+            flags &= ~CONTACT_V2_COMPRESSED;
+        } else if (strcmp(argv[i], "--passphrase") == 0 && i + 1 < argc) {
+            passphrase = argv[++i];
+        } else if (strcmp(argv[i], "--encrypt") == 0 && i + 1 < argc) {
+            encryptWith = argv[++i];
+            flags |= CONTACT_V2_ENCRYPTED;
+        } else if (strcmp(argv[i], "--sort") == 0 && i + 1 < argc) {
+            if (!ContactSort_ParseSpec(&sort, argv[++i])) {
+                fprintf(stderr, "Bad sort columns: %s (use name, phone, email, date; '-' for descending)\n", argv[i]);
+                return 2;
+            }
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    ContactStore store;
+    ContactFileStatus status = Tool_Load(&store, input, passphrase);
+    if (status != CONTACT_FILE_OK) {
+        fprintf(stderr, "%s: %s\n", input, ContactFile_StatusMessage(status));
+        return 1;
+    }
+
+    if (sort.count > 0 && !Tool_SortStore(&store, &sort)) {
+        fprintf(stderr, "Out of memory while sorting contacts\n");
+        Store_Free(&store);
+        return 1;
+    }
+
+    status = ContactFile_SaveV2(&store, output, flags, encryptWith);
+    if (status != CONTACT_FILE_OK) {
+        fprintf(stderr, "%s: %s\n", output, ContactFile_StatusMessage(status));
+        Store_Free(&store);
+        return 1;
+    }
+
+    printf("Migrated %d contacts: %lld -> %lld bytes\n",
+           store.count, Tool_FileSize(input), Tool_FileSize(output));
+    Store_Free(&store);
+    return 0;
+}
+
+// ------------------------------------------
+// import: CSV or vCard export -> contacts file
+// ------------------------------------------
+static int Tool_Import(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: ContactTool import <input> <contacts> [--format csv|vcard]"
+                        " [--passphrase <text>] [--report <file>] [--no-compress]\n");
+        return 2;
+    }
+    const char *input = argv[0];
+    const char *output = argv[1];
+    const char *passphrase = NULL;
+    const char *report = NULL;
+    ImportFormat format = IMPORT_AUTO;
+    int flags = CONTACT_V2_COMPRESSED;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "csv") == 0) {
+                format = IMPORT_CSV;
+            } else if (strcmp(argv[i], "vcard") == 0) {
+                format = IMPORT_VCARD;
+            } else {
+                fprintf(stderr, "Unknown format: %s (use csv or vcard)\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--passphrase") == 0 && i + 1 < argc) {
+            passphrase = argv[++i];
+            flags |= CONTACT_V2_ENCRYPTED;
+        } else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+            report = argv[++i];
+        } else if (strcmp(argv[i], "--no-compress") == 0) {
+            flags &= ~CONTACT_V2_COMPRESSED;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    ContactStore store;
+    ContactFileStatus status = Tool_Load(&store, output, passphrase);
+    if (status != CONTACT_FILE_OK && status != CONTACT_FILE_NOT_FOUND) {
+        fprintf(stderr, "%s: %s\n", output, ContactFile_StatusMessage(status));
+        return 1;
+    }
+
+    ImportResult result;
+    status = Import_File(&store, input, format, &result);
+    if (status != CONTACT_FILE_OK) {
+        fprintf(stderr, "%s: %s\n", input, ContactFile_StatusMessage(status));
+        Import_FreeResult(&result);
+        Store_Free(&store);
+        return 1;
+    }
+    printf("Imported %d of %d %s (%d rejected) in %.1f ms, %.0f rows/s\n",
+           result.imported, result.rows, result.format == IMPORT_VCARD ? "vCards" : "CSV rows",
+           result.rejectedCount, result.ms, result.ms > 0 ? result.rows * 1000.0 / result.ms : 0.0);
+    if (report) {
+        if (!Import_WriteReport(&result, report)) fprintf(stderr, "%s: could not write the report\n", report);
+    } else {
+        for (int i = 0; i < result.rejectedCount && i < 10; i++) {
+            fprintf(stderr, "  line %lld: %s\n", result.rejected[i].line, Import_ReasonText(result.rejected[i].reason));
+        }
+        if (result.rejectedCount > 10) fprintf(stderr, "  ... (--report <file> lists them all)\n");
+    }
+    Import_FreeResult(&result);
+
+    status = ContactFile_SaveV2(&store, output, flags, passphrase);
+    if (status == CONTACT_FILE_OK && passphrase) {
+        // The old journal is folded into the new file; start an empty one
+        Journal journal;
+        Journal_Init(&journal);
+        status = Journal_Create(&journal, output, passphrase);
+        Journal_Close(&journal);
+    }
+    Store_Free(&store);
+    if (status != CONTACT_FILE_OK) {
+        fprintf(stderr, "%s: %s\n", output, ContactFile_StatusMessage(status));
+        return 1;
+    }
+    return 0;
+}
+
+// ------------------------------------------
+// export: contacts file -> CSV, vCard or JSON Lines
+// ------------------------------------------
+static int Tool_Export(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: ContactTool export <contacts> <output> [--format csv|vcard|jsonl]"
+                        " [--passphrase <text>] [--search <text>] [--fuzzy <text>] [--sort <columns>]\n");
+        return 2;
+    }
+    const char *input = argv[0];
+    const char *output = argv[1];
+    const char *passphrase = NULL;
+    const char *query = NULL;
+    const char *fuzzy = NULL;
+    ExportFormat format = EXPORT_AUTO;
+    SortSpec sort;
+    sort.count = 0;
+    Query structured;
+    int isStructured = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "csv") == 0) {
+                format = EXPORT_CSV;
+            } else if (strcmp(argv[i], "vcard") == 0) {
+                format = EXPORT_VCARD;
+            } else if (strcmp(argv[i], "jsonl") == 0) {
+                format = EXPORT_JSONL;
+            } else {
+                fprintf(stderr, "Unknown format: %s (use csv, vcard or jsonl)\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--passphrase") == 0 && i + 1 < argc) {
+            passphrase = argv[++i];
+        } else if (strcmp(argv[i], "--search") == 0 && i + 1 < argc) {
+            query = argv[++i];
+            isStructured = Query_IsStructured(query);
+            if (isStructured && !Query_Parse(&structured, query)) {
+                fprintf(stderr, "Bad query: %s\n", structured.error);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--fuzzy") == 0 && i + 1 < argc) {
+            fuzzy = argv[++i];
+            if (strlen(fuzzy) > FUZZY_MAX_QUERY) {
+                fprintf(stderr, "Fuzzy search text is longer than %d characters\n", FUZZY_MAX_QUERY);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--sort") == 0 && i + 1 < argc) {
+            if (!ContactSort_ParseSpec(&sort, argv[++i])) {
+                fprintf(stderr, "Bad sort columns: %s (use name, phone, email, date; '-' for descending)\n", argv[i]);
+                return 2;
+            }
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    ContactStore store;
+    ContactFileStatus status = Tool_Load(&store, input, passphrase);
+    if (status != CONTACT_FILE_OK) {
+        fprintf(stderr, "%s: %s\n", input, ContactFile_StatusMessage(status));
+        return 1;
+    }
+
+    // The subset and its order are a list of positions; the store is not copied
+    int *rows = (int*)malloc((size_t)(store.count > 0 ? store.count : 1) * sizeof(int));
+    if (!rows) {
+        fprintf(stderr, "Out of memory\n");
+        Store_Free(&store);
+        return 1;
+    }
+    int count = 0;
+    if (fuzzy && fuzzy[0] != '\0') {
+        TrigramIndex index;
+        TrigramIndex_Init(&index);
+        int indexed = TrigramIndex_Build(&index, &store);
+        count = FuzzySearch_Names(&store, indexed ? &index : NULL, fuzzy, FuzzySearch_DefaultDistance(strlen(fuzzy)),
+                                  Platform_CpuCount(), rows, NULL);
+        TrigramIndex_Free(&index);
+        if (count < 0) {
+            fprintf(stderr, "Out of memory\n");
+            free(rows);
+            Store_Free(&store);
+            return 1;
+        }
+    } else if (isStructured) {
+        // One query: a scan costs less than building an index for it
+        Query_Plan(&structured, &store, NULL);
+        count = Query_Run(&structured, &store, NULL, rows);
+    } else if (query && query[0] != '\0') {
+        TrigramIndex index;
+        TrigramIndex_Init(&index);
+        int indexed = TrigramIndex_Build(&index, &store);
+        count = Search_Contacts(&store, indexed ? &index : NULL, query, rows);
+        TrigramIndex_Free(&index);
+    } else {
+        for (int i = 0; i < store.count; i++) {
+            if (!Store_IsDeleted(&store, i)) rows[count++] = i;
+        }
+    }
+    if (sort.count > 0 && !ContactSort_Rows(&store, &sort, rows, count)) {
+        fprintf(stderr, "Out of memory while sorting contacts\n");
+        free(rows);
+        Store_Free(&store);
+        return 1;
+    }
+
+    int exported = 0;
+    double start = Platform_NowMs();
+    status = Export_File(&store, rows, count, output, format, &exported);
+    double ms = Platform_NowMs() - start;
+    free(rows);
+    Store_Free(&store);
+    if (status != CONTACT_FILE_OK) {
+        fprintf(stderr, "%s: %s\n", output, ContactFile_StatusMessage(status));
+        return 1;
+    }
+    long long bytes = Tool_FileSize(output);
+    printf("Exported %d contacts (%lld bytes) in %.1f ms, %.0f contacts/s\n", exported, bytes, ms,
+           ms > 0 ? exported * 1000.0 / ms : 0.0);
+    return 0;
+}
+
+// ------------------------------------------
+// phone: who owns a number
+// ------------------------------------------
+static int Tool_Phone(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: ContactTool phone <contacts> <number> [--passphrase <text>]\n");
+        return 2;
+    }
+    const char *input = argv[0];
+    const char *number = argv[1];
+    const char *passphrase = NULL;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--passphrase") == 0 && i + 1 < argc) {
+            passphrase = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    uint64_t key = PhoneKey_Parse(number);
+    if (key == PHONE_KEY_NONE) {
+        fprintf(stderr, "Not a phone number: %s\n", number);
+        return 2;
+    }
+
+    ContactStore store;
+    ContactFileStatus status = Tool_Load(&store, input, passphrase);
+    if (status != CONTACT_FILE_OK) {
+        fprintf(stderr, "%s: %s\n", input, ContactFile_StatusMessage(status));
+        return 1;
+    }
+    PhoneIndex index;
+    PhoneIndex_Init(&index);
+    int *rows = (int*)malloc((size_t)(store.count > 0 ? store.count : 1) * sizeof(int));
+    if (!rows || !PhoneIndex_Build(&index, &store)) {
+        fprintf(stderr, "Out of memory\n");
+        free(rows);
+        PhoneIndex_Free(&index);
+        Store_Free(&store);
+        return 1;
+    }
+
+    char canonical[PHONE_KEY_MAX_DIGITS + 2];
+    PhoneKey_Format(key, canonical);
+    int found = PhoneIndex_Owners(&index, &store, number, rows, store.count);
+    printf("%s: %d contact%s\n", canonical, found, found == 1 ? "" : "s");
+    for (int i = 0; i < found; i++) {
+        printf("  %s\t%s\t%s\n", Store_GetName(&store, rows[i]), Store_GetPhone(&store, rows[i]),
+               Store_GetEmail(&store, rows[i]));
+    }
+    free(rows);
+    PhoneIndex_Free(&index);
+    Store_Free(&store);
+    return found > 0 ? 0 : 1;
+}
+
+// ------------------------------------------
+// dedup: groups of likely duplicates, optionally merged
+// ------------------------------------------
+static int Tool_Dedup(int argc, char **argv) {
+    if (argc < 1) {
+        fprintf(stderr, "Usage: ContactTool dedup <contacts> [--threshold <0..1>] [--apply]"
+                        " [--passphrase <text>] [--no-compress]\n");
+        return 2;
+    }
+    const char *input = argv[0];
+    const char *passphrase = NULL;
+    double threshold = DEDUP_DEFAULT_THRESHOLD;
+    int apply = 0;
+    int flags = CONTACT_V2_COMPRESSED;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            char *end;
+            threshold = strtod(argv[++i], &end);
+            if (*end != '\0' || threshold <= 0.0 || threshold > 1.0) {
+                fprintf(stderr, "Bad threshold: %s (use a number in (0, 1])\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--apply") == 0) {
+            apply = 1;
+        } else if (strcmp(argv[i], "--passphrase") == 0 && i + 1 < argc) {
+            passphrase = argv[++i];
+            flags |= CONTACT_V2_ENCRYPTED;
+        } else if (strcmp(argv[i], "--no-compress") == 0) {
+            flags &= ~CONTACT_V2_COMPRESSED;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    ContactStore store;
+    ContactFileStatus status = Tool_Load(&store, input, passphrase);
+    if (status != CONTACT_FILE_OK) {
+        fprintf(stderr, "%s: %s\n", input, ContactFile_StatusMessage(status));
+        return 1;
+    }
+    DedupResult result;
+    if (!Dedup_Find(&store, threshold, &result)) {
+        fprintf(stderr, "Out of memory\n");
+        Store_Free(&store);
+        return 1;
+    }
+    printf("%d groups (%d contacts) among %d contacts: %d blocks, %lld pairs scored in %.1f ms\n",
+           result.groupCount, result.groupStart[result.groupCount], Store_LiveCount(&store),
+           result.blocks, result.pairs, result.ms);
+    for (int g = 0; g < result.groupCount && g < 20; g++) {
+        printf("%.2f\n", result.groupScore[g]);
+        for (int m = result.groupStart[g]; m < result.groupStart[g + 1]; m++) {
+            int row = result.members[m];
+            printf("  %s %s\t%s\t%s\t%s\n", m == result.groupStart[g] ? "keep " : "merge",
+                   Store_GetName(&store, row), Store_GetPhone(&store, row), Store_GetEmail(&store, row),
+                   Store_GetDate(&store, row));
+        }
+    }
+    if (result.groupCount > 20) printf("... and %d more groups\n", result.groupCount - 20);
+
+    if (apply && result.groupCount > 0) {
+        // Values that differ from the survivor's do not survive the merge: list them
+        int lost = Dedup_Dropped(&store, &result, NULL, 0, NULL, 0);
+        DedupDropped *dropped = (DedupDropped*)malloc((size_t)(lost > 0 ? lost : 1) * sizeof(DedupDropped));
+        if (!dropped) {
+            fprintf(stderr, "Out of memory\n");
+            Dedup_FreeResult(&result);
+            Store_Free(&store);
+            return 1;
+        }
+        lost = Dedup_Dropped(&store, &result, NULL, 0, dropped, lost);
+        for (int i = 0; i < lost; i++) {
+            static const char *s_fields[CONTACT_FIELD_COUNT] = { "name", "phone", "email", "date" };
+            printf("Not kept: %s %s of \"%s\" (merged into \"%s\")\n", s_fields[dropped[i].field],
+                   dropped[i].value, Store_GetName(&store, dropped[i].row),
+                   Store_GetName(&store, result.members[result.groupStart[dropped[i].group]]));
+        }
+        free(dropped);
+        int merged = Dedup_Merge(&store, &result, NULL, 0);
+        printf("Merged away %d contacts (%d differing values not kept)\n", merged, lost);
+        status = ContactFile_SaveV2(&store, input, flags, passphrase);
+        if (status == CONTACT_FILE_OK && passphrase) {
+            // The old journal is folded into the new file; start an empty one
+            Journal journal;
+            Journal_Init(&journal);
+            status = Journal_Create(&journal, input, passphrase);
+            Journal_Close(&journal);
+        }
+    }
+    Dedup_FreeResult(&result);
+    Store_Free(&store);
+    if (status != CONTACT_FILE_OK) {
+        fprintf(stderr, "%s: %s\n", input, ContactFile_StatusMessage(status));
+        return 1;
+    }
+    return 0;
+}
+
+// ------------------------------------------
+// complete: most frequent names or domains for a prefix
+// ------------------------------------------
+static int Tool_Complete(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: ContactTool complete <contacts> <prefix> [--domain] [--passphrase <text>]\n");
+        return 2;
+    }
+    const char *input = argv[0];
+    const char *prefix = argv[1];
+    const char *passphrase = NULL;
+    CompleteKind kind = COMPLETE_NAME;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--domain") == 0) {
+            kind = COMPLETE_DOMAIN;
+        } else if (strcmp(argv[i], "--passphrase") == 0 && i + 1 < argc) {
+            passphrase = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    ContactStore store;
+    ContactFileStatus status = Tool_Load(&store, input, passphrase);
+    if (status != CONTACT_FILE_OK) {
+        fprintf(stderr, "%s: %s\n", input, ContactFile_StatusMessage(status));
+        return 1;
+    }
+    Autocomplete complete;
+    Autocomplete_Init(&complete);
+    double t0 = Platform_NowMs();
+    if (!Autocomplete_Build(&complete, &store)) {
+        fprintf(stderr, "Out of memory\n");
+        Autocomplete_Free(&complete);
+        Store_Free(&store);
+        return 1;
+    }
+    double buildMs = Platform_NowMs() - t0;
+
+    Completion found[COMPLETE_MAX_RESULTS];
+    t0 = Platform_NowMs();
+    int count = Autocomplete_Lookup(&complete, kind, prefix, found, COMPLETE_MAX_RESULTS);
+    double lookupMs = Platform_NowMs() - t0;
+    printf("%u keys in %zu bytes, built in %.1f ms; %d completions in %.3f ms\n",
+           complete.tries[kind].keys, Autocomplete_MemoryBytes(&complete), buildMs, count, lookupMs);
+    for (int i = 0; i < count; i++) {
+        printf("  %s\t%d\n", found[i].text, found[i].count);
+    }
+    Autocomplete_Free(&complete);
+    Store_Free(&store);
+    return count > 0 ? 0 : 1;
+}
+
+// ------------------------------------------
+// query: structured query, optionally explained
+// ------------------------------------------
+static int Tool_Query(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: ContactTool query <contacts> <query> [--explain] [--scan] [--limit <n>]"
+                        " [--passphrase <text>]\n");
+        return 2;
+    }
+    const char *input = argv[0];
+    const char *passphrase = NULL;
+    int explain = 0, scan = 0, limit = 20;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--explain") == 0) {
+            explain = 1;
+        } else if (strcmp(argv[i], "--scan") == 0) {
+            scan = 1;
+        } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+            limit = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--passphrase") == 0 && i + 1 < argc) {
+            passphrase = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    Query query;
+    if (!Query_Parse(&query, argv[1])) {
+        fprintf(stderr, "Bad query: %s\n", query.error);
+        return 2;
+    }
+
+    ContactStore store;
+    ContactFileStatus status = Tool_Load(&store, input, passphrase);
+    if (status != CONTACT_FILE_OK) {
+        fprintf(stderr, "%s: %s\n", input, ContactFile_StatusMessage(status));
+        return 1;
+    }
+    TrigramIndex trigrams;
+    PhoneIndex phones;
+    SortIndex sorted;
+    TrigramIndex_Init(&trigrams);
+    PhoneIndex_Init(&phones);
+    SortIndex_Init(&sorted);
+    QueryIndexes indexes = { &trigrams, &phones, &sorted };
+    if (!scan) {
+        double t0 = Platform_NowMs();
+        TrigramIndex_Build(&trigrams, &store);
+        PhoneIndex_Build(&phones, &store);
+        SortIndex_Build(&sorted, &store);
+        printf("Indexed %d contacts in %.1f ms\n", Store_LiveCount(&store), Platform_NowMs() - t0);
+    }
+
+    int *rows = (int*)malloc((size_t)(store.count > 0 ? store.count : 1) * sizeof(int));
+    double t0 = Platform_NowMs();
+    Query_Plan(&query, &store, scan ? NULL : &indexes);
+    int count = rows ? Query_Run(&query, &store, scan ? NULL : &indexes, rows) : -1;
+    double ms = Platform_NowMs() - t0;
+    if (explain) {
+        char plan[2048];
+        Query_Explain(&query, plan, sizeof(plan));
+        fputs(plan, stdout);
+    }
+    if (count < 0) {
+        fprintf(stderr, "Out of memory\n");
+    } else {
+        printf("%d contact%s in %.3f ms\n", count, count == 1 ? "" : "s", ms);
+        for (int i = 0; i < count && i < limit; i++) {
+            printf("  %s\t%s\t%s\t%s\n", Store_GetName(&store, rows[i]), Store_GetPhone(&store, rows[i]),
+                   Store_GetEmail(&store, rows[i]), Store_GetDate(&store, rows[i]));
+        }
+        if (count > limit) printf("  ... and %d more\n", count - limit);
+    }
+    free(rows);
+    SortIndex_Free(&sorted);
+    PhoneIndex_Free(&phones);
+    TrigramIndex_Free(&trigrams);
+    Store_Free(&store);
+    return count > 0 ? 0 : 1;
+}
+
+static void Tool_Usage(void) {
+    fprintf(stderr,
+            "Usage: ContactTool <command> [arguments]\n"
+            "  migrate <input> <output> [--no-compress] [--passphrase <text>] [--encrypt <text>]\n"
+            "          [--sort <columns>]\n"
+            "  import <input> <contacts> [--format csv|vcard] [--passphrase <text>] [--report <file>]\n"
+            "          [--no-compress]\n"
+            "  export <contacts> <output> [--format csv|vcard|jsonl] [--passphrase <text>]\n"
+            "          [--search <text>] [--fuzzy <text>] [--sort <columns>]\n"
+            "  phone <contacts> <number> [--passphrase <text>]\n"
+            "  dedup <contacts> [--threshold <0..1>] [--apply] [--passphrase <text>] [--no-compress]\n"
+            "  query <contacts> <query> [--explain] [--scan] [--limit <n>] [--passphrase <text>]\n"
+            "  complete <contacts> <prefix> [--domain] [--passphrase <text>]\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        Tool_Usage();
+        return 2;
+    }
+    if (strcmp(argv[1], "migrate") == 0) {
+        return Tool_Migrate(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "import") == 0) {
+        return Tool_Import(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "export") == 0) {
+        return Tool_Export(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "phone") == 0) {
+        return Tool_Phone(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "dedup") == 0) {
+        return Tool_Dedup(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "query") == 0) {
+        return Tool_Query(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "complete") == 0) {
+        return Tool_Complete(argc - 2, argv + 2);
+    }
+    Tool_Usage();
+    return 2;
+}